@@ -24,7 +24,28 @@
 
 #include "idlib/process/configure.h"
 #include "idlib/process/status.h"
+#include "idlib/process/allocator.h"
 #include "idlib/process/mutex.h"
+#include "idlib/process/seqlock.h"
+#include "idlib/process/condition.h"
+#include "idlib/process/once.h"
+#include "idlib/process/semaphore.h"
+#include "idlib/process/latch.h"
+#include "idlib/process/barrier.h"
+#include "idlib/process/combining_lock.h"
+#include "idlib/process/lock_table.h"
+#include "idlib/process/event.h"
+#include "idlib/process/shared_registry.h"
+#include "idlib/process/intern.h"
+#include "idlib/process/watch.h"
+#include "idlib/process/clock.h"
+#include "idlib/process/timer.h"
+#include "idlib/process/future.h"
+#include "idlib/process/fiber.h"
+#include "idlib/process/topology.h"
+#include "idlib/process/tls.h"
+#include "idlib/process/metrics.h"
+#include "idlib/process/trace.h"
 
 #if IDLIB_OPERATING_SYSTEM_LINUX == IDLIB_OPERATING_SYSTEM || IDLIB_OPERATING_SYSTEM_CYGWIN == IDLIB_OPERATING_SYSTEM
 
@@ -55,8 +76,12 @@ idlib_process_acquire
 /**
  * @since 1.0
  * Relinquish a reference to the process singleton.
- * @param process A pointer to an idlib_process value.
+ * @param process A pointer to the idlib_process value as obtained by idlib_process_acquire.
  * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * #IDLIB_OPERATION_INVALID if <code>process</code> is not the singleton.
+ * @failure The reference was not relinquished.
+ * If the failure is #IDLIB_LOCK_FAILED (#IDLIB_LOCKED under Windows), the timer service of the singleton may have been stopped.
+ * The singleton remains valid and the timer service is restarted on demand.
  */
 idlib_status
 idlib_process_relinquish
@@ -88,6 +113,92 @@ idlib_add_global
   );
 
 
+/**
+ * @since 1.0
+ * @brief The type of a destructor of the value of a global.
+ * @param v The value.
+ */
+typedef void (idlib_global_destructor)(void* v);
+
+/**
+ * @since 1.0
+ * @brief The opaque type of a reference to a global.
+ */
+typedef struct idlib_global_ref idlib_global_ref;
+
+/**
+ * @since 1.0
+ * Add an entry for the specified key and the specified value.
+ * The value is destroyed by the specified destructor when the entry was removed and the last reference to it was released.
+ * @param p A pointer to a sequence of <code>n</code> Bytes.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param v The value.
+ * @param destructor A pointer to the destructor of the value or a null pointer.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, or `value` is null
+ * - IDLIB_EXISTS if an entry for the key (`p`, `n`) exists
+ * @remarks
+ * This function is mt-safe.
+ * The value is also destroyed when the process singleton is destroyed and no reference to it is held.
+ */
+idlib_status
+idlib_add_global_with_destructor
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    void* v,
+    idlib_global_destructor* destructor
+  );
+
+/**
+ * @since 1.0
+ * Get the value of the entry of the specified key and acquire a reference to it.
+ * The value is not destroyed before the reference is released even if the entry is removed.
+ * @param p A pointer to a sequence of <code>n</code> Bytes.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param ref [out] A pointer to a `idlib_global_ref*` variable.
+ * @param v [out] A pointer to a `void*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, `ref`, or `v` is null
+ * - IDLIB_NOT_EXISTS if no entry for the key (`p`, `n`) was found
+ * - IDLIB_OVERFLOW if the number of references is not representable
+ * @success `*ref` was assigned the reference and `*v` was assigned the value.
+ * @remarks
+ * This function is mt-safe.
+ * Globals frozen by idlib_process_freeze_globals are found without acquiring a lock, hence readers of them never wait for writers.
+ * Other globals are found while the registry is locked for reading, hence readers of them wait while a global is added or removed.
+ * Writers hold the lock only to link or unlink an entry. Destructors of removed values run after the lock was released.
+ */
+idlib_status
+idlib_get_global_ref
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_ref** ref,
+    void** v
+  );
+
+/**
+ * @since 1.0
+ * Release a reference to a global.
+ * If the entry was removed and this was the last reference, then the value is destroyed.
+ * @param ref The reference.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `ref` is null
+ * @remarks
+ * This function is mt-safe and does not block.
+ */
+idlib_status
+idlib_global_ref_release
+  (
+    idlib_global_ref* ref
+  );
+
 /**
  * @since 1.0
  * Get a pointer to the value of the entry of the specified key.
@@ -119,6 +230,7 @@ idlib_get_global
  * In particular, this function returns
  * - IDLIB_ARGUMENT_INVALID if `process` or `p` is null
  * - IDLIB_NOT_EXISTS if no global is registered for the key `p` and `n` 
+ * - IDLIB_OPERATION_INVALID if the global was frozen by idlib_process_freeze_globals
  */
 idlib_status
 idlib_remove_global
@@ -128,4 +240,173 @@ idlib_remove_global
     size_t n
   );
 
+/**
+ * @since 1.0
+ * Remove the globals whose keys start with the specified prefix.
+ * The globals are found by a prefix index of the keys, hence this function takes time proportional to the number of these globals
+ * and not to the number of all globals.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to a sequence of <code>n</code> Bytes, the prefix.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>. If zero, all globals are removed.
+ * @param number_of_removed [out] A pointer to a `size_t` variable or a null pointer.
+ * @return #IDLIB_SUCCESS on success. A non-zero value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `p` is null
+ * - IDLIB_OPERATION_INVALID if the key of a global frozen by idlib_process_freeze_globals starts with the prefix. No global was removed.
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed. No global was removed.
+ * @success If `number_of_removed` is not null, `*number_of_removed` was assigned the number of removed globals.
+ * @remarks
+ * This function is mt-safe.
+ * The globals of files mapped by idlib_globals_load_mapped are neither indexed nor removed.
+ */
+idlib_status
+idlib_remove_globals_with_prefix
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    size_t* number_of_removed
+  );
+
+/**
+ * @since 1.0
+ * @brief The type of a function visiting a global for idlib_globals_foreach_prefix.
+ * @param context The context passed to idlib_globals_foreach_prefix.
+ * @param p A pointer to the key.
+ * @param n The size of the key.
+ * @param v The value.
+ * @return #IDLIB_SUCCESS to continue. Any other value aborts idlib_globals_foreach_prefix.
+ */
+typedef idlib_status (idlib_global_visitor)(void* context, void const* p, size_t n, void* v);
+
+/**
+ * @since 1.0
+ * Visit the globals whose keys start with the specified prefix in the lexicographic order of their keys.
+ * The globals are found by a prefix index of the keys, hence this function takes time proportional to the number of these globals
+ * and not to the number of all globals.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to a sequence of <code>n</code> Bytes, the prefix.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>. If zero, all globals are visited.
+ * @param visitor A pointer to the visitor.
+ * @param context A pointer passed to the visitor.
+ * @return #IDLIB_SUCCESS on success. A non-zero value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, or `visitor` is null
+ * - the value returned by the visitor if it is not IDLIB_SUCCESS
+ * @remarks
+ * This function is mt-safe.
+ * The visitor is invoked while the registry is locked for reading and must not add or remove globals.
+ * The globals of files mapped by idlib_globals_load_mapped are not visited.
+ */
+idlib_status
+idlib_globals_foreach_prefix
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_visitor* visitor,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * Freeze the globals.
+ * The globals are rebuilt into a minimal perfect hash table with their keys packed contiguously.
+ * idlib_get_global looks up a frozen global with one probe and one comparison and without acquiring a lock.
+ * Globals added after this call are stored in a mutable overlay which is consulted second.
+ * Calling this function again merges the overlay into a new frozen table.
+ * @param process A pointer to the process singleton.
+ * @return #IDLIB_SUCCESS on success. A non-zero value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` is null
+ * - IDLIB_TOO_BIG if there are more than `UINT32_MAX` globals
+ * - IDLIB_NOT_REPRESENTABLE if the hash values of two keys collide
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * The globals are not modified on failure.
+ * @remarks
+ * This function is mt-safe.
+ * A frozen global can not be removed: idlib_remove_global fails with IDLIB_OPERATION_INVALID.
+ * The memory of a superseded frozen table is reclaimed when the process singleton is destroyed.
+ */
+idlib_status
+idlib_process_freeze_globals
+  (
+    idlib_process* process
+  );
+
+/**
+ * @since 1.0
+ * @brief The type of a function serializing the value of a global for idlib_globals_save.
+ * @param context The context passed to idlib_globals_save.
+ * @param p A pointer to the key.
+ * @param n The size of the key.
+ * @param v The value.
+ * @param blob [out] A pointer to a `void const*` variable which is assigned a pointer to the serialized value.
+ * The serialized value must remain valid until idlib_globals_save returns.
+ * @param m [out] A pointer to a `size_t` variable which is assigned the size of the serialized value.
+ * @return #IDLIB_SUCCESS if the value was serialized, #IDLIB_NOT_EXISTS if the global shall not be saved.
+ * Any other value aborts idlib_globals_save.
+ */
+typedef idlib_status (idlib_global_serializer)(void* context, void const* p, size_t n, void* v, void const** blob, size_t* m);
+
+/**
+ * @since 1.0
+ * Save the globals to a file which can be mapped by idlib_globals_load_mapped.
+ * The file contains the keys, the values serialized by the specified serializer, and a minimal perfect hash table of the keys.
+ * Globals loaded by idlib_globals_load_mapped are saved without invoking the serializer.
+ * @param process A pointer to the process singleton.
+ * @param path The path of the file.
+ * @param serializer A pointer to the serializer.
+ * @param context A pointer passed to the serializer.
+ * @return #IDLIB_SUCCESS on success. A non-zero value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `path`, or `serializer` is null or the serializer returned a null blob of non-zero size
+ * - IDLIB_ENVIRONMENT_FAILED if the file could not be written
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_NOT_REPRESENTABLE if the hash values of two keys collide
+ * - IDLIB_OVERFLOW if the number of references to a global is not representable
+ * - the value returned by the serializer if it is neither IDLIB_SUCCESS nor IDLIB_NOT_EXISTS
+ * @remarks
+ * This function is mt-safe.
+ * The globals are collected while the registry is locked for reading and the serializer is invoked after the lock was released.
+ * Hence the serializer may get, add, and remove globals. The file contains the globals which existed when they were collected.
+ */
+idlib_status
+idlib_globals_save
+  (
+    idlib_process* process,
+    char const* path,
+    idlib_global_serializer* serializer,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * Map a file written by idlib_globals_save read-only and use it as a lookup table.
+ * No entries are allocated: idlib_get_global looks up the keys of the file in the mapping
+ * and returns pointers to the serialized values in the mapping which must not be modified.
+ * @param process A pointer to the process singleton.
+ * @param path The path of the file.
+ * @return #IDLIB_SUCCESS on success. A non-zero value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `path` is null
+ * - IDLIB_ENVIRONMENT_FAILED if the file could not be opened or mapped
+ * - IDLIB_NOT_REPRESENTABLE if the file is not a file of this version written on a machine of the same byte order or it is corrupted
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_EXISTS if a key of the file is the key of an existing global (including the globals of files mapped before)
+ * @remarks
+ * This function is mt-safe.
+ * The keys of the file are compared with the keys of the existing globals while the registry is locked for writing.
+ * The values of the file are not read when it is loaded.
+ * The globals of the file are consulted after frozen globals and before other globals.
+ * They can not be removed (idlib_remove_global fails with IDLIB_OPERATION_INVALID) and are not reference counted (idlib_get_global_ref fails with IDLIB_OPERATION_INVALID).
+ * The file is unmapped when the process singleton is destroyed.
+ */
+idlib_status
+idlib_globals_load_mapped
+  (
+    idlib_process* process,
+    char const* path
+  );
+
 #endif // IDLIB_PROCESS_H_INCLUDED
@@ -0,0 +1,134 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_ALLOCATOR_H_INCLUDED)
+#define IDLIB_PROCESS_ALLOCATOR_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+// uint64_t
+#include <stdint.h>
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief The size, in Bytes, of the largest allocation served from the size classes of the allocator.
+ * Larger allocations are forwarded to malloc.
+ */
+#define IDLIB_ALLOCATOR_MAXIMUM_SIZE (1024)
+
+/**
+ * @since 1.0
+ * @brief The statistics of the allocator of the process singleton.
+ */
+typedef struct idlib_allocator_statistics {
+  // The number of allocations.
+  uint64_t allocations;
+  // The number of deallocations.
+  uint64_t deallocations;
+  // The number of Bytes of the allocations which were not deallocated.
+  // Allocations served from the size classes are accounted with the size of their class.
+  uint64_t bytes_in_use;
+  // The number of allocations larger than IDLIB_ALLOCATOR_MAXIMUM_SIZE.
+  uint64_t large_allocations;
+  // The number of slabs from which the blocks of the size classes are carved.
+  uint64_t slabs;
+  // The number of Bytes of the slabs.
+  uint64_t slab_bytes;
+  // The number of batches of blocks moved between the thread caches and the depot.
+  uint64_t batch_transfers;
+  // The number of thread caches.
+  uint64_t caches;
+} idlib_allocator_statistics;
+
+/**
+ * @since 1.0
+ * @brief Allocate a block of memory from the allocator of the process singleton.
+ * The allocator serves allocations of at most IDLIB_ALLOCATOR_MAXIMUM_SIZE Bytes from size classes.
+ * Each thread caches free blocks of each size class and exchanges them with a shared depot in batches.
+ * @param process A pointer to the process singleton.
+ * @param n The size, in Bytes, of the block. Must not be zero.
+ * @param p [out] A pointer to a `void*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `p` is null or `n` is zero
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @success `*p` was assigned a pointer to the block. The block is aligned like a block returned by malloc.
+ * @remarks
+ * This function is mt-safe.
+ * The block must be deallocated by idlib_allocator_deallocate with the same size.
+ * The block remains valid after the last reference to the process singleton was relinquished.
+ */
+idlib_status
+idlib_allocator_allocate
+  (
+    idlib_process* process,
+    size_t n,
+    void** p
+  );
+
+/**
+ * @since 1.0
+ * @brief Deallocate a block of memory allocated by idlib_allocator_allocate.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to the block.
+ * @param n The size, in Bytes, of the block as passed to idlib_allocator_allocate.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `p` is null or `n` is zero
+ * @remarks
+ * This function is mt-safe.
+ * A block can be deallocated by a thread other than the thread which allocated it.
+ */
+idlib_status
+idlib_allocator_deallocate
+  (
+    idlib_process* process,
+    void* p,
+    size_t n
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the statistics of the allocator of the process singleton.
+ * @param process A pointer to the process singleton.
+ * @param statistics [out] A pointer to an idlib_allocator_statistics variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `statistics` is null
+ * @remarks
+ * This function is mt-safe.
+ * The statistics are a snapshot which may be inconsistent if other threads allocate or deallocate concurrently.
+ * The statistics include the allocations of the library itself.
+ */
+idlib_status
+idlib_allocator_get_statistics
+  (
+    idlib_process* process,
+    idlib_allocator_statistics* statistics
+  );
+
+#endif // IDLIB_PROCESS_ALLOCATOR_H_INCLUDED
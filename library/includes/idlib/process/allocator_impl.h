@@ -0,0 +1,124 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_ALLOCATOR_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_ALLOCATOR_IMPL_H_INCLUDED
+
+#include "idlib/process/allocator.h"
+#include "idlib/process/atomic.h"
+
+// The number of size classes.
+#define IDLIB_ALLOCATOR_NUMBER_OF_CLASSES (12)
+
+// The number of blocks moved between a thread cache and the depot at once.
+#define IDLIB_ALLOCATOR_BATCH_SIZE (32)
+
+// The number of times the locked allocator is polled before the thread waits.
+#define IDLIB_ALLOCATOR_SPIN_COUNT (128)
+
+// The size, in Bytes, of a slab.
+#define IDLIB_ALLOCATOR_SLAB_SIZE (64 * 1024)
+
+typedef struct idlib_allocator_block idlib_allocator_block;
+
+// A free block.
+// The first block of a batch in the depot links to the next batch.
+struct idlib_allocator_block {
+  idlib_allocator_block* next;
+  idlib_allocator_block* next_batch;
+};
+
+typedef struct idlib_allocator_depot {
+  // The list of batches of IDLIB_ALLOCATOR_BATCH_SIZE blocks.
+  idlib_allocator_block* batches;
+  // The list of blocks which do not form a full batch and its length.
+  idlib_allocator_block* blocks;
+  uint32_t number_of_blocks;
+  // The uncarved range of the current slab.
+  char* begin;
+  char* end;
+} idlib_allocator_depot;
+
+typedef struct idlib_allocator_cache idlib_allocator_cache;
+
+typedef struct idlib_allocator idlib_allocator;
+
+// The free blocks cached by a thread.
+// The lists and the statistics are only written by the owning thread.
+struct idlib_allocator_cache {
+  idlib_allocator* allocator;
+  idlib_allocator_block* blocks[IDLIB_ALLOCATOR_NUMBER_OF_CLASSES];
+  uint32_t number_of_blocks[IDLIB_ALLOCATOR_NUMBER_OF_CLASSES];
+  uint64_t volatile allocations;
+  uint64_t volatile deallocations;
+  uint64_t volatile allocated_bytes;
+  uint64_t volatile deallocated_bytes;
+  uint64_t volatile large_allocations;
+  // Non-zero if the owning thread has terminated.
+  uint32_t volatile retired;
+  idlib_allocator_cache* next;
+};
+
+// The allocator.
+// It lives as long as the process (not as long as the process singleton) as blocks may outlive the singleton.
+struct idlib_allocator {
+  // Guards the depots, the list of caches, and the statistics below.
+  // 0 if unlocked, 1 if locked, 2 if locked and threads may wait.
+  // It is only acquired to exchange a batch or when a thread allocates for the first time, hence it is polled before a thread waits.
+  uint32_t volatile lock;
+  idlib_allocator_depot depots[IDLIB_ALLOCATOR_NUMBER_OF_CLASSES];
+  idlib_allocator_cache* caches;
+  uint64_t slabs;
+  uint64_t batch_transfers;
+  // The statistics of allocations and deallocations without a thread cache.
+  uint64_t allocations;
+  uint64_t deallocations;
+  uint64_t allocated_bytes;
+  uint64_t deallocated_bytes;
+  uint64_t large_allocations;
+};
+
+// Get the allocator of this module.
+// The process singleton stores a pointer to it such that all modules use the allocator of the module which created the singleton.
+idlib_allocator*
+idlib_allocator_impl_get
+  (
+  );
+
+// Allocate a block of n > 0 Bytes from the specified allocator.
+// Returns a null pointer on failure.
+void*
+idlib_allocator_impl_allocate
+  (
+    idlib_allocator* allocator,
+    size_t n
+  );
+
+// Deallocate a block of n Bytes allocated by idlib_allocator_impl_allocate.
+void
+idlib_allocator_impl_deallocate
+  (
+    idlib_allocator* allocator,
+    void* p,
+    size_t n
+  );
+
+#endif // IDLIB_PROCESS_ALLOCATOR_IMPL_H_INCLUDED
@@ -0,0 +1,503 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_ATOMIC_H_INCLUDED)
+#define IDLIB_PROCESS_ATOMIC_H_INCLUDED
+
+#include "idlib/process/configure.h"
+
+// uint32_t, uint64_t, int64_t
+#include <stdint.h>
+
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  // _Interlocked*, _ReadWriteBarrier, _mm_pause
+  #include <intrin.h>
+#endif
+
+// Atomic operations, thread-local storage, and cache line alignment.
+// The operations are sequentially consistent unless their name says otherwise ("relaxed", "acquire", "release").
+// Under MSVC, loads and stores of volatile variables are acquire and release operations (/volatile:ms).
+
+/**
+ * @since 1.0
+ * @brief The assumed size, in Bytes, of a cache line.
+ */
+#define IDLIB_CACHE_LINE_SIZE (64)
+
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+
+  /**
+   * @since 1.0
+   * @brief Storage-class specifier for thread-local variables.
+   */
+  #define IDLIB_THREAD_LOCAL __declspec(thread)
+
+  /**
+   * @since 1.0
+   * @brief Specifier aligning a type to the size of a cache line.
+   */
+  #define IDLIB_CACHE_LINE_ALIGNED __declspec(align(64))
+
+  /**
+   * @since 1.0
+   * @brief Hint for the optimizer that a condition is likely/unlikely true.
+   */
+  #define IDLIB_LIKELY(x) (x)
+  #define IDLIB_UNLIKELY(x) (x)
+
+#elif (IDLIB_COMPILER_C == IDLIB_COMPILER_C_GCC) || (IDLIB_COMPILER_C == IDLIB_COMPILER_C_CLANG)
+
+  #define IDLIB_THREAD_LOCAL __thread
+
+  #define IDLIB_CACHE_LINE_ALIGNED __attribute__((aligned(64)))
+
+  #define IDLIB_LIKELY(x) __builtin_expect(!!(x), 1)
+  #define IDLIB_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+#else
+
+  #error("C compiler not (yet) supported")
+
+#endif
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+static inline uint32_t
+idlib_atomic_load_relaxed_u32
+  (
+    uint32_t volatile* p
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return *p;
+#else
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline uint32_t
+idlib_atomic_load_u32
+  (
+    uint32_t volatile* p
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  uint32_t v = *p;
+  _ReadWriteBarrier();
+  return v;
+#else
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint32_t
+idlib_atomic_load_acquire_u32
+  (
+    uint32_t volatile* p
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  uint32_t v = *p;
+  _ReadWriteBarrier();
+  return v;
+#else
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void
+idlib_atomic_store_relaxed_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  *p = v;
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void
+idlib_atomic_store_release_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  _ReadWriteBarrier();
+  *p = v;
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline uint32_t
+idlib_atomic_exchange_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return (uint32_t)_InterlockedExchange((long volatile*)p, (long)v);
+#else
+  return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @since 1.0
+ * @brief Compare the value of <code>*p</code> with <code>*expected</code>.
+ * If they are equal, <code>v</code> is stored in <code>*p</code> and non-zero is returned.
+ * Otherwise the value of <code>*p</code> is stored in <code>*expected</code> and zero is returned.
+ */
+static inline int
+idlib_atomic_compare_exchange_u32
+  (
+    uint32_t volatile* p,
+    uint32_t* expected,
+    uint32_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  uint32_t old = (uint32_t)_InterlockedCompareExchange((long volatile*)p, (long)v, (long)*expected);
+  if (old == *expected) {
+    return 1;
+  }
+  *expected = old;
+  return 0;
+#else
+  return __atomic_compare_exchange_n(p, expected, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint32_t
+idlib_atomic_fetch_add_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return (uint32_t)_InterlockedExchangeAdd((long volatile*)p, (long)v);
+#else
+  return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint32_t
+idlib_atomic_fetch_sub_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return (uint32_t)_InterlockedExchangeAdd((long volatile*)p, -(long)v);
+#else
+  return __atomic_fetch_sub(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Subtract v from *p if *p is greater than or equal to v.
+// Return 1 if v was subtracted, 0 otherwise.
+static inline int
+idlib_atomic_try_sub_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+  uint32_t expected = idlib_atomic_load_relaxed_u32(p);
+  while (expected >= v) {
+    if (idlib_atomic_compare_exchange_u32(p, &expected, expected - v)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Add v to *p if the sum is representable.
+// Return 1 if v was added, 0 otherwise.
+static inline int
+idlib_atomic_try_add_u32
+  (
+    uint32_t volatile* p,
+    uint32_t v
+  )
+{
+  uint32_t expected = idlib_atomic_load_relaxed_u32(p);
+  while (expected <= UINT32_MAX - v) {
+    if (idlib_atomic_compare_exchange_u32(p, &expected, expected + v)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+static inline uint64_t
+idlib_atomic_load_relaxed_u64
+  (
+    uint64_t volatile* p
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return *p;
+#else
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void
+idlib_atomic_store_relaxed_u64
+  (
+    uint64_t volatile* p,
+    uint64_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  *p = v;
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline uint64_t
+idlib_atomic_load_acquire_u64
+  (
+    uint64_t volatile* p
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  uint64_t v = *p;
+  _ReadWriteBarrier();
+  return v;
+#else
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void
+idlib_atomic_store_release_u64
+  (
+    uint64_t volatile* p,
+    uint64_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  _ReadWriteBarrier();
+  *p = v;
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline int
+idlib_atomic_compare_exchange_u64
+  (
+    uint64_t volatile* p,
+    uint64_t* expected,
+    uint64_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  uint64_t old = (uint64_t)_InterlockedCompareExchange64((__int64 volatile*)p, (__int64)v, (__int64)*expected);
+  if (old == *expected) {
+    return 1;
+  }
+  *expected = old;
+  return 0;
+#else
+  return __atomic_compare_exchange_n(p, expected, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint64_t
+idlib_atomic_fetch_add_u64
+  (
+    uint64_t volatile* p,
+    uint64_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return (uint64_t)_InterlockedExchangeAdd64((__int64 volatile*)p, (__int64)v);
+#else
+  return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint64_t
+idlib_atomic_fetch_add_relaxed_u64
+  (
+    uint64_t volatile* p,
+    uint64_t v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return (uint64_t)_InterlockedExchangeAdd64((__int64 volatile*)p, (__int64)v);
+#else
+  return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+static inline void*
+idlib_atomic_load_acquire_pointer
+  (
+    void* volatile* p
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  void* v = *p;
+  _ReadWriteBarrier();
+  return v;
+#else
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void
+idlib_atomic_store_release_pointer
+  (
+    void* volatile* p,
+    void* v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  _ReadWriteBarrier();
+  *p = v;
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline void*
+idlib_atomic_exchange_pointer
+  (
+    void* volatile* p,
+    void* v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  return _InterlockedExchangePointer(p, v);
+#else
+  return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline int
+idlib_atomic_compare_exchange_pointer
+  (
+    void* volatile* p,
+    void** expected,
+    void* v
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  void* old = _InterlockedCompareExchangePointer(p, v, *expected);
+  if (old == *expected) {
+    return 1;
+  }
+  *expected = old;
+  return 0;
+#else
+  return __atomic_compare_exchange_n(p, expected, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @since 1.0
+ * @brief A full memory fence.
+ */
+static inline void
+idlib_atomic_fence
+  (
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  _ReadWriteBarrier();
+  _mm_mfence();
+#else
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * @since 1.0
+ * @brief An acquire fence: loads before the fence are ordered before loads and stores after the fence.
+ */
+static inline void
+idlib_atomic_fence_acquire
+  (
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  _ReadWriteBarrier();
+#else
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+/**
+ * @since 1.0
+ * @brief A release fence: loads and stores before the fence are ordered before stores after the fence.
+ */
+static inline void
+idlib_atomic_fence_release
+  (
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  _ReadWriteBarrier();
+#else
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/**
+ * @since 1.0
+ * @brief Hint to the processor that the calling thread is in a spin-wait loop.
+ */
+static inline void
+idlib_cpu_relax
+  (
+  )
+{
+#if (IDLIB_INSTRUCTION_SET_ARCHITECTURE == IDLIB_INSTRUCTION_SET_ARCHITECTURE_X64) || \
+    (IDLIB_INSTRUCTION_SET_ARCHITECTURE == IDLIB_INSTRUCTION_SET_ARCHITECTURE_X86)
+  #if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+    _mm_pause();
+  #else
+    __builtin_ia32_pause();
+  #endif
+#endif
+}
+
+#endif // IDLIB_PROCESS_ATOMIC_H_INCLUDED
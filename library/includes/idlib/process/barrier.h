@@ -0,0 +1,96 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_BARRIER_H_INCLUDED)
+#define IDLIB_PROCESS_BARRIER_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// uint32_t
+#include <stdint.h>
+
+// The type of a barrier.
+// A barrier blocks a fixed number of threads until all of them have arrived.
+// Then the barrier is reset and can be used again (the next phase).
+typedef struct idlib_barrier idlib_barrier;
+
+struct idlib_barrier {
+  void* pimpl;
+}; // struct idlib_barrier
+
+/**
+ * @since 1.0
+ * @brief The type of a function invoked when all threads have arrived at a barrier.
+ * @param context The context pointer passed to idlib_barrier_initialize.
+ */
+typedef void (idlib_barrier_completion)(void* context);
+
+/**
+ * @since 1.0
+ * @brief Initialize a barrier.
+ * @param barrier A pointer to the barrier.
+ * @param count The number of threads of each phase. Must be positive.
+ * @param completion A pointer to a function or a null pointer.
+ * If not a null pointer, the function is invoked in each phase by the last thread arriving before any thread is unblocked.
+ * @param context The context pointer passed to the completion function.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `barrier` is null or `count` is zero
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_barrier_initialize
+  (
+    idlib_barrier* barrier,
+    uint32_t count,
+    idlib_barrier_completion* completion,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize a barrier.
+ * @param barrier A pointer to the barrier. No thread may wait on the barrier.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_barrier_uninitialize
+  (
+    idlib_barrier* barrier
+  );
+
+/**
+ * @since 1.0
+ * @brief Arrive at a barrier and block the calling thread until all threads of the phase have arrived.
+ * @param barrier A pointer to the barrier.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks
+ * This function is mt-safe.
+ * Only the last thread arriving performs a system call (to unblock the other threads) unless the other threads block.
+ */
+idlib_status
+idlib_barrier_arrive_and_wait
+  (
+    idlib_barrier* barrier
+  );
+
+#endif // IDLIB_PROCESS_BARRIER_H_INCLUDED
@@ -0,0 +1,46 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_BARRIER_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_BARRIER_IMPL_H_INCLUDED
+
+#include "idlib/process/configure.h"
+
+#include "idlib/process/barrier.h"
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/futex.h"
+
+typedef struct idlib_barrier_impl {
+  // The number of threads of each phase.
+  uint32_t count;
+  // The number of threads that have arrived in the current phase.
+  uint32_t volatile arrived;
+  // Incremented when all threads of the current phase have arrived.
+  uint32_t volatile phase;
+  // The number of threads waiting for the current phase to complete.
+  uint32_t volatile waiters;
+  idlib_barrier_completion* completion;
+  void* context;
+} idlib_barrier_impl;
+
+#endif // IDLIB_PROCESS_BARRIER_IMPL_H_INCLUDED
@@ -0,0 +1,97 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_COMBINING_LOCK_H_INCLUDED)
+#define IDLIB_PROCESS_COMBINING_LOCK_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// The type of a combining lock.
+// A thread applying an operation publishes it in a record of the lock.
+// The thread holding the lock (the combiner) executes the published operations of all threads in a batch,
+// hence the data guarded by the lock stays in the cache of the combiner instead of moving between the threads.
+typedef struct idlib_combining_lock idlib_combining_lock;
+
+struct idlib_combining_lock {
+  void* pimpl;
+}; // struct idlib_combining_lock
+
+/**
+ * @since 1.0
+ * @brief The type of an operation applied under a combining lock.
+ * @param argument The argument passed to idlib_combining_lock_apply.
+ */
+typedef void (idlib_combining_procedure)(void* argument);
+
+/**
+ * @since 1.0
+ * @brief Initialize a combining lock.
+ * @param lock A pointer to the combining lock.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `lock` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_combining_lock_initialize
+  (
+    idlib_combining_lock* lock
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize a combining lock.
+ * @param lock A pointer to the combining lock. No thread may apply an operation.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_combining_lock_uninitialize
+  (
+    idlib_combining_lock* lock
+  );
+
+/**
+ * @since 1.0
+ * @brief Apply an operation under a combining lock.
+ * The operation is executed by this thread or by another thread while that thread holds the lock.
+ * The operations of a lock are executed one at a time.
+ * @param lock A pointer to the combining lock.
+ * @param procedure A pointer to the operation.
+ * @param argument The argument passed to the operation.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `lock` or `procedure` is null
+ * @success The operation was executed. Its effects are visible to the calling thread.
+ * @remarks
+ * This function is mt-safe.
+ * The operation must not apply operations under the same lock.
+ * As it may be executed by another thread, it must not depend on the identity of the calling thread (e.g., thread-local variables).
+ */
+idlib_status
+idlib_combining_lock_apply
+  (
+    idlib_combining_lock* lock,
+    idlib_combining_procedure* procedure,
+    void* argument
+  );
+
+#endif // IDLIB_PROCESS_COMBINING_LOCK_H_INCLUDED
@@ -0,0 +1,67 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_COMBINING_LOCK_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_COMBINING_LOCK_IMPL_H_INCLUDED
+
+#include "idlib/process/combining_lock.h"
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/futex.h"
+
+// The number of records of a combining lock.
+// If more threads apply operations at the same time, then the surplus threads acquire the lock and execute their operations themselves.
+#define IDLIB_COMBINING_LOCK_RECORDS (64)
+
+// The maximum number of passes of a combiner over the records.
+#define IDLIB_COMBINING_LOCK_PASSES (4)
+
+// The number of times a thread polls its record and the lock before it sleeps.
+#define IDLIB_COMBINING_LOCK_SPINS (128)
+
+// The record is not used.
+#define IDLIB_COMBINING_LOCK_RECORD_FREE (0)
+// The record is claimed by a thread which writes its operation.
+#define IDLIB_COMBINING_LOCK_RECORD_CLAIMED (1)
+// The operation of the record waits for a combiner.
+#define IDLIB_COMBINING_LOCK_RECORD_PENDING (2)
+// The operation of the record was executed.
+#define IDLIB_COMBINING_LOCK_RECORD_DONE (3)
+
+// A record occupies its own cache line such that publishing an operation does not invalidate the records of other threads.
+typedef struct idlib_combining_lock_record {
+  IDLIB_CACHE_LINE_ALIGNED uint32_t volatile state;
+  idlib_combining_procedure* procedure;
+  void* argument;
+} idlib_combining_lock_record;
+
+typedef struct idlib_combining_lock_impl {
+  // 0 if the lock is free, 1 if it is held, 2 if it is held and threads may sleep on it.
+  IDLIB_CACHE_LINE_ALIGNED uint32_t volatile lock;
+  // The greatest index of a record ever claimed plus 1. The combiner scans only these records.
+  uint32_t volatile number_of_records;
+  IDLIB_CACHE_LINE_ALIGNED idlib_combining_lock_record records[IDLIB_COMBINING_LOCK_RECORDS];
+  // The allocation of this object which aligns it to a cache line.
+  void* allocation;
+} idlib_combining_lock_impl;
+
+#endif // IDLIB_PROCESS_COMBINING_LOCK_IMPL_H_INCLUDED
@@ -34,6 +34,17 @@ struct idlib_condition {
   void* pimpl;
 }; // struct idlib_condition
 
+idlib_status
+idlib_condition_initialize
+  (
+    idlib_condition* condition
+  );
+
+/**
+ * @since 1.0
+ * @brief Deprecated alias of idlib_condition_initialize kept for existing callers.
+ * @deprecated Use idlib_condition_initialize.
+ */
 idlib_status
 idlib_condition_intialize
   (
@@ -46,6 +57,17 @@ idlib_condition_uninitialize
     idlib_condition* condition
   );
 
+/**
+ * @since 1.0
+ * @brief Unlock a mutex, wait until the condition is signaled, and lock the mutex again.
+ * @param condition A pointer to the condition.
+ * @param mutex A pointer to the mutex. The calling thread must have locked it.
+ * @remarks
+ * The mutex should be locked exactly once by the calling thread.
+ * The pthread backend releases only one level of a mutex the calling thread has locked recursively,
+ * hence the mutex stays locked while the thread waits and threads which would signal the condition may deadlock.
+ * The futex backends release and restore all levels.
+ */
 idlib_status
 idlib_condition_wait
   (
@@ -24,6 +24,8 @@
 
 #include "idlib/process/configure.h"
 
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
@@ -42,11 +44,29 @@ typedef struct idlib_condition_impl {
   pthread_cond_t condition;
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
   CONDITION_VARIABLE condition_variable;
-  CRITICAL_SECTION critical_section;
 #else
   #error("operating system not (yet) supported")
 #endif
 } idlib_condition_impl;
 
+#elif (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_FUTEX) || \
+      (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_ADAPTIVE)
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/futex.h"
+
+typedef struct idlib_condition_impl {
+  // Incremented by each signal.
+  // A waiter waits until the sequence differs from the value it observed before it released the mutex.
+  uint32_t volatile sequence;
+} idlib_condition_impl;
+
+#else
+
+  #error("mutex backend not (yet) supported")
+
+#endif
+
 
 #endif // IDLIB_PROCESS_CONDITION_IMPL_H_INCLUDED
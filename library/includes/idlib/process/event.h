@@ -0,0 +1,153 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_EVENT_H_INCLUDED)
+#define IDLIB_PROCESS_EVENT_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+/**
+ * @since 1.0
+ * @brief The type of the descriptor of an event.
+ * Under Windows this is a HANDLE which can be passed to WaitForMultipleObjects,
+ * otherwise this is a file descriptor which can be passed to poll, select, or epoll.
+ */
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+typedef void* idlib_event_descriptor;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+typedef int idlib_event_descriptor;
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// The type of an event.
+// An event is either signaled or not. Its descriptor is readable (signaled under Windows) while the event is signaled.
+// Signals are coalesced: signaling a signaled event performs no system call.
+typedef struct idlib_event idlib_event;
+
+struct idlib_event {
+  void* pimpl;
+}; // struct idlib_event
+
+/**
+ * @since 1.0
+ * @brief Initialize an event which is not signaled.
+ * @param event A pointer to the event.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `event` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the descriptor could not be created
+ */
+idlib_status
+idlib_event_initialize
+  (
+    idlib_event* event
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize an event and close its descriptor.
+ * @param event A pointer to the event. No thread may wait on the event.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_event_uninitialize
+  (
+    idlib_event* event
+  );
+
+/**
+ * @since 1.0
+ * @brief Signal an event.
+ * @param event A pointer to the event.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `event` is null
+ * - IDLIB_ENVIRONMENT_FAILED if the descriptor could not be signaled
+ * @remarks
+ * This function is mt-safe.
+ * If the event is signaled, this function performs no system call.
+ */
+idlib_status
+idlib_event_signal
+  (
+    idlib_event* event
+  );
+
+/**
+ * @since 1.0
+ * @brief Reset an event.
+ * A consumer resets the event after its descriptor became readable and before it examines the state the event notifies about.
+ * Then a signal after the examination is not lost.
+ * @param event A pointer to the event.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `event` is null
+ * @remarks
+ * This function is mt-safe and does not block.
+ */
+idlib_status
+idlib_event_reset
+  (
+    idlib_event* event
+  );
+
+/**
+ * @since 1.0
+ * @brief Block the calling thread until an event is signaled and reset the event.
+ * @param event A pointer to the event.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `event` is null
+ * - IDLIB_ENVIRONMENT_FAILED if waiting on the descriptor failed
+ * @remarks
+ * This function is mt-safe.
+ * A fiber waiting on an event blocks its worker thread.
+ */
+idlib_status
+idlib_event_wait
+  (
+    idlib_event* event
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the descriptor of an event.
+ * @param event A pointer to the event.
+ * @param descriptor [out] A pointer to an idlib_event_descriptor variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `event` or `descriptor` is null
+ * @success `*descriptor` was assigned the descriptor of the event.
+ * It is owned by the event and must neither be read from nor closed.
+ */
+idlib_status
+idlib_event_get_descriptor
+  (
+    idlib_event* event,
+    idlib_event_descriptor* descriptor
+  );
+
+#endif // IDLIB_PROCESS_EVENT_H_INCLUDED
@@ -0,0 +1,128 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_FIBER_H_INCLUDED)
+#define IDLIB_PROCESS_FIBER_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+/**
+ * @since 1.0
+ * @brief The default size, in Bytes, of the stack of a fiber. 64 KiB.
+ */
+#define IDLIB_FIBER_STACK_SIZE (65536)
+
+/**
+ * @since 1.0
+ * @brief The type of the procedure of a fiber.
+ * @param context The context passed to idlib_fiber_spawn.
+ */
+typedef void (idlib_fiber_procedure)(void* context);
+
+// The type of a fiber scheduler.
+// A fiber scheduler runs any number of fibers on a fixed number of worker threads.
+// A fiber runs until it returns, yields, or waits: idlib_semaphore, idlib_latch, idlib_barrier, idlib_once,
+// idlib_future, and, with the futex and the adaptive mutex backends, idlib_mutex and idlib_condition
+// suspend the waiting fiber instead of blocking its worker thread.
+typedef struct idlib_fiber_scheduler idlib_fiber_scheduler;
+
+struct idlib_fiber_scheduler {
+  void* pimpl;
+}; // struct idlib_fiber_scheduler
+
+/**
+ * @since 1.0
+ * @brief Initialize a fiber scheduler and start its worker threads.
+ * @param scheduler A pointer to the fiber scheduler.
+ * @param number_of_workers The number of worker threads.
+ * @param stack_size The size, in Bytes, of the stacks of the fibers or 0 for IDLIB_FIBER_STACK_SIZE.
+ * The size is rounded up to a multiple of the page size.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `scheduler` is null or `number_of_workers` is 0
+ * - IDLIB_TOO_BIG if the stack size or the number of worker threads is not representable
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if a worker thread could not be started
+ */
+idlib_status
+idlib_fiber_scheduler_initialize
+  (
+    idlib_fiber_scheduler* scheduler,
+    size_t number_of_workers,
+    size_t stack_size
+  );
+
+/**
+ * @since 1.0
+ * @brief Wait until all fibers of a fiber scheduler have returned, stop its worker threads, and uninitialize it.
+ * @param scheduler A pointer to the fiber scheduler.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `scheduler` is null
+ * - IDLIB_OPERATION_INVALID if the calling thread is a worker thread of a fiber scheduler
+ */
+idlib_status
+idlib_fiber_scheduler_uninitialize
+  (
+    idlib_fiber_scheduler* scheduler
+  );
+
+/**
+ * @since 1.0
+ * @brief Create a fiber and schedule it.
+ * @param scheduler A pointer to the fiber scheduler.
+ * @param procedure A pointer to the procedure of the fiber.
+ * @param context The context passed to the procedure.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `scheduler` or `procedure` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the stack could not be mapped
+ * @remarks
+ * This function is mt-safe and may be invoked by a fiber.
+ * The stack of a fiber is preceded by a guard page such that a stack overflow faults.
+ * The stacks of fibers which returned are reused.
+ */
+idlib_status
+idlib_fiber_spawn
+  (
+    idlib_fiber_scheduler* scheduler,
+    idlib_fiber_procedure* procedure,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * @brief Suspend the calling fiber and schedule it again.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_OPERATION_INVALID if the caller is not a fiber
+ */
+idlib_status
+idlib_fiber_yield
+  (
+  );
+
+#endif // IDLIB_PROCESS_FIBER_H_INCLUDED
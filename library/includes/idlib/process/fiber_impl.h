@@ -0,0 +1,161 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_FIBER_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_FIBER_IMPL_H_INCLUDED
+
+#include "idlib/process/fiber.h"
+#include "idlib/process/atomic.h"
+
+// The context switch of a fiber.
+// Under Linux on x86-64 the callee-saved registers are saved on the stack by a hand-written function (see fiber.c),
+// under Windows the fibers are Windows fibers, otherwise the context switch is swapcontext.
+#define IDLIB_FIBER_CONTEXT_ASSEMBLY (1)
+#define IDLIB_FIBER_CONTEXT_WINDOWS (2)
+#define IDLIB_FIBER_CONTEXT_UCONTEXT (3)
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define IDLIB_FIBER_CONTEXT IDLIB_FIBER_CONTEXT_WINDOWS
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX) && defined(__x86_64__)
+  #define IDLIB_FIBER_CONTEXT IDLIB_FIBER_CONTEXT_ASSEMBLY
+  #include <pthread.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  #define IDLIB_FIBER_CONTEXT IDLIB_FIBER_CONTEXT_UCONTEXT
+  #include <pthread.h>
+  #include <ucontext.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// Stack switches are announced to the address sanitizer such that it does not report false positives.
+#if (IDLIB_FIBER_CONTEXT != IDLIB_FIBER_CONTEXT_WINDOWS)
+  #if defined(__SANITIZE_ADDRESS__)
+    #define IDLIB_FIBER_WITH_ADDRESS_SANITIZER
+  #elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+      #define IDLIB_FIBER_WITH_ADDRESS_SANITIZER
+    #endif
+  #endif
+#endif
+
+typedef struct idlib_fiber_impl idlib_fiber_impl;
+typedef struct idlib_fiber_worker idlib_fiber_worker;
+typedef struct idlib_fiber_scheduler_impl idlib_fiber_scheduler_impl;
+
+// The saved context of a fiber or of a worker thread.
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_ASSEMBLY)
+  // The stack pointer. The registers are saved on the stack.
+  typedef void* idlib_fiber_context;
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  // The Windows fiber.
+  typedef LPVOID idlib_fiber_context;
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_UCONTEXT)
+  typedef ucontext_t idlib_fiber_context;
+#else
+  #error("fiber context not (yet) supported")
+#endif
+
+struct idlib_fiber_impl {
+  idlib_fiber_context context;
+  idlib_fiber_procedure* procedure;
+  void* context_of_procedure;
+  idlib_fiber_scheduler_impl* scheduler;
+  // The worker thread running the fiber.
+  idlib_fiber_worker* worker;
+  // The next fiber in the run queue or the list of unused fibers.
+  idlib_fiber_impl* next;
+  // The word the fiber is parked on and the next fiber parked in the same bucket.
+  uint32_t volatile* parked_on;
+  idlib_fiber_impl* next_parked;
+  // If the fiber is parked with a timeout, the value of the clock at which it is unparked, the word it is parked on,
+  // and its neighbours in the list of fibers parked with a timeout of its scheduler. Otherwise the deadline is UINT64_MAX.
+  // Guarded by the lock of the scheduler.
+  uint64_t deadline;
+  uint32_t volatile* timed_on;
+  idlib_fiber_impl* previous_timed;
+  idlib_fiber_impl* next_timed;
+#if (IDLIB_FIBER_CONTEXT != IDLIB_FIBER_CONTEXT_WINDOWS)
+  // The mapping of the stack including the guard page at its lowest address.
+  void* mapping;
+  size_t mapping_size;
+#endif
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  void* fake_stack;
+#endif
+};
+
+// What a worker thread does with the fiber that switched to it.
+#define IDLIB_FIBER_ACTION_YIELD (0)
+#define IDLIB_FIBER_ACTION_PARK (1)
+#define IDLIB_FIBER_ACTION_EXIT (2)
+
+struct idlib_fiber_worker {
+  idlib_fiber_context context;
+  idlib_fiber_scheduler_impl* scheduler;
+  // One of IDLIB_FIBER_ACTION_*.
+  int action;
+  // If the action is IDLIB_FIBER_ACTION_PARK, the lock of the bucket the fiber was parked in.
+  // It is released by the worker thread after the context of the fiber was saved.
+  uint32_t volatile* lock;
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  void const* stack_bottom;
+  size_t stack_size;
+#endif
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_t thread;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  HANDLE thread;
+#else
+  #error("operating system not (yet) supported")
+#endif
+};
+
+struct idlib_fiber_scheduler_impl {
+  // A spin lock guarding the run queue, the list of unused fibers, the list of fibers parked with a timeout, and the stop flag.
+  uint32_t volatile lock;
+  // The run queue.
+  idlib_fiber_impl* head;
+  idlib_fiber_impl* tail;
+  // Fibers which returned. Their stacks are reused.
+  idlib_fiber_impl* unused;
+  // Fibers parked with a timeout. The worker threads unpark them when their deadlines passed.
+  idlib_fiber_impl* timed;
+  // Incremented when a fiber is enqueued or the worker threads are stopped. Idle worker threads wait on it.
+  uint32_t volatile sequence;
+  uint32_t number_of_idle_workers;
+  int stop;
+  // The number of fibers which did not return. idlib_fiber_scheduler_uninitialize waits on it.
+  uint32_t volatile number_of_fibers;
+  size_t stack_size;
+  size_t number_of_workers;
+  idlib_fiber_worker* workers;
+};
+
+// The fiber running on the calling thread or a null pointer.
+extern IDLIB_THREAD_LOCAL idlib_fiber_impl* idlib_fiber_impl_of_thread;
+
+#endif // IDLIB_PROCESS_FIBER_IMPL_H_INCLUDED
@@ -0,0 +1,261 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_FUTEX_H_INCLUDED)
+#define IDLIB_PROCESS_FUTEX_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/atomic.h"
+
+// uint32_t
+#include <stdint.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // INT_MAX
+  #include <limits.h>
+  // FUTEX_WAIT, FUTEX_WAKE, FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+  #include <linux/futex.h>
+  // SYS_futex
+  #include <sys/syscall.h>
+  // struct timespec
+  #include <time.h>
+  // syscall
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  /* Intentionally empty. */
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// Waiting on and waking threads waiting on a 32 bit word.
+// Under Linux these are the futex system calls, under Windows WaitOnAddress and WakeByAddress*.
+// Otherwise they are emulated by a table of pthread mutexes and condition variables (see futex.c).
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+void
+idlib_futex_wait_emulated
+  (
+    uint32_t volatile* address,
+    uint32_t expected
+  );
+
+void
+idlib_futex_wait_for_emulated
+  (
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t timeout
+  );
+
+void
+idlib_futex_wake_emulated
+  (
+    uint32_t volatile* address
+  );
+
+#endif
+
+// A fiber (see fiber.c) waiting on a word is parked in a table keyed by the address of the word
+// and its worker thread runs other fibers. A wake-up unparks the fibers before it unblocks threads.
+
+// The number of fibers which are parked or about to be parked.
+extern uint32_t volatile idlib_fiber_impl_number_of_parked;
+
+// If the calling thread runs a fiber, park the fiber if the value of the word pointed to by address is expected and return 1.
+// Otherwise return 0.
+int
+idlib_fiber_impl_park
+  (
+    uint32_t volatile* address,
+    uint32_t expected
+  );
+
+// Like idlib_fiber_impl_park but the fiber is also unparked after at least timeout nanoseconds.
+// The worker threads of its scheduler unpark it when they switch fibers or are idle.
+int
+idlib_fiber_impl_park_for
+  (
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t timeout
+  );
+
+// If the calling thread runs a fiber, suspend the fiber, schedule it again, and return 1.
+// Otherwise return 0.
+int
+idlib_fiber_impl_yield
+  (
+  );
+
+// Unpark one or all fibers parked on the word pointed to by address.
+void
+idlib_fiber_impl_unpark
+  (
+    uint32_t volatile* address,
+    int all
+  );
+
+// Return non-zero if fibers may be parked.
+// The fence orders the modification of the word by the caller before the load of the number of parked fibers.
+static inline int
+idlib_fiber_impl_may_be_parked
+  (
+  )
+{
+  idlib_atomic_fence();
+  return 0 != idlib_atomic_load_relaxed_u32(&idlib_fiber_impl_number_of_parked);
+}
+
+// Block the calling thread if the value of the word pointed to by address is expected.
+// The thread is unblocked by idlib_futex_wake_one or idlib_futex_wake_all but may also be unblocked spuriously.
+static inline void
+idlib_futex_wait
+  (
+    uint32_t volatile* address,
+    uint32_t expected
+  )
+{
+  if (idlib_fiber_impl_park(address, expected)) {
+    return;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  syscall(SYS_futex, (uint32_t*)address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  WaitOnAddress((volatile VOID*)address, &expected, sizeof(uint32_t), INFINITE);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  idlib_futex_wait_emulated(address, expected);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+// Like idlib_futex_wait but the thread is also unblocked after timeout nanoseconds.
+// A fiber is parked until it is unparked or the timeout elapsed.
+static inline void
+idlib_futex_wait_for
+  (
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t timeout
+  )
+{
+  if (idlib_fiber_impl_park_for(address, expected, timeout)) {
+    return;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  struct timespec relative;
+  relative.tv_sec = (time_t)(timeout / UINT64_C(1000000000));
+  relative.tv_nsec = (long)(timeout % UINT64_C(1000000000));
+  syscall(SYS_futex, (uint32_t*)address, FUTEX_WAIT_PRIVATE, expected, &relative, NULL, 0);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  // Round up to milliseconds. INFINITE is not a valid timeout.
+  uint64_t milliseconds = (timeout + UINT64_C(999999)) / UINT64_C(1000000);
+  WaitOnAddress((volatile VOID*)address, &expected, sizeof(uint32_t), milliseconds < INFINITE ? (DWORD)milliseconds : INFINITE - 1);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  idlib_futex_wait_for_emulated(address, expected, timeout);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+// Unblock at most one thread waiting on the word pointed to by address.
+static inline void
+idlib_futex_wake_one
+  (
+    uint32_t volatile* address
+  )
+{
+  if (IDLIB_UNLIKELY(idlib_fiber_impl_may_be_parked())) {
+    idlib_fiber_impl_unpark(address, 0);
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  syscall(SYS_futex, (uint32_t*)address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  WakeByAddressSingle((PVOID)address);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  idlib_futex_wake_emulated(address);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+// Unblock all threads waiting on the word pointed to by address.
+static inline void
+idlib_futex_wake_all
+  (
+    uint32_t volatile* address
+  )
+{
+  if (IDLIB_UNLIKELY(idlib_fiber_impl_may_be_parked())) {
+    idlib_fiber_impl_unpark(address, 1);
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  syscall(SYS_futex, (uint32_t*)address, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  WakeByAddressAll((PVOID)address);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  idlib_futex_wake_emulated(address);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+
+// Like idlib_futex_wait_for but the word may reside in memory shared between processes.
+// A fiber is not parked but blocks its worker thread.
+static inline void
+idlib_futex_wait_for_shared
+  (
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t timeout
+  )
+{
+  struct timespec relative;
+  relative.tv_sec = (time_t)(timeout / UINT64_C(1000000000));
+  relative.tv_nsec = (long)(timeout % UINT64_C(1000000000));
+  syscall(SYS_futex, (uint32_t*)address, FUTEX_WAIT, expected, &relative, NULL, 0);
+}
+
+// Like idlib_futex_wake_one but the word may reside in memory shared between processes.
+static inline void
+idlib_futex_wake_one_shared
+  (
+    uint32_t volatile* address
+  )
+{
+  syscall(SYS_futex, (uint32_t*)address, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+#endif
+
+#endif // IDLIB_PROCESS_FUTEX_H_INCLUDED
@@ -0,0 +1,293 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_FUTURE_H_INCLUDED)
+#define IDLIB_PROCESS_FUTURE_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+// uint64_t
+#include <stdint.h>
+
+/**
+ * @since 1.0
+ * @brief The type of an executor of continuations.
+ * An executor must invoke or arrange for the invocation of the task with the context.
+ * This type is compatible with idlib_timer_executor.
+ * @param executor_context The executor context passed to idlib_future_then.
+ * @param task The task.
+ * @param context The context of the task.
+ */
+typedef void (idlib_future_executor)(void* executor_context, void (*task)(void* context), void* context);
+
+/**
+ * @since 1.0
+ * @brief The type of a continuation.
+ * @param context The context passed to idlib_future_then.
+ * @param status #IDLIB_SUCCESS if the future was set to a value, the error otherwise.
+ * @param value The value of the future if `status` is #IDLIB_SUCCESS, a null pointer otherwise.
+ * @param result [out] A pointer to a `void*` variable the value of the future returned by idlib_future_then is assigned to.
+ * @return #IDLIB_SUCCESS if `*result` was assigned the value of the future returned by idlib_future_then,
+ * otherwise the error the future returned by idlib_future_then is set to.
+ */
+typedef idlib_status (idlib_future_continuation)(void* context, idlib_status status, void* value, void** result);
+
+// The type of a future.
+// A future refers to the shared state of a promise and is ready when the promise was set.
+// Any number of futures can refer to the same shared state.
+typedef struct idlib_future idlib_future;
+
+struct idlib_future {
+  void* pimpl;
+}; // struct idlib_future
+
+// The type of a promise.
+// A promise is set once to a value or to an error.
+typedef struct idlib_promise idlib_promise;
+
+struct idlib_promise {
+  void* pimpl;
+}; // struct idlib_promise
+
+/**
+ * @since 1.0
+ * @brief Initialize a promise.
+ * @param promise A pointer to the promise.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `promise` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_promise_initialize
+  (
+    idlib_promise* promise
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize a promise.
+ * If the promise was not set, it is set to the error #IDLIB_ABORTED.
+ * @param promise A pointer to the promise.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_promise_uninitialize
+  (
+    idlib_promise* promise
+  );
+
+/**
+ * @since 1.0
+ * @brief Initialize a future referring to the shared state of a promise.
+ * @param promise A pointer to the promise.
+ * @param future A pointer to the future.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `promise` or `future` is null
+ * - IDLIB_OVERFLOW if the number of references to the shared state is not representable
+ */
+idlib_status
+idlib_promise_get_future
+  (
+    idlib_promise* promise,
+    idlib_future* future
+  );
+
+/**
+ * @since 1.0
+ * @brief Set a promise to a value.
+ * Threads waiting for futures of the promise are unblocked and the continuations of the futures are dispatched.
+ * @param promise A pointer to the promise.
+ * @param value The value.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `promise` is null
+ * - IDLIB_OPERATION_INVALID if the promise was already set
+ * @remarks
+ * Continuations without an executor are invoked by this function.
+ */
+idlib_status
+idlib_promise_set_value
+  (
+    idlib_promise* promise,
+    void* value
+  );
+
+/**
+ * @since 1.0
+ * @brief Set a promise to an error.
+ * @param promise A pointer to the promise.
+ * @param error The error. Must not be #IDLIB_SUCCESS.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `promise` is null or `error` is #IDLIB_SUCCESS
+ * - IDLIB_OPERATION_INVALID if the promise was already set
+ */
+idlib_status
+idlib_promise_set_error
+  (
+    idlib_promise* promise,
+    idlib_status error
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize a future.
+ * @param future A pointer to the future.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks
+ * Continuations added to the future are still dispatched when the promise is set.
+ */
+idlib_status
+idlib_future_uninitialize
+  (
+    idlib_future* future
+  );
+
+/**
+ * @since 1.0
+ * @brief Wait until a future is ready.
+ * @param future A pointer to the future.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `future` is null
+ * @remarks
+ * The calling thread is only blocked if the future is not ready.
+ */
+idlib_status
+idlib_future_wait
+  (
+    idlib_future* future
+  );
+
+/**
+ * @since 1.0
+ * @brief Wait until a future is ready or a deadline passed.
+ * @param future A pointer to the future.
+ * @param deadline The deadline. A value of the clock of idlib_clock_now.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `future` is null
+ * - IDLIB_TIMED_OUT if the deadline passed before the future was ready
+ */
+idlib_status
+idlib_future_wait_until
+  (
+    idlib_future* future,
+    uint64_t deadline
+  );
+
+/**
+ * @since 1.0
+ * @brief Wait until a future is ready and get its value.
+ * @param future A pointer to the future.
+ * @param value [out] A pointer to a `void*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `future` or `value` is null
+ * - the error if the promise was set to an error
+ * @success `*value` was assigned the value.
+ */
+idlib_status
+idlib_future_get
+  (
+    idlib_future* future,
+    void** value
+  );
+
+/**
+ * @since 1.0
+ * @brief Add a continuation to a future.
+ * The continuation is dispatched when the future is ready or immediately if the future is ready.
+ * @param future A pointer to the future.
+ * @param executor A pointer to the executor or a null pointer.
+ * If this is a null pointer, the continuation is invoked by the thread setting the promise or by this function if the future is ready.
+ * @param executor_context The context passed to the executor.
+ * @param continuation A pointer to the continuation.
+ * @param context The context passed to the continuation.
+ * @param result A pointer to a future or a null pointer.
+ * If this is not a null pointer, then the future is initialized and set to the result of the continuation.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `future` or `continuation` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @remarks
+ * This function is mt-safe and does not block.
+ */
+idlib_status
+idlib_future_then
+  (
+    idlib_future* future,
+    idlib_future_executor* executor,
+    void* executor_context,
+    idlib_future_continuation* continuation,
+    void* context,
+    idlib_future* result
+  );
+
+/**
+ * @since 1.0
+ * @brief Get a future which is ready when all of the specified futures are ready.
+ * @param futures A pointer to an array of `n` futures.
+ * @param n The number of futures.
+ * @param result A pointer to the future to initialize.
+ * The future is set to a null pointer if all futures were set to values and to the error of one of the futures otherwise.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `futures` or `result` is null
+ * - IDLIB_TOO_BIG if `n` is greater than `UINT32_MAX`
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_future_when_all
+  (
+    idlib_future* futures,
+    size_t n,
+    idlib_future* result
+  );
+
+/**
+ * @since 1.0
+ * @brief Get a future which is ready when one of the specified futures is ready.
+ * @param futures A pointer to an array of `n` futures.
+ * @param n The number of futures. Must not be zero.
+ * @param result A pointer to the future to initialize.
+ * The future is set to the value or the error of the first future which is ready.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `futures` or `result` is null or `n` is zero
+ * - IDLIB_TOO_BIG if `n` is greater than `UINT32_MAX`
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_future_when_any
+  (
+    idlib_future* futures,
+    size_t n,
+    idlib_future* result
+  );
+
+#endif // IDLIB_PROCESS_FUTURE_H_INCLUDED
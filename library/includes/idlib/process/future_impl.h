@@ -0,0 +1,77 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_FUTURE_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_FUTURE_IMPL_H_INCLUDED
+
+#include "idlib/process/future.h"
+#include "idlib/process/atomic.h"
+#include "idlib/process/allocator_impl.h"
+
+// The states of the state word of a shared state.
+// The promise was not set and no thread waits for it.
+#define IDLIB_FUTURE_EMPTY (0)
+// The promise was not set and threads may wait for it.
+#define IDLIB_FUTURE_WAITERS (1)
+// The promise was set.
+#define IDLIB_FUTURE_READY (2)
+
+// The value of the list of continuations after the continuations were dispatched.
+#define IDLIB_FUTURE_SEALED ((void*)(uintptr_t)1)
+
+typedef struct idlib_future_state idlib_future_state;
+
+typedef struct idlib_future_node idlib_future_node;
+
+// A continuation added to a shared state.
+struct idlib_future_node {
+  // The allocator the continuation was allocated from.
+  idlib_allocator* allocator;
+  idlib_future_node* next;
+  idlib_future_executor* executor;
+  void* executor_context;
+  idlib_future_continuation* continuation;
+  void* context;
+  // The shared state the result of the continuation is stored in or a null pointer.
+  idlib_future_state* result;
+  // The status and the value of the shared state, assigned when the continuation is dispatched.
+  idlib_status status;
+  void* value;
+};
+
+// The shared state of a promise and its futures.
+// The status and the value are written before the state word becomes IDLIB_FUTURE_READY (release)
+// and read after the state word was observed to be IDLIB_FUTURE_READY (acquire).
+struct idlib_future_state {
+  // The allocator the shared state was allocated from.
+  // A shared state may be released by a module other than the one which created it.
+  idlib_allocator* allocator;
+  uint32_t volatile reference_count;
+  // Set to 1 by the thread which sets the promise.
+  uint32_t volatile claimed;
+  uint32_t volatile state;
+  idlib_status status;
+  void* value;
+  // The continuations in reverse order of their addition or IDLIB_FUTURE_SEALED.
+  void* volatile nodes;
+};
+
+#endif // IDLIB_PROCESS_FUTURE_IMPL_H_INCLUDED
@@ -0,0 +1,107 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_INTERN_H_INCLUDED)
+#define IDLIB_PROCESS_INTERN_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief Intern a byte sequence.
+ * The process singleton stores one copy of each distinct byte sequence and returns a pointer to it.
+ * Two byte sequences are equal if and only if their interned pointers are equal.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to a sequence of <code>n</code> Bytes.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param interned [out] A pointer to a `void const*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, or `interned` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @success `*interned` was assigned a pointer to the interned copy of the byte sequence.
+ * The copy is followed by a zero Byte such that interned strings are null-terminated.
+ * It remains valid until the process singleton is destroyed and must not be modified.
+ * @remarks
+ * This function is mt-safe.
+ * If the byte sequence was interned before, then this function neither blocks nor allocates.
+ */
+idlib_status
+idlib_intern
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    void const** interned
+  );
+
+/**
+ * @since 1.0
+ * @brief Intern byte sequences.
+ * Acquires the lock of the interned byte sequences once for all byte sequences (e.g., when interning the names known at startup).
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to an array of <code>count</code> pointers to byte sequences.
+ * @param n A pointer to an array of <code>count</code> numbers of Bytes of the byte sequences.
+ * @param count The number of byte sequences.
+ * @param interned [out] A pointer to an array of <code>count</code> `void const*` variables.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, `n`, `interned`, or an element of `p` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @success `interned[i]` was assigned a pointer to the interned copy of the byte sequence (`p[i]`, `n[i]`).
+ * @remarks
+ * This function is mt-safe.
+ * On failure, some of the byte sequences may have been interned.
+ */
+idlib_status
+idlib_intern_many
+  (
+    idlib_process* process,
+    void const* const* p,
+    size_t const* n,
+    size_t count,
+    void const** interned
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the number of Bytes of an interned byte sequence.
+ * @param interned A pointer to an interned byte sequence.
+ * @param n [out] A pointer to a `size_t` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `interned` or `n` is null
+ * @success `*n` was assigned the number of Bytes of the byte sequence excluding the terminating zero Byte.
+ */
+idlib_status
+idlib_intern_get_size
+  (
+    void const* interned,
+    size_t* n
+  );
+
+#endif // IDLIB_PROCESS_INTERN_H_INCLUDED
@@ -0,0 +1,104 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_INTERN_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_INTERN_IMPL_H_INCLUDED
+
+#include "idlib/process/intern.h"
+#include "idlib/process/mutex.h"
+
+// uint64_t
+#include <stdint.h>
+
+// The number of Bytes of a chunk of the arena.
+#define IDLIB_INTERN_CHUNK_SIZE (65536)
+
+// The initial number of slots of the hash set. A power of two.
+#define IDLIB_INTERN_MINIMUM_CAPACITY (256)
+
+typedef struct idlib_intern_record idlib_intern_record;
+
+// An interned byte sequence.
+// The interned pointer points to the bytes.
+struct idlib_intern_record {
+  // The hash value of the bytes.
+  uint64_t hash;
+  // The number of Bytes excluding the terminating zero Byte.
+  size_t n;
+  char bytes[];
+};
+
+typedef struct idlib_intern_chunk idlib_intern_chunk;
+
+// A chunk of the arena the records are packed into.
+// Records larger than a quarter of a chunk are stored in a chunk of their own.
+struct idlib_intern_chunk {
+  idlib_intern_chunk* next;
+  // The number of Bytes of the chunk.
+  size_t size;
+  // The number of Bytes in use.
+  size_t used;
+  // Aligned such that the records are aligned.
+  uint64_t bytes[];
+};
+
+typedef struct idlib_intern_table idlib_intern_table;
+
+// A hash set with open addressing and linear probing.
+// A slot is assigned once and never cleared, hence lookups probe without synchronization.
+// When the table is half full, it is superseded by a table of twice the capacity.
+// Superseded tables are destroyed with the singleton as lookups may still probe them.
+struct idlib_intern_table {
+  // The table superseded by this table or a null pointer.
+  idlib_intern_table* previous;
+  // The number of slots. A power of two.
+  size_t capacity;
+  // An array of capacity pointers to records or null pointers.
+  idlib_intern_record* volatile* slots;
+};
+
+typedef struct idlib_intern_set idlib_intern_set;
+
+struct idlib_intern_set {
+  // Guards the insertion of records.
+  idlib_mutex lock;
+  // The current table.
+  // Written under the lock, read without synchronization.
+  idlib_intern_table* volatile table;
+  // The number of records.
+  size_t size;
+  // The chunks of the arena. The first chunk is the one records are packed into.
+  idlib_intern_chunk* chunks;
+};
+
+idlib_status
+idlib_intern_impl_create
+  (
+    idlib_intern_set** set
+  );
+
+void
+idlib_intern_impl_destroy
+  (
+    idlib_intern_set* set
+  );
+
+#endif // IDLIB_PROCESS_INTERN_IMPL_H_INCLUDED
@@ -0,0 +1,133 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_LATCH_H_INCLUDED)
+#define IDLIB_PROCESS_LATCH_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// uint32_t
+#include <stdint.h>
+
+// The type of a latch.
+// A latch is a single-use counter threads can wait on until it reaches zero.
+typedef struct idlib_latch idlib_latch;
+
+struct idlib_latch {
+  void* pimpl;
+}; // struct idlib_latch
+
+/**
+ * @since 1.0
+ * @brief Initialize a latch.
+ * @param latch A pointer to the latch.
+ * @param count The initial value of the counter.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `latch` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_latch_initialize
+  (
+    idlib_latch* latch,
+    uint32_t count
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize a latch.
+ * @param latch A pointer to the latch. No thread may wait on the latch.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_latch_uninitialize
+  (
+    idlib_latch* latch
+  );
+
+/**
+ * @since 1.0
+ * @brief Decrement the counter of a latch.
+ * If the counter reaches zero, the threads waiting on the latch are unblocked.
+ * @param latch A pointer to the latch.
+ * @param count The value to subtract from the counter.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `latch` is null
+ * - IDLIB_UNDERFLOW if `count` is greater than the counter
+ * @remarks
+ * This function is mt-safe.
+ * Unless the counter reaches zero and threads wait on the latch, this function performs no system call.
+ */
+idlib_status
+idlib_latch_count_down
+  (
+    idlib_latch* latch,
+    uint32_t count
+  );
+
+/**
+ * @since 1.0
+ * @brief Block the calling thread until the counter of a latch is zero.
+ * @param latch A pointer to the latch.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks This function is mt-safe.
+ */
+idlib_status
+idlib_latch_wait
+  (
+    idlib_latch* latch
+  );
+
+/**
+ * @since 1.0
+ * @brief Get if the counter of a latch is zero.
+ * @param latch A pointer to the latch.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `latch` is null
+ * - IDLIB_LOCKED if the counter is not zero
+ * @remarks This function is mt-safe and lock-free.
+ */
+idlib_status
+idlib_latch_try_wait
+  (
+    idlib_latch* latch
+  );
+
+/**
+ * @since 1.0
+ * @brief Decrement the counter of a latch and block the calling thread until the counter is zero.
+ * @param latch A pointer to the latch.
+ * @param count The value to subtract from the counter.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks This function is mt-safe.
+ */
+idlib_status
+idlib_latch_arrive_and_wait
+  (
+    idlib_latch* latch,
+    uint32_t count
+  );
+
+#endif // IDLIB_PROCESS_LATCH_H_INCLUDED
@@ -0,0 +1,168 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_LOCK_TABLE_H_INCLUDED)
+#define IDLIB_PROCESS_LOCK_TABLE_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+// uint8_t
+#include <stdint.h>
+
+typedef struct idlib_process idlib_process;
+
+// The type of a striped lock table.
+// Each address is mapped to one of a fixed number of locks by a hash of the address
+// such that objects can be locked individually without embedding a mutex in each object.
+typedef struct idlib_lock_table idlib_lock_table;
+
+/**
+ * @since 1.0
+ * @brief The type of the mode in which the lock of an address is acquired.
+ */
+typedef uint8_t idlib_lock_mode;
+
+/**
+ * @since 1.0
+ * @brief The lock is held by one thread.
+ */
+#define IDLIB_LOCK_MODE_EXCLUSIVE (1)
+
+/**
+ * @since 1.0
+ * @brief The lock is held by any number of threads.
+ */
+#define IDLIB_LOCK_MODE_SHARED (2)
+
+/**
+ * @since 1.0
+ * @brief Get the lock table of the process singleton.
+ * It is created by the first invocation and destroyed when the process singleton is destroyed.
+ * Hence all modules of the process share one lock table.
+ * @param process A pointer to the process singleton.
+ * @param table [out] A pointer to an `idlib_lock_table*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `table` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @success `*table` was assigned a pointer to the lock table.
+ * @remarks
+ * This function is mt-safe.
+ */
+idlib_status
+idlib_process_get_lock_table
+  (
+    idlib_process* process,
+    idlib_lock_table** table
+  );
+
+/**
+ * @since 1.0
+ * @brief Acquire the lock of an address.
+ * @param table A pointer to the lock table.
+ * @param address The address.
+ * @param mode The mode.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `table` or `address` is null or `mode` is not a mode
+ * @remarks
+ * This function is mt-safe.
+ * Distinct addresses may share a lock, hence the lock is not recursive in either mode
+ * and a thread holding the lock of an address must not acquire the lock of another address by this function.
+ * Use idlib_lock_table_lock_many to hold the locks of several addresses.
+ * Waiting exclusive lockers take precedence over new shared lockers.
+ */
+idlib_status
+idlib_lock_table_lock
+  (
+    idlib_lock_table* table,
+    void const* address,
+    idlib_lock_mode mode
+  );
+
+/**
+ * @since 1.0
+ * @brief Release the lock of an address acquired by idlib_lock_table_lock.
+ * @param table A pointer to the lock table.
+ * @param address The address.
+ * @param mode The mode the lock was acquired in.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `table` or `address` is null or `mode` is not a mode
+ */
+idlib_status
+idlib_lock_table_unlock
+  (
+    idlib_lock_table* table,
+    void const* address,
+    idlib_lock_mode mode
+  );
+
+/**
+ * @since 1.0
+ * @brief Acquire the locks of addresses.
+ * The locks are acquired in the order of their indices in the table and each lock is acquired once,
+ * hence threads locking overlapping sets of addresses do not deadlock.
+ * @param table A pointer to the lock table.
+ * @param addresses A pointer to an array of <code>count</code> addresses.
+ * @param count The number of addresses.
+ * @param mode The mode.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `table`, `addresses`, or an element of `addresses` is null or `mode` is not a mode
+ * @remarks
+ * This function is mt-safe.
+ * It takes time quadratic in <code>count</code> and is intended for a few addresses (e.g., the objects of a transfer).
+ */
+idlib_status
+idlib_lock_table_lock_many
+  (
+    idlib_lock_table* table,
+    void const* const* addresses,
+    size_t count,
+    idlib_lock_mode mode
+  );
+
+/**
+ * @since 1.0
+ * @brief Release the locks of addresses acquired by idlib_lock_table_lock_many.
+ * @param table A pointer to the lock table.
+ * @param addresses A pointer to an array of <code>count</code> addresses.
+ * @param count The number of addresses.
+ * @param mode The mode the locks were acquired in.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `table`, `addresses`, or an element of `addresses` is null or `mode` is not a mode
+ */
+idlib_status
+idlib_lock_table_unlock_many
+  (
+    idlib_lock_table* table,
+    void const* const* addresses,
+    size_t count,
+    idlib_lock_mode mode
+  );
+
+#endif // IDLIB_PROCESS_LOCK_TABLE_H_INCLUDED
@@ -0,0 +1,68 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_LOCK_TABLE_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_LOCK_TABLE_IMPL_H_INCLUDED
+
+#include "idlib/process/lock_table.h"
+
+#include "idlib/process/atomic.h"
+
+// The binary logarithm of the number of locks of a lock table.
+#define IDLIB_LOCK_TABLE_SHIFT (10)
+
+// The number of locks of a lock table.
+#define IDLIB_LOCK_TABLE_LOCKS (1 << IDLIB_LOCK_TABLE_SHIFT)
+
+// The number of times a contended lock is polled before the thread sleeps.
+#define IDLIB_LOCK_TABLE_SPINS (128)
+
+// The lock is held exclusively.
+#define IDLIB_LOCK_TABLE_WRITER (UINT32_C(0x80000000))
+// Threads may sleep on the lock. Shared lockers do not acquire the lock while this bit is set.
+#define IDLIB_LOCK_TABLE_WAITERS (UINT32_C(0x40000000))
+// The number of shared holders.
+#define IDLIB_LOCK_TABLE_READERS (UINT32_C(0x3fffffff))
+
+// A lock occupies its own cache line such that threads locking unrelated addresses do not contend for cache lines.
+typedef struct idlib_lock_table_lock_impl {
+  IDLIB_CACHE_LINE_ALIGNED uint32_t volatile state;
+} idlib_lock_table_lock_impl;
+
+struct idlib_lock_table {
+  idlib_lock_table_lock_impl locks[IDLIB_LOCK_TABLE_LOCKS];
+  // The allocation of this object which aligns it to a cache line.
+  void* allocation;
+};
+
+idlib_status
+idlib_lock_table_impl_create
+  (
+    idlib_lock_table** table
+  );
+
+void
+idlib_lock_table_impl_destroy
+  (
+    idlib_lock_table* table
+  );
+
+#endif // IDLIB_PROCESS_LOCK_TABLE_IMPL_H_INCLUDED
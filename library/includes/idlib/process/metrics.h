@@ -0,0 +1,229 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_METRICS_H_INCLUDED)
+#define IDLIB_PROCESS_METRICS_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+#include "idlib/process/atomic.h"
+
+// size_t
+#include <stddef.h>
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief The type of the kind of a metric.
+ */
+typedef uint8_t idlib_metric_kind;
+
+/**
+ * @since 1.0
+ * @brief A counter. A counter is only incremented.
+ */
+#define IDLIB_METRIC_KIND_COUNTER (1)
+
+/**
+ * @since 1.0
+ * @brief A gauge. A gauge is incremented and decremented.
+ */
+#define IDLIB_METRIC_KIND_GAUGE (2)
+
+/**
+ * @since 1.0
+ * @brief The number of shards of a metric.
+ */
+#define IDLIB_METRIC_SHARDS (32)
+
+typedef struct IDLIB_CACHE_LINE_ALIGNED idlib_metric_shard {
+  uint64_t volatile value;
+  char padding[IDLIB_CACHE_LINE_SIZE - sizeof(uint64_t)];
+} idlib_metric_shard;
+
+/**
+ * @since 1.0
+ * @brief The type of a metric.
+ * The value of a metric is distributed over shards each residing in its own cache line.
+ * Each thread updates the shard assigned to it such that threads do not write to shared cache lines (unless there are more threads than shards).
+ * The shards are aggregated when the value is read.
+ * @remarks A metric must be zero-initialized (e.g., by #IDLIB_METRIC_INITIALIZER) before it is used.
+ */
+typedef struct idlib_metric idlib_metric;
+
+struct idlib_metric {
+  idlib_metric_shard shards[IDLIB_METRIC_SHARDS];
+  // The following members are owned by the process singleton.
+  idlib_metric* next;
+  char* name;
+  idlib_metric_kind kind;
+}; // struct idlib_metric
+
+/**
+ * @since 1.0
+ * @brief Static initializer for an idlib_metric object.
+ */
+#define IDLIB_METRIC_INITIALIZER { .shards = { { 0 } }, .next = NULL, .name = NULL, .kind = 0 }
+
+/**
+ * @since 1.0
+ * @brief A value of a metric as obtained by idlib_metrics_snapshot.
+ */
+typedef struct idlib_metric_value {
+  // The name of the metric. Valid as long as the metric is registered.
+  char const* name;
+  idlib_metric_kind kind;
+  int64_t value;
+} idlib_metric_value;
+
+// Do not use directly.
+extern IDLIB_THREAD_LOCAL uint32_t idlib_metrics_shard_index_plus_one;
+
+// Do not use directly.
+uint32_t
+idlib_metrics_assign_shard
+  (
+  );
+
+/**
+ * @since 1.0
+ * @brief Add a value to a metric.
+ * @param metric A pointer to the metric.
+ * @param delta The value to add. Must be non-negative for counters.
+ * @remarks This function is mt-safe and lock-free.
+ */
+static inline void
+idlib_metric_add
+  (
+    idlib_metric* metric,
+    int64_t delta
+  )
+{
+  uint32_t index = idlib_metrics_shard_index_plus_one;
+  if (IDLIB_UNLIKELY(!index)) {
+    index = idlib_metrics_assign_shard();
+  }
+  idlib_atomic_fetch_add_relaxed_u64(&metric->shards[index - 1].value, (uint64_t)delta);
+}
+
+/**
+ * @since 1.0
+ * @brief Get the value of a metric by aggregating its shards.
+ * @param metric A pointer to the metric.
+ * @return The value of the metric.
+ * @remarks This function is mt-safe.
+ */
+int64_t
+idlib_metric_get
+  (
+    idlib_metric* metric
+  );
+
+/**
+ * @since 1.0
+ * @brief Register a metric with the process singleton under the specified name.
+ * @param process A pointer to the process singleton.
+ * @param metric A pointer to the metric. The metric must not be registered.
+ * @param name The name of the metric.
+ * @param kind The kind of the metric.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `metric`, or `name` is null or `kind` is not a valid kind
+ * - IDLIB_EXISTS if a metric of the same name is registered
+ * @remarks
+ * This function is mt-safe.
+ * The storage of the metric is owned by the caller and must remain valid until the metric is unregistered or the process singleton is destroyed.
+ */
+idlib_status
+idlib_metric_register
+  (
+    idlib_process* process,
+    idlib_metric* metric,
+    char const* name,
+    idlib_metric_kind kind
+  );
+
+/**
+ * @since 1.0
+ * @brief Unregister a metric from the process singleton.
+ * @param process A pointer to the process singleton.
+ * @param metric A pointer to the metric.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `metric` is null
+ * - IDLIB_NOT_EXISTS if the metric is not registered
+ * @remarks This function is mt-safe.
+ */
+idlib_status
+idlib_metric_unregister
+  (
+    idlib_process* process,
+    idlib_metric* metric
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the metric registered under the specified name.
+ * @param process A pointer to the process singleton.
+ * @param name The name of the metric.
+ * @param metric [out] A pointer to an <code>idlib_metric*</code> variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `name`, or `metric` is null
+ * - IDLIB_NOT_EXISTS if no metric of that name is registered
+ * @remarks This function is mt-safe.
+ */
+idlib_status
+idlib_metric_find
+  (
+    idlib_process* process,
+    char const* name,
+    idlib_metric** metric
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the values of all metrics registered with the process singleton.
+ * @param process A pointer to the process singleton.
+ * @param values A pointer to an array of <code>capacity</code> idlib_metric_value elements. May be null if <code>capacity</code> is zero.
+ * @param capacity The number of elements in the array pointed to by <code>values</code>.
+ * @param count [out] A pointer to a <code>size_t</code> variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `count` is null
+ * - IDLIB_TOO_SMALL if <code>capacity</code> is smaller than the number of registered metrics
+ * @success <code>values[0]</code>, ..., <code>values[*count - 1]</code> were assigned the values of the registered metrics.
+ * @remarks
+ * This function is mt-safe.
+ * If IDLIB_TOO_SMALL is returned, then <code>*count</code> was assigned the number of registered metrics.
+ */
+idlib_status
+idlib_metrics_snapshot
+  (
+    idlib_process* process,
+    idlib_metric_value* values,
+    size_t capacity,
+    size_t* count
+  );
+
+#endif // IDLIB_PROCESS_METRICS_H_INCLUDED
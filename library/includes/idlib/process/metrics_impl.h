@@ -0,0 +1,80 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_METRICS_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_METRICS_IMPL_H_INCLUDED
+
+#include "idlib/process/metrics.h"
+
+// The metrics the library is instrumented with.
+// They are registered with the process singleton when it is created.
+// If IDLIB_PROCESS_WITH_METRICS is 0, then IDLIB_METRIC_ADD expands to nothing and the instrumentation has no cost.
+
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+
+  extern idlib_metric idlib_metric_process_acquire;
+  extern idlib_metric idlib_metric_process_relinquish;
+  extern idlib_metric idlib_metric_process_allocation;
+  extern idlib_metric idlib_metric_registry_add;
+  extern idlib_metric idlib_metric_registry_get;
+  extern idlib_metric idlib_metric_registry_remove;
+  extern idlib_metric idlib_metric_registry_probe;
+  extern idlib_metric idlib_metric_registry_filter_reject;
+  extern idlib_metric idlib_metric_mutex_lock;
+  extern idlib_metric idlib_metric_mutex_lock_contended;
+  extern idlib_metric idlib_metric_mutex_allocation;
+  extern idlib_metric idlib_metric_mutex_live;
+  extern idlib_metric idlib_metric_condition_wait;
+  extern idlib_metric idlib_metric_condition_signal;
+  extern idlib_metric idlib_metric_condition_allocation;
+  extern idlib_metric idlib_metric_condition_live;
+
+  #define IDLIB_METRIC_ADD(metric, delta) idlib_metric_add(&idlib_metric_##metric, (delta))
+
+#else
+
+  #define IDLIB_METRIC_ADD(metric, delta)
+
+#endif
+
+/**
+ * @brief Initialize the metrics of the process singleton and register the metrics of the library.
+ * @param process A pointer to the process singleton.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_metrics_startup
+  (
+    idlib_process* process
+  );
+
+/**
+ * @brief Uninitialize the metrics of the process singleton. All metrics are unregistered.
+ * @param process A pointer to the process singleton.
+ */
+void
+idlib_metrics_shutdown
+  (
+    idlib_process* process
+  );
+
+#endif // IDLIB_PROCESS_METRICS_IMPL_H_INCLUDED
@@ -24,6 +24,8 @@
 
 #include "idlib/process/configure.h"
 
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
@@ -41,11 +43,95 @@ typedef struct idlib_mutex_impl {
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
   pthread_mutex_t mtx;
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
-  HANDLE mtx;
+  // Critical sections are recursive and can be used with condition variables.
+  CRITICAL_SECTION mtx;
 #else
   #error("operating system not (yet) supported")
 #endif
 } idlib_mutex_impl;
 
+#elif (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_FUTEX) || \
+      (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_ADAPTIVE)
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/futex.h"
+
+#include "idlib/process/fiber_impl.h"
+
+typedef struct idlib_mutex_impl {
+  // 0 if unlocked, 1 if locked and no thread waits, 2 if locked and threads may wait.
+  uint32_t volatile state;
+  // The number of times the owner has locked the mutex.
+  // Only accessed by the owner.
+  uint32_t count;
+  // The owner of the mutex (see idlib_mutex_impl_self) or a null pointer.
+  void* volatile owner;
+} idlib_mutex_impl;
+
+// The address of this variable identifies the calling thread if it does not run a fiber.
+extern IDLIB_THREAD_LOCAL char idlib_mutex_impl_thread;
+
+// Acquire the mutex if the attempt to acquire it by idlib_mutex_impl_try_acquire failed.
+void
+idlib_mutex_impl_acquire_slow
+  (
+    idlib_mutex_impl* pimpl
+  );
+
+// The owner is the fiber if the calling thread runs a fiber as a fiber may resume on another thread.
+static inline void*
+idlib_mutex_impl_self
+  (
+  )
+{
+  idlib_fiber_impl* fiber = idlib_fiber_impl_of_thread;
+  return fiber ? (void*)fiber : (void*)&idlib_mutex_impl_thread;
+}
+
+// Return 1 if the mutex was acquired, 0 otherwise.
+// Does not consider the owner and the count.
+static inline int
+idlib_mutex_impl_try_acquire
+  (
+    idlib_mutex_impl* pimpl
+  )
+{
+  uint32_t expected = 0;
+  return idlib_atomic_compare_exchange_u32(&pimpl->state, &expected, 1);
+}
+
+// Acquire the mutex.
+// Does not consider the owner and the count.
+static inline void
+idlib_mutex_impl_acquire
+  (
+    idlib_mutex_impl* pimpl
+  )
+{
+  if (IDLIB_UNLIKELY(!idlib_mutex_impl_try_acquire(pimpl))) {
+    idlib_mutex_impl_acquire_slow(pimpl);
+  }
+}
+
+// Release the mutex.
+// Does not consider the owner and the count.
+static inline void
+idlib_mutex_impl_release
+  (
+    idlib_mutex_impl* pimpl
+  )
+{
+  if (IDLIB_UNLIKELY(1 != idlib_atomic_fetch_sub_u32(&pimpl->state, 1))) {
+    idlib_atomic_store_release_u32(&pimpl->state, 0);
+    idlib_futex_wake_one(&pimpl->state);
+  }
+}
+
+#else
+
+  #error("mutex backend not (yet) supported")
+
+#endif
 
 #endif // IDBLIB_PROCESS_MUTEX_IMPL_H_INCLUDED
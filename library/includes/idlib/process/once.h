@@ -0,0 +1,121 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_ONCE_H_INCLUDED)
+#define IDLIB_PROCESS_ONCE_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+#include "idlib/process/atomic.h"
+
+/**
+ * @since 1.0
+ * @brief The state of an idlib_once object if its procedure was not invoked or failed.
+ */
+#define IDLIB_ONCE_INITIAL (0)
+
+/**
+ * @since 1.0
+ * @brief The state of an idlib_once object if its procedure is running and no thread waits for it.
+ */
+#define IDLIB_ONCE_RUNNING (1)
+
+/**
+ * @since 1.0
+ * @brief The state of an idlib_once object if its procedure is running and threads may wait for it.
+ */
+#define IDLIB_ONCE_RUNNING_WAITERS (2)
+
+/**
+ * @since 1.0
+ * @brief The state of an idlib_once object if its procedure succeeded.
+ */
+#define IDLIB_ONCE_DONE (3)
+
+/**
+ * @since 1.0
+ * @brief The type of a one-time initialization.
+ * An idlib_once object requires no uninitialization and is usually a static variable initialized by IDLIB_ONCE_INITIALIZER.
+ */
+typedef struct idlib_once idlib_once;
+
+struct idlib_once {
+  uint32_t volatile state;
+}; // struct idlib_once
+
+/**
+ * @since 1.0
+ * @brief Static initializer for an idlib_once object.
+ */
+#define IDLIB_ONCE_INITIALIZER { IDLIB_ONCE_INITIAL }
+
+/**
+ * @since 1.0
+ * @brief The type of a procedure invoked by idlib_once_call.
+ * @param context The context pointer passed to idlib_once_call.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+typedef idlib_status (idlib_once_procedure)(void* context);
+
+/**
+ * @since 1.0
+ * @brief Invoked by idlib_once_call if the procedure has not succeeded yet.
+ */
+idlib_status
+idlib_once_call_slow
+  (
+    idlib_once* once,
+    idlib_once_procedure* procedure,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * @brief Invoke a procedure unless it has succeeded before.
+ * @param once A pointer to the idlib_once object.
+ * @param procedure A pointer to the procedure.
+ * @param context The context pointer passed to the procedure.
+ * @return #IDLIB_SUCCESS if the procedure has succeeded (in this or an earlier call). A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `once` or `procedure` is null
+ * - the status returned by the procedure if the procedure was invoked by this call and failed
+ * @remarks
+ * This function is mt-safe.
+ * At most one thread invokes the procedure at a time.
+ * Other threads calling this function meanwhile block without spinning until the procedure returns.
+ * If the procedure failed, the next call invokes the procedure again.
+ * Once the procedure has succeeded, this function performs a single acquire load.
+ */
+static inline idlib_status
+idlib_once_call
+  (
+    idlib_once* once,
+    idlib_once_procedure* procedure,
+    void* context
+  )
+{
+  if (IDLIB_LIKELY(once && IDLIB_ONCE_DONE == idlib_atomic_load_acquire_u32(&once->state))) {
+    return IDLIB_SUCCESS;
+  }
+  return idlib_once_call_slow(once, procedure, context);
+}
+
+#endif // IDLIB_PROCESS_ONCE_H_INCLUDED
@@ -0,0 +1,337 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_PROCESS_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_PROCESS_IMPL_H_INCLUDED
+
+#include "idlib/process.h"
+
+#include "idlib/process/allocator_impl.h"
+
+#include "idlib/process/topology_impl.h"
+
+#include "idlib/process/tls_impl.h"
+
+#include "idlib/process/intern_impl.h"
+#include "idlib/process/watch_impl.h"
+#include "idlib/process/lock_table_impl.h"
+
+#include "idlib/process/timer.h"
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+  // uint64_t
+  #include <stdint.h>
+
+  #include <pthread.h>
+
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+
+  // uint64_t
+  #include <stdint.h>
+
+#else
+
+  #error("operating system not (yet) supported")
+
+#endif
+
+typedef struct _entry _entry;
+
+typedef struct _entries _entries;
+
+// An entry is handed out as an idlib_global_ref.
+// The registry holds one reference to an entry until the entry is removed or the singleton is destroyed.
+// The entry and its value are destroyed when the last reference is released.
+struct _entry {
+  _entry* next;
+  // The link pointing to this entry in the entries or a null pointer if the entry is frozen.
+  _entry** link;
+  // The hash value of the key.
+  uint64_t hash;
+  void *p;
+  size_t n;
+  void* v;
+  // The destructor of the value or a null pointer.
+  idlib_global_destructor* destructor;
+  // The allocator the entry and its key were allocated from.
+  // The allocator outlives the singleton, hence the last reference may be released after the singleton was destroyed.
+  idlib_allocator* allocator;
+  uint32_t volatile reference_count;
+};
+
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_LIST)
+
+struct _entries {
+  _entry* entries;
+};
+
+#elif (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+
+// A hash table with separate chaining.
+struct _entries {
+  // The buckets.
+  _entry** buckets;
+  // The number of buckets. A power of two.
+  size_t capacity;
+  // The number of entries.
+  size_t size;
+};
+
+#else
+
+  #error("registry not (yet) supported")
+
+#endif
+
+typedef struct _prefix_node _prefix_node;
+
+// A node of the prefix index.
+// The prefix index is a radix tree of the keys of the entries including the frozen entries.
+// The key of a node is the concatenation of the labels of the nodes on the path from the root to the node.
+// The entries with keys starting with a prefix are the entries of the subtree of the node the prefix ends in,
+// hence they are found in time proportional to their number and the length of the prefix.
+struct _prefix_node {
+  // The parent or a null pointer for the root.
+  _prefix_node* parent;
+  // The index of this node in the children of its parent.
+  size_t index;
+  // The label of the edge from the parent. Empty for the root.
+  unsigned char* label;
+  size_t label_size;
+  // The entry whose key is the key of this node or a null pointer.
+  _entry* entry;
+  // The children ordered by the first Bytes of their labels which are distinct.
+  _prefix_node** children;
+  size_t number_of_children;
+  size_t capacity;
+};
+
+// A slot of a frozen table.
+typedef struct _frozen_slot {
+  // The hash value of the key.
+  uint64_t hash;
+  // The offset of the key in the keys of the frozen table.
+  size_t offset;
+  // The size of the key.
+  size_t n;
+  void* v;
+  // The entry of the key.
+  _entry* entry;
+} _frozen_slot;
+
+typedef struct _frozen _frozen;
+
+// A frozen table is an immutable minimal perfect hash table created by idlib_process_freeze_globals.
+// The key of an entry is mapped to its bucket and the displacement of the bucket maps the key to its slot (hash and displace).
+// The frozen table is never modified once published and is destroyed with the singleton, hence lookups require no synchronization.
+// The registry's references to the entries of frozen keys are held by the most recent frozen table.
+struct _frozen {
+  // The frozen table superseded by this frozen table or a null pointer.
+  _frozen* previous;
+  // The number of buckets.
+  uint32_t number_of_buckets;
+  // An array of number_of_buckets displacements.
+  uint32_t* displacements;
+  // The number of slots. Equal to the number of entries.
+  uint32_t number_of_slots;
+  // An array of number_of_slots slots.
+  _frozen_slot* slots;
+  // The keys packed contiguously.
+  char* keys;
+};
+
+// The number of 64 bit words of a block of a filter.
+// A block occupies one cache line.
+#define IDLIB_PROCESS_FILTER_BLOCK_WORDS (8)
+
+typedef struct _filter _filter;
+
+// A blocked Bloom filter of the hash values of the entries.
+// A key sets one bit in each word of one block, hence a query reads one cache line.
+struct _filter {
+  // The filter superseded by this filter or a null pointer.
+  _filter* previous;
+  // The number of blocks. A power of two.
+  uint32_t number_of_blocks;
+  // An array of number_of_blocks * IDLIB_PROCESS_FILTER_BLOCK_WORDS words.
+  uint64_t volatile* words;
+  // The allocation of the words which aligns them to cache lines.
+  void* allocation;
+};
+
+// The file written by idlib_globals_save.
+// The file contains no pointers but only offsets relative to its start such that it can be mapped at any address and used as a frozen table.
+//
+// The file starts with a header followed by the displacements and the slots of a minimal perfect hash table (see _frozen).
+// The keys and the values follow the slots. A value starts at the next multiple of IDLIB_GLOBALS_FILE_ALIGNMENT after its key.
+
+#define IDLIB_GLOBALS_FILE_MAGIC "IDLIBGS"
+
+#define IDLIB_GLOBALS_FILE_VERSION (1)
+
+// Written in the byte order of the writer to detect files written on machines with a different byte order.
+#define IDLIB_GLOBALS_FILE_BYTE_ORDER UINT32_C(0x01020304)
+
+#define IDLIB_GLOBALS_FILE_ALIGNMENT (16)
+
+typedef struct idlib_globals_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  // The size of the file.
+  uint64_t size;
+  // The number of buckets.
+  uint32_t number_of_buckets;
+  // The number of slots.
+  uint32_t number_of_slots;
+  // The offset of the array of number_of_buckets displacements.
+  uint64_t displacements;
+  // The offset of the array of number_of_slots slots.
+  uint64_t slots;
+  // The FNV-1a hash of the header with this field set to zero.
+  uint64_t checksum;
+} idlib_globals_file_header;
+
+typedef struct idlib_globals_file_slot {
+  // The hash value of the key.
+  uint64_t hash;
+  // The offset of the key.
+  uint64_t key;
+  // The size of the key.
+  uint64_t n;
+  // The offset of the value.
+  uint64_t value;
+  // The size of the value.
+  uint64_t m;
+} idlib_globals_file_slot;
+
+typedef struct _mapped _mapped;
+
+// A file written by idlib_globals_save and mapped by idlib_globals_load_mapped.
+// The mapping is never modified and is unmapped with the singleton, hence lookups require no synchronization.
+struct _mapped {
+  // The file mapped before this file or a null pointer.
+  _mapped* previous;
+  // The address of the mapping.
+  char const* base;
+  // The size of the mapping.
+  size_t size;
+  uint32_t number_of_buckets;
+  uint32_t const* displacements;
+  uint32_t number_of_slots;
+  idlib_globals_file_slot const* slots;
+};
+
+// FNV-1a hash of a key.
+static inline uint64_t
+idlib_process_hash
+  (
+    void const* p,
+    size_t n
+  )
+{
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  for (size_t i = 0; i < n; ++i) {
+    hash ^= ((uint8_t const*)p)[i];
+    hash *= UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+// The process singleton.
+// Services hosted by the singleton keep their state here such that they are shared by all modules of the process.
+struct idlib_process {
+  uint64_t reference_count;
+  // Guards the entries.
+  // Readers (idlib_get_global) acquire it in shared mode, writers in exclusive mode.
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_rwlock_t entries_lock;
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  SRWLOCK entries_lock;
+#else
+  #error("operating system not (yet) supported")
+#endif
+  // The entries added since the entries were frozen or all entries if the entries were never frozen.
+  _entries entries;
+  // The root of the prefix index of the entries including the frozen entries.
+  // The globals of mapped files are not indexed.
+  _prefix_node prefix_index;
+  // The frozen table or a null pointer.
+  // Written under the entries lock, read without synchronization.
+  _frozen* volatile frozen;
+  // The most recently mapped file or a null pointer.
+  // Written under the entries lock, read without synchronization.
+  _mapped* volatile mapped;
+  // The filter of the entries or a null pointer.
+  // Bits are set under the entries lock in exclusive mode, queried without synchronization.
+  // Clearing or replacing the filter increments filter_sequence before and after such that queries can detect it.
+  _filter* volatile filter;
+  // Odd while the filter is cleared or replaced.
+  uint32_t volatile filter_sequence;
+  // The number of keys added to the filter since it was cleared.
+  size_t filter_keys;
+  // The number of keys of the filter which were removed from the entries since the filter was cleared.
+  size_t filter_removes;
+  // The allocator of the module which created the singleton.
+  idlib_allocator* allocator;
+  // Starts the timer service.
+  idlib_once timer_once;
+  // The timer service. Started by idlib_process_get_timer_service.
+  idlib_timer_service timer_service;
+  // Discovers the topology.
+  idlib_once topology_once;
+  // The CPU topology. Discovered by idlib_process_get_topology.
+  idlib_topology* topology;
+  // Creates the registry of the per-thread storage slots.
+  idlib_once tls_once;
+  // The registry of the per-thread storage slots. Created by the first allocation of a slot.
+  idlib_tls_registry* tls;
+  // Creates the set of interned byte sequences.
+  idlib_once intern_once;
+  // The set of interned byte sequences. Created by the first invocation of idlib_intern or idlib_intern_many.
+  idlib_intern_set* intern;
+  // Creates the watches of the globals.
+  idlib_once watch_once;
+  // The watches of the globals. Created by the first invocation of idlib_watch_global, idlib_unwatch_global, or idlib_wait_global.
+  idlib_watch_set* watches;
+  // The number of watches.
+  // Modified under the lock of the watches, read under the entries lock such that adding and removing globals does not notify if nobody watches.
+  uint32_t volatile number_of_watches;
+  // Creates the lock table.
+  idlib_once lock_table_once;
+  // The lock table. Created by idlib_process_get_lock_table.
+  idlib_lock_table* lock_table;
+  // Guards the list of metrics.
+  idlib_mutex metrics_lock;
+  // The list of registered metrics.
+  idlib_metric* metrics;
+};
+
+#endif // IDLIB_PROCESS_PROCESS_IMPL_H_INCLUDED
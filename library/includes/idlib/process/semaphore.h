@@ -0,0 +1,118 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_SEMAPHORE_H_INCLUDED)
+#define IDLIB_PROCESS_SEMAPHORE_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// uint32_t
+#include <stdint.h>
+
+// The type of a counting semaphore.
+typedef struct idlib_semaphore idlib_semaphore;
+
+struct idlib_semaphore {
+  void* pimpl;
+}; // struct idlib_semaphore
+
+/**
+ * @since 1.0
+ * @brief Initialize a semaphore.
+ * @param semaphore A pointer to the semaphore.
+ * @param count The initial number of permits.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `semaphore` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ */
+idlib_status
+idlib_semaphore_initialize
+  (
+    idlib_semaphore* semaphore,
+    uint32_t count
+  );
+
+/**
+ * @since 1.0
+ * @brief Uninitialize a semaphore.
+ * @param semaphore A pointer to the semaphore. No thread may wait on the semaphore.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_semaphore_uninitialize
+  (
+    idlib_semaphore* semaphore
+  );
+
+/**
+ * @since 1.0
+ * @brief Acquire a permit, blocking the calling thread until a permit is available.
+ * @param semaphore A pointer to the semaphore.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks
+ * This function is mt-safe.
+ * If a permit is available, this function does not block and performs no system call.
+ */
+idlib_status
+idlib_semaphore_acquire
+  (
+    idlib_semaphore* semaphore
+  );
+
+/**
+ * @since 1.0
+ * @brief Acquire a permit if a permit is available.
+ * @param semaphore A pointer to the semaphore.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `semaphore` is null
+ * - IDLIB_LOCKED if no permit is available
+ * @remarks This function is mt-safe and lock-free.
+ */
+idlib_status
+idlib_semaphore_try_acquire
+  (
+    idlib_semaphore* semaphore
+  );
+
+/**
+ * @since 1.0
+ * @brief Release permits.
+ * @param semaphore A pointer to the semaphore.
+ * @param count The number of permits to release.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `semaphore` is null
+ * - IDLIB_OVERFLOW if the number of permits is not representable
+ * @remarks
+ * This function is mt-safe.
+ * If no thread waits on the semaphore, this function performs no system call.
+ */
+idlib_status
+idlib_semaphore_release
+  (
+    idlib_semaphore* semaphore,
+    uint32_t count
+  );
+
+#endif // IDLIB_PROCESS_SEMAPHORE_H_INCLUDED
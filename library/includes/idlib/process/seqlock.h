@@ -0,0 +1,161 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_SEQLOCK_H_INCLUDED)
+#define IDLIB_PROCESS_SEQLOCK_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+// uint32_t
+#include <stdint.h>
+
+// The type of a sequence lock.
+// A sequence lock protects small data that is frequently read and rarely written.
+// Writers are serialized by a mutex and increment a sequence counter before and after they write.
+// Readers do not write to shared memory: they copy the data and retry if the sequence counter changed meanwhile.
+typedef struct idlib_seqlock idlib_seqlock;
+
+struct idlib_seqlock {
+  void* pimpl;
+}; // struct idlib_seqlock
+
+idlib_status
+idlib_seqlock_initialize
+  (
+    idlib_seqlock* seqlock
+  );
+
+idlib_status
+idlib_seqlock_uninitialize
+  (
+    idlib_seqlock* seqlock
+  );
+
+/**
+ * @since 1.0
+ * @brief Begin a read.
+ * Wait until no writer holds the sequence lock and get the sequence counter.
+ * @param seqlock A pointer to the sequence lock.
+ * @param sequence [out] A pointer to a <code>uint32_t</code> variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @success <code>*sequence</code> was assigned the sequence counter.
+ * @remarks This function is mt-safe and does not write to shared memory.
+ */
+idlib_status
+idlib_seqlock_read_begin
+  (
+    idlib_seqlock* seqlock,
+    uint32_t* sequence
+  );
+
+/**
+ * @since 1.0
+ * @brief End a read.
+ * @param seqlock A pointer to the sequence lock.
+ * @param sequence The sequence counter obtained by idlib_seqlock_read_begin.
+ * @return #IDLIB_SUCCESS if no writer has written since idlib_seqlock_read_begin. A non-zero return value otherwise.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `seqlock` is null
+ * - IDLIB_ABORTED if a writer has written; the data read must be discarded and the read must be retried
+ * @remarks This function is mt-safe and does not write to shared memory.
+ */
+idlib_status
+idlib_seqlock_read_end
+  (
+    idlib_seqlock* seqlock,
+    uint32_t sequence
+  );
+
+/**
+ * @since 1.0
+ * @brief Copy data protected by a sequence lock, retrying until the copy is consistent.
+ * @param seqlock A pointer to the sequence lock.
+ * @param target A pointer to an array of <code>n</code> Bytes receiving the copy.
+ * @param source A pointer to the array of <code>n</code> Bytes protected by the sequence lock.
+ * @param n The number of Bytes.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks This function is mt-safe and does not write to shared memory.
+ */
+idlib_status
+idlib_seqlock_read
+  (
+    idlib_seqlock* seqlock,
+    void* target,
+    void const* source,
+    size_t n
+  );
+
+/**
+ * @since 1.0
+ * @brief Lock a sequence lock for writing.
+ * @param seqlock A pointer to the sequence lock.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `seqlock` is null
+ * - IDLIB_OPERATION_INVALID if the calling thread already holds the sequence lock
+ * @remarks This function is mt-safe. The writer must not read by idlib_seqlock_read_begin.
+ * A sequence lock is not recursive.
+ */
+idlib_status
+idlib_seqlock_write_lock
+  (
+    idlib_seqlock* seqlock
+  );
+
+/**
+ * @since 1.0
+ * @brief Unlock a sequence lock locked for writing.
+ * @param seqlock A pointer to the sequence lock.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `seqlock` is null
+ * - IDLIB_NOT_LOCKED if the calling thread does not hold the sequence lock
+ */
+idlib_status
+idlib_seqlock_write_unlock
+  (
+    idlib_seqlock* seqlock
+  );
+
+/**
+ * @since 1.0
+ * @brief Copy data to the data protected by a sequence lock.
+ * @param seqlock A pointer to the sequence lock.
+ * @param target A pointer to the array of <code>n</code> Bytes protected by the sequence lock.
+ * @param source A pointer to an array of <code>n</code> Bytes.
+ * @param n The number of Bytes.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks This function is mt-safe.
+ */
+idlib_status
+idlib_seqlock_write
+  (
+    idlib_seqlock* seqlock,
+    void* target,
+    void const* source,
+    size_t n
+  );
+
+#endif // IDLIB_PROCESS_SEQLOCK_H_INCLUDED
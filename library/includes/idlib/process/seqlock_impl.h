@@ -0,0 +1,56 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_SEQLOCK_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_SEQLOCK_IMPL_H_INCLUDED
+
+#include "idlib/process/configure.h"
+
+#include "idlib/process/mutex.h"
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/fiber_impl.h"
+
+typedef struct idlib_seqlock_impl {
+  // Odd while a writer writes.
+  uint32_t volatile sequence;
+  // Serializes the writers.
+  idlib_mutex mutex;
+  // The writer holding the mutex (see idlib_seqlock_impl_self) or a null pointer.
+  // Unlike the mutex, a sequence lock is not recursive: the sequence counter must be odd exactly while the writer writes.
+  void* volatile owner;
+} idlib_seqlock_impl;
+
+// The address of this variable identifies the calling thread if it does not run a fiber.
+extern IDLIB_THREAD_LOCAL char idlib_seqlock_impl_thread;
+
+// The writer is the fiber if the calling thread runs a fiber as a fiber may resume on another thread.
+static inline void*
+idlib_seqlock_impl_self
+  (
+  )
+{
+  idlib_fiber_impl* fiber = idlib_fiber_impl_of_thread;
+  return fiber ? (void*)fiber : (void*)&idlib_seqlock_impl_thread;
+}
+
+#endif // IDLIB_PROCESS_SEQLOCK_IMPL_H_INCLUDED
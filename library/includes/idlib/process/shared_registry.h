@@ -0,0 +1,154 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_SHARED_REGISTRY_H_INCLUDED)
+#define IDLIB_PROCESS_SHARED_REGISTRY_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+// The type of a registry shared between processes.
+// The entries are stored in a named shared memory segment which each process maps.
+typedef struct idlib_shared_registry idlib_shared_registry;
+
+struct idlib_shared_registry {
+  void* pimpl;
+}; // struct idlib_shared_registry
+
+/**
+ * @since 1.0
+ * @brief Open a shared registry.
+ * If no shared registry of the specified name exists, it is created with the specified size.
+ * Otherwise the existing shared registry is opened and the specified size is ignored.
+ * @param registry A pointer to the shared registry.
+ * @param name The name of the shared registry. A sequence of at most 200 letters, digits, `-`, `_`, and `.`.
+ * @param size The size, in Bytes, of the shared memory segment if it is created. At least 4096.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `registry` or `name` is null or `name` is not a valid name
+ * - IDLIB_TOO_SMALL if the shared registry is created and `size` is smaller than 4096
+ * - IDLIB_ENVIRONMENT_FAILED if the shared memory segment could not be created, opened, or mapped or is not a shared registry of this version
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_TIMED_OUT if the shared registry exists but its creator did not initialize it within one second (e.g., as the creator terminated)
+ * @remarks
+ * A shared registry which timed out remains unusable until it is unlinked.
+ */
+idlib_status
+idlib_shared_registry_open
+  (
+    idlib_shared_registry* registry,
+    char const* name,
+    size_t size
+  );
+
+/**
+ * @since 1.0
+ * @brief Close a shared registry.
+ * The pointers to values obtained from the shared registry become invalid.
+ * The shared registry continues to exist until it is unlinked (under Windows, until the last process has closed it).
+ * @param registry A pointer to the shared registry.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ */
+idlib_status
+idlib_shared_registry_close
+  (
+    idlib_shared_registry* registry
+  );
+
+/**
+ * @since 1.0
+ * @brief Remove the name of a shared registry.
+ * Processes which have opened the shared registry can continue to use it.
+ * @param name The name of the shared registry.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `name` is null or not a valid name
+ * - IDLIB_NOT_EXISTS if no shared registry of the specified name exists
+ * - IDLIB_OPERATION_INVALID under Windows: a named file mapping can not be unlinked,
+ *   the shared registry is destroyed when the last process has closed it
+ */
+idlib_status
+idlib_shared_registry_unlink
+  (
+    char const* name
+  );
+
+/**
+ * @since 1.0
+ * @brief Add an entry for the specified key and a copy of the specified value.
+ * @param registry A pointer to the shared registry.
+ * @param p A pointer to a sequence of <code>n</code> Bytes.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param v A pointer to a sequence of <code>m</code> Bytes. The value.
+ * @param m The number of Bytes in the array pointed to by <code>v</code>.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `registry` or `p` is null or `v` is null and `m` is not zero
+ * - IDLIB_EXISTS if an entry for the key (`p`, `n`) exists
+ * - IDLIB_ALLOCATION_FAILED if the shared memory segment is full
+ * - IDLIB_ENVIRONMENT_FAILED if the shared memory segment is corrupted
+ * @remarks
+ * This function is mt-safe and may be called by different processes concurrently.
+ * If a process terminates while it adds an entry, the lock of the writers is taken over by the next writer.
+ * Entries can not be removed.
+ */
+idlib_status
+idlib_shared_registry_add
+  (
+    idlib_shared_registry* registry,
+    void const* p,
+    size_t n,
+    void const* v,
+    size_t m
+  );
+
+/**
+ * @since 1.0
+ * @brief Get a pointer to the value of the entry of the specified key.
+ * @param registry A pointer to the shared registry.
+ * @param p A pointer to a sequence of <code>n</code> Bytes.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param v [out] A pointer to a `void const*` variable.
+ * @param m [out] A pointer to a `size_t` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `registry`, `p`, `v`, or `m` is null
+ * - IDLIB_NOT_EXISTS if no entry for the key (`p`, `n`) was found
+ * - IDLIB_ENVIRONMENT_FAILED if the shared memory segment is corrupted
+ * @success `*v` was assigned a pointer to the value in the shared memory segment and `*m` was assigned its size.
+ * The value is aligned to 16 Bytes, must not be modified, and remains valid until the shared registry is closed.
+ * @remarks
+ * This function is mt-safe and does not acquire a lock.
+ */
+idlib_status
+idlib_shared_registry_get
+  (
+    idlib_shared_registry* registry,
+    void const* p,
+    size_t n,
+    void const** v,
+    size_t* m
+  );
+
+#endif // IDLIB_PROCESS_SHARED_REGISTRY_H_INCLUDED
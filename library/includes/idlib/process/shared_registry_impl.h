@@ -0,0 +1,119 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_SHARED_REGISTRY_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_SHARED_REGISTRY_IMPL_H_INCLUDED
+
+#include "idlib/process/configure.h"
+
+#include "idlib/process/atomic.h"
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  /* Intentionally empty. */
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// The layout of the shared memory segment of a shared registry.
+// The segment contains no pointers but only offsets relative to its start such that each process may map it at a different address.
+//
+// The segment starts with a header followed by the buckets of the hash table.
+// The remainder of the segment is allocated by incrementing header.top.
+// An entry is followed by its key, the value follows at the next multiple of IDLIB_SHARED_REGISTRY_ALIGNMENT.
+//
+// Writers acquire header.lock, readers acquire no lock.
+// The lock word contains the process identifier of the holder such that the lock of a terminated holder can be taken over.
+// A writer publishes an entry by a release store of its offset to its bucket after the entry, its key, and its value were written.
+// Entries are never removed or modified after they were published.
+
+#define IDLIB_SHARED_REGISTRY_MAGIC "IDLIBSR"
+
+#define IDLIB_SHARED_REGISTRY_VERSION (2)
+
+#define IDLIB_SHARED_REGISTRY_ALIGNMENT (16)
+
+// The minimum size of the segment.
+#define IDLIB_SHARED_REGISTRY_MINIMUM_SIZE (4096)
+
+// The segment was created but not yet initialized.
+#define IDLIB_SHARED_REGISTRY_STATE_INITIAL (0)
+
+// The segment was initialized.
+#define IDLIB_SHARED_REGISTRY_STATE_READY (1)
+
+// The time, in nanoseconds, a process opening a segment waits for the creator to initialize it.
+#define IDLIB_SHARED_REGISTRY_INITIALIZATION_TIMEOUT (UINT64_C(1000000000))
+
+// The bit of the lock word which is set if processes might wait.
+#define IDLIB_SHARED_REGISTRY_LOCK_WAITERS (UINT32_C(0x80000000))
+
+// The time, in nanoseconds, after which a waiting process checks if the holder of the lock has terminated.
+#define IDLIB_SHARED_REGISTRY_LOCK_POLL_INTERVAL (UINT64_C(10000000))
+
+typedef struct idlib_shared_registry_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t volatile state;
+  // 0 if unlocked, the process identifier of the holder otherwise.
+  // IDLIB_SHARED_REGISTRY_LOCK_WAITERS is set in addition if processes might wait.
+  uint32_t volatile lock;
+  uint32_t reserved;
+  // The size of the segment.
+  uint64_t size;
+  // The number of buckets. A power of two.
+  uint64_t number_of_buckets;
+  // The offset of the array of number_of_buckets entry offsets.
+  uint64_t buckets;
+  // The offset of the first unallocated Byte.
+  uint64_t top;
+  // The number of entries.
+  uint64_t number_of_entries;
+} idlib_shared_registry_header;
+
+typedef struct idlib_shared_registry_entry {
+  // The offset of the next entry in the bucket or 0.
+  uint64_t next;
+  // The hash value of the key.
+  uint64_t hash;
+  // The size of the key.
+  uint64_t n;
+  // The size of the value.
+  uint64_t m;
+  // The offset of the value.
+  uint64_t value;
+} idlib_shared_registry_entry;
+
+typedef struct idlib_shared_registry_impl {
+  // The address at which the segment is mapped into this process.
+  idlib_shared_registry_header* header;
+  // The size of the mapping.
+  size_t size;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  HANDLE mapping;
+#endif
+} idlib_shared_registry_impl;
+
+#endif // IDLIB_PROCESS_SHARED_REGISTRY_IMPL_H_INCLUDED
@@ -63,4 +63,6 @@ typedef uint32_t idlib_status;
 
 #define IDLIB_NOT_REPRESENTABLE (17)
 
+#define IDLIB_TIMED_OUT (18)
+
 #endif // IDLIB_PROCESS_STATUS_H_INCLUDED
@@ -0,0 +1,182 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_TIMER_H_INCLUDED)
+#define IDLIB_PROCESS_TIMER_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// uint64_t
+#include <stdint.h>
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief The resolution, in nanoseconds, of the timers. One millisecond.
+ */
+#define IDLIB_TIMER_RESOLUTION (1000000)
+
+/**
+ * @since 1.0
+ * @brief The type of a callback of a timer.
+ * @param context The context passed to idlib_timer_schedule.
+ */
+typedef void (idlib_timer_callback)(void* context);
+
+/**
+ * @since 1.0
+ * @brief The type of an executor of the callbacks of expired timers.
+ * An executor must invoke or arrange for the invocation of the callback with the context.
+ * It is invoked on the thread of the timer service and should not block.
+ * @param executor_context The executor context passed to idlib_timer_service_initialize.
+ * @param callback The callback of the timer.
+ * @param context The context of the timer.
+ */
+typedef void (idlib_timer_executor)(void* executor_context, idlib_timer_callback* callback, void* context);
+
+/**
+ * @since 1.0
+ * @brief The type of the identifier of a scheduled timer.
+ */
+typedef uint64_t idlib_timer_id;
+
+// The type of a timer service.
+// The timers are stored in a hierarchical hashed timer wheel with four levels of 256 slots.
+// A dedicated thread sleeps until the next non-empty slot and dispatches the callbacks of the expired timers.
+typedef struct idlib_timer_service idlib_timer_service;
+
+struct idlib_timer_service {
+  void* pimpl;
+}; // struct idlib_timer_service
+
+/**
+ * @since 1.0
+ * @brief Initialize a timer service and start its thread.
+ * @param service A pointer to the timer service.
+ * @param executor A pointer to the executor or a null pointer.
+ * If this is a null pointer, then the callbacks are invoked on the thread of the timer service.
+ * @param executor_context The context passed to the executor.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `service` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the thread could not be started
+ */
+idlib_status
+idlib_timer_service_initialize
+  (
+    idlib_timer_service* service,
+    idlib_timer_executor* executor,
+    void* executor_context
+  );
+
+/**
+ * @since 1.0
+ * @brief Stop the thread of a timer service and uninitialize the timer service.
+ * Timers which did not expire are discarded without invoking their callbacks.
+ * @param service A pointer to the timer service.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @remarks
+ * This function must not be invoked by a callback of the timer service.
+ */
+idlib_status
+idlib_timer_service_uninitialize
+  (
+    idlib_timer_service* service
+  );
+
+/**
+ * @since 1.0
+ * @brief Schedule a timer.
+ * @param service A pointer to the timer service.
+ * @param delay The delay, in nanoseconds, after which the timer expires.
+ * The delay is rounded up to a multiple of IDLIB_TIMER_RESOLUTION.
+ * @param callback A pointer to the callback.
+ * @param context The context passed to the callback.
+ * @param id [out] A pointer to an idlib_timer_id variable or a null pointer.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `service` or `callback` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_TOO_BIG if the number of scheduled timers is not representable
+ * - the value returned by idlib_mutex_lock if the timer service could not be locked
+ * @success If `id` is not null, `*id` was assigned the identifier of the timer.
+ * @remarks
+ * This function is mt-safe and takes constant time.
+ * The callback is never invoked before the delay has elapsed.
+ */
+idlib_status
+idlib_timer_schedule
+  (
+    idlib_timer_service* service,
+    uint64_t delay,
+    idlib_timer_callback* callback,
+    void* context,
+    idlib_timer_id* id
+  );
+
+/**
+ * @since 1.0
+ * @brief Cancel a timer.
+ * @param service A pointer to the timer service.
+ * @param id The identifier of the timer.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `service` is null
+ * - IDLIB_NOT_EXISTS if the timer was cancelled or its callback was dispatched
+ * - the value returned by idlib_mutex_lock if the timer service could not be locked
+ * @remarks
+ * This function is mt-safe and takes constant time.
+ * This function does not wait for a callback which is running.
+ */
+idlib_status
+idlib_timer_cancel
+  (
+    idlib_timer_service* service,
+    idlib_timer_id id
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the timer service of the process singleton.
+ * The timer service is started by the first invocation of this function and stopped when the process singleton is destroyed.
+ * Its callbacks are invoked on its thread.
+ * @param process A pointer to the process singleton.
+ * @param service [out] A pointer to an `idlib_timer_service*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `service` is null
+ * - the value returned by idlib_timer_service_initialize if the timer service could not be started
+ * @remarks
+ * This function is mt-safe.
+ * The callbacks of this timer service may acquire and relinquish the process singleton
+ * but must not relinquish the last reference to it as that would stop the timer service.
+ */
+idlib_status
+idlib_process_get_timer_service
+  (
+    idlib_process* process,
+    idlib_timer_service** service
+  );
+
+#endif // IDLIB_PROCESS_TIMER_H_INCLUDED
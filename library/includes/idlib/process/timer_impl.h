@@ -0,0 +1,108 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_TIMER_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_TIMER_IMPL_H_INCLUDED
+
+#include "idlib/process/timer.h"
+#include "idlib/process/mutex.h"
+#include "idlib/process/atomic.h"
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  #include <pthread.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// The number of levels of the timer wheel.
+#define IDLIB_TIMER_LEVELS (4)
+
+// The binary logarithm of the number of slots of a level.
+#define IDLIB_TIMER_SLOT_BITS (8)
+
+// The number of slots of a level.
+#define IDLIB_TIMER_SLOTS (1 << IDLIB_TIMER_SLOT_BITS)
+
+// The list of expired timers which were not yet dispatched.
+#define IDLIB_TIMER_EXPIRED (IDLIB_TIMER_LEVELS * IDLIB_TIMER_SLOTS)
+
+// The null index.
+#define IDLIB_TIMER_NULL UINT32_MAX
+
+// A timer.
+// The timers are stored in an array and refer to each other by their indices such that the array can grow.
+// The identifier of a timer is its generation in the upper and its index in the lower 32 bits.
+typedef struct idlib_timer_node {
+  // Incremented when the timer is cancelled or dispatched.
+  uint32_t generation;
+  // The list of the timer or IDLIB_TIMER_NULL if the timer is free.
+  uint32_t list;
+  uint32_t previous;
+  // The next timer in the list of the timer or in the free list.
+  uint32_t next;
+  // The tick at which the timer expires.
+  uint64_t expiry;
+  idlib_timer_callback* callback;
+  void* context;
+} idlib_timer_node;
+
+typedef struct idlib_timer_service_impl {
+  // Guards the fields below except for stop, sequence, and base.
+  idlib_mutex mutex;
+  idlib_timer_executor* executor;
+  void* executor_context;
+  // The value of the clock at tick zero.
+  uint64_t base;
+  // The tick which is processed next. All timers expiring before it were moved to the list of expired timers.
+  uint64_t current;
+  // The tick at which the thread wakes up or UINT64_MAX if it waits for a timer to be scheduled.
+  uint64_t wakeup;
+  // The heads of the lists of the slots and of the list of expired timers.
+  uint32_t heads[IDLIB_TIMER_EXPIRED + 1];
+  // The occupied slots of level zero.
+  uint64_t occupied[IDLIB_TIMER_SLOTS / 64];
+  // The number of timers in the slots.
+  uint32_t number_of_timers;
+  idlib_timer_node* nodes;
+  uint32_t number_of_nodes;
+  uint32_t capacity;
+  uint32_t free;
+  // Non-zero if the thread shall stop. Not guarded by the mutex.
+  uint32_t volatile stop;
+  // Incremented to wake up the thread.
+  uint32_t volatile sequence;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_t thread;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  HANDLE thread;
+#else
+  #error("operating system not (yet) supported")
+#endif
+} idlib_timer_service_impl;
+
+#endif // IDLIB_PROCESS_TIMER_IMPL_H_INCLUDED
@@ -0,0 +1,208 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_TLS_H_INCLUDED)
+#define IDLIB_PROCESS_TLS_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+#include "idlib/process/atomic.h"
+
+// NULL
+#include <stddef.h>
+
+// uint32_t
+#include <stdint.h>
+
+// Per-thread storage slots.
+// Slots are allocated from the process singleton such that all modules of the process agree on them.
+// The values of the slots of a thread are stored in a dense array, the block of the thread.
+// Each module caches a pointer to the block in a thread-local variable, hence reading a slot costs one thread-local load and one indexed load.
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief The maximum number of slots allocated at the same time.
+ */
+#define IDLIB_TLS_MAXIMUM_SLOTS (1024)
+
+/**
+ * @since 1.0
+ * @brief The maximum number of times the destructors are invoked when a thread terminates.
+ * Destructors may assign values to slots which are destroyed in the next pass.
+ */
+#define IDLIB_TLS_DESTRUCTOR_PASSES (4)
+
+/**
+ * @since 1.0
+ * @brief The type of a slot.
+ */
+typedef uint32_t idlib_tls_slot;
+
+/**
+ * @since 1.0
+ * @brief The type of a destructor of the values of a slot.
+ * @param value The value. Not null.
+ */
+typedef void (idlib_tls_destructor)(void* value);
+
+typedef struct idlib_tls_block idlib_tls_block;
+
+// The block of a thread.
+// Exposed for idlib_tls_get only.
+struct idlib_tls_block {
+  void* values[IDLIB_TLS_MAXIMUM_SLOTS];
+  // The registry of the slots.
+  // Null if the registry was destroyed while the owning thread was alive.
+  // Such a block is not freed as the modules of the thread may still cache it.
+  // It is attached to the next registry when the thread sets a value.
+  void* volatile registry;
+  idlib_tls_block* next;
+  // Non-zero if the owning thread has terminated.
+  uint32_t volatile retired;
+  // Non-zero while the terminating owning thread acquires a reference to the registry.
+  uint32_t volatile pinned;
+};
+
+// The block of the calling thread as seen by this module or null.
+extern IDLIB_THREAD_LOCAL idlib_tls_block* idlib_tls_block_of_thread;
+
+// Get the block of the calling thread.
+// If the thread has no block and `create` is zero, then `*block` is assigned null.
+idlib_status
+idlib_tls_impl_attach
+  (
+    idlib_process* process,
+    int create,
+    idlib_tls_block** block
+  );
+
+/**
+ * @since 1.0
+ * @brief Allocate a slot.
+ * The value of the slot is null for all threads.
+ * @param process A pointer to the process singleton.
+ * @param destructor A pointer to the destructor of the values of the slot or a null pointer.
+ * @param slot [out] A pointer to an idlib_tls_slot variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `slot` is null
+ * - IDLIB_TOO_BIG if IDLIB_TLS_MAXIMUM_SLOTS slots are allocated
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the thread-local storage of the operating system could not be allocated
+ * @success `*slot` was assigned the slot.
+ * @remarks
+ * This function is mt-safe.
+ * When a thread terminates, the destructor is invoked for each non-null value of the slot of that thread.
+ */
+idlib_status
+idlib_tls_allocate
+  (
+    idlib_process* process,
+    idlib_tls_destructor* destructor,
+    idlib_tls_slot* slot
+  );
+
+/**
+ * @since 1.0
+ * @brief Free a slot.
+ * The values of the slot are not destroyed.
+ * @param process A pointer to the process singleton.
+ * @param slot The slot.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` is null or `slot` is not smaller than IDLIB_TLS_MAXIMUM_SLOTS
+ * - IDLIB_NOT_EXISTS if the slot is not allocated
+ * @remarks
+ * This function is mt-safe.
+ * The slot must not be used by other threads while it is freed.
+ */
+idlib_status
+idlib_tls_free
+  (
+    idlib_process* process,
+    idlib_tls_slot slot
+  );
+
+/**
+ * @since 1.0
+ * @brief Set the value of a slot for the calling thread.
+ * @param process A pointer to the process singleton.
+ * @param slot The slot. Must be allocated.
+ * @param value The value or a null pointer.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` is null or `slot` is not smaller than IDLIB_TLS_MAXIMUM_SLOTS
+ * - IDLIB_ALLOCATION_FAILED if the block of the thread could not be allocated
+ * - IDLIB_ENVIRONMENT_FAILED if the block of the thread could not be registered with the operating system
+ * @remarks
+ * The first invocation by a thread allocates its block.
+ */
+idlib_status
+idlib_tls_set
+  (
+    idlib_process* process,
+    idlib_tls_slot slot,
+    void* value
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the value of a slot for the calling thread.
+ * @param process A pointer to the process singleton.
+ * @param slot The slot. Must be allocated.
+ * @param value [out] A pointer to a `void*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `value` is null or `slot` is not smaller than IDLIB_TLS_MAXIMUM_SLOTS
+ * @success `*value` was assigned the value of the slot or null if no value was set.
+ * @remarks
+ * This function does not block and does not allocate.
+ * Once the block of the thread is cached by the module, it reads the value without synchronization.
+ */
+static inline idlib_status
+idlib_tls_get
+  (
+    idlib_process* process,
+    idlib_tls_slot slot,
+    void** value
+  )
+{
+  if (IDLIB_UNLIKELY(!process || !value || slot >= IDLIB_TLS_MAXIMUM_SLOTS)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_tls_block* block = idlib_tls_block_of_thread;
+  if (IDLIB_UNLIKELY(!block || !block->registry)) {
+    idlib_status status = idlib_tls_impl_attach(process, 0, &block);
+    if (status) {
+      return status;
+    }
+    if (!block) {
+      *value = NULL;
+      return IDLIB_SUCCESS;
+    }
+  }
+  *value = block->values[slot];
+  return IDLIB_SUCCESS;
+}
+
+#endif // IDLIB_PROCESS_TLS_H_INCLUDED
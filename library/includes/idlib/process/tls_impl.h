@@ -0,0 +1,87 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_TLS_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_TLS_IMPL_H_INCLUDED
+
+#include "idlib/process/tls.h"
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  #include <pthread.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+typedef struct idlib_tls_registry idlib_tls_registry;
+
+// The slots of the process singleton and the blocks of the threads.
+struct idlib_tls_registry {
+  // Guards this registry.
+  // A spin lock as it is only acquired when slots are allocated or freed and when threads acquire or retire their blocks.
+  uint32_t volatile lock;
+  // The greatest slot ever allocated plus 1.
+  uint32_t number_of_slots;
+  // Non-zero if the slot is allocated.
+  uint8_t allocated[IDLIB_TLS_MAXIMUM_SLOTS];
+  // The destructors of the slots.
+  idlib_tls_destructor* destructors[IDLIB_TLS_MAXIMUM_SLOTS];
+  // The list of blocks including the blocks of terminated threads which are reused.
+  idlib_tls_block* blocks;
+  // Non-zero if the registry was destroyed.
+  // Terminating threads stop invoking destructors and the last of them frees the registry.
+  uint32_t volatile destroying;
+  // The number of references to this registry.
+  // One for the process singleton and one for each terminating thread invoking the destructors of its values.
+  uint32_t volatile reference_count;
+  // Associates the calling thread with its block.
+  // Shared by all modules such that a module can find a block created by another module.
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_key_t key;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  DWORD key;
+#else
+  #error("operating system not (yet) supported")
+#endif
+};
+
+idlib_status
+idlib_tls_impl_create
+  (
+    idlib_tls_registry** registry
+  );
+
+// The values of the slots are not destroyed.
+// The blocks of threads which did not terminate are not freed but detached from the registry.
+// The registry is freed when the threads which are terminating concurrently stopped invoking destructors.
+void
+idlib_tls_impl_destroy
+  (
+    idlib_tls_registry* registry
+  );
+
+#endif // IDLIB_PROCESS_TLS_IMPL_H_INCLUDED
@@ -0,0 +1,177 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_TOPOLOGY_H_INCLUDED)
+#define IDLIB_PROCESS_TOPOLOGY_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// uint32_t
+#include <stdint.h>
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief The description of an online CPU (a hardware thread).
+ * Cores, caches, and nodes are numbered densely from 0 such that they can be used as shard indices.
+ */
+typedef struct idlib_topology_cpu {
+  // The identifier of the CPU used by the operating system.
+  uint32_t id;
+  // The index of the physical core. SMT siblings have the same core.
+  uint32_t core;
+  // The index of the last-level cache.
+  uint32_t cache;
+  // The index of the NUMA node.
+  uint32_t node;
+  // The identifier of the package (socket) used by the operating system.
+  uint32_t package;
+} idlib_topology_cpu;
+
+// The type of the CPU topology.
+// The topology is discovered once by idlib_process_get_topology and does not change afterwards.
+typedef struct idlib_topology idlib_topology;
+
+/**
+ * @since 1.0
+ * @brief Get the CPU topology of the process singleton.
+ * It is discovered by the first invocation (under Linux from /sys/devices/system/cpu and /sys/devices/system/node)
+ * and destroyed when the process singleton is destroyed.
+ * @param process A pointer to the process singleton.
+ * @param topology [out] A pointer to an `idlib_topology*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process` or `topology` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the topology could not be discovered
+ * @success `*topology` was assigned a pointer to the topology.
+ * @remarks
+ * This function is mt-safe.
+ */
+idlib_status
+idlib_process_get_topology
+  (
+    idlib_process* process,
+    idlib_topology** topology
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the number of online CPUs and the number of NUMA nodes.
+ * @param topology A pointer to the topology.
+ * @param number_of_cpus [out] A pointer to a `uint32_t` variable or a null pointer.
+ * @param number_of_nodes [out] A pointer to a `uint32_t` variable or a null pointer.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `topology` is null
+ * @success The variables which are not null were assigned the numbers. Both are at least 1.
+ */
+idlib_status
+idlib_topology_get_counts
+  (
+    idlib_topology* topology,
+    uint32_t* number_of_cpus,
+    uint32_t* number_of_nodes
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the description of an online CPU.
+ * @param topology A pointer to the topology.
+ * @param index The index of the CPU. The CPUs are ordered by their identifiers.
+ * @param cpu [out] A pointer to an idlib_topology_cpu variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `topology` or `cpu` is null or `index` is not smaller than the number of CPUs
+ */
+idlib_status
+idlib_topology_get_cpu
+  (
+    idlib_topology* topology,
+    uint32_t index,
+    idlib_topology_cpu* cpu
+  );
+
+/**
+ * @since 1.0
+ * @brief Get the CPU the calling thread runs on and its NUMA node.
+ * The node is the per-node shard index of the calling thread.
+ * @param topology A pointer to the topology.
+ * @param index [out] A pointer to a `uint32_t` variable or a null pointer.
+ * @param node [out] A pointer to a `uint32_t` variable or a null pointer.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `topology` is null
+ * @success The variables which are not null were assigned the index of the CPU and the index of its node.
+ * @remarks
+ * This function is mt-safe and does not perform a system call under Linux (glibc reads the CPU from rseq or the vDSO) and Windows.
+ * The thread may migrate to another CPU before the function returns unless it is pinned.
+ * If the CPU can not be determined, then CPU 0 is assumed.
+ */
+idlib_status
+idlib_topology_get_current
+  (
+    idlib_topology* topology,
+    uint32_t* index,
+    uint32_t* node
+  );
+
+/**
+ * @since 1.0
+ * @brief Restrict the calling thread to a CPU.
+ * @param topology A pointer to the topology.
+ * @param index The index of the CPU.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `topology` is null or `index` is not smaller than the number of CPUs
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the affinity of the thread could not be set
+ * - IDLIB_OPERATION_INVALID if the operating system does not support thread affinities
+ */
+idlib_status
+idlib_topology_pin_thread_to_cpu
+  (
+    idlib_topology* topology,
+    uint32_t index
+  );
+
+/**
+ * @since 1.0
+ * @brief Restrict the calling thread to the CPUs of a NUMA node.
+ * @param topology A pointer to the topology.
+ * @param node The index of the node.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `topology` is null or `node` is not smaller than the number of nodes
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_ENVIRONMENT_FAILED if the affinity of the thread could not be set
+ * - IDLIB_OPERATION_INVALID if the operating system does not support thread affinities
+ */
+idlib_status
+idlib_topology_pin_thread_to_node
+  (
+    idlib_topology* topology,
+    uint32_t node
+  );
+
+#endif // IDLIB_PROCESS_TOPOLOGY_H_INCLUDED
@@ -0,0 +1,51 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_TOPOLOGY_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_TOPOLOGY_IMPL_H_INCLUDED
+
+#include "idlib/process/topology.h"
+
+struct idlib_topology {
+  uint32_t number_of_cpus;
+  uint32_t number_of_nodes;
+  // The online CPUs ordered by their identifiers.
+  idlib_topology_cpu* cpus;
+  // Maps the identifier of a CPU to its index or UINT32_MAX if the CPU is not online.
+  uint32_t* indices;
+  // The greatest identifier of an online CPU plus 1.
+  uint32_t number_of_indices;
+};
+
+// Discover the topology.
+idlib_status
+idlib_topology_impl_create
+  (
+    idlib_topology** topology
+  );
+
+void
+idlib_topology_impl_destroy
+  (
+    idlib_topology* topology
+  );
+
+#endif // IDLIB_PROCESS_TOPOLOGY_IMPL_H_INCLUDED
@@ -0,0 +1,156 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_TRACE_H_INCLUDED)
+#define IDLIB_PROCESS_TRACE_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// uint8_t, uint32_t, uint64_t
+#include <stdint.h>
+
+// Event tracing.
+// If the library was configured with the CMake option <code>idlib-process.with-tracing</code>,
+// then the library records events of the mutexes, the singleton, and the registry into per-thread ring buffers.
+// idlib_trace_save writes the ring buffers to a binary file.
+// The tool <code>idlib-process.tools.trace-to-json</code> converts such a file into the Chrome trace event format which can be viewed by Perfetto or chrome://tracing.
+
+/**
+ * @since 1.0
+ * @brief A thread starts to acquire a lock. The object is the address of the lock.
+ */
+#define IDLIB_TRACE_EVENT_LOCK_ACQUIRE_START (1)
+
+/**
+ * @since 1.0
+ * @brief A thread acquired a lock. The object is the address of the lock.
+ */
+#define IDLIB_TRACE_EVENT_LOCK_ACQUIRED (2)
+
+/**
+ * @since 1.0
+ * @brief A thread released a lock. The object is the address of the lock.
+ */
+#define IDLIB_TRACE_EVENT_LOCK_RELEASED (3)
+
+/**
+ * @since 1.0
+ * @brief A thread added an entry to the registry. The object is a hash value of the key.
+ */
+#define IDLIB_TRACE_EVENT_REGISTRY_ADD (4)
+
+/**
+ * @since 1.0
+ * @brief A thread removed an entry from the registry. The object is a hash value of the key.
+ */
+#define IDLIB_TRACE_EVENT_REGISTRY_REMOVE (5)
+
+/**
+ * @since 1.0
+ * @brief A thread created the process singleton. The object is the address of the singleton.
+ */
+#define IDLIB_TRACE_EVENT_SINGLETON_CREATE (6)
+
+/**
+ * @since 1.0
+ * @brief A thread destroyed the process singleton. The object is the address of the singleton.
+ */
+#define IDLIB_TRACE_EVENT_SINGLETON_DESTROY (7)
+
+/**
+ * @since 1.0
+ * @brief The capacity, in events, of a ring buffer. A power of two.
+ */
+#define IDLIB_TRACE_RING_CAPACITY (4096)
+
+/**
+ * @since 1.0
+ * @brief An event.
+ * The upper 8 Bits of <code>data</code> are the type of the event (IDLIB_TRACE_EVENT_*),
+ * the lower 56 Bits of <code>data</code> are the object of the event.
+ */
+typedef struct idlib_trace_event {
+  // The time stamp in ticks. The ticks are those of the time stamp counter of the processor if available.
+  uint64_t timestamp;
+  uint64_t data;
+} idlib_trace_event;
+
+#define IDLIB_TRACE_EVENT_TYPE(event) ((uint8_t)((event)->data >> 56))
+
+#define IDLIB_TRACE_EVENT_OBJECT(event) ((event)->data & UINT64_C(0x00FFFFFFFFFFFFFF))
+
+/**
+ * @since 1.0
+ * @brief The magic number of a trace file.
+ */
+#define IDLIB_TRACE_FILE_MAGIC "IDLTRACE"
+
+/**
+ * @since 1.0
+ * @brief The version of the trace file format.
+ */
+#define IDLIB_TRACE_FILE_VERSION (1)
+
+/**
+ * @since 1.0
+ * @brief The header of a trace file.
+ * The header is followed by <code>number_of_rings</code> ring buffers.
+ * Each ring buffer consists of an idlib_trace_file_ring header followed by <code>number_of_events</code> idlib_trace_event values in chronological order.
+ * All values are stored in the byte order of the machine which wrote the file.
+ */
+typedef struct idlib_trace_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t number_of_rings;
+  // The number of ticks per nanosecond.
+  double ticks_per_nanosecond;
+  // The time stamp at which tracing started.
+  uint64_t base_timestamp;
+} idlib_trace_file_header;
+
+typedef struct idlib_trace_file_ring {
+  uint64_t thread_id;
+  uint64_t number_of_events;
+} idlib_trace_file_ring;
+
+/**
+ * @since 1.0
+ * @brief Write the events recorded so far to a file.
+ * @param path The path of the file.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `path` is null
+ * - IDLIB_OPERATION_INVALID if the library was not configured with tracing
+ * - IDLIB_ENVIRONMENT_FAILED if the file could not be written
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @remarks
+ * This function is mt-safe.
+ * Events recorded concurrently to this call may or may not be written.
+ */
+idlib_status
+idlib_trace_save
+  (
+    char const* path
+  );
+
+#endif // IDLIB_PROCESS_TRACE_H_INCLUDED
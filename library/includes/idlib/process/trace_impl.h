@@ -0,0 +1,134 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_TRACE_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_TRACE_IMPL_H_INCLUDED
+
+#include "idlib/process/trace.h"
+#include "idlib/process/atomic.h"
+
+// size_t
+#include <stddef.h>
+
+// The tracing points of the library.
+// If IDLIB_PROCESS_WITH_TRACING is 0, then IDLIB_TRACE expands to nothing and the tracing points have no cost.
+
+#if 1 == IDLIB_PROCESS_WITH_TRACING
+
+  // The monotonic clock in nanoseconds.
+  uint64_t
+  idlib_trace_clock
+    (
+    );
+
+  typedef struct idlib_trace_ring idlib_trace_ring;
+
+  struct idlib_trace_ring {
+    // The number of events written to this ring buffer.
+    // Only written by the owning thread.
+    IDLIB_CACHE_LINE_ALIGNED uint64_t volatile head;
+    uint64_t thread_id;
+    // Non-zero if the owning thread has terminated.
+    uint32_t volatile retired;
+    idlib_trace_ring* next;
+    IDLIB_CACHE_LINE_ALIGNED idlib_trace_event events[IDLIB_TRACE_RING_CAPACITY];
+  };
+
+  // The ring buffer of the calling thread or null.
+  extern IDLIB_THREAD_LOCAL idlib_trace_ring* idlib_trace_ring_of_thread;
+
+  // Assign a ring buffer to the calling thread.
+  // Returns null if no ring buffer could be assigned.
+  idlib_trace_ring*
+  idlib_trace_ring_acquire
+    (
+    );
+
+  static inline uint64_t
+  idlib_trace_timestamp
+    (
+    )
+  {
+  #if (IDLIB_INSTRUCTION_SET_ARCHITECTURE == IDLIB_INSTRUCTION_SET_ARCHITECTURE_X64) || \
+      (IDLIB_INSTRUCTION_SET_ARCHITECTURE == IDLIB_INSTRUCTION_SET_ARCHITECTURE_X86)
+    #if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+      return __rdtsc();
+    #else
+      return __builtin_ia32_rdtsc();
+    #endif
+  #else
+    return idlib_trace_clock();
+  #endif
+  }
+
+  static inline void
+  idlib_trace_emit
+    (
+      uint8_t type,
+      uint64_t object
+    )
+  {
+    idlib_trace_ring* ring = idlib_trace_ring_of_thread;
+    if (IDLIB_UNLIKELY(!ring)) {
+      ring = idlib_trace_ring_acquire();
+      if (!ring) {
+        return;
+      }
+    }
+    uint64_t head = ring->head;
+    idlib_trace_event* event = &ring->events[head & (IDLIB_TRACE_RING_CAPACITY - 1)];
+    event->timestamp = idlib_trace_timestamp();
+    event->data = (object & UINT64_C(0x00FFFFFFFFFFFFFF)) | ((uint64_t)type << 56);
+    idlib_atomic_store_release_u64(&ring->head, head + 1);
+  }
+
+  // FNV-1a hash of a key.
+  static inline uint64_t
+  idlib_trace_hash
+    (
+      void const* p,
+      size_t n
+    )
+  {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (size_t i = 0; i < n; ++i) {
+      hash ^= ((uint8_t const*)p)[i];
+      hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+  }
+
+  // Record an event of the specified type (e.g., LOCK_ACQUIRED) for the specified object (a pointer).
+  #define IDLIB_TRACE(type, object) idlib_trace_emit(IDLIB_TRACE_EVENT_##type, (uint64_t)(uintptr_t)(object))
+
+  // Record an event of the specified type (e.g., REGISTRY_ADD) for the key (p, n).
+  #define IDLIB_TRACE_KEY(type, p, n) idlib_trace_emit(IDLIB_TRACE_EVENT_##type, idlib_trace_hash((p), (n)))
+
+#else
+
+  #define IDLIB_TRACE(type, object)
+
+  #define IDLIB_TRACE_KEY(type, p, n)
+
+#endif
+
+#endif // IDLIB_PROCESS_TRACE_IMPL_H_INCLUDED
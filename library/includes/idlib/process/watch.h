@@ -0,0 +1,155 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_WATCH_H_INCLUDED)
+#define IDLIB_PROCESS_WATCH_H_INCLUDED
+
+#include "idlib/process/configure.h"
+#include "idlib/process/status.h"
+
+// size_t
+#include <stddef.h>
+
+// uint8_t, uint64_t
+#include <stdint.h>
+
+typedef struct idlib_process idlib_process;
+
+/**
+ * @since 1.0
+ * @brief The type of an event of a global.
+ */
+typedef uint8_t idlib_global_event;
+
+/**
+ * @since 1.0
+ * @brief A global was added by idlib_add_global or idlib_add_global_with_destructor.
+ */
+#define IDLIB_GLOBAL_ADDED (1)
+
+/**
+ * @since 1.0
+ * @brief A global was removed by idlib_remove_global or idlib_remove_globals_with_prefix.
+ */
+#define IDLIB_GLOBAL_REMOVED (2)
+
+/**
+ * @since 1.0
+ * @brief The type of a function notified of the events of a global.
+ * @param context The context passed to idlib_watch_global.
+ * @param event The event.
+ * @param p A pointer to the key.
+ * @param n The size of the key.
+ * @param v The value of the global. The value is not destroyed before the function returns.
+ */
+typedef void (idlib_global_watcher)(void* context, idlib_global_event event, void const* p, size_t n, void* v);
+
+/**
+ * @since 1.0
+ * @brief Watch the global of a key.
+ * The watcher is notified when a global of the key is added or removed.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to a sequence of <code>n</code> Bytes, the key.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param watcher A pointer to the watcher.
+ * @param context A pointer passed to the watcher.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, or `watcher` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * @remarks
+ * This function is mt-safe.
+ * The watcher is invoked by the thread which added or removed the global after the registry was unlocked
+ * and without holding the lock of the watches. Hence the watcher may get, watch, and unwatch globals.
+ * The notifications are not serialized: if a global of a key is added and removed by different threads,
+ * the watcher may be notified of the removal before it is notified of the addition.
+ * A watcher which depends on the current state of the key must get the global.
+ * The globals of files mapped by idlib_globals_load_mapped are not notified.
+ */
+idlib_status
+idlib_watch_global
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_watcher* watcher,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * @brief Stop watching the global of a key.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to a sequence of <code>n</code> Bytes, the key.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param watcher A pointer to the watcher.
+ * @param context A pointer passed to the watcher.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, or `watcher` is null
+ * - IDLIB_NOT_EXISTS if the watcher with the context does not watch the key
+ * @remarks
+ * This function is mt-safe.
+ * The watcher is not invoked for that watch after this function returned.
+ * However, an invocation which started before this function was called may still run.
+ * The watcher may unwatch itself.
+ */
+idlib_status
+idlib_unwatch_global
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_watcher* watcher,
+    void* context
+  );
+
+/**
+ * @since 1.0
+ * @brief Wait until a global of a key exists or a deadline passed.
+ * @param process A pointer to the process singleton.
+ * @param p A pointer to a sequence of <code>n</code> Bytes, the key.
+ * @param n The number of Bytes in the array pointed to by <code>p</code>.
+ * @param deadline The deadline. A value of the clock of idlib_clock_now.
+ * @param v [out] A pointer to a `void*` variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * In particular, this function returns
+ * - IDLIB_ARGUMENT_INVALID if `process`, `p`, or `v` is null
+ * - IDLIB_ALLOCATION_FAILED if an allocation failed
+ * - IDLIB_TIMED_OUT if the deadline passed before a global of the key was added
+ * @success `*v` was assigned the value of the global.
+ * @remarks
+ * This function is mt-safe.
+ * The calling thread is only blocked if no global of the key exists.
+ * It is woken by the addition of a global of that key and not by additions of globals of other keys.
+ * Globals of files mapped by idlib_globals_load_mapped while the thread is blocked do not wake it.
+ */
+idlib_status
+idlib_wait_global
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    uint64_t deadline,
+    void** v
+  );
+
+#endif // IDLIB_PROCESS_WATCH_H_INCLUDED
@@ -0,0 +1,89 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if !defined(IDLIB_PROCESS_WATCH_IMPL_H_INCLUDED)
+#define IDLIB_PROCESS_WATCH_IMPL_H_INCLUDED
+
+#include "idlib/process/watch.h"
+
+// The number of buckets of the watches. A power of two.
+#define IDLIB_WATCH_BUCKETS (64)
+
+typedef struct idlib_watch idlib_watch;
+
+// A watcher registered by idlib_watch_global or a thread blocked in idlib_wait_global.
+struct idlib_watch {
+  idlib_watch* next;
+  // The hash value of the key.
+  uint64_t hash;
+  // The key. A copy owned by the watch if the watch is a watcher, the key of the blocked thread otherwise.
+  void const* p;
+  size_t n;
+  // The watcher or a null pointer if the watch is a blocked thread.
+  idlib_global_watcher* watcher;
+  void* context;
+  // The number of threads invoking the watcher. Guarded by the lock.
+  uint32_t references;
+  // Non-zero if the watcher was unwatched while it was invoked. Guarded by the lock.
+  // The watch is skipped and freed by the last thread invoking it.
+  int removed;
+  // 0 while the thread is blocked, 1 after a global of the key was added.
+  uint32_t volatile state;
+  // The value of the added global.
+  void* v;
+};
+
+typedef struct idlib_watch_set idlib_watch_set;
+
+struct idlib_watch_set {
+  // Guards the buckets. A futex: 0 if unlocked, 1 if locked, 2 if locked and threads wait.
+  // Watchers are invoked without holding the lock.
+  uint32_t volatile lock;
+  // The watches of the keys by the hash values of the keys.
+  idlib_watch* buckets[IDLIB_WATCH_BUCKETS];
+};
+
+idlib_status
+idlib_watch_impl_create
+  (
+    idlib_watch_set** set
+  );
+
+void
+idlib_watch_impl_destroy
+  (
+    idlib_watch_set* set
+  );
+
+// Notify the watches of a key of an event.
+// Invoked after the entries lock was released if idlib_process::number_of_watches was non-zero while the entries lock was held.
+void
+idlib_watch_impl_notify
+  (
+    idlib_watch_set* set,
+    uint64_t hash,
+    idlib_global_event event,
+    void const* p,
+    size_t n,
+    void* v
+  );
+
+#endif // IDLIB_PROCESS_WATCH_IMPL_H_INCLUDED
@@ -19,16 +19,24 @@
   3. This notice may not be removed or altered from any source distribution.
 */
 
-// TODO:
-// - Linux version not yet thread-safe.
-
 #define IDLIB_PROCESS_PRIVATE (1)
 #include "idlib/process.h"
 
-// fprintf, stderr
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/metrics_impl.h"
+
+#include "idlib/process/trace_impl.h"
+
+#include "idlib/process/atomic.h"
+
+// qsort
+#include <stdlib.h>
+
+// fprintf, stderr, fopen, fwrite, fclose
 #include <stdio.h>
 
-// malloc, free
+// malloc, calloc, free
 #include <malloc.h>
 
 // memcmp, memcpy
@@ -43,6 +51,18 @@
 
   #include <pthread.h>
 
+  // open, O_RDONLY
+  #include <fcntl.h>
+
+  // mmap, munmap
+  #include <sys/mman.h>
+
+  // fstat
+  #include <sys/stat.h>
+
+  // close
+  #include <unistd.h>
+
 #elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
 
   #define WIN32_LEAN_AND_MEAN
@@ -57,234 +77,1426 @@
 
 #endif
 
-typedef struct _entry _entry;
-
-typedef struct _entries _entries;
-
-struct _entry {
-  _entry* next;
-  void *p;
-  size_t n;
-  void* v;
-};
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
 
-struct _entries {
-  _entry* entries;
-};
+// The initial number of buckets of the hash table.
+#define ENTRIES_MINIMUM_CAPACITY (16)
 
-struct idlib_process {
-  uint64_t reference_count;
-  _entries entries; 
-};
+#endif
 
 static idlib_status
 initialize_entries(_entries* entries) {
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_LIST)
   entries->entries = NULL;
+#elif (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  entries->buckets = calloc(ENTRIES_MINIMUM_CAPACITY, sizeof(_entry*));
+  if (!entries->buckets) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  entries->capacity = ENTRIES_MINIMUM_CAPACITY;
+  entries->size = 0;
+#else
+  #error("registry not (yet) supported")
+#endif
   return IDLIB_SUCCESS;
 }
 
+// Release a reference to an entry.
+// If this was the last reference, then the value and the entry are destroyed.
+static void
+release_entry(_entry* entry) {
+  if (1 == idlib_atomic_fetch_sub_u32(&entry->reference_count, 1)) {
+    if (entry->destructor) {
+      entry->destructor(entry->v);
+    }
+    // The singleton might be destroyed, hence the blocks are returned to the allocator stored in the entry.
+    idlib_allocator* allocator = entry->allocator;
+    idlib_allocator_impl_deallocate(allocator, entry->p, entry->n > 0 ? entry->n : 1);
+    idlib_allocator_impl_deallocate(allocator, entry, sizeof(_entry));
+  }
+}
+
+static void
+uninitialize_chain(_entry* entry) {
+  while (entry) {
+    _entry* next = entry->next;
+    release_entry(entry);
+    entry = next;
+  }
+}
+
 static idlib_status
 uninitialize_entries(_entries* entries) {
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_LIST)
+  uninitialize_chain(entries->entries);
+  entries->entries = NULL;
+#elif (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  for (size_t i = 0; i < entries->capacity; ++i) {
+    uninitialize_chain(entries->buckets[i]);
+  }
+  free(entries->buckets);
+  entries->buckets = NULL;
+  entries->capacity = 0;
+  entries->size = 0;
+#else
+  #error("registry not (yet) supported")
+#endif
   return IDLIB_SUCCESS;
 }
 
-static idlib_process* g = NULL;
-
-#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
-    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
-    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
-
-  static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+// Get the chain of the entries with the specified hash value.
+static inline _entry**
+get_chain(_entries* entries, uint64_t hash) {
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_LIST)
+  (void)hash;
+  return &entries->entries;
+#elif (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  return &entries->buckets[hash & (entries->capacity - 1)];
+#else
+  #error("registry not (yet) supported")
+#endif
+}
 
-#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+// Get the link pointing to the entry with the specified key.
+// The link is a null pointer if no such entry exists.
+// The number of entries visited is added to *probes.
+static inline _entry**
+find_entry(_entries* entries, uint64_t hash, void const* p, size_t n, uint64_t* probes) {
+  _entry** link = get_chain(entries, hash);
+  while (*link) {
+    _entry* entry = *link;
+    (*probes)++;
+    if (entry->hash == hash && entry->n == n && !memcmp(entry->p, p, n)) {
+      break;
+    }
+    link = &entry->next;
+  }
+  return link;
+}
 
-  // The system will free this handle automatically when the process exits.
-  static volatile HANDLE g_lock = NULL;
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
 
-  __declspec(dllexport) idlib_status
-  acquire_impl
-    (
-      idlib_process** process
-    )
-  {
-    if (!process) {
-      return IDLIB_ARGUMENT_INVALID;
-    }
-    if (!InterlockedCompareExchangePointer((volatile void*)&g_lock,NULL, NULL)) {
-      HANDLE mutex = CreateMutex(NULL, FALSE, NULL);
-      if (!mutex) {
-        return IDLIB_ENVIRONMENT_FAILED;
-      }
-      if (NULL != InterlockedCompareExchangePointer((volatile void*)&g_lock, (void*)mutex, NULL)) {
-        CloseHandle(mutex);
-        mutex = NULL;
-      }
-    }
-    if (WAIT_FAILED == WaitForSingleObject(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL), INFINITE)) {
-      return IDLIB_LOCKED;
-    }
-    if (!g) {
-      idlib_process* p = malloc(sizeof(idlib_process));
-      if (!p) {
-        ReleaseMutex(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL));
-        return IDLIB_ALLOCATION_FAILED;
+// Double the number of buckets.
+// If the allocation fails, the number of buckets remains unchanged.
+static void
+grow_entries(_entries* entries) {
+  if (entries->capacity > SIZE_MAX / sizeof(_entry*) / 2) {
+    return;
+  }
+  size_t new_capacity = entries->capacity * 2;
+  _entry** new_buckets = calloc(new_capacity, sizeof(_entry*));
+  if (!new_buckets) {
+    return;
+  }
+  for (size_t i = 0; i < entries->capacity; ++i) {
+    _entry* entry = entries->buckets[i];
+    while (entry) {
+      _entry* next = entry->next;
+      _entry** bucket = &new_buckets[entry->hash & (new_capacity - 1)];
+      entry->next = *bucket;
+      if (entry->next) {
+        entry->next->link = &entry->next;
       }
-      initialize_entries(&p->entries);
-      p->reference_count = 0;
-      g = p;
+      entry->link = bucket;
+      *bucket = entry;
+      entry = next;
     }
-    if (UINT64_MAX == g->reference_count) {
-      ReleaseMutex(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL));
-      return IDLIB_OVERFLOW;
-    }
-    g->reference_count++;
-    *process = g;
-    ReleaseMutex(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL));
-    return IDLIB_SUCCESS;
   }
+  free(entries->buckets);
+  entries->buckets = new_buckets;
+  entries->capacity = new_capacity;
+}
 
-  __declspec(dllexport) idlib_status
-  relinquish_impl
-    (
-      idlib_process** process
-    )
-  {
-    if (WAIT_FAILED == WaitForSingleObject(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL), INFINITE)) {
-      return IDLIB_LOCKED;
-    }
-    if (!g) {
-      return IDLIB_OPERATION_INVALID;
-    }
-    if (0 == g->reference_count) {
-      ReleaseMutex(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL));
-      return IDLIB_UNDERFLOW;
-    }
-    if (0 == --g->reference_count) {
-      uninitialize_entries(&g->entries);
-      free(g);
-      g = NULL;
-    }
-    ReleaseMutex(InterlockedCompareExchangePointer((volatile void*)&g_lock, NULL, NULL));
-    return IDLIB_SUCCESS;
+#endif
+
+// Insert an entry.
+// The entries must not contain an entry with the same key.
+static void
+insert_entry(_entries* entries, _entry* entry) {
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  if (entries->size >= entries->capacity) {
+    grow_entries(entries);
+  }
+  entries->size++;
+#endif
+  _entry** chain = get_chain(entries, entry->hash);
+  entry->next = *chain;
+  if (entry->next) {
+    entry->next->link = &entry->next;
   }
+  entry->link = chain;
+  *chain = entry;
+}
 
+// Remove the entry the specified link points to.
+// The reference held by the entries is transferred to the caller which releases it after the entries lock was released
+// such that readers do not wait for the destructor of the value.
+static void
+remove_entry(_entries* entries, _entry** link) {
+  _entry* entry = *link;
+  *link = entry->next;
+  if (entry->next) {
+    entry->next->link = link;
+  }
+  entry->link = NULL;
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  entries->size--;
 #else
+  (void)entries;
+#endif
+}
 
-  #error("operating system not (yet) supported")
+// Get the chains of the entries.
+static _entry**
+get_chains(_entries* entries, size_t* number_of_chains) {
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_LIST)
+  *number_of_chains = 1;
+  return &entries->entries;
+#elif (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  *number_of_chains = entries->capacity;
+  return entries->buckets;
+#else
+  #error("registry not (yet) supported")
+#endif
+}
 
+// Remove all entries without releasing them.
+// Unlike uninitialize_entries followed by initialize_entries, this function does not allocate.
+static void
+clear_entries(_entries* entries) {
+  size_t number_of_chains;
+  _entry** chains = get_chains(entries, &number_of_chains);
+  for (size_t i = 0; i < number_of_chains; ++i) {
+    for (_entry* entry = chains[i]; NULL != entry; entry = entry->next) {
+      entry->link = NULL;
+    }
+  }
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_LIST)
+  entries->entries = NULL;
+#elif (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+  for (size_t i = 0; i < entries->capacity; ++i) {
+    entries->buckets[i] = NULL;
+  }
+  entries->size = 0;
+#else
+  #error("registry not (yet) supported")
 #endif
+}
 
-idlib_status
-idlib_process_acquire
-  (
-    idlib_process** process
-  )
-{
-  if (!process) {
-    return IDLIB_ARGUMENT_INVALID;
+// Get the number of entries.
+static size_t
+count_entries(_entries* entries) {
+  size_t number_of_chains, number_of_entries = 0;
+  _entry** chains = get_chains(entries, &number_of_chains);
+  for (size_t i = 0; i < number_of_chains; ++i) {
+    for (_entry* entry = chains[i]; NULL != entry; entry = entry->next) {
+      number_of_entries++;
+    }
   }
-#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
-    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
-    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  return number_of_entries;
+}
 
-  if (pthread_mutex_lock(&g_lock)) {
-    return IDLIB_LOCK_FAILED;
+// Initialize the root of the prefix index.
+static void
+initialize_prefix(_prefix_node* root) {
+  root->parent = NULL;
+  root->index = 0;
+  root->label = NULL;
+  root->label_size = 0;
+  root->entry = NULL;
+  root->children = NULL;
+  root->number_of_children = 0;
+  root->capacity = 0;
+}
+
+// The nodes of the prefix index, their labels, and their arrays of children are allocated from the allocator of the singleton like the entries.
+
+// Create a node with a copy of the specified label.
+static _prefix_node*
+create_prefix_node(idlib_allocator* allocator, unsigned char const* label, size_t label_size) {
+  _prefix_node* node = idlib_allocator_impl_allocate(allocator, sizeof(_prefix_node));
+  if (!node) {
+    return NULL;
   }
-  
-  if (!g) {
-    g = malloc(sizeof(idlib_process));
-    if (!g) {
-      pthread_mutex_unlock(&g_lock);
-      return IDLIB_ALLOCATION_FAILED;
+  initialize_prefix(node);
+  if (label_size) {
+    node->label = idlib_allocator_impl_allocate(allocator, label_size);
+    if (!node->label) {
+      idlib_allocator_impl_deallocate(allocator, node, sizeof(_prefix_node));
+      return NULL;
     }
-    initialize_entries(&g->entries);
-    g->reference_count = 0;
+    memcpy(node->label, label, label_size);
+    node->label_size = label_size;
   }
-  if (UINT64_MAX == g->reference_count) {
-    pthread_mutex_unlock(&g_lock);
-    return IDLIB_OVERFLOW;
+  return node;
+}
+
+// Free a node but not its children.
+static void
+free_prefix_node(idlib_allocator* allocator, _prefix_node* node) {
+  if (node->label_size) {
+    idlib_allocator_impl_deallocate(allocator, node->label, node->label_size);
   }
-  g->reference_count++;
-  *process = g;
-  pthread_mutex_unlock(&g_lock);
+  if (node->capacity) {
+    idlib_allocator_impl_deallocate(allocator, node->children, sizeof(_prefix_node*) * node->capacity);
+  }
+  idlib_allocator_impl_deallocate(allocator, node, sizeof(_prefix_node));
+}
 
-#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+// Get the index of the child whose label starts with the specified Byte.
+// If there is no such child, then *found is assigned zero and the index at which such a child is inserted is returned.
+static size_t
+find_prefix_child(_prefix_node* node, unsigned char byte, int* found) {
+  size_t low = 0, high = node->number_of_children;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    unsigned char other = node->children[middle]->label[0];
+    if (other == byte) {
+      *found = 1;
+      return middle;
+    } else if (other < byte) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  *found = 0;
+  return low;
+}
 
-  // We use GetModuleHandle(NULL) for that we always use the same instance of acquire_impl
-  // that always uses the same instance of g_lock.
-  HMODULE module = GetModuleHandle(NULL);
-  if (!module) {
-    return IDLIB_ENVIRONMENT_FAILED;
+// Insert a child at the specified index.
+static idlib_status
+insert_prefix_child(idlib_allocator* allocator, _prefix_node* node, size_t index, _prefix_node* child) {
+  if (node->number_of_children == node->capacity) {
+    if (node->capacity > SIZE_MAX / sizeof(_prefix_node*) / 2) {
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    size_t new_capacity = node->capacity ? node->capacity * 2 : 2;
+    _prefix_node** new_children = idlib_allocator_impl_allocate(allocator, sizeof(_prefix_node*) * new_capacity);
+    if (!new_children) {
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    if (node->capacity) {
+      memcpy(new_children, node->children, sizeof(_prefix_node*) * node->number_of_children);
+      idlib_allocator_impl_deallocate(allocator, node->children, sizeof(_prefix_node*) * node->capacity);
+    }
+    node->children = new_children;
+    node->capacity = new_capacity;
   }
-  idlib_status (*f)(idlib_process**) = (idlib_status(*)(idlib_process**))GetProcAddress(module, "acquire_impl");
-  if (!f) {
-    return IDLIB_NOT_EXISTS;
+  for (size_t i = node->number_of_children; i > index; --i) {
+    node->children[i] = node->children[i - 1];
+    node->children[i]->index = i;
   }
-  return (*f)(process);
+  node->children[index] = child;
+  node->number_of_children++;
+  child->parent = node;
+  child->index = index;
+  return IDLIB_SUCCESS;
+}
 
-#else
+// Remove the child at the specified index without freeing it.
+static void
+remove_prefix_child(_prefix_node* node, size_t index) {
+  node->number_of_children--;
+  for (size_t i = index; i < node->number_of_children; ++i) {
+    node->children[i] = node->children[i + 1];
+    node->children[i]->index = i;
+  }
+}
 
-  #error("operating system not (yet) supported")
+// Get the node of the specified key.
+// If exact is zero, then the node is the root of the subtree of the keys starting with the specified key.
+// Returns a null pointer if no such node exists.
+static _prefix_node*
+find_prefix(_prefix_node* root, void const* p, size_t n, int exact) {
+  unsigned char const* q = (unsigned char const*)p;
+  _prefix_node* node = root;
+  while (n) {
+    int found;
+    size_t i = find_prefix_child(node, q[0], &found);
+    if (!found) {
+      return NULL;
+    }
+    _prefix_node* child = node->children[i];
+    size_t k = child->label_size < n ? child->label_size : n;
+    if (memcmp(child->label, q, k)) {
+      return NULL;
+    }
+    if (k < child->label_size) {
+      return exact ? NULL : child;
+    }
+    node = child;
+    q += k;
+    n -= k;
+  }
+  return node;
+}
 
-#endif
+// Get the node following the specified node in the subtree of the specified root in pre-order (the order of the keys).
+// Returns a null pointer if the specified node is the last node.
+static _prefix_node*
+next_prefix(_prefix_node* root, _prefix_node* node) {
+  if (node->number_of_children) {
+    return node->children[0];
+  }
+  while (node != root) {
+    _prefix_node* parent = node->parent;
+    if (node->index + 1 < parent->number_of_children) {
+      return parent->children[node->index + 1];
+    }
+    node = parent;
+  }
+  return NULL;
+}
 
+// Add an entry to the prefix index.
+// The prefix index must not contain an entry with the same key.
+// If the allocation fails, the prefix index remains valid but not necessarily compact.
+static idlib_status
+insert_prefix(idlib_allocator* allocator, _prefix_node* root, _entry* entry) {
+  unsigned char const* q = (unsigned char const*)entry->p;
+  size_t n = entry->n;
+  _prefix_node* node = root;
+  while (n) {
+    int found;
+    size_t i = find_prefix_child(node, q[0], &found);
+    if (!found) {
+      _prefix_node* leaf = create_prefix_node(allocator, q, n);
+      if (!leaf) {
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      if (insert_prefix_child(allocator, node, i, leaf)) {
+        free_prefix_node(allocator, leaf);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      node = leaf;
+      break;
+    }
+    _prefix_node* child = node->children[i];
+    size_t k = 0;
+    while (k < child->label_size && k < n && child->label[k] == q[k]) {
+      k++;
+    }
+    if (k < child->label_size) {
+      // Split the edge to the child by a node with the common part of the label.
+      _prefix_node* middle = create_prefix_node(allocator, child->label, k);
+      if (!middle) {
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      unsigned char* rest = idlib_allocator_impl_allocate(allocator, child->label_size - k);
+      if (!rest) {
+        free_prefix_node(allocator, middle);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      middle->children = idlib_allocator_impl_allocate(allocator, sizeof(_prefix_node*) * 2);
+      if (!middle->children) {
+        idlib_allocator_impl_deallocate(allocator, rest, child->label_size - k);
+        free_prefix_node(allocator, middle);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      middle->capacity = 2;
+      memcpy(rest, child->label + k, child->label_size - k);
+      idlib_allocator_impl_deallocate(allocator, child->label, child->label_size);
+      child->label = rest;
+      child->label_size -= k;
+      middle->parent = node;
+      middle->index = i;
+      node->children[i] = middle;
+      middle->children[0] = child;
+      middle->number_of_children = 1;
+      child->parent = middle;
+      child->index = 0;
+      child = middle;
+    }
+    node = child;
+    q += k;
+    n -= k;
+  }
+  node->entry = entry;
   return IDLIB_SUCCESS;
 }
 
-idlib_status
-idlib_process_relinquish
-  (
-    idlib_process* process
-  )
-{
-
-#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
-    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
-    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
-
-  if (pthread_mutex_lock(&g_lock)) {
-    return IDLIB_LOCK_FAILED;
+// Remove an entry from the prefix index.
+// Nodes without entries are removed or merged with their only child unless an allocation fails.
+static void
+remove_prefix(idlib_allocator* allocator, _prefix_node* root, _entry* entry) {
+  _prefix_node* node = find_prefix(root, entry->p, entry->n, 1);
+  if (!node || node->entry != entry) {
+    return;
   }
-  if (!g) {
-    pthread_mutex_unlock(&g_lock);
-    return IDLIB_OPERATION_INVALID;
+  node->entry = NULL;
+  while (node->parent && !node->entry) {
+    _prefix_node* parent = node->parent;
+    if (0 == node->number_of_children) {
+      remove_prefix_child(parent, node->index);
+      free_prefix_node(allocator, node);
+      node = parent;
+    } else if (1 == node->number_of_children) {
+      _prefix_node* child = node->children[0];
+      unsigned char* label = idlib_allocator_impl_allocate(allocator, node->label_size + child->label_size);
+      if (!label) {
+        break;
+      }
+      memcpy(label, node->label, node->label_size);
+      memcpy(label + node->label_size, child->label, child->label_size);
+      idlib_allocator_impl_deallocate(allocator, child->label, child->label_size);
+      child->label = label;
+      child->label_size += node->label_size;
+      child->parent = parent;
+      child->index = node->index;
+      parent->children[node->index] = child;
+      free_prefix_node(allocator, node);
+      break;
+    } else {
+      break;
+    }
   }
-  if (0 == g->reference_count) {
-    pthread_mutex_unlock(&g_lock);
-    return IDLIB_UNDERFLOW;
+}
+
+// Free the nodes of the prefix index except for the root.
+static void
+uninitialize_prefix(idlib_allocator* allocator, _prefix_node* root) {
+  _prefix_node* node = root;
+  for (;;) {
+    while (node->number_of_children) {
+      node = node->children[node->number_of_children - 1];
+    }
+    if (node == root) {
+      break;
+    }
+    _prefix_node* parent = node->parent;
+    parent->number_of_children--;
+    free_prefix_node(allocator, node);
+    node = parent;
   }
-  if (0 == --g->reference_count) {
-    uninitialize_entries(&g->entries);
-    free(g);
-    g = NULL;
+  if (root->capacity) {
+    idlib_allocator_impl_deallocate(allocator, root->children, sizeof(_prefix_node*) * root->capacity);
   }
-  pthread_mutex_unlock(&g_lock);
+  initialize_prefix(root);
+}
 
-#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+// The multiplier applied to a displacement before it is mixed into a hash value (2^64 divided by the golden ratio).
+#define FROZEN_DISPLACEMENT_MULTIPLIER UINT64_C(0x9e3779b97f4a7c15)
 
-  // We use GetModuleHandle(NULL) for that we always use the same instance of relinquish_impl
-  // that always uses the same instance of g_lock.
-  HMODULE module = GetModuleHandle(NULL);
-  if (!module) {
-    return IDLIB_ENVIRONMENT_FAILED;
+// The minimum number of displacements tried for a bucket before the number of buckets is increased.
+#define FROZEN_MINIMUM_DISPLACEMENTS (UINT32_C(1) << 16)
+
+// The splitmix64 finalizer.
+static inline uint64_t
+mix_hash(uint64_t x) {
+  x ^= x >> 30;
+  x *= UINT64_C(0xbf58476d1ce4e5b9);
+  x ^= x >> 27;
+  x *= UINT64_C(0x94d049bb133111eb);
+  x ^= x >> 31;
+  return x;
+}
+
+// Map a hash value to a bucket.
+static inline uint32_t
+frozen_bucket(uint64_t hash, uint32_t number_of_buckets) {
+  return (uint32_t)(((hash >> 32) * number_of_buckets) >> 32);
+}
+
+// Map a hash value and the displacement of its bucket to a slot.
+static inline uint32_t
+frozen_slot(uint64_t hash, uint32_t displacement, uint32_t number_of_slots) {
+  uint64_t x = mix_hash(hash ^ ((uint64_t)displacement * FROZEN_DISPLACEMENT_MULTIPLIER));
+  return (uint32_t)(((x >> 32) * number_of_slots) >> 32);
+}
+
+// Get the slot of the entry with the specified key in the specified frozen table.
+// Returns a null pointer if the frozen table is a null pointer or no such entry exists.
+static inline _frozen_slot*
+find_frozen(_frozen* frozen, uint64_t hash, void const* p, size_t n) {
+  if (!frozen) {
+    return NULL;
   }
-  idlib_status(*f)(idlib_process*) = (idlib_status (*)(idlib_process*))GetProcAddress(module, "relinquish_impl");
-  if (!f) {
-    return IDLIB_NOT_EXISTS;
+  uint32_t displacement = frozen->displacements[frozen_bucket(hash, frozen->number_of_buckets)];
+  _frozen_slot* slot = &frozen->slots[frozen_slot(hash, displacement, frozen->number_of_slots)];
+  if (slot->hash == hash && slot->n == n && !memcmp(frozen->keys + slot->offset, p, n)) {
+    return slot;
   }
-  return (*f)(process);
+  return NULL;
+}
 
-#else
+// Free the memory of the specified frozen table.
+static void
+free_frozen(_frozen* frozen) {
+  free(frozen->keys);
+  free(frozen->slots);
+  free(frozen->displacements);
+  free(frozen);
+}
 
-  #error("operating system not (yet) supported")
+// Destroy the specified frozen table and the frozen tables it superseded.
+// Release the references to the entries held by the specified frozen table.
+static void
+uninitialize_frozen(_frozen* frozen) {
+  for (uint32_t i = 0; NULL != frozen && i < frozen->number_of_slots; ++i) {
+    release_entry(frozen->slots[i].entry);
+  }
+  while (frozen) {
+    _frozen* previous = frozen->previous;
+    free_frozen(frozen);
+    frozen = previous;
+  }
+}
 
-#endif
+typedef struct _frozen_bucket {
+  // The number of sources in the bucket.
+  uint32_t size;
+  // The index of the bucket.
+  uint32_t index;
+  // The index of the first source of the bucket in the sorted sources.
+  uint32_t start;
+} _frozen_bucket;
 
-  return IDLIB_SUCCESS;
+// Order buckets by descending size.
+static int
+compare_frozen_buckets(void const* x, void const* y) {
+  uint32_t a = ((_frozen_bucket const*)x)->size, b = ((_frozen_bucket const*)y)->size;
+  return a < b ? 1 : (a > b ? -1 : 0);
 }
 
-idlib_status
-idlib_add_global
+// Try to assign displacements to the specified number of buckets such that the specified hash values map to distinct slots.
+// On success, slots[i] is the slot of the i-th hash value.
+// Returns IDLIB_NOT_REPRESENTABLE if no such displacements were found.
+static idlib_status
+place_frozen(uint64_t const* hashes, uint32_t number_of_sources, uint32_t number_of_buckets, uint32_t* displacements, uint32_t* slots) {
+  idlib_status status = IDLIB_SUCCESS;
+  _frozen_bucket* buckets = calloc(number_of_buckets, sizeof(_frozen_bucket));
+  uint32_t* sorted = malloc(sizeof(uint32_t) * number_of_sources);
+  uint8_t* taken = calloc(number_of_sources, sizeof(uint8_t));
+  if (!buckets || !sorted || !taken) {
+    free(taken);
+    free(sorted);
+    free(buckets);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  // Sort the sources by bucket.
+  for (uint32_t i = 0; i < number_of_sources; ++i) {
+    buckets[frozen_bucket(hashes[i], number_of_buckets)].size++;
+  }
+  for (uint32_t i = 0, start = 0; i < number_of_buckets; ++i) {
+    buckets[i].index = i;
+    buckets[i].start = start;
+    start += buckets[i].size;
+    buckets[i].size = 0;
+  }
+  for (uint32_t i = 0; i < number_of_sources; ++i) {
+    _frozen_bucket* bucket = &buckets[frozen_bucket(hashes[i], number_of_buckets)];
+    sorted[bucket->start + bucket->size++] = i;
+  }
+  // Place the largest buckets first as they are the hardest to place.
+  qsort(buckets, number_of_buckets, sizeof(_frozen_bucket), &compare_frozen_buckets);
+  uint32_t maximum_displacements = number_of_sources > FROZEN_MINIMUM_DISPLACEMENTS / 8 ? (number_of_sources > UINT32_MAX / 8 ? UINT32_MAX : number_of_sources * 8) : FROZEN_MINIMUM_DISPLACEMENTS;
+  for (uint32_t i = 0; i < number_of_buckets && 0 < buckets[i].size && !status; ++i) {
+    _frozen_bucket* bucket = &buckets[i];
+    uint32_t const* members = &sorted[bucket->start];
+    uint32_t displacement = 0;
+    for (; displacement < maximum_displacements; ++displacement) {
+      uint32_t j = 0;
+      for (; j < bucket->size; ++j) {
+        uint32_t slot = frozen_slot(hashes[members[j]], displacement, number_of_sources);
+        if (taken[slot]) {
+          break;
+        }
+        taken[slot] = 1;
+        slots[members[j]] = slot;
+      }
+      if (j == bucket->size) {
+        break;
+      }
+      while (j > 0) {
+        taken[slots[members[--j]]] = 0;
+      }
+    }
+    if (displacement == maximum_displacements) {
+      status = IDLIB_NOT_REPRESENTABLE;
+    } else {
+      displacements[bucket->index] = displacement;
+    }
+  }
+  free(taken);
+  free(sorted);
+  free(buckets);
+  return status;
+}
+
+// Assign displacements to buckets such that the specified hash values map to distinct slots.
+// On success, *displacements is an array of *number_of_buckets displacements and slots[i] is the slot of the i-th hash value.
+// Returns IDLIB_NOT_REPRESENTABLE if two hash values are equal or no such displacements were found.
+static idlib_status
+build_frozen(uint64_t const* hashes, uint32_t number_of_sources, uint32_t* number_of_buckets, uint32_t** displacements, uint32_t* slots) {
+  // Start with an average of four sources per bucket and double the number of buckets on failure.
+  idlib_status status = IDLIB_NOT_REPRESENTABLE;
+  uint32_t n = number_of_sources / 4 > 0 ? number_of_sources / 4 : 1;
+  uint32_t* d = NULL;
+  while (IDLIB_NOT_REPRESENTABLE == status) {
+    free(d);
+    d = calloc(n, sizeof(uint32_t));
+    if (!d) {
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    status = place_frozen(hashes, number_of_sources, n, d, slots);
+    if (!status || n >= number_of_sources) {
+      // Sources with the same hash value are not separated by any number of buckets.
+      break;
+    }
+    n = n > number_of_sources / 2 ? number_of_sources : n * 2;
+  }
+  if (status) {
+    free(d);
+    return status;
+  }
+  *number_of_buckets = n;
+  *displacements = d;
+  return IDLIB_SUCCESS;
+}
+
+// Create a frozen table from the specified sources.
+// The keys of the sources are copied.
+// Returns IDLIB_NOT_REPRESENTABLE if two sources have the same hash value or the sources could not be placed.
+static idlib_status
+create_frozen(_entry* const* sources, uint32_t number_of_sources, _frozen** result) {
+  size_t number_of_key_bytes = 0;
+  for (uint32_t i = 0; i < number_of_sources; ++i) {
+    if (sources[i]->n > SIZE_MAX - number_of_key_bytes) {
+      return IDLIB_TOO_BIG;
+    }
+    number_of_key_bytes += sources[i]->n;
+  }
+  _frozen* frozen = calloc(1, sizeof(_frozen));
+  uint32_t* slots = malloc(sizeof(uint32_t) * number_of_sources);
+  uint64_t* hashes = malloc(sizeof(uint64_t) * number_of_sources);
+  if (!frozen || !slots || !hashes) {
+    free(hashes);
+    free(slots);
+    free(frozen);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  frozen->number_of_slots = number_of_sources;
+  frozen->slots = malloc(sizeof(_frozen_slot) * number_of_sources);
+  frozen->keys = malloc(number_of_key_bytes > 0 ? number_of_key_bytes : 1);
+  if (!frozen->slots || !frozen->keys) {
+    free(hashes);
+    free(slots);
+    free_frozen(frozen);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  for (uint32_t i = 0; i < number_of_sources; ++i) {
+    hashes[i] = sources[i]->hash;
+  }
+  idlib_status status = build_frozen(hashes, number_of_sources, &frozen->number_of_buckets, &frozen->displacements, slots);
+  free(hashes);
+  if (status) {
+    free(slots);
+    free_frozen(frozen);
+    return status;
+  }
+  size_t offset = 0;
+  for (uint32_t i = 0; i < number_of_sources; ++i) {
+    _frozen_slot* slot = &frozen->slots[slots[i]];
+    slot->hash = sources[i]->hash;
+    slot->offset = offset;
+    slot->n = sources[i]->n;
+    slot->v = sources[i]->v;
+    slot->entry = sources[i];
+    memcpy(frozen->keys + offset, sources[i]->p, sources[i]->n);
+    offset += sources[i]->n;
+  }
+  free(slots);
+  *result = frozen;
+  return IDLIB_SUCCESS;
+}
+
+// Get the value of the entry with the specified key in the specified mapped file or the files mapped before it.
+// Returns a null pointer if no such entry exists.
+static inline void*
+find_mapped(_mapped* mapped, uint64_t hash, void const* p, size_t n) {
+  for (; NULL != mapped; mapped = mapped->previous) {
+    if (!mapped->number_of_slots) {
+      continue;
+    }
+    uint32_t displacement = mapped->displacements[frozen_bucket(hash, mapped->number_of_buckets)];
+    idlib_globals_file_slot const* slot = &mapped->slots[frozen_slot(hash, displacement, mapped->number_of_slots)];
+    // The offsets were not validated when the file was mapped.
+    if (slot->hash == hash && slot->n == n && slot->key <= mapped->size && n <= mapped->size - slot->key &&
+        slot->value <= mapped->size && slot->m <= mapped->size - slot->value && !memcmp(mapped->base + slot->key, p, n)) {
+      return (void*)(mapped->base + slot->value);
+    }
+  }
+  return NULL;
+}
+
+// Unmap the specified mapped file and the files mapped before it.
+static void
+uninitialize_mapped(_mapped* mapped) {
+  while (mapped) {
+    _mapped* previous = mapped->previous;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    munmap((void*)mapped->base, mapped->size);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+    UnmapViewOfFile(mapped->base);
+#else
+    #error("operating system not (yet) supported")
+#endif
+    free(mapped);
+    mapped = previous;
+  }
+}
+
+// The minimum number of blocks of the filter.
+#define FILTER_MINIMUM_BLOCKS (16)
+
+// The number of keys per block before the filter grows (16 bits per key).
+#define FILTER_KEYS_PER_BLOCK (32)
+
+// The minimum number of removes before the filter is rebuilt.
+#define FILTER_MINIMUM_REMOVES (64)
+
+// Get the block of the specified hash value.
+static inline uint64_t volatile*
+get_filter_block(_filter* filter, uint64_t hash) {
+  return &filter->words[((uint32_t)(hash >> 32) & (filter->number_of_blocks - 1)) * IDLIB_PROCESS_FILTER_BLOCK_WORDS];
+}
+
+// Get the bit of the specified hash value in the i-th word of its block.
+// The bits are taken from the mixed hash value six bits at a time.
+static inline uint64_t
+get_filter_bit(uint64_t mixed, int i) {
+  return UINT64_C(1) << ((mixed >> (6 * i)) & 63);
+}
+
+// Return 0 if no entry with the specified hash value was added to the filter.
+static inline int
+query_filter(_filter* filter, uint64_t hash) {
+  uint64_t volatile* block = get_filter_block(filter, hash);
+  uint64_t mixed = mix_hash(hash);
+  for (int i = 0; i < IDLIB_PROCESS_FILTER_BLOCK_WORDS; ++i) {
+    if (!(idlib_atomic_load_relaxed_u64(&block[i]) & get_filter_bit(mixed, i))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Add the specified hash value to the filter.
+static inline void
+insert_filter(_filter* filter, uint64_t hash) {
+  uint64_t volatile* block = get_filter_block(filter, hash);
+  uint64_t mixed = mix_hash(hash);
+  for (int i = 0; i < IDLIB_PROCESS_FILTER_BLOCK_WORDS; ++i) {
+    idlib_atomic_store_relaxed_u64(&block[i], block[i] | get_filter_bit(mixed, i));
+  }
+}
+
+// Add the hash values of the entries to the filter.
+static void
+fill_filter(_filter* filter, _entries* entries) {
+  size_t number_of_chains;
+  _entry** chains = get_chains(entries, &number_of_chains);
+  for (size_t i = 0; i < number_of_chains; ++i) {
+    for (_entry* entry = chains[i]; NULL != entry; entry = entry->next) {
+      insert_filter(filter, entry->hash);
+    }
+  }
+}
+
+// Destroy the specified filter and the filters it superseded.
+static void
+uninitialize_filter(_filter* filter) {
+  while (filter) {
+    _filter* previous = filter->previous;
+    free(filter->allocation);
+    free(filter);
+    filter = previous;
+  }
+}
+
+// Order the stores of the sequence counter before the stores to the filter.
+static inline void
+begin_filter_update(idlib_process* process) {
+  idlib_atomic_store_relaxed_u32(&process->filter_sequence, process->filter_sequence + 1);
+  idlib_atomic_fence_release();
+}
+
+static inline void
+end_filter_update(idlib_process* process) {
+  idlib_atomic_store_release_u32(&process->filter_sequence, process->filter_sequence + 1);
+}
+
+// Replace the filter by a filter with twice as many blocks or create the filter.
+// If the allocation fails, the filter remains unchanged and its false positive rate increases.
+static void
+grow_filter(idlib_process* process) {
+  _filter* previous = process->filter;
+  if (previous && previous->number_of_blocks > UINT32_MAX / 2) {
+    return;
+  }
+  uint32_t number_of_blocks = previous ? previous->number_of_blocks * 2 : FILTER_MINIMUM_BLOCKS;
+  size_t number_of_bytes = (size_t)number_of_blocks * IDLIB_PROCESS_FILTER_BLOCK_WORDS * sizeof(uint64_t);
+  _filter* filter = malloc(sizeof(_filter));
+  if (!filter) {
+    return;
+  }
+  filter->allocation = calloc(1, number_of_bytes + IDLIB_CACHE_LINE_SIZE);
+  if (!filter->allocation) {
+    free(filter);
+    return;
+  }
+  filter->words = (uint64_t volatile*)(((uintptr_t)filter->allocation + IDLIB_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(IDLIB_CACHE_LINE_SIZE - 1));
+  filter->number_of_blocks = number_of_blocks;
+  filter->previous = previous;
+  fill_filter(filter, &process->entries);
+  // Queries still using the superseded filter would miss keys added from now on, hence they must detect the replacement.
+  // The superseded filter is destroyed with the singleton.
+  begin_filter_update(process);
+  idlib_atomic_store_release_pointer((void* volatile*)&process->filter, filter);
+  end_filter_update(process);
+}
+
+// Clear the filter and add the hash values of the entries to it.
+static void
+rebuild_filter(idlib_process* process) {
+  _filter* filter = process->filter;
+  process->filter_removes = 0;
+  process->filter_keys = count_entries(&process->entries);
+  if (!filter) {
+    return;
+  }
+  begin_filter_update(process);
+  size_t number_of_words = (size_t)filter->number_of_blocks * IDLIB_PROCESS_FILTER_BLOCK_WORDS;
+  for (size_t i = 0; i < number_of_words; ++i) {
+    idlib_atomic_store_relaxed_u64(&filter->words[i], 0);
+  }
+  fill_filter(filter, &process->entries);
+  end_filter_update(process);
+}
+
+// Add the hash value of an entry which was added to the entries to the filter.
+static void
+add_filter(idlib_process* process, uint64_t hash) {
+  _filter* filter = process->filter;
+  process->filter_keys++;
+  if (!filter || process->filter_keys > (size_t)filter->number_of_blocks * FILTER_KEYS_PER_BLOCK) {
+    // The entry was already added to the entries, hence it is added to the new filter.
+    grow_filter(process);
+  }
+  if (filter && filter == process->filter) {
+    insert_filter(filter, hash);
+  }
+}
+
+// Account for an entry which was removed from the entries.
+// The filter is rebuilt if more than half of its keys were removed.
+static void
+remove_filter(idlib_process* process) {
+  process->filter_removes++;
+  if (process->filter_removes >= FILTER_MINIMUM_REMOVES && process->filter_removes > process->filter_keys / 2) {
+    rebuild_filter(process);
+  }
+}
+
+static idlib_status
+initialize_entries_lock(idlib_process* process) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pthread_rwlock_init(&process->entries_lock, NULL)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  InitializeSRWLock(&process->entries_lock);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+static void
+uninitialize_entries_lock(idlib_process* process) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_rwlock_destroy(&process->entries_lock);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  /* Intentionally empty. */
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+static idlib_status
+lock_entries_shared(idlib_process* process) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  IDLIB_TRACE(LOCK_ACQUIRE_START, &process->entries_lock);
+  if (pthread_rwlock_rdlock(&process->entries_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_TRACE(LOCK_ACQUIRED, &process->entries_lock);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  IDLIB_TRACE(LOCK_ACQUIRE_START, &process->entries_lock);
+  AcquireSRWLockShared(&process->entries_lock);
+  IDLIB_TRACE(LOCK_ACQUIRED, &process->entries_lock);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+static void
+unlock_entries_shared(idlib_process* process) {
+  IDLIB_TRACE(LOCK_RELEASED, &process->entries_lock);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_rwlock_unlock(&process->entries_lock);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  ReleaseSRWLockShared(&process->entries_lock);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+static idlib_status
+lock_entries_exclusive(idlib_process* process) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  IDLIB_TRACE(LOCK_ACQUIRE_START, &process->entries_lock);
+  if (pthread_rwlock_wrlock(&process->entries_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_TRACE(LOCK_ACQUIRED, &process->entries_lock);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  IDLIB_TRACE(LOCK_ACQUIRE_START, &process->entries_lock);
+  AcquireSRWLockExclusive(&process->entries_lock);
+  IDLIB_TRACE(LOCK_ACQUIRED, &process->entries_lock);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+static void
+unlock_entries_exclusive(idlib_process* process) {
+  IDLIB_TRACE(LOCK_RELEASED, &process->entries_lock);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_rwlock_unlock(&process->entries_lock);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  ReleaseSRWLockExclusive(&process->entries_lock);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+static idlib_process* g = NULL;
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+  static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+
+  // The system will free this handle automatically when the process exits.
+  static HANDLE g_lock = NULL;
+
+  // Creates g_lock.
+  static idlib_once g_lock_once = IDLIB_ONCE_INITIALIZER;
+
+  static idlib_status
+  create_lock
+    (
+      void* context
+    )
+  {
+    g_lock = CreateMutex(NULL, FALSE, NULL);
+    if (!g_lock) {
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+    return IDLIB_SUCCESS;
+  }
+
+  __declspec(dllexport) idlib_status
+  acquire_impl
+    (
+      idlib_process** process
+    )
+  {
+    if (!process) {
+      return IDLIB_ARGUMENT_INVALID;
+    }
+    idlib_status status = idlib_once_call(&g_lock_once, &create_lock, NULL);
+    if (status) {
+      return status;
+    }
+    IDLIB_TRACE(LOCK_ACQUIRE_START, &g_lock);
+    if (WAIT_FAILED == WaitForSingleObject(g_lock, INFINITE)) {
+      return IDLIB_LOCKED;
+    }
+    IDLIB_TRACE(LOCK_ACQUIRED, &g_lock);
+    if (!g) {
+      idlib_process* p = malloc(sizeof(idlib_process));
+      if (!p) {
+        IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+        ReleaseMutex(g_lock);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      IDLIB_METRIC_ADD(process_allocation, 1);
+      initialize_entries_lock(p);
+      if (idlib_metrics_startup(p)) {
+        uninitialize_entries_lock(p);
+        free(p);
+        IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+        ReleaseMutex(g_lock);
+        return IDLIB_ENVIRONMENT_FAILED;
+      }
+      if (initialize_entries(&p->entries)) {
+        idlib_metrics_shutdown(p);
+        uninitialize_entries_lock(p);
+        free(p);
+        IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+        ReleaseMutex(g_lock);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      initialize_prefix(&p->prefix_index);
+      p->allocator = idlib_allocator_impl_get();
+      p->timer_once.state = IDLIB_ONCE_INITIAL;
+      p->topology_once.state = IDLIB_ONCE_INITIAL;
+      p->topology = NULL;
+      p->tls_once.state = IDLIB_ONCE_INITIAL;
+      p->tls = NULL;
+      p->intern_once.state = IDLIB_ONCE_INITIAL;
+      p->intern = NULL;
+      p->watch_once.state = IDLIB_ONCE_INITIAL;
+      p->watches = NULL;
+      p->number_of_watches = 0;
+      p->lock_table_once.state = IDLIB_ONCE_INITIAL;
+      p->lock_table = NULL;
+      p->frozen = NULL;
+      p->mapped = NULL;
+      p->filter = NULL;
+      p->filter_sequence = 0;
+      p->filter_keys = 0;
+      p->filter_removes = 0;
+      p->reference_count = 0;
+      g = p;
+      IDLIB_TRACE(SINGLETON_CREATE, g);
+    }
+    if (UINT64_MAX == g->reference_count) {
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      ReleaseMutex(g_lock);
+      return IDLIB_OVERFLOW;
+    }
+    g->reference_count++;
+    *process = g;
+    IDLIB_METRIC_ADD(process_acquire, 1);
+    IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+    ReleaseMutex(g_lock);
+    return IDLIB_SUCCESS;
+  }
+
+  __declspec(dllexport) idlib_status
+  relinquish_impl
+    (
+      idlib_process* process
+    )
+  {
+    IDLIB_TRACE(LOCK_ACQUIRE_START, &g_lock);
+    if (WAIT_FAILED == WaitForSingleObject(g_lock, INFINITE)) {
+      return IDLIB_LOCKED;
+    }
+    IDLIB_TRACE(LOCK_ACQUIRED, &g_lock);
+    if (!g || process != g) {
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      ReleaseMutex(g_lock);
+      return IDLIB_OPERATION_INVALID;
+    }
+    if (0 == g->reference_count) {
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      ReleaseMutex(g_lock);
+      return IDLIB_UNDERFLOW;
+    }
+    IDLIB_METRIC_ADD(process_relinquish, 1);
+    // See idlib_process_relinquish.
+    while (1 == g->reference_count && IDLIB_ONCE_DONE == g->timer_once.state) {
+      idlib_timer_service service = g->timer_service;
+      g->timer_once.state = IDLIB_ONCE_INITIAL;
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      ReleaseMutex(g_lock);
+      idlib_timer_service_uninitialize(&service);
+      IDLIB_TRACE(LOCK_ACQUIRE_START, &g_lock);
+      if (WAIT_FAILED == WaitForSingleObject(g_lock, INFINITE)) {
+        return IDLIB_LOCKED;
+      }
+      IDLIB_TRACE(LOCK_ACQUIRED, &g_lock);
+    }
+    if (0 == --g->reference_count) {
+      if (IDLIB_ONCE_DONE == g->topology_once.state) {
+        idlib_topology_impl_destroy(g->topology);
+      }
+      if (IDLIB_ONCE_DONE == g->tls_once.state) {
+        idlib_tls_impl_destroy(g->tls);
+      }
+      if (IDLIB_ONCE_DONE == g->intern_once.state) {
+        idlib_intern_impl_destroy(g->intern);
+      }
+      if (IDLIB_ONCE_DONE == g->watch_once.state) {
+        idlib_watch_impl_destroy(g->watches);
+      }
+      if (IDLIB_ONCE_DONE == g->lock_table_once.state) {
+        idlib_lock_table_impl_destroy(g->lock_table);
+      }
+      uninitialize_prefix(g->allocator, &g->prefix_index);
+      uninitialize_entries(&g->entries);
+      uninitialize_frozen(g->frozen);
+      uninitialize_mapped(g->mapped);
+      uninitialize_filter(g->filter);
+      IDLIB_TRACE(SINGLETON_DESTROY, g);
+      idlib_metrics_shutdown(g);
+      uninitialize_entries_lock(g);
+      free(g);
+      g = NULL;
+    }
+    IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+    ReleaseMutex(g_lock);
+    return IDLIB_SUCCESS;
+  }
+
+#else
+
+  #error("operating system not (yet) supported")
+
+#endif
+
+idlib_status
+idlib_process_acquire
+  (
+    idlib_process** process
+  )
+{
+  if (!process) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+  IDLIB_TRACE(LOCK_ACQUIRE_START, &g_lock);
+  if (pthread_mutex_lock(&g_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_TRACE(LOCK_ACQUIRED, &g_lock);
+  
+  if (!g) {
+    idlib_process* p = malloc(sizeof(idlib_process));
+    if (!p) {
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      pthread_mutex_unlock(&g_lock);
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    IDLIB_METRIC_ADD(process_allocation, 1);
+    if (initialize_entries_lock(p)) {
+      free(p);
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      pthread_mutex_unlock(&g_lock);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+    if (idlib_metrics_startup(p)) {
+      uninitialize_entries_lock(p);
+      free(p);
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      pthread_mutex_unlock(&g_lock);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+    if (initialize_entries(&p->entries)) {
+      idlib_metrics_shutdown(p);
+      uninitialize_entries_lock(p);
+      free(p);
+      IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+      pthread_mutex_unlock(&g_lock);
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    initialize_prefix(&p->prefix_index);
+    p->allocator = idlib_allocator_impl_get();
+    p->timer_once.state = IDLIB_ONCE_INITIAL;
+    p->topology_once.state = IDLIB_ONCE_INITIAL;
+    p->topology = NULL;
+    p->tls_once.state = IDLIB_ONCE_INITIAL;
+    p->tls = NULL;
+    p->intern_once.state = IDLIB_ONCE_INITIAL;
+    p->intern = NULL;
+    p->watch_once.state = IDLIB_ONCE_INITIAL;
+    p->watches = NULL;
+    p->number_of_watches = 0;
+    p->lock_table_once.state = IDLIB_ONCE_INITIAL;
+    p->lock_table = NULL;
+    p->frozen = NULL;
+    p->mapped = NULL;
+    p->filter = NULL;
+    p->filter_sequence = 0;
+    p->filter_keys = 0;
+    p->filter_removes = 0;
+    g = p;
+    IDLIB_TRACE(SINGLETON_CREATE, g);
+    g->reference_count = 0;
+  }
+  if (UINT64_MAX == g->reference_count) {
+    IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+    return IDLIB_OVERFLOW;
+  }
+  g->reference_count++;
+  *process = g;
+  IDLIB_METRIC_ADD(process_acquire, 1);
+  IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+  pthread_mutex_unlock(&g_lock);
+
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+
+  // We use GetModuleHandle(NULL) for that we always use the same instance of acquire_impl
+  // that always uses the same instance of g_lock.
+  HMODULE module = GetModuleHandle(NULL);
+  if (!module) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_status (*f)(idlib_process**) = (idlib_status(*)(idlib_process**))GetProcAddress(module, "acquire_impl");
+  if (!f) {
+    return IDLIB_NOT_EXISTS;
+  }
+  return (*f)(process);
+
+#else
+
+  #error("operating system not (yet) supported")
+
+#endif
+
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_process_relinquish
+  (
+    idlib_process* process
+  )
+{
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+  IDLIB_TRACE(LOCK_ACQUIRE_START, &g_lock);
+  if (pthread_mutex_lock(&g_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_TRACE(LOCK_ACQUIRED, &g_lock);
+  if (!g || process != g) {
+    IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+    return IDLIB_OPERATION_INVALID;
+  }
+  if (0 == g->reference_count) {
+    IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+    return IDLIB_UNDERFLOW;
+  }
+  IDLIB_METRIC_ADD(process_relinquish, 1);
+  // The thread of the timer service is stopped without holding g_lock as its callbacks may acquire and relinquish the singleton.
+  // Meanwhile the reference of the caller keeps the singleton alive. A callback may start the timer service again.
+  while (1 == g->reference_count && IDLIB_ONCE_DONE == g->timer_once.state) {
+    idlib_timer_service service = g->timer_service;
+    g->timer_once.state = IDLIB_ONCE_INITIAL;
+    IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+    idlib_timer_service_uninitialize(&service);
+    IDLIB_TRACE(LOCK_ACQUIRE_START, &g_lock);
+    if (pthread_mutex_lock(&g_lock)) {
+      return IDLIB_LOCK_FAILED;
+    }
+    IDLIB_TRACE(LOCK_ACQUIRED, &g_lock);
+  }
+  if (0 == --g->reference_count) {
+    if (IDLIB_ONCE_DONE == g->topology_once.state) {
+      idlib_topology_impl_destroy(g->topology);
+    }
+    if (IDLIB_ONCE_DONE == g->tls_once.state) {
+      idlib_tls_impl_destroy(g->tls);
+    }
+    if (IDLIB_ONCE_DONE == g->intern_once.state) {
+      idlib_intern_impl_destroy(g->intern);
+    }
+    if (IDLIB_ONCE_DONE == g->watch_once.state) {
+      idlib_watch_impl_destroy(g->watches);
+    }
+    if (IDLIB_ONCE_DONE == g->lock_table_once.state) {
+      idlib_lock_table_impl_destroy(g->lock_table);
+    }
+    uninitialize_prefix(g->allocator, &g->prefix_index);
+    uninitialize_entries(&g->entries);
+    uninitialize_frozen(g->frozen);
+    uninitialize_mapped(g->mapped);
+    uninitialize_filter(g->filter);
+    IDLIB_TRACE(SINGLETON_DESTROY, g);
+    idlib_metrics_shutdown(g);
+    uninitialize_entries_lock(g);
+    free(g);
+    g = NULL;
+  }
+  IDLIB_TRACE(LOCK_RELEASED, &g_lock);
+  pthread_mutex_unlock(&g_lock);
+
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+
+  // We use GetModuleHandle(NULL) for that we always use the same instance of relinquish_impl
+  // that always uses the same instance of g_lock.
+  HMODULE module = GetModuleHandle(NULL);
+  if (!module) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_status(*f)(idlib_process*) = (idlib_status (*)(idlib_process*))GetProcAddress(module, "relinquish_impl");
+  if (!f) {
+    return IDLIB_NOT_EXISTS;
+  }
+  return (*f)(process);
+
+#else
+
+  #error("operating system not (yet) supported")
+
+#endif
+
+  return IDLIB_SUCCESS;
+}
+
+// Get if globals are watched such that additions and removals must be notified after the entries lock was released.
+// The entries lock must be held.
+static int
+is_watched(idlib_process* process) {
+  // The full fence orders the insertion of an entry before the load, see idlib_wait_global.
+  idlib_atomic_fence();
+  return 0 != idlib_atomic_load_acquire_u32(&process->number_of_watches);
+}
+
+// Notify the watchers of an entry of an event.
+// The entries lock must not be held and the caller must hold a reference to the entry.
+static void
+notify_entry(idlib_process* process, _entry* entry, idlib_global_event event) {
+  idlib_watch_impl_notify(process->watches, entry->hash, event, entry->p, entry->n, entry->v);
+}
+
+idlib_status
+idlib_add_global
   (
     idlib_process* process,
     void const* p,
@@ -292,30 +1504,72 @@ idlib_add_global
     void* v
   )
 {
-  _entry* entry = process->entries.entries;
-  while (entry) {
-    if (entry->n == n) {
-      if (!memcmp(entry->p, p, n)) {
-        return IDLIB_EXISTS;
-      }
-    }
-    entry = entry->next;
+  return idlib_add_global_with_destructor(process, p, n, v, NULL);
+}
+
+idlib_status
+idlib_add_global_with_destructor
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    void* v,
+    idlib_global_destructor* destructor
+  )
+{
+  if (!process || !p || !v) {
+    return IDLIB_ARGUMENT_INVALID;
   }
-  entry = malloc(sizeof(_entry));
+  uint64_t hash = idlib_process_hash(p, n);
+  if (lock_entries_exclusive(process)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_METRIC_ADD(registry_add, 1);
+  uint64_t probes = process->frozen ? 1 : 0;
+  if (find_frozen(process->frozen, hash, p, n) || find_mapped(process->mapped, hash, p, n) ||
+      *find_entry(&process->entries, hash, p, n, &probes)) {
+    unlock_entries_exclusive(process);
+    IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+    return IDLIB_EXISTS;
+  }
+  IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+  _entry* entry = idlib_allocator_impl_allocate(process->allocator, sizeof(_entry));
   if (!entry) {
+    unlock_entries_exclusive(process);
     return IDLIB_ALLOCATION_FAILED;
   }
-  entry->p = malloc(n > 0 ? n : 1);
+  entry->p = idlib_allocator_impl_allocate(process->allocator, n > 0 ? n : 1);
   if (!entry->p) {
-    free(entry);
+    idlib_allocator_impl_deallocate(process->allocator, entry, sizeof(_entry));
     entry = NULL;
+    unlock_entries_exclusive(process);
     return IDLIB_ALLOCATION_FAILED;
   }
+  IDLIB_METRIC_ADD(process_allocation, 2);
   memcpy(entry->p, p, n);
   entry->n = n;
   entry->v = v;
-  entry->next = process->entries.entries;
-  process->entries.entries = entry;
+  entry->destructor = destructor;
+  entry->allocator = process->allocator;
+  entry->reference_count = 1;
+  entry->hash = hash;
+  if (insert_prefix(process->allocator, &process->prefix_index, entry)) {
+    idlib_allocator_impl_deallocate(process->allocator, entry->p, n > 0 ? n : 1);
+    idlib_allocator_impl_deallocate(process->allocator, entry, sizeof(_entry));
+    entry = NULL;
+    unlock_entries_exclusive(process);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  insert_entry(&process->entries, entry);
+  add_filter(process, hash);
+  IDLIB_TRACE_KEY(REGISTRY_ADD, p, n);
+  // The entry might be removed by another thread once the lock is released, hence a reference is held while it is notified.
+  int watched = is_watched(process) && idlib_atomic_try_add_u32(&entry->reference_count, 1);
+  unlock_entries_exclusive(process);
+  if (watched) {
+    notify_entry(process, entry, IDLIB_GLOBAL_ADDED);
+    release_entry(entry);
+  }
   return IDLIB_SUCCESS;
 }
  
@@ -328,17 +1582,124 @@ idlib_get_global
     void** v
   )
 {
-  _entry* entry = process->entries.entries;
-  while (entry) {
-    if (entry->n == n) {
-      if (!memcmp(entry->p, p, n)) {
-        *v = entry->v;
-        return IDLIB_SUCCESS;
+  if (!process || !p || !v) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  uint64_t hash = idlib_process_hash(p, n);
+  uint32_t sequence = idlib_atomic_load_acquire_u32(&process->filter_sequence);
+  // The frozen table is immutable once published, hence it is consulted without acquiring the lock.
+  _frozen* frozen = idlib_atomic_load_acquire_pointer((void* volatile*)&process->frozen);
+  _frozen_slot* slot = find_frozen(frozen, hash, p, n);
+  if (slot) {
+    *v = slot->v;
+    IDLIB_METRIC_ADD(registry_get, 1);
+    IDLIB_METRIC_ADD(registry_probe, 1);
+    return IDLIB_SUCCESS;
+  }
+  void* value = find_mapped(idlib_atomic_load_acquire_pointer((void* volatile*)&process->mapped), hash, p, n);
+  if (value) {
+    *v = value;
+    IDLIB_METRIC_ADD(registry_get, 1);
+    return IDLIB_SUCCESS;
+  }
+  // Reject the key without acquiring the lock if the filter of the entries does not contain it.
+  // The rejection is only valid if the filter was neither cleared nor replaced in the meantime.
+  if (!(sequence & 1)) {
+    _filter* filter = idlib_atomic_load_acquire_pointer((void* volatile*)&process->filter);
+    if (filter && !query_filter(filter, hash)) {
+      idlib_atomic_fence_acquire();
+      if (sequence == idlib_atomic_load_relaxed_u32(&process->filter_sequence)) {
+        IDLIB_METRIC_ADD(registry_get, 1);
+        IDLIB_METRIC_ADD(registry_filter_reject, 1);
+        return IDLIB_NOT_EXISTS;
       }
     }
-    entry = entry->next;
   }
-  return IDLIB_NOT_EXISTS;
+  if (lock_entries_shared(process)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_METRIC_ADD(registry_get, 1);
+  uint64_t probes = frozen ? 1 : 0;
+  if (process->frozen != frozen) {
+    // The entries were frozen after the frozen table was consulted.
+    probes++;
+    slot = find_frozen(process->frozen, hash, p, n);
+    if (slot) {
+      *v = slot->v;
+      unlock_entries_shared(process);
+      IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+      return IDLIB_SUCCESS;
+    }
+  }
+  _entry* entry = *find_entry(&process->entries, hash, p, n, &probes);
+  if (entry) {
+    *v = entry->v;
+  }
+  unlock_entries_shared(process);
+  IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+  return entry ? IDLIB_SUCCESS : IDLIB_NOT_EXISTS;
+}
+
+idlib_status
+idlib_get_global_ref
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_ref** ref,
+    void** v
+  )
+{
+  if (!process || !p || !ref || !v) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  uint64_t hash = idlib_process_hash(p, n);
+  // The most recent frozen table holds a reference to each of its entries until the singleton is destroyed.
+  _frozen* frozen = idlib_atomic_load_acquire_pointer((void* volatile*)&process->frozen);
+  _frozen_slot* slot = find_frozen(frozen, hash, p, n);
+  _entry* entry = slot ? slot->entry : NULL;
+  if (!entry) {
+    if (lock_entries_shared(process)) {
+      return IDLIB_LOCK_FAILED;
+    }
+    slot = find_frozen(process->frozen, hash, p, n);
+    if (!slot && find_mapped(process->mapped, hash, p, n)) {
+      // The values of mapped files are not reference counted.
+      unlock_entries_shared(process);
+      return IDLIB_OPERATION_INVALID;
+    }
+    uint64_t probes = 0;
+    entry = slot ? slot->entry : *find_entry(&process->entries, hash, p, n, &probes);
+    // The entry can not be removed while the lock is held in shared mode, hence its reference count is positive.
+    if (entry && !idlib_atomic_try_add_u32(&entry->reference_count, 1)) {
+      unlock_entries_shared(process);
+      return IDLIB_OVERFLOW;
+    }
+    unlock_entries_shared(process);
+    IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+  } else if (!idlib_atomic_try_add_u32(&entry->reference_count, 1)) {
+    return IDLIB_OVERFLOW;
+  }
+  IDLIB_METRIC_ADD(registry_get, 1);
+  if (!entry) {
+    return IDLIB_NOT_EXISTS;
+  }
+  *ref = (idlib_global_ref*)entry;
+  *v = entry->v;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_global_ref_release
+  (
+    idlib_global_ref* ref
+  )
+{
+  if (!ref) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  release_entry((_entry*)ref);
+  return IDLIB_SUCCESS;
 }
 
 idlib_status
@@ -346,25 +1707,563 @@ idlib_remove_global
   (
     idlib_process* process,
     void const* p,
-     size_t n
+    size_t n
+  )
+{
+  if (!process || !p) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  uint64_t hash = idlib_process_hash(p, n);
+  if (lock_entries_exclusive(process)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  IDLIB_METRIC_ADD(registry_remove, 1);
+  uint64_t probes = process->frozen ? 1 : 0;
+  if (find_frozen(process->frozen, hash, p, n) || find_mapped(process->mapped, hash, p, n)) {
+    unlock_entries_exclusive(process);
+    IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+    return IDLIB_OPERATION_INVALID;
+  }
+  _entry** link = find_entry(&process->entries, hash, p, n, &probes);
+  if (!*link) {
+    unlock_entries_exclusive(process);
+    IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+    return IDLIB_NOT_EXISTS;
+  }
+  _entry* entry = *link;
+  int watched = is_watched(process);
+  remove_prefix(process->allocator, &process->prefix_index, entry);
+  remove_entry(&process->entries, link);
+  remove_filter(process);
+  IDLIB_TRACE_KEY(REGISTRY_REMOVE, p, n);
+  unlock_entries_exclusive(process);
+  if (watched) {
+    notify_entry(process, entry, IDLIB_GLOBAL_REMOVED);
+  }
+  release_entry(entry);
+  IDLIB_METRIC_ADD(registry_probe, (int64_t)probes);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_remove_globals_with_prefix
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    size_t* number_of_removed
   )
 {
   if (!process || !p) {
     return IDLIB_ARGUMENT_INVALID;
   }
-  _entry** previous = &process->entries.entries;
-  _entry* current = process->entries.entries;
-  while (current) {
-    if (current->n == n) {
-      if (!memcmp(current->p, p, n)) {
-        _entry* node = current;
-        *previous = current->next;
-        free(node);
-        return IDLIB_SUCCESS;
+  if (lock_entries_exclusive(process)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  _prefix_node* root = find_prefix(&process->prefix_index, p, n, 0);
+  // Collect the entries first as removing them modifies the prefix index.
+  _entry** removed = NULL;
+  size_t number_of_entries = 0, capacity = 0;
+  for (_prefix_node* node = root; NULL != node; node = next_prefix(root, node)) {
+    if (!node->entry) {
+      continue;
+    }
+    if (!node->entry->link) {
+      // Like idlib_remove_global, no global is removed if a frozen global matches.
+      free(removed);
+      unlock_entries_exclusive(process);
+      return IDLIB_OPERATION_INVALID;
+    }
+    if (number_of_entries == capacity) {
+      size_t new_capacity = capacity ? capacity * 2 : 16;
+      _entry** new_removed = new_capacity <= SIZE_MAX / sizeof(_entry*) ? realloc(removed, sizeof(_entry*) * new_capacity) : NULL;
+      if (!new_removed) {
+        free(removed);
+        unlock_entries_exclusive(process);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      removed = new_removed;
+      capacity = new_capacity;
+    }
+    removed[number_of_entries++] = node->entry;
+  }
+  IDLIB_METRIC_ADD(registry_remove, (int64_t)number_of_entries);
+  int watched = is_watched(process);
+  for (size_t i = 0; i < number_of_entries; ++i) {
+    _entry* entry = removed[i];
+    IDLIB_TRACE_KEY(REGISTRY_REMOVE, entry->p, entry->n);
+    remove_prefix(process->allocator, &process->prefix_index, entry);
+    remove_entry(&process->entries, entry->link);
+    remove_filter(process);
+  }
+  unlock_entries_exclusive(process);
+  for (size_t i = 0; i < number_of_entries; ++i) {
+    if (watched) {
+      notify_entry(process, removed[i], IDLIB_GLOBAL_REMOVED);
+    }
+    release_entry(removed[i]);
+  }
+  free(removed);
+  if (number_of_removed) {
+    *number_of_removed = number_of_entries;
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_globals_foreach_prefix
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_visitor* visitor,
+    void* context
+  )
+{
+  if (!process || !p || !visitor) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (lock_entries_shared(process)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  idlib_status status = IDLIB_SUCCESS;
+  _prefix_node* root = find_prefix(&process->prefix_index, p, n, 0);
+  for (_prefix_node* node = root; NULL != node && !status; node = next_prefix(root, node)) {
+    if (node->entry) {
+      status = visitor(context, node->entry->p, node->entry->n, node->entry->v);
+    }
+  }
+  unlock_entries_shared(process);
+  return status;
+}
+
+idlib_status
+idlib_process_freeze_globals
+  (
+    idlib_process* process
+  )
+{
+  if (!process) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (lock_entries_exclusive(process)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  _frozen* previous = process->frozen;
+  size_t number_of_chains;
+  _entry** chains = get_chains(&process->entries, &number_of_chains);
+  size_t number_of_sources = previous ? previous->number_of_slots : 0, number_of_entries = count_entries(&process->entries);
+  if (!number_of_entries) {
+    unlock_entries_exclusive(process);
+    return IDLIB_SUCCESS;
+  }
+  if (number_of_entries > UINT32_MAX - number_of_sources) {
+    unlock_entries_exclusive(process);
+    return IDLIB_TOO_BIG;
+  }
+  number_of_sources += number_of_entries;
+  _entry** sources = malloc(sizeof(_entry*) * number_of_sources);
+  if (!sources) {
+    unlock_entries_exclusive(process);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  size_t j = 0;
+  for (uint32_t i = 0; NULL != previous && i < previous->number_of_slots; ++i) {
+    sources[j++] = previous->slots[i].entry;
+  }
+  for (size_t i = 0; i < number_of_chains; ++i) {
+    for (_entry* entry = chains[i]; NULL != entry; entry = entry->next) {
+      sources[j++] = entry;
+    }
+  }
+  _frozen* frozen = NULL;
+  idlib_status status = create_frozen(sources, (uint32_t)number_of_sources, &frozen);
+  free(sources);
+  if (status) {
+    unlock_entries_exclusive(process);
+    return status;
+  }
+  // Readers might still use the superseded frozen table, hence it is destroyed with the singleton.
+  frozen->previous = previous;
+  idlib_atomic_store_release_pointer((void* volatile*)&process->frozen, frozen);
+  clear_entries(&process->entries);
+  rebuild_filter(process);
+  unlock_entries_exclusive(process);
+  return IDLIB_SUCCESS;
+}
+
+// An entry to be written by idlib_globals_save.
+typedef struct _record {
+  uint64_t hash;
+  void const* p;
+  size_t n;
+  // The entry whose value is serialized after the entries lock was released or a null pointer if the blob is known.
+  _entry* entry;
+  void const* blob;
+  size_t m;
+} _record;
+
+// Write the specified number of zero Bytes.
+static int
+write_padding(FILE* file, size_t n) {
+  static char const zeroes[IDLIB_GLOBALS_FILE_ALIGNMENT] = { 0 };
+  return n == fwrite(zeroes, 1, n, file);
+}
+
+static inline uint64_t
+align_globals_file(uint64_t x) {
+  return (x + IDLIB_GLOBALS_FILE_ALIGNMENT - 1) & ~(uint64_t)(IDLIB_GLOBALS_FILE_ALIGNMENT - 1);
+}
+
+// Acquire a reference to a frozen entry or an entry and append it to the records.
+// The entries lock must be held.
+static idlib_status
+append_record(_record* records, uint32_t* number_of_records, _entry** references, uint32_t* number_of_references, _entry* entry) {
+  if (!idlib_atomic_try_add_u32(&entry->reference_count, 1)) {
+    return IDLIB_OVERFLOW;
+  }
+  references[(*number_of_references)++] = entry;
+  _record* record = &records[(*number_of_records)++];
+  record->hash = entry->hash;
+  record->p = entry->p;
+  record->n = entry->n;
+  record->entry = entry;
+  record->blob = NULL;
+  record->m = 0;
+  return IDLIB_SUCCESS;
+}
+
+// Serialize the values of the entries of the records and remove the records of the values which shall not be saved.
+// The entries lock must not be held such that the serializer may add or remove globals.
+static idlib_status
+serialize_records(_record* records, uint32_t* number_of_records, idlib_global_serializer* serializer, void* context) {
+  uint32_t j = 0;
+  for (uint32_t i = 0; i < *number_of_records; ++i) {
+    _record record = records[i];
+    if (record.entry) {
+      idlib_status status = serializer(context, record.p, record.n, record.entry->v, &record.blob, &record.m);
+      if (IDLIB_NOT_EXISTS == status) {
+        continue;
+      }
+      if (status) {
+        return status;
+      }
+      if (!record.blob && record.m) {
+        return IDLIB_ARGUMENT_INVALID;
+      }
+    }
+    records[j++] = record;
+  }
+  *number_of_records = j;
+  return IDLIB_SUCCESS;
+}
+
+// Write the records to the file.
+static idlib_status
+write_globals_file(FILE* file, _record const* records, uint32_t number_of_records) {
+  uint32_t* slots = malloc(sizeof(uint32_t) * (number_of_records > 0 ? number_of_records : 1));
+  uint64_t* hashes = malloc(sizeof(uint64_t) * (number_of_records > 0 ? number_of_records : 1));
+  if (!slots || !hashes) {
+    free(hashes);
+    free(slots);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  for (uint32_t i = 0; i < number_of_records; ++i) {
+    hashes[i] = records[i].hash;
+  }
+  uint32_t number_of_buckets = 1;
+  uint32_t* displacements = NULL;
+  idlib_status status = IDLIB_SUCCESS;
+  if (number_of_records) {
+    status = build_frozen(hashes, number_of_records, &number_of_buckets, &displacements, slots);
+  } else {
+    displacements = calloc(1, sizeof(uint32_t));
+    status = displacements ? IDLIB_SUCCESS : IDLIB_ALLOCATION_FAILED;
+  }
+  free(hashes);
+  idlib_globals_file_slot* file_slots = NULL;
+  if (!status) {
+    file_slots = calloc(number_of_records > 0 ? number_of_records : 1, sizeof(idlib_globals_file_slot));
+    status = file_slots ? IDLIB_SUCCESS : IDLIB_ALLOCATION_FAILED;
+  }
+  if (status) {
+    free(displacements);
+    free(slots);
+    return status;
+  }
+  // Compute the layout.
+  idlib_globals_file_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IDLIB_GLOBALS_FILE_MAGIC, sizeof(header.magic));
+  header.version = IDLIB_GLOBALS_FILE_VERSION;
+  header.byte_order = IDLIB_GLOBALS_FILE_BYTE_ORDER;
+  header.number_of_buckets = number_of_buckets;
+  header.number_of_slots = number_of_records;
+  header.displacements = align_globals_file(sizeof(idlib_globals_file_header));
+  header.slots = align_globals_file(header.displacements + (uint64_t)number_of_buckets * sizeof(uint32_t));
+  uint64_t offset = header.slots + (uint64_t)number_of_records * sizeof(idlib_globals_file_slot);
+  for (uint32_t i = 0; i < number_of_records; ++i) {
+    idlib_globals_file_slot* slot = &file_slots[slots[i]];
+    slot->hash = records[i].hash;
+    slot->key = offset;
+    slot->n = records[i].n;
+    slot->value = align_globals_file(offset + records[i].n);
+    slot->m = records[i].m;
+    offset = slot->value + records[i].m;
+  }
+  header.size = offset;
+  header.checksum = idlib_process_hash(&header, sizeof(header));
+  // Write the header, the displacements, the slots, and the keys and values in the order of the records.
+  int failed = 1 != fwrite(&header, sizeof(header), 1, file)
+            || !write_padding(file, (size_t)(header.displacements - sizeof(header)))
+            || number_of_buckets != fwrite(displacements, sizeof(uint32_t), number_of_buckets, file)
+            || !write_padding(file, (size_t)(header.slots - header.displacements - (uint64_t)number_of_buckets * sizeof(uint32_t)))
+            || number_of_records != fwrite(file_slots, sizeof(idlib_globals_file_slot), number_of_records, file);
+  for (uint32_t i = 0; i < number_of_records && !failed; ++i) {
+    idlib_globals_file_slot const* slot = &file_slots[slots[i]];
+    failed = records[i].n != fwrite(records[i].p, 1, records[i].n, file)
+          || !write_padding(file, (size_t)(slot->value - slot->key - slot->n))
+          || records[i].m != fwrite(records[i].blob, 1, records[i].m, file);
+  }
+  free(file_slots);
+  free(displacements);
+  free(slots);
+  return failed ? IDLIB_ENVIRONMENT_FAILED : IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_globals_save
+  (
+    idlib_process* process,
+    char const* path,
+    idlib_global_serializer* serializer,
+    void* context
+  )
+{
+  if (!process || !path || !serializer) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (lock_entries_shared(process)) {
+    fclose(file);
+    return IDLIB_LOCK_FAILED;
+  }
+  _frozen* frozen = process->frozen;
+  size_t number_of_records = (frozen ? frozen->number_of_slots : 0) + count_entries(&process->entries);
+  for (_mapped* mapped = process->mapped; NULL != mapped; mapped = mapped->previous) {
+    number_of_records += mapped->number_of_slots;
+  }
+  if (number_of_records > UINT32_MAX) {
+    unlock_entries_shared(process);
+    fclose(file);
+    return IDLIB_TOO_BIG;
+  }
+  _record* records = malloc(sizeof(_record) * (number_of_records > 0 ? number_of_records : 1));
+  _entry** references = malloc(sizeof(_entry*) * (number_of_records > 0 ? number_of_records : 1));
+  if (!records || !references) {
+    unlock_entries_shared(process);
+    free(references);
+    free(records);
+    fclose(file);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  // Collect the entries in the order in which idlib_get_global consults them and skip entries shadowed by a preceding entry.
+  // References to the entries are held such that their keys and values remain valid after the lock was released.
+  uint32_t j = 0, number_of_references = 0;
+  idlib_status status = IDLIB_SUCCESS;
+  for (uint32_t i = 0; NULL != frozen && i < frozen->number_of_slots && !status; ++i) {
+    status = append_record(records, &j, references, &number_of_references, frozen->slots[i].entry);
+  }
+  for (_mapped* mapped = process->mapped; NULL != mapped && !status; mapped = mapped->previous) {
+    for (uint32_t i = 0; i < mapped->number_of_slots; ++i) {
+      idlib_globals_file_slot const* slot = &mapped->slots[i];
+      void const* p = mapped->base + slot->key;
+      // The values of mapped files are written as they are.
+      if (find_mapped(process->mapped, slot->hash, p, slot->n) == mapped->base + slot->value &&
+          !find_frozen(frozen, slot->hash, p, slot->n)) {
+        records[j].hash = slot->hash;
+        records[j].p = p;
+        records[j].n = slot->n;
+        records[j].entry = NULL;
+        records[j].blob = mapped->base + slot->value;
+        records[j].m = slot->m;
+        j++;
+      }
+    }
+  }
+  size_t number_of_chains;
+  _entry** chains = get_chains(&process->entries, &number_of_chains);
+  for (size_t i = 0; i < number_of_chains && !status; ++i) {
+    for (_entry* entry = chains[i]; NULL != entry && !status; entry = entry->next) {
+      if (!find_mapped(process->mapped, entry->hash, entry->p, entry->n)) {
+        status = append_record(records, &j, references, &number_of_references, entry);
       }
     }
-    previous = &current->next;
-    current = current->next;
   }
-  return IDLIB_NOT_EXISTS;
+  unlock_entries_shared(process);
+  if (!status) {
+    status = serialize_records(records, &j, serializer, context);
+  }
+  if (!status) {
+    status = write_globals_file(file, records, j);
+  }
+  while (number_of_references > 0) {
+    release_entry(references[--number_of_references]);
+  }
+  free(references);
+  free(records);
+  if (fclose(file) && !status) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  return status;
+}
+
+// Validate the slots of a mapped file and reject it if one of its keys is the key of an existing global.
+// A global of the file would shadow or be shadowed by the existing global depending on the order of the lookups.
+// The entries lock must be held exclusively.
+static idlib_status
+check_mapped(idlib_process* process, _mapped* mapped) {
+  for (uint32_t i = 0; i < mapped->number_of_slots; ++i) {
+    idlib_globals_file_slot const* slot = &mapped->slots[i];
+    if (slot->key > mapped->size || slot->n > mapped->size - slot->key ||
+        slot->value > mapped->size || slot->m > mapped->size - slot->value) {
+      return IDLIB_NOT_REPRESENTABLE;
+    }
+    void const* p = mapped->base + slot->key;
+    size_t n = (size_t)slot->n;
+    uint64_t hash = idlib_process_hash(p, n);
+    if (hash != slot->hash) {
+      return IDLIB_NOT_REPRESENTABLE;
+    }
+    uint64_t probes = 0;
+    if (find_frozen(process->frozen, hash, p, n) || find_mapped(process->mapped, hash, p, n) ||
+        *find_entry(&process->entries, hash, p, n, &probes)) {
+      return IDLIB_EXISTS;
+    }
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Validate the header of a mapped file and create its _mapped object.
+static idlib_status
+create_mapped(char const* base, size_t size, _mapped** result) {
+  if (size < sizeof(idlib_globals_file_header)) {
+    return IDLIB_NOT_REPRESENTABLE;
+  }
+  idlib_globals_file_header header;
+  memcpy(&header, base, sizeof(header));
+  uint64_t checksum = header.checksum;
+  header.checksum = 0;
+  if (memcmp(header.magic, IDLIB_GLOBALS_FILE_MAGIC, sizeof(header.magic)) ||
+      IDLIB_GLOBALS_FILE_VERSION != header.version || IDLIB_GLOBALS_FILE_BYTE_ORDER != header.byte_order ||
+      checksum != idlib_process_hash(&header, sizeof(header)) || header.size != size || !header.number_of_buckets ||
+      header.displacements % sizeof(uint32_t) || header.displacements > size ||
+      (size - header.displacements) / sizeof(uint32_t) < header.number_of_buckets ||
+      header.slots % sizeof(uint64_t) || header.slots > size ||
+      (size - header.slots) / sizeof(idlib_globals_file_slot) < header.number_of_slots) {
+    return IDLIB_NOT_REPRESENTABLE;
+  }
+  _mapped* mapped = malloc(sizeof(_mapped));
+  if (!mapped) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  mapped->previous = NULL;
+  mapped->base = base;
+  mapped->size = size;
+  mapped->number_of_buckets = header.number_of_buckets;
+  mapped->displacements = (uint32_t const*)(base + header.displacements);
+  mapped->number_of_slots = header.number_of_slots;
+  mapped->slots = (idlib_globals_file_slot const*)(base + header.slots);
+  *result = mapped;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_globals_load_mapped
+  (
+    idlib_process* process,
+    char const* path
+  )
+{
+  if (!process || !path) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  char const* base = NULL;
+  size_t size = 0;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  int fd = open(path, O_RDONLY);
+  if (-1 == fd) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  struct stat information;
+  if (fstat(fd, &information) || !information.st_size) {
+    close(fd);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  size = (size_t)information.st_size;
+  void* address = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping remains valid after the file descriptor was closed.
+  close(fd);
+  if (MAP_FAILED == address) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  base = (char const*)address;
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE == file) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || !file_size.QuadPart) {
+    CloseHandle(file);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  size = (size_t)file_size.QuadPart;
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // The view remains valid after the handle of the mapping was closed.
+  base = (char const*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!base) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  _mapped* mapped = NULL;
+  idlib_status status = create_mapped(base, size, &mapped);
+  if (!status && lock_entries_exclusive(process)) {
+    free(mapped);
+    status = IDLIB_LOCK_FAILED;
+  } else if (!status) {
+    status = check_mapped(process, mapped);
+    if (status) {
+      unlock_entries_exclusive(process);
+      free(mapped);
+    }
+  }
+  if (status) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    munmap((void*)base, size);
+#elif IDLIB_OPERATING_SYSTEM_WINDOWS == IDLIB_OPERATING_SYSTEM
+    UnmapViewOfFile(base);
+#else
+    #error("operating system not (yet) supported")
+#endif
+    return status;
+  }
+  mapped->previous = process->mapped;
+  idlib_atomic_store_release_pointer((void* volatile*)&process->mapped, mapped);
+  unlock_entries_exclusive(process);
+  return IDLIB_SUCCESS;
 }
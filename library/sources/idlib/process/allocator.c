@@ -0,0 +1,547 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process/allocator.h"
+
+#include "idlib/process/allocator_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/once.h"
+
+#include "idlib/process/futex.h"
+
+// malloc, free
+#include <malloc.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  #include <pthread.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// The sizes of the size classes.
+static size_t const g_class_sizes[IDLIB_ALLOCATOR_NUMBER_OF_CLASSES] = {
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024,
+};
+
+// The size class of an allocation of n Bytes is g_classes[(n + 15) / 16].
+static uint8_t const g_classes[IDLIB_ALLOCATOR_MAXIMUM_SIZE / 16 + 1] = {
+  0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+  8, 8, 8, 8, 8, 8, 8, 8,
+  9, 9, 9, 9, 9, 9, 9, 9,
+  10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+  11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+};
+
+// The allocator of this module.
+static idlib_allocator g_allocator;
+
+// The cache of the calling thread or null.
+static IDLIB_THREAD_LOCAL idlib_allocator_cache* g_cache_of_thread = NULL;
+
+// Creates g_key.
+static idlib_once g_once = IDLIB_ONCE_INITIALIZER;
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // Used to retire the cache of a thread when the thread terminates.
+  static pthread_key_t g_key;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  static DWORD g_key = FLS_OUT_OF_INDEXES;
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+static void
+lock
+  (
+    idlib_allocator* allocator
+  )
+{
+  uint32_t expected = 0;
+  if (IDLIB_LIKELY(idlib_atomic_compare_exchange_u32(&allocator->lock, &expected, 1))) {
+    return;
+  }
+  for (int i = 0; i < IDLIB_ALLOCATOR_SPIN_COUNT; ++i) {
+    expected = 0;
+    if (0 == idlib_atomic_load_relaxed_u32(&allocator->lock) && idlib_atomic_compare_exchange_u32(&allocator->lock, &expected, 1)) {
+      return;
+    }
+    idlib_cpu_relax();
+  }
+  // Announce that threads wait (state 2) and wait until the allocator was unlocked (state 0).
+  uint32_t state = idlib_atomic_exchange_u32(&allocator->lock, 2);
+  while (0 != state) {
+    idlib_futex_wait(&allocator->lock, 2);
+    state = idlib_atomic_exchange_u32(&allocator->lock, 2);
+  }
+}
+
+static void
+unlock
+  (
+    idlib_allocator* allocator
+  )
+{
+  if (2 == idlib_atomic_exchange_u32(&allocator->lock, 0)) {
+    idlib_futex_wake_one(&allocator->lock);
+  }
+}
+
+// Add to a statistic of a cache.
+// Only the owning thread writes the statistic, other threads read it.
+static inline void
+add
+  (
+    uint64_t volatile* statistic,
+    uint64_t delta
+  )
+{
+  idlib_atomic_store_relaxed_u64(statistic, idlib_atomic_load_relaxed_u64(statistic) + delta);
+}
+
+// Carve at most IDLIB_ALLOCATOR_BATCH_SIZE blocks of the size class k from the current slab or a new slab.
+// The allocator must be locked.
+// Returns the number of blocks. Returns zero if a slab could not be allocated.
+static uint32_t
+carve_blocks
+  (
+    idlib_allocator* allocator,
+    size_t k,
+    idlib_allocator_block** blocks
+  )
+{
+  idlib_allocator_depot* depot = &allocator->depots[k];
+  size_t size = g_class_sizes[k];
+  if ((size_t)(depot->end - depot->begin) < size) {
+    char* slab = malloc(IDLIB_ALLOCATOR_SLAB_SIZE);
+    if (!slab) {
+      return 0;
+    }
+    allocator->slabs++;
+    depot->begin = slab;
+    depot->end = slab + IDLIB_ALLOCATOR_SLAB_SIZE;
+  }
+  idlib_allocator_block* head = NULL;
+  uint32_t count = 0;
+  while (count < IDLIB_ALLOCATOR_BATCH_SIZE && (size_t)(depot->end - depot->begin) >= size) {
+    idlib_allocator_block* block = (idlib_allocator_block*)depot->begin;
+    depot->begin += size;
+    block->next = head;
+    head = block;
+    count++;
+  }
+  *blocks = head;
+  return count;
+}
+
+// Take a batch or the remaining blocks of the size class k from the depot.
+// If the depot has no blocks, then the blocks are carved from a slab.
+// The allocator must be locked.
+// Returns the number of blocks. Returns zero if a slab could not be allocated.
+static uint32_t
+take_blocks
+  (
+    idlib_allocator* allocator,
+    size_t k,
+    idlib_allocator_block** blocks
+  )
+{
+  idlib_allocator_depot* depot = &allocator->depots[k];
+  if (depot->batches) {
+    *blocks = depot->batches;
+    depot->batches = depot->batches->next_batch;
+    return IDLIB_ALLOCATOR_BATCH_SIZE;
+  }
+  if (depot->blocks) {
+    uint32_t count = depot->number_of_blocks;
+    *blocks = depot->blocks;
+    depot->blocks = NULL;
+    depot->number_of_blocks = 0;
+    return count;
+  }
+  return carve_blocks(allocator, k, blocks);
+}
+
+// Put a batch of IDLIB_ALLOCATOR_BATCH_SIZE blocks of the size class k into the depot.
+// The allocator must be locked.
+static void
+put_batch
+  (
+    idlib_allocator* allocator,
+    size_t k,
+    idlib_allocator_block* batch
+  )
+{
+  idlib_allocator_depot* depot = &allocator->depots[k];
+  batch->next_batch = depot->batches;
+  depot->batches = batch;
+}
+
+// Put a block of the size class k into the depot.
+// The allocator must be locked.
+static void
+put_block
+  (
+    idlib_allocator* allocator,
+    size_t k,
+    idlib_allocator_block* block
+  )
+{
+  idlib_allocator_depot* depot = &allocator->depots[k];
+  block->next = depot->blocks;
+  depot->blocks = block;
+  if (IDLIB_ALLOCATOR_BATCH_SIZE == ++depot->number_of_blocks) {
+    put_batch(allocator, k, depot->blocks);
+    depot->blocks = NULL;
+    depot->number_of_blocks = 0;
+  }
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+static void
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+static void WINAPI
+#else
+  #error("operating system not (yet) supported")
+#endif
+retire
+  (
+    void* p
+  )
+{
+  idlib_allocator_cache* cache = (idlib_allocator_cache*)p;
+  if (!cache) {
+    return;
+  }
+  g_cache_of_thread = NULL;
+  // Return the cached blocks to the depot.
+  lock(cache->allocator);
+  for (size_t k = 0; k < IDLIB_ALLOCATOR_NUMBER_OF_CLASSES; ++k) {
+    while (cache->blocks[k]) {
+      idlib_allocator_block* block = cache->blocks[k];
+      cache->blocks[k] = block->next;
+      put_block(cache->allocator, k, block);
+    }
+    cache->number_of_blocks[k] = 0;
+  }
+  idlib_atomic_store_release_u32(&cache->retired, 1);
+  unlock(cache->allocator);
+}
+
+static idlib_status
+initialize
+  (
+    void* context
+  )
+{
+  (void)context;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pthread_key_create(&g_key, &retire)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  g_key = FlsAlloc(&retire);
+  if (FLS_OUT_OF_INDEXES == g_key) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+// Assign a cache of the allocator of this module to the calling thread.
+// Returns null if no cache could be assigned.
+static idlib_allocator_cache*
+acquire_cache
+  (
+  )
+{
+  if (idlib_once_call(&g_once, &initialize, NULL)) {
+    return NULL;
+  }
+  idlib_allocator* allocator = &g_allocator;
+  lock(allocator);
+  // Reuse the cache of a terminated thread if possible.
+  idlib_allocator_cache* cache = allocator->caches;
+  while (cache && !idlib_atomic_load_acquire_u32(&cache->retired)) {
+    cache = cache->next;
+  }
+  if (cache) {
+    cache->retired = 0;
+  } else {
+    cache = malloc(sizeof(idlib_allocator_cache));
+    if (!cache) {
+      unlock(allocator);
+      return NULL;
+    }
+    cache->allocator = allocator;
+    for (size_t k = 0; k < IDLIB_ALLOCATOR_NUMBER_OF_CLASSES; ++k) {
+      cache->blocks[k] = NULL;
+      cache->number_of_blocks[k] = 0;
+    }
+    cache->allocations = 0;
+    cache->deallocations = 0;
+    cache->allocated_bytes = 0;
+    cache->deallocated_bytes = 0;
+    cache->large_allocations = 0;
+    cache->retired = 0;
+    cache->next = allocator->caches;
+    allocator->caches = cache;
+  }
+  unlock(allocator);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_setspecific(g_key, cache);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  FlsSetValue(g_key, cache);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  g_cache_of_thread = cache;
+  return cache;
+}
+
+// Get the cache of the calling thread for the specified allocator.
+// Returns null if the allocator is not the allocator of this module or no cache could be assigned.
+static inline idlib_allocator_cache*
+get_cache
+  (
+    idlib_allocator* allocator
+  )
+{
+  idlib_allocator_cache* cache = g_cache_of_thread;
+  if (IDLIB_UNLIKELY(!cache)) {
+    if (allocator != &g_allocator) {
+      return NULL;
+    }
+    cache = acquire_cache();
+  }
+  return cache && cache->allocator == allocator ? cache : NULL;
+}
+
+idlib_allocator*
+idlib_allocator_impl_get
+  (
+  )
+{
+  return &g_allocator;
+}
+
+void*
+idlib_allocator_impl_allocate
+  (
+    idlib_allocator* allocator,
+    size_t n
+  )
+{
+  idlib_allocator_cache* cache = get_cache(allocator);
+  if (IDLIB_UNLIKELY(n > IDLIB_ALLOCATOR_MAXIMUM_SIZE)) {
+    void* p = malloc(n);
+    if (!p) {
+      return NULL;
+    }
+    if (cache) {
+      add(&cache->allocations, 1);
+      add(&cache->allocated_bytes, n);
+      add(&cache->large_allocations, 1);
+    } else {
+      lock(allocator);
+      allocator->allocations++;
+      allocator->allocated_bytes += n;
+      allocator->large_allocations++;
+      unlock(allocator);
+    }
+    return p;
+  }
+  size_t k = g_classes[(n + 15) / 16];
+  if (IDLIB_LIKELY(cache != NULL)) {
+    idlib_allocator_block* block = cache->blocks[k];
+    if (IDLIB_UNLIKELY(!block)) {
+      lock(allocator);
+      uint32_t count = take_blocks(allocator, k, &block);
+      if (count) {
+        allocator->batch_transfers++;
+      }
+      unlock(allocator);
+      if (!count) {
+        return NULL;
+      }
+      cache->number_of_blocks[k] = count;
+    }
+    cache->blocks[k] = block->next;
+    cache->number_of_blocks[k]--;
+    add(&cache->allocations, 1);
+    add(&cache->allocated_bytes, g_class_sizes[k]);
+    return block;
+  }
+  // Without a cache, take a single block from the depot.
+  idlib_allocator_depot* depot = &allocator->depots[k];
+  lock(allocator);
+  if (!depot->blocks) {
+    depot->number_of_blocks = take_blocks(allocator, k, &depot->blocks);
+    if (!depot->number_of_blocks) {
+      unlock(allocator);
+      return NULL;
+    }
+  }
+  idlib_allocator_block* block = depot->blocks;
+  depot->blocks = block->next;
+  depot->number_of_blocks--;
+  allocator->allocations++;
+  allocator->allocated_bytes += g_class_sizes[k];
+  unlock(allocator);
+  return block;
+}
+
+void
+idlib_allocator_impl_deallocate
+  (
+    idlib_allocator* allocator,
+    void* p,
+    size_t n
+  )
+{
+  idlib_allocator_cache* cache = get_cache(allocator);
+  if (IDLIB_UNLIKELY(n > IDLIB_ALLOCATOR_MAXIMUM_SIZE)) {
+    free(p);
+    if (cache) {
+      add(&cache->deallocations, 1);
+      add(&cache->deallocated_bytes, n);
+    } else {
+      lock(allocator);
+      allocator->deallocations++;
+      allocator->deallocated_bytes += n;
+      unlock(allocator);
+    }
+    return;
+  }
+  size_t k = g_classes[(n + 15) / 16];
+  idlib_allocator_block* block = (idlib_allocator_block*)p;
+  if (IDLIB_LIKELY(cache != NULL)) {
+    block->next = cache->blocks[k];
+    cache->blocks[k] = block;
+    add(&cache->deallocations, 1);
+    add(&cache->deallocated_bytes, g_class_sizes[k]);
+    if (IDLIB_UNLIKELY(++cache->number_of_blocks[k] > 2 * IDLIB_ALLOCATOR_BATCH_SIZE)) {
+      // Return a batch to the depot.
+      idlib_allocator_block* last = block;
+      for (uint32_t i = 1; i < IDLIB_ALLOCATOR_BATCH_SIZE; ++i) {
+        last = last->next;
+      }
+      cache->blocks[k] = last->next;
+      cache->number_of_blocks[k] -= IDLIB_ALLOCATOR_BATCH_SIZE;
+      last->next = NULL;
+      lock(allocator);
+      put_batch(allocator, k, block);
+      allocator->batch_transfers++;
+      unlock(allocator);
+    }
+    return;
+  }
+  lock(allocator);
+  put_block(allocator, k, block);
+  allocator->deallocations++;
+  allocator->deallocated_bytes += g_class_sizes[k];
+  unlock(allocator);
+}
+
+idlib_status
+idlib_allocator_allocate
+  (
+    idlib_process* process,
+    size_t n,
+    void** p
+  )
+{
+  if (!process || !n || !p) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  void* q = idlib_allocator_impl_allocate(process->allocator, n);
+  if (!q) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  *p = q;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_allocator_deallocate
+  (
+    idlib_process* process,
+    void* p,
+    size_t n
+  )
+{
+  if (!process || !p || !n) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_allocator_impl_deallocate(process->allocator, p, n);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_allocator_get_statistics
+  (
+    idlib_process* process,
+    idlib_allocator_statistics* statistics
+  )
+{
+  if (!process || !statistics) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_allocator* allocator = process->allocator;
+  lock(allocator);
+  uint64_t allocated_bytes = allocator->allocated_bytes;
+  uint64_t deallocated_bytes = allocator->deallocated_bytes;
+  statistics->allocations = allocator->allocations;
+  statistics->deallocations = allocator->deallocations;
+  statistics->large_allocations = allocator->large_allocations;
+  statistics->slabs = allocator->slabs;
+  statistics->slab_bytes = allocator->slabs * IDLIB_ALLOCATOR_SLAB_SIZE;
+  statistics->batch_transfers = allocator->batch_transfers;
+  statistics->caches = 0;
+  for (idlib_allocator_cache* cache = allocator->caches; NULL != cache; cache = cache->next) {
+    statistics->allocations += idlib_atomic_load_relaxed_u64(&cache->allocations);
+    statistics->deallocations += idlib_atomic_load_relaxed_u64(&cache->deallocations);
+    statistics->large_allocations += idlib_atomic_load_relaxed_u64(&cache->large_allocations);
+    allocated_bytes += idlib_atomic_load_relaxed_u64(&cache->allocated_bytes);
+    deallocated_bytes += idlib_atomic_load_relaxed_u64(&cache->deallocated_bytes);
+    statistics->caches++;
+  }
+  unlock(allocator);
+  statistics->bytes_in_use = allocated_bytes > deallocated_bytes ? allocated_bytes - deallocated_bytes : 0;
+  return IDLIB_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/barrier.h"
+
+#include "idlib/process/barrier_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+idlib_status
+idlib_barrier_initialize
+  (
+    idlib_barrier* barrier,
+    uint32_t count,
+    idlib_barrier_completion* completion,
+    void* context
+  )
+{
+  if (!barrier || !count) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_barrier_impl* pimpl = malloc(sizeof(idlib_barrier_impl));
+  if (!pimpl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  pimpl->count = count;
+  pimpl->arrived = 0;
+  pimpl->phase = 0;
+  pimpl->waiters = 0;
+  pimpl->completion = completion;
+  pimpl->context = context;
+  barrier->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_barrier_uninitialize
+  (
+    idlib_barrier* barrier
+  )
+{
+  if (!barrier) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_barrier_impl* pimpl = (idlib_barrier_impl*)barrier->pimpl;
+  barrier->pimpl = NULL;
+  free(pimpl);
+  pimpl = NULL;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_barrier_arrive_and_wait
+  (
+    idlib_barrier* barrier
+  )
+{
+  if (!barrier) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_barrier_impl* pimpl = (idlib_barrier_impl*)barrier->pimpl;
+  // The phase can not advance before this thread has arrived.
+  uint32_t phase = idlib_atomic_load_acquire_u32(&pimpl->phase);
+  if (pimpl->count == idlib_atomic_fetch_add_u32(&pimpl->arrived, 1) + 1) {
+    // No thread can arrive in the next phase before the phase is advanced.
+    idlib_atomic_store_relaxed_u32(&pimpl->arrived, 0);
+    if (pimpl->completion) {
+      pimpl->completion(pimpl->context);
+    }
+    idlib_atomic_fetch_add_u32(&pimpl->phase, 1);
+    // See idlib_semaphore_release for why the waiters can not be missed.
+    if (idlib_atomic_load_u32(&pimpl->waiters)) {
+      idlib_futex_wake_all(&pimpl->phase);
+    }
+    return IDLIB_SUCCESS;
+  }
+  idlib_atomic_fetch_add_u32(&pimpl->waiters, 1);
+  while (phase == idlib_atomic_load_acquire_u32(&pimpl->phase)) {
+    idlib_futex_wait(&pimpl->phase, phase);
+  }
+  idlib_atomic_fetch_sub_u32(&pimpl->waiters, 1);
+  return IDLIB_SUCCESS;
+}
@@ -0,0 +1,207 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/combining_lock.h"
+
+#include "idlib/process/combining_lock_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+// The index of the record a thread tries first. Assigned round-robin such that threads start at different records.
+static IDLIB_THREAD_LOCAL uint32_t g_home = UINT32_MAX;
+
+static uint32_t volatile g_next_home = 0;
+
+// Execute the pending operations.
+// Must be invoked by the holder of the lock.
+static void
+combine
+  (
+    idlib_combining_lock_impl* pimpl
+  )
+{
+  for (uint32_t pass = 0; pass < IDLIB_COMBINING_LOCK_PASSES; ++pass) {
+    int executed = 0;
+    uint32_t number_of_records = idlib_atomic_load_acquire_u32(&pimpl->number_of_records);
+    for (uint32_t i = 0; i < number_of_records; ++i) {
+      idlib_combining_lock_record* record = &pimpl->records[i];
+      if (IDLIB_COMBINING_LOCK_RECORD_PENDING == idlib_atomic_load_acquire_u32(&record->state)) {
+        record->procedure(record->argument);
+        idlib_atomic_store_release_u32(&record->state, IDLIB_COMBINING_LOCK_RECORD_DONE);
+        executed = 1;
+      }
+    }
+    if (!executed) {
+      break;
+    }
+  }
+}
+
+static int
+try_lock
+  (
+    idlib_combining_lock_impl* pimpl
+  )
+{
+  uint32_t expected = 0;
+  return 0 == idlib_atomic_load_relaxed_u32(&pimpl->lock)
+      && idlib_atomic_compare_exchange_u32(&pimpl->lock, &expected, 1);
+}
+
+// Sleep until the lock is released. Returns immediately if the lock is free.
+static void
+wait_for_unlock
+  (
+    idlib_combining_lock_impl* pimpl
+  )
+{
+  uint32_t expected = idlib_atomic_load_relaxed_u32(&pimpl->lock);
+  if (1 == expected && !idlib_atomic_compare_exchange_u32(&pimpl->lock, &expected, 2)) {
+    return;
+  }
+  if (0 != expected) {
+    idlib_futex_wait(&pimpl->lock, 2);
+  }
+}
+
+static void
+unlock
+  (
+    idlib_combining_lock_impl* pimpl
+  )
+{
+  if (2 == idlib_atomic_exchange_u32(&pimpl->lock, 0)) {
+    idlib_futex_wake_all(&pimpl->lock);
+  }
+}
+
+idlib_status
+idlib_combining_lock_initialize
+  (
+    idlib_combining_lock* lock
+  )
+{
+  if (!lock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  void* allocation = malloc(sizeof(idlib_combining_lock_impl) + IDLIB_CACHE_LINE_SIZE);
+  if (!allocation) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  idlib_combining_lock_impl* pimpl = (idlib_combining_lock_impl*)(((uintptr_t)allocation + IDLIB_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(IDLIB_CACHE_LINE_SIZE - 1));
+  pimpl->allocation = allocation;
+  pimpl->lock = 0;
+  pimpl->number_of_records = 0;
+  for (uint32_t i = 0; i < IDLIB_COMBINING_LOCK_RECORDS; ++i) {
+    pimpl->records[i].state = IDLIB_COMBINING_LOCK_RECORD_FREE;
+    pimpl->records[i].procedure = NULL;
+    pimpl->records[i].argument = NULL;
+  }
+  lock->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_combining_lock_uninitialize
+  (
+    idlib_combining_lock* lock
+  )
+{
+  if (!lock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_combining_lock_impl* pimpl = (idlib_combining_lock_impl*)lock->pimpl;
+  lock->pimpl = NULL;
+  free(pimpl->allocation);
+  pimpl = NULL;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_combining_lock_apply
+  (
+    idlib_combining_lock* lock,
+    idlib_combining_procedure* procedure,
+    void* argument
+  )
+{
+  if (!lock || !procedure) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_combining_lock_impl* pimpl = (idlib_combining_lock_impl*)lock->pimpl;
+  if (try_lock(pimpl)) {
+    // Uncontended: execute the operation and the operations published meanwhile.
+    procedure(argument);
+    combine(pimpl);
+    unlock(pimpl);
+    return IDLIB_SUCCESS;
+  }
+  uint32_t home = g_home;
+  if (IDLIB_UNLIKELY(UINT32_MAX == home)) {
+    home = idlib_atomic_fetch_add_u32(&g_next_home, 1) % IDLIB_COMBINING_LOCK_RECORDS;
+    g_home = home;
+  }
+  // Claim a record.
+  idlib_combining_lock_record* record = NULL;
+  for (uint32_t i = 0; i < IDLIB_COMBINING_LOCK_RECORDS; ++i) {
+    uint32_t index = (home + i) % IDLIB_COMBINING_LOCK_RECORDS;
+    idlib_combining_lock_record* candidate = &pimpl->records[index];
+    uint32_t expected = IDLIB_COMBINING_LOCK_RECORD_FREE;
+    if (IDLIB_COMBINING_LOCK_RECORD_FREE == idlib_atomic_load_relaxed_u32(&candidate->state) &&
+        idlib_atomic_compare_exchange_u32(&candidate->state, &expected, IDLIB_COMBINING_LOCK_RECORD_CLAIMED)) {
+      record = candidate;
+      uint32_t number_of_records = idlib_atomic_load_relaxed_u32(&pimpl->number_of_records);
+      while (number_of_records <= index &&
+             !idlib_atomic_compare_exchange_u32(&pimpl->number_of_records, &number_of_records, index + 1)) {
+      }
+      break;
+    }
+  }
+  if (IDLIB_UNLIKELY(!record)) {
+    // All records are in use: execute the operation under the lock.
+    while (!try_lock(pimpl)) {
+      wait_for_unlock(pimpl);
+    }
+    procedure(argument);
+    unlock(pimpl);
+    return IDLIB_SUCCESS;
+  }
+  record->procedure = procedure;
+  record->argument = argument;
+  idlib_atomic_store_release_u32(&record->state, IDLIB_COMBINING_LOCK_RECORD_PENDING);
+  // Wait until a combiner executed the operation or become the combiner.
+  uint32_t spins = 0;
+  while (IDLIB_COMBINING_LOCK_RECORD_DONE != idlib_atomic_load_acquire_u32(&record->state)) {
+    if (try_lock(pimpl)) {
+      combine(pimpl);
+      unlock(pimpl);
+    } else if (spins < IDLIB_COMBINING_LOCK_SPINS) {
+      spins++;
+      idlib_cpu_relax();
+    } else {
+      // The combiner releases the lock after it executed the pending operations.
+      wait_for_unlock(pimpl);
+    }
+  }
+  idlib_atomic_store_release_u32(&record->state, IDLIB_COMBINING_LOCK_RECORD_FREE);
+  return IDLIB_SUCCESS;
+}
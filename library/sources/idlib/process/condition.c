@@ -23,11 +23,18 @@
 
 #include "idlib/process/condition_impl.h"
 
-// malloc, free
-#include <malloc.h>
+#include "idlib/process/mutex.h"
+
+#include "idlib/process/mutex_impl.h"
+
+#include "idlib/process/allocator_impl.h"
+
+#include "idlib/process/fiber_impl.h"
+
+#include "idlib/process/metrics_impl.h"
 
 idlib_status
-idlib_condition_intialize
+idlib_condition_initialize
   (
     idlib_condition* condition
   )
@@ -35,15 +42,17 @@ idlib_condition_intialize
   if (!condition) {
     return IDLIB_ARGUMENT_INVALID;
   }
-  idlib_condition_impl* pimpl = malloc(sizeof(idlib_condition_impl));
+  idlib_condition_impl* pimpl = idlib_allocator_impl_allocate(idlib_allocator_impl_get(), sizeof(idlib_condition_impl));
   if (!pimpl) {
     return IDLIB_ALLOCATION_FAILED;
   }
+  IDLIB_METRIC_ADD(condition_allocation, 1);
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
   if (pthread_cond_init(&pimpl->condition, NULL)) {
-    free(pimpl);
+    idlib_allocator_impl_deallocate(idlib_allocator_impl_get(), pimpl, sizeof(idlib_condition_impl));
     pimpl = NULL;
     return IDLIB_ENVIRONMENT_FAILED;
   }
@@ -51,11 +60,24 @@ idlib_condition_intialize
   InitializeConditionVariable(&pimpl->condition_variable);
 #else
   #error("operating system not (yet) supported")
+#endif
+#else
+  pimpl->sequence = 0;
 #endif
   condition->pimpl = pimpl;
+  IDLIB_METRIC_ADD(condition_live, 1);
   return IDLIB_SUCCESS;
 }
 
+idlib_status
+idlib_condition_intialize
+  (
+    idlib_condition* condition
+  )
+{
+  return idlib_condition_initialize(condition);
+}
+
 idlib_status
 idlib_condition_uninitialize
   (
@@ -67,6 +89,7 @@ idlib_condition_uninitialize
   }
   idlib_condition_impl* pimpl = (idlib_condition_impl*)condition->pimpl;
   condition->pimpl = NULL;
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
@@ -76,8 +99,10 @@ idlib_condition_uninitialize
 #else
   #error("operating system not (yet) supported")
 #endif
-  free(pimpl);
+#endif
+  idlib_allocator_impl_deallocate(idlib_allocator_impl_get(), pimpl, sizeof(idlib_condition_impl));
   pimpl = NULL;
+  IDLIB_METRIC_ADD(condition_live, -1);
   return IDLIB_SUCCESS;
 }
 
@@ -86,16 +111,104 @@ idlib_condition_wait
   (
     idlib_condition* condition,
     idlib_mutex* mutex
-  );
+  )
+{
+  if (!condition || !mutex) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_condition_impl* pimpl = (idlib_condition_impl*)condition->pimpl;
+  idlib_mutex_impl* mutex_pimpl = (idlib_mutex_impl*)mutex->pimpl;
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+  // See idlib_mutex_lock.
+  if (idlib_fiber_impl_of_thread) {
+    return IDLIB_OPERATION_INVALID;
+  }
+#endif
+  IDLIB_METRIC_ADD(condition_wait, 1);
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pthread_cond_wait(&pimpl->condition, &mutex_pimpl->mtx)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  if (!SleepConditionVariableCS(&pimpl->condition_variable, &mutex_pimpl->mtx, INFINITE)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+#else
+  void* self = idlib_mutex_impl_self();
+  if (self != idlib_atomic_load_acquire_pointer(&mutex_pimpl->owner)) {
+    return IDLIB_NOT_LOCKED;
+  }
+  uint32_t sequence = idlib_atomic_load_relaxed_u32(&pimpl->sequence);
+  // Release the mutex regardless of the number of times the owner has locked it.
+  uint32_t count = mutex_pimpl->count;
+  idlib_atomic_store_release_pointer(&mutex_pimpl->owner, NULL);
+  idlib_mutex_impl_release(mutex_pimpl);
+  idlib_futex_wait(&pimpl->sequence, sequence);
+  idlib_mutex_impl_acquire(mutex_pimpl);
+  idlib_atomic_store_release_pointer(&mutex_pimpl->owner, self);
+  mutex_pimpl->count = count;
+#endif
+  return IDLIB_SUCCESS;
+}
 
 idlib_status
 idlib_condition_signal_one
   (
     idlib_condition* condition
-  );
+  )
+{
+  if (!condition) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_condition_impl* pimpl = (idlib_condition_impl*)condition->pimpl;
+  IDLIB_METRIC_ADD(condition_signal, 1);
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_cond_signal(&pimpl->condition);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  WakeConditionVariable(&pimpl->condition_variable);
+#else
+  #error("operating system not (yet) supported")
+#endif
+#else
+  idlib_atomic_fetch_add_u32(&pimpl->sequence, 1);
+  idlib_futex_wake_one(&pimpl->sequence);
+#endif
+  return IDLIB_SUCCESS;
+}
 
 idlib_status
 idlib_condition_signal_all
   (
     idlib_condition* condition
-  );
+  )
+{
+  if (!condition) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_condition_impl* pimpl = (idlib_condition_impl*)condition->pimpl;
+  IDLIB_METRIC_ADD(condition_signal, 1);
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_cond_broadcast(&pimpl->condition);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  WakeAllConditionVariable(&pimpl->condition_variable);
+#else
+  #error("operating system not (yet) supported")
+#endif
+#else
+  idlib_atomic_fetch_add_u32(&pimpl->sequence, 1);
+  idlib_futex_wake_all(&pimpl->sequence);
+#endif
+  return IDLIB_SUCCESS;
+}
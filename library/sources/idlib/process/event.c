@@ -0,0 +1,292 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/event.h"
+
+#include "idlib/process/event_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // errno, EINTR
+  #include <errno.h>
+  // poll
+  #include <poll.h>
+  // eventfd
+  #include <sys/eventfd.h>
+  // close, read, write
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // errno, EINTR, EAGAIN
+  #include <errno.h>
+  // fcntl
+  #include <fcntl.h>
+  // poll
+  #include <poll.h>
+  // close, pipe, read, write
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  /* Intentionally empty. */
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// Make the descriptor non-readable (non-signaled under Windows).
+static void
+drain
+  (
+    idlib_event_impl* pimpl
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // Reading an eventfd resets its counter. It fails with EAGAIN if the counter is 0.
+  uint64_t value;
+  while (-1 == read(pimpl->descriptor, &value, sizeof(value)) && EINTR == errno) {
+    /* Intentionally empty. */
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  char buffer[64];
+  for (;;) {
+    ssize_t result = read(pimpl->descriptors[0], buffer, sizeof(buffer));
+    if (result < 0 && EINTR == errno) {
+      continue;
+    }
+    if (result < (ssize_t)sizeof(buffer)) {
+      break;
+    }
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  ResetEvent(pimpl->handle);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+// Drain the descriptor and reset the event.
+// Return 1 if the event was signaled, 0 otherwise.
+// The descriptor is drained first: a signal between the two steps finds the event signaled and does not signal the descriptor,
+// but its caller examines the state after this function returns.
+static int
+reset
+  (
+    idlib_event_impl* pimpl
+  )
+{
+  drain(pimpl);
+  return 0 != idlib_atomic_exchange_u32(&pimpl->signaled, 0);
+}
+
+idlib_status
+idlib_event_initialize
+  (
+    idlib_event* event
+  )
+{
+  if (!event) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_event_impl* pimpl = malloc(sizeof(idlib_event_impl));
+  if (!pimpl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  pimpl->signaled = 0;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  pimpl->descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (-1 == pimpl->descriptor) {
+    free(pimpl);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pipe(pimpl->descriptors)) {
+    free(pimpl);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < 2; ++i) {
+    int flags = fcntl(pimpl->descriptors[i], F_GETFL);
+    if (-1 == flags || -1 == fcntl(pimpl->descriptors[i], F_SETFL, flags | O_NONBLOCK) ||
+        -1 == fcntl(pimpl->descriptors[i], F_SETFD, FD_CLOEXEC)) {
+      close(pimpl->descriptors[0]);
+      close(pimpl->descriptors[1]);
+      free(pimpl);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  pimpl->handle = CreateEvent(NULL, TRUE, FALSE, NULL);
+  if (!pimpl->handle) {
+    free(pimpl);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  event->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_event_uninitialize
+  (
+    idlib_event* event
+  )
+{
+  if (!event) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_event_impl* pimpl = (idlib_event_impl*)event->pimpl;
+  event->pimpl = NULL;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  close(pimpl->descriptor);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  close(pimpl->descriptors[0]);
+  close(pimpl->descriptors[1]);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  CloseHandle(pimpl->handle);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  free(pimpl);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_event_signal
+  (
+    idlib_event* event
+  )
+{
+  if (!event) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_event_impl* pimpl = (idlib_event_impl*)event->pimpl;
+  // The exchange also orders the modifications of the state by the caller before the reset by the consumer.
+  if (idlib_atomic_exchange_u32(&pimpl->signaled, 1)) {
+    return IDLIB_SUCCESS;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  uint64_t value = 1;
+  ssize_t result;
+  do {
+    result = write(pimpl->descriptor, &value, sizeof(value));
+  } while (-1 == result && EINTR == errno);
+  if (-1 == result) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  char value = 1;
+  ssize_t result;
+  do {
+    result = write(pimpl->descriptors[1], &value, sizeof(value));
+  } while (-1 == result && EINTR == errno);
+  // If the pipe is full, then it is readable.
+  if (-1 == result && EAGAIN != errno) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  if (!SetEvent(pimpl->handle)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_event_reset
+  (
+    idlib_event* event
+  )
+{
+  if (!event) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  reset((idlib_event_impl*)event->pimpl);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_event_wait
+  (
+    idlib_event* event
+  )
+{
+  if (!event) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_event_impl* pimpl = (idlib_event_impl*)event->pimpl;
+  // The descriptor may be readable although the event is not signaled if a signal raced with a reset.
+  do {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    struct pollfd descriptor;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+    descriptor.fd = pimpl->descriptor;
+#else
+    descriptor.fd = pimpl->descriptors[0];
+#endif
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+    int result = poll(&descriptor, 1, -1);
+    if (-1 == result && EINTR != errno) {
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+    if (WAIT_OBJECT_0 != WaitForSingleObject(pimpl->handle, INFINITE)) {
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+#else
+    #error("operating system not (yet) supported")
+#endif
+  } while (!reset(pimpl));
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_event_get_descriptor
+  (
+    idlib_event* event,
+    idlib_event_descriptor* descriptor
+  )
+{
+  if (!event || !descriptor) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_event_impl* pimpl = (idlib_event_impl*)event->pimpl;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  *descriptor = pimpl->descriptor;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  *descriptor = pimpl->descriptors[0];
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  *descriptor = (idlib_event_descriptor)pimpl->handle;
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
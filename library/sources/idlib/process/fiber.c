@@ -0,0 +1,891 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/fiber.h"
+
+#include "idlib/process/fiber_impl.h"
+
+#include "idlib/process/futex.h"
+
+#include "idlib/process/clock.h"
+
+// malloc, free
+#include <malloc.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // mmap, mprotect, munmap
+  #include <sys/mman.h>
+  // sysconf
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  /* Intentionally empty. */
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  // __sanitizer_start_switch_fiber, __sanitizer_finish_switch_fiber
+  #include <sanitizer/common_interface_defs.h>
+#endif
+
+// The number of buckets of the table of parked fibers. A power of two.
+#define BUCKETS (256)
+
+// The number of fibers whose timeouts elapsed unparked per acquisition of the lock of the scheduler.
+#define EXPIRY_BATCH_SIZE (16)
+
+// The fibers parked on words whose addresses hash to the bucket in the order in which they were parked.
+typedef struct bucket {
+  uint32_t volatile lock;
+  idlib_fiber_impl* head;
+  idlib_fiber_impl* tail;
+} bucket;
+
+static bucket g_buckets[BUCKETS];
+
+uint32_t volatile idlib_fiber_impl_number_of_parked = 0;
+
+IDLIB_THREAD_LOCAL idlib_fiber_impl* idlib_fiber_impl_of_thread = NULL;
+
+static void
+lock
+  (
+    uint32_t volatile* lock
+  )
+{
+  uint32_t expected = 0;
+  while (!idlib_atomic_compare_exchange_u32(lock, &expected, 1)) {
+    expected = 0;
+    idlib_cpu_relax();
+  }
+}
+
+static void
+unlock
+  (
+    uint32_t volatile* lock
+  )
+{
+  idlib_atomic_store_release_u32(lock, 0);
+}
+
+static bucket*
+get_bucket
+  (
+    uint32_t volatile* address
+  )
+{
+  uint64_t hash = (uint64_t)(uintptr_t)address * UINT64_C(0x9e3779b97f4a7c15);
+  return &g_buckets[(hash >> 32) & (BUCKETS - 1)];
+}
+
+// Remove a parked fiber from its bucket given its predecessor in the bucket or a null pointer.
+// The bucket must be locked.
+static void
+remove_parked
+  (
+    bucket* bucket,
+    idlib_fiber_impl* previous,
+    idlib_fiber_impl* fiber
+  )
+{
+  if (previous) {
+    previous->next_parked = fiber->next_parked;
+  } else {
+    bucket->head = fiber->next_parked;
+  }
+  if (bucket->tail == fiber) {
+    bucket->tail = previous;
+  }
+  fiber->parked_on = NULL;
+  idlib_atomic_fetch_sub_u32(&idlib_fiber_impl_number_of_parked, 1);
+}
+
+// Remove a fiber from the list of fibers parked with a timeout.
+// The scheduler must be locked.
+static void
+unlink_timed
+  (
+    idlib_fiber_scheduler_impl* scheduler,
+    idlib_fiber_impl* fiber
+  )
+{
+  if (fiber->previous_timed) {
+    fiber->previous_timed->next_timed = fiber->next_timed;
+  } else {
+    scheduler->timed = fiber->next_timed;
+  }
+  if (fiber->next_timed) {
+    fiber->next_timed->previous_timed = fiber->previous_timed;
+  }
+  fiber->deadline = UINT64_MAX;
+  fiber->timed_on = NULL;
+  fiber->previous_timed = NULL;
+  fiber->next_timed = NULL;
+}
+
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_ASSEMBLY)
+
+// Save the callee-saved registers, the MXCSR register, and the x87 control word on the stack,
+// store the stack pointer in *from, load the stack pointer to, and restore the registers from that stack.
+void
+idlib_fiber_impl_switch
+  (
+    void** from,
+    void* to
+  );
+
+__asm__
+  (
+    ".text\n"
+    ".globl idlib_fiber_impl_switch\n"
+    ".hidden idlib_fiber_impl_switch\n"
+    ".type idlib_fiber_impl_switch, @function\n"
+    ".p2align 4\n"
+    "idlib_fiber_impl_switch:\n"
+    "  pushq %rbp\n"
+    "  pushq %rbx\n"
+    "  pushq %r12\n"
+    "  pushq %r13\n"
+    "  pushq %r14\n"
+    "  pushq %r15\n"
+    "  subq $8, %rsp\n"
+    "  stmxcsr (%rsp)\n"
+    "  fnstcw 4(%rsp)\n"
+    "  movq %rsp, (%rdi)\n"
+    "  movq %rsi, %rsp\n"
+    "  ldmxcsr (%rsp)\n"
+    "  fldcw 4(%rsp)\n"
+    "  addq $8, %rsp\n"
+    "  popq %r15\n"
+    "  popq %r14\n"
+    "  popq %r13\n"
+    "  popq %r12\n"
+    "  popq %rbx\n"
+    "  popq %rbp\n"
+    "  ret\n"
+    ".size idlib_fiber_impl_switch, .-idlib_fiber_impl_switch\n"
+  );
+
+#endif
+
+static void
+fiber_main
+  (
+  );
+
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+
+static VOID CALLBACK
+fiber_start
+  (
+    LPVOID argument
+  )
+{
+  fiber_main();
+}
+
+#endif
+
+// Switch from the worker thread to the fiber.
+static void
+resume
+  (
+    idlib_fiber_worker* worker,
+    idlib_fiber_impl* fiber
+  )
+{
+  fiber->worker = worker;
+  idlib_fiber_impl_of_thread = fiber;
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  void* fake_stack = NULL;
+  __sanitizer_start_switch_fiber(&fake_stack, (char*)fiber->mapping + (fiber->mapping_size - worker->scheduler->stack_size), worker->scheduler->stack_size);
+#endif
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_ASSEMBLY)
+  idlib_fiber_impl_switch(&worker->context, fiber->context);
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  SwitchToFiber(fiber->context);
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_UCONTEXT)
+  swapcontext(&worker->context, &fiber->context);
+#else
+  #error("fiber context not (yet) supported")
+#endif
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  __sanitizer_finish_switch_fiber(fake_stack, NULL, NULL);
+#endif
+  idlib_fiber_impl_of_thread = NULL;
+}
+
+// Switch from the fiber to its worker thread which performs the action.
+// The fiber continues when a worker thread resumes it.
+static void
+suspend
+  (
+    idlib_fiber_impl* fiber,
+    int action,
+    uint32_t volatile* lock
+  )
+{
+  idlib_fiber_worker* worker = fiber->worker;
+  worker->action = action;
+  worker->lock = lock;
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  __sanitizer_start_switch_fiber(&fiber->fake_stack, worker->stack_bottom, worker->stack_size);
+#endif
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_ASSEMBLY)
+  idlib_fiber_impl_switch(&fiber->context, worker->context);
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  SwitchToFiber(worker->context);
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_UCONTEXT)
+  swapcontext(&fiber->context, &worker->context);
+#else
+  #error("fiber context not (yet) supported")
+#endif
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  __sanitizer_finish_switch_fiber(fiber->fake_stack, &fiber->worker->stack_bottom, &fiber->worker->stack_size);
+#endif
+}
+
+// The procedure of the context of a fiber.
+// A fiber whose procedure returned is reused by switching to it again with another procedure.
+static void
+fiber_main
+  (
+  )
+{
+  idlib_fiber_impl* fiber = idlib_fiber_impl_of_thread;
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  __sanitizer_finish_switch_fiber(NULL, &fiber->worker->stack_bottom, &fiber->worker->stack_size);
+#endif
+  for (;;) {
+    fiber->procedure(fiber->context_of_procedure);
+    suspend(fiber, IDLIB_FIBER_ACTION_EXIT, NULL);
+  }
+}
+
+static idlib_status
+create_fiber
+  (
+    idlib_fiber_scheduler_impl* scheduler,
+    idlib_fiber_impl** result
+  )
+{
+  idlib_fiber_impl* fiber = malloc(sizeof(idlib_fiber_impl));
+  if (!fiber) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+  fiber->fake_stack = NULL;
+#endif
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  // Windows reserves the stack and its guard page.
+  fiber->context = CreateFiberEx(scheduler->stack_size, scheduler->stack_size, FIBER_FLAG_FLOAT_SWITCH, &fiber_start, NULL);
+  if (!fiber->context) {
+    free(fiber);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  fiber->mapping_size = scheduler->stack_size + page_size;
+#if defined(MAP_STACK)
+  fiber->mapping = mmap(NULL, fiber->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+#else
+  fiber->mapping = mmap(NULL, fiber->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+  if (MAP_FAILED == fiber->mapping) {
+    free(fiber);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // The stack grows downwards, hence an overflow faults in the guard page at the lowest address.
+  if (mprotect(fiber->mapping, page_size, PROT_NONE)) {
+    munmap(fiber->mapping, fiber->mapping_size);
+    free(fiber);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_ASSEMBLY)
+  // The initial frame restored by idlib_fiber_impl_switch.
+  // Its return address is fiber_main which is entered with a misaligned stack as if it was called, its return address is null.
+  uintptr_t top = ((uintptr_t)fiber->mapping + fiber->mapping_size) & ~(uintptr_t)15;
+  uintptr_t* frame = (uintptr_t*)(top - 9 * sizeof(uintptr_t));
+  // The default MXCSR register and x87 control word.
+  frame[0] = (uintptr_t)0x1F80 | ((uintptr_t)0x037F << 32);
+  for (size_t i = 1; i < 7; ++i) {
+    frame[i] = 0;
+  }
+  frame[7] = (uintptr_t)&fiber_main;
+  frame[8] = 0;
+  fiber->context = frame;
+#elif (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_UCONTEXT)
+  if (getcontext(&fiber->context)) {
+    munmap(fiber->mapping, fiber->mapping_size);
+    free(fiber);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  fiber->context.uc_stack.ss_sp = (char*)fiber->mapping + page_size;
+  fiber->context.uc_stack.ss_size = scheduler->stack_size;
+  fiber->context.uc_link = NULL;
+  makecontext(&fiber->context, &fiber_main, 0);
+#else
+  #error("fiber context not (yet) supported")
+#endif
+#endif
+  fiber->scheduler = scheduler;
+  fiber->worker = NULL;
+  fiber->next = NULL;
+  fiber->parked_on = NULL;
+  fiber->next_parked = NULL;
+  fiber->deadline = UINT64_MAX;
+  fiber->timed_on = NULL;
+  fiber->previous_timed = NULL;
+  fiber->next_timed = NULL;
+  *result = fiber;
+  return IDLIB_SUCCESS;
+}
+
+static void
+destroy_fiber
+  (
+    idlib_fiber_impl* fiber
+  )
+{
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  DeleteFiber(fiber->context);
+#else
+  munmap(fiber->mapping, fiber->mapping_size);
+#endif
+  free(fiber);
+}
+
+// Append a fiber to the run queue and wake up an idle worker thread.
+static void
+schedule
+  (
+    idlib_fiber_scheduler_impl* scheduler,
+    idlib_fiber_impl* fiber
+  )
+{
+  fiber->next = NULL;
+  lock(&scheduler->lock);
+  // A fiber parked with a timeout which was unparked before its deadline.
+  if (UINT64_MAX != fiber->deadline) {
+    unlink_timed(scheduler, fiber);
+  }
+  if (scheduler->tail) {
+    scheduler->tail->next = fiber;
+  } else {
+    scheduler->head = fiber;
+  }
+  scheduler->tail = fiber;
+  int idle = 0 != scheduler->number_of_idle_workers;
+  if (idle) {
+    idlib_atomic_fetch_add_u32(&scheduler->sequence, 1);
+  }
+  unlock(&scheduler->lock);
+  if (idle) {
+    idlib_futex_wake_one(&scheduler->sequence);
+  }
+}
+
+// Take at most EXPIRY_BATCH_SIZE fibers whose deadlines passed from the list of fibers parked with a timeout
+// and store them and the words they are parked on in the specified arrays.
+// The scheduler must be locked.
+// Returns the number of fibers. *deadline is assigned the earliest deadline of the remaining fibers or UINT64_MAX.
+static size_t
+take_expired
+  (
+    idlib_fiber_scheduler_impl* scheduler,
+    idlib_fiber_impl** fibers,
+    uint32_t volatile** addresses,
+    uint64_t* deadline
+  )
+{
+  uint64_t now = idlib_clock_now();
+  size_t n = 0;
+  *deadline = UINT64_MAX;
+  idlib_fiber_impl* fiber = scheduler->timed;
+  while (fiber) {
+    idlib_fiber_impl* next = fiber->next_timed;
+    if (fiber->deadline <= now && n < EXPIRY_BATCH_SIZE) {
+      fibers[n] = fiber;
+      addresses[n] = fiber->timed_on;
+      n++;
+      unlink_timed(scheduler, fiber);
+    } else if (fiber->deadline < *deadline) {
+      *deadline = fiber->deadline;
+    }
+    fiber = next;
+  }
+  return n;
+}
+
+// Unpark a fiber whose deadline passed if it is still parked on the specified word.
+// It might have been unparked, resumed, and parked again since it was taken from the list of fibers parked with a timeout.
+// In that case it is unparked spuriously which its waiter tolerates.
+static void
+unpark_expired
+  (
+    idlib_fiber_impl* fiber,
+    uint32_t volatile* address
+  )
+{
+  bucket* bucket = get_bucket(address);
+  int found = 0;
+  lock(&bucket->lock);
+  idlib_fiber_impl* previous = NULL;
+  for (idlib_fiber_impl* current = bucket->head; NULL != current; current = current->next_parked) {
+    if (fiber == current) {
+      remove_parked(bucket, previous, current);
+      found = 1;
+      break;
+    }
+    previous = current;
+  }
+  unlock(&bucket->lock);
+  if (found) {
+    schedule(fiber->scheduler, fiber);
+  }
+}
+
+static void
+run
+  (
+    idlib_fiber_worker* worker
+  )
+{
+  idlib_fiber_scheduler_impl* scheduler = worker->scheduler;
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  worker->context = ConvertThreadToFiberEx(NULL, FIBER_FLAG_FLOAT_SWITCH);
+#endif
+  lock(&scheduler->lock);
+  for (;;) {
+    uint64_t deadline = UINT64_MAX;
+    if (IDLIB_UNLIKELY(NULL != scheduler->timed)) {
+      idlib_fiber_impl* fibers[EXPIRY_BATCH_SIZE];
+      uint32_t volatile* addresses[EXPIRY_BATCH_SIZE];
+      size_t n = take_expired(scheduler, fibers, addresses, &deadline);
+      if (n) {
+        unlock(&scheduler->lock);
+        for (size_t i = 0; i < n; ++i) {
+          unpark_expired(fibers[i], addresses[i]);
+        }
+        lock(&scheduler->lock);
+        continue;
+      }
+    }
+    idlib_fiber_impl* fiber = scheduler->head;
+    if (!fiber) {
+      if (scheduler->stop) {
+        break;
+      }
+      scheduler->number_of_idle_workers++;
+      uint32_t sequence = idlib_atomic_load_relaxed_u32(&scheduler->sequence);
+      unlock(&scheduler->lock);
+      if (UINT64_MAX == deadline) {
+        idlib_futex_wait(&scheduler->sequence, sequence);
+      } else {
+        // Wake up when the earliest deadline passes.
+        uint64_t now = idlib_clock_now();
+        if (deadline > now) {
+          idlib_futex_wait_for(&scheduler->sequence, sequence, deadline - now);
+        }
+      }
+      lock(&scheduler->lock);
+      scheduler->number_of_idle_workers--;
+      continue;
+    }
+    scheduler->head = fiber->next;
+    if (!scheduler->head) {
+      scheduler->tail = NULL;
+    }
+    unlock(&scheduler->lock);
+    resume(worker, fiber);
+    switch (worker->action) {
+      case IDLIB_FIBER_ACTION_YIELD: {
+        // This worker thread dequeues the fiber again unless other fibers are runnable.
+        fiber->next = NULL;
+        lock(&scheduler->lock);
+        if (scheduler->tail) {
+          scheduler->tail->next = fiber;
+        } else {
+          scheduler->head = fiber;
+        }
+        scheduler->tail = fiber;
+      } break;
+      case IDLIB_FIBER_ACTION_PARK: {
+        // The context of the fiber was saved, hence it can be unparked.
+        unlock(worker->lock);
+        lock(&scheduler->lock);
+      } break;
+      case IDLIB_FIBER_ACTION_EXIT: {
+        if (1 == idlib_atomic_fetch_sub_u32(&scheduler->number_of_fibers, 1)) {
+          idlib_futex_wake_all(&scheduler->number_of_fibers);
+        }
+        lock(&scheduler->lock);
+        fiber->next = scheduler->unused;
+        scheduler->unused = fiber;
+      } break;
+    }
+  }
+  unlock(&scheduler->lock);
+#if (IDLIB_FIBER_CONTEXT == IDLIB_FIBER_CONTEXT_WINDOWS)
+  ConvertFiberToThread();
+#endif
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+static void*
+thread_procedure
+  (
+    void* argument
+  )
+{
+  run((idlib_fiber_worker*)argument);
+  return NULL;
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+static DWORD WINAPI
+thread_procedure
+  (
+    LPVOID argument
+  )
+{
+  run((idlib_fiber_worker*)argument);
+  return 0;
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// Stop the worker threads once the run queue is empty and wait for the first number_of_workers of them to terminate.
+static void
+stop
+  (
+    idlib_fiber_scheduler_impl* scheduler,
+    size_t number_of_workers
+  )
+{
+  lock(&scheduler->lock);
+  scheduler->stop = 1;
+  idlib_atomic_fetch_add_u32(&scheduler->sequence, 1);
+  unlock(&scheduler->lock);
+  idlib_futex_wake_all(&scheduler->sequence);
+  for (size_t i = 0; i < number_of_workers; ++i) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    pthread_join(scheduler->workers[i].thread, NULL);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+    WaitForSingleObject(scheduler->workers[i].thread, INFINITE);
+    CloseHandle(scheduler->workers[i].thread);
+#else
+    #error("operating system not (yet) supported")
+#endif
+  }
+}
+
+// Park a fiber if the value of the word pointed to by address is expected.
+// If the deadline is not UINT64_MAX, then the fiber is also unparked when the deadline passed.
+static void
+park
+  (
+    idlib_fiber_impl* fiber,
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t deadline
+  )
+{
+  bucket* bucket = get_bucket(address);
+  // Announce the fiber before the word is compared such that a waker which modified the word either
+  // observes the announcement (see idlib_fiber_impl_may_be_parked) or the fiber observes the modification.
+  idlib_atomic_fetch_add_u32(&idlib_fiber_impl_number_of_parked, 1);
+  lock(&bucket->lock);
+  if (expected != idlib_atomic_load_u32(address)) {
+    unlock(&bucket->lock);
+    idlib_atomic_fetch_sub_u32(&idlib_fiber_impl_number_of_parked, 1);
+    return;
+  }
+  fiber->parked_on = address;
+  fiber->next_parked = NULL;
+  if (bucket->tail) {
+    bucket->tail->next_parked = fiber;
+  } else {
+    bucket->head = fiber;
+  }
+  bucket->tail = fiber;
+  if (UINT64_MAX != deadline) {
+    // The worker thread this fiber runs on observes the deadline when it takes the next fiber.
+    idlib_fiber_scheduler_impl* scheduler = fiber->scheduler;
+    lock(&scheduler->lock);
+    fiber->deadline = deadline;
+    fiber->timed_on = address;
+    fiber->previous_timed = NULL;
+    fiber->next_timed = scheduler->timed;
+    if (scheduler->timed) {
+      scheduler->timed->previous_timed = fiber;
+    }
+    scheduler->timed = fiber;
+    unlock(&scheduler->lock);
+  }
+  // The worker thread releases the lock of the bucket.
+  suspend(fiber, IDLIB_FIBER_ACTION_PARK, &bucket->lock);
+}
+
+int
+idlib_fiber_impl_park
+  (
+    uint32_t volatile* address,
+    uint32_t expected
+  )
+{
+  idlib_fiber_impl* fiber = idlib_fiber_impl_of_thread;
+  if (!fiber) {
+    return 0;
+  }
+  park(fiber, address, expected, UINT64_MAX);
+  return 1;
+}
+
+int
+idlib_fiber_impl_park_for
+  (
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t timeout
+  )
+{
+  idlib_fiber_impl* fiber = idlib_fiber_impl_of_thread;
+  if (!fiber) {
+    return 0;
+  }
+  // UINT64_MAX denotes a fiber parked without a timeout.
+  uint64_t now = idlib_clock_now();
+  park(fiber, address, expected, timeout < UINT64_MAX - 1 - now ? now + timeout : UINT64_MAX - 1);
+  return 1;
+}
+
+int
+idlib_fiber_impl_yield
+  (
+  )
+{
+  idlib_fiber_impl* fiber = idlib_fiber_impl_of_thread;
+  if (!fiber) {
+    return 0;
+  }
+  suspend(fiber, IDLIB_FIBER_ACTION_YIELD, NULL);
+  return 1;
+}
+
+void
+idlib_fiber_impl_unpark
+  (
+    uint32_t volatile* address,
+    int all
+  )
+{
+  bucket* bucket = get_bucket(address);
+  idlib_fiber_impl* unparked = NULL;
+  idlib_fiber_impl** last = &unparked;
+  lock(&bucket->lock);
+  idlib_fiber_impl* previous = NULL;
+  idlib_fiber_impl* current = bucket->head;
+  while (current) {
+    idlib_fiber_impl* next = current->next_parked;
+    if (address == current->parked_on) {
+      remove_parked(bucket, previous, current);
+      current->next = NULL;
+      *last = current;
+      last = &current->next;
+      if (!all) {
+        break;
+      }
+    } else {
+      previous = current;
+    }
+    current = next;
+  }
+  unlock(&bucket->lock);
+  while (unparked) {
+    idlib_fiber_impl* next = unparked->next;
+    schedule(unparked->scheduler, unparked);
+    unparked = next;
+  }
+}
+
+idlib_status
+idlib_fiber_scheduler_initialize
+  (
+    idlib_fiber_scheduler* scheduler,
+    size_t number_of_workers,
+    size_t stack_size
+  )
+{
+  if (!scheduler || !number_of_workers) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (!stack_size) {
+    stack_size = IDLIB_FIBER_STACK_SIZE;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  size_t page_size = (size_t)system_info.dwPageSize;
+#else
+  #error("operating system not (yet) supported")
+#endif
+  if (stack_size > SIZE_MAX - 2 * page_size) {
+    return IDLIB_TOO_BIG;
+  }
+  stack_size = (stack_size + page_size - 1) / page_size * page_size;
+  idlib_fiber_scheduler_impl* impl = malloc(sizeof(idlib_fiber_scheduler_impl));
+  if (!impl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  if (number_of_workers > SIZE_MAX / sizeof(idlib_fiber_worker)) {
+    free(impl);
+    return IDLIB_TOO_BIG;
+  }
+  impl->workers = malloc(number_of_workers * sizeof(idlib_fiber_worker));
+  if (!impl->workers) {
+    free(impl);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  impl->lock = 0;
+  impl->head = NULL;
+  impl->tail = NULL;
+  impl->unused = NULL;
+  impl->timed = NULL;
+  impl->sequence = 0;
+  impl->number_of_idle_workers = 0;
+  impl->stop = 0;
+  impl->number_of_fibers = 0;
+  impl->stack_size = stack_size;
+  impl->number_of_workers = number_of_workers;
+  for (size_t i = 0; i < number_of_workers; ++i) {
+    idlib_fiber_worker* worker = &impl->workers[i];
+    worker->scheduler = impl;
+    worker->action = IDLIB_FIBER_ACTION_YIELD;
+    worker->lock = NULL;
+#if defined(IDLIB_FIBER_WITH_ADDRESS_SANITIZER)
+    worker->stack_bottom = NULL;
+    worker->stack_size = 0;
+#endif
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    int failed = 0 != pthread_create(&worker->thread, NULL, &thread_procedure, worker);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+    worker->thread = CreateThread(NULL, 0, &thread_procedure, worker, 0, NULL);
+    int failed = NULL == worker->thread;
+#else
+    #error("operating system not (yet) supported")
+#endif
+    if (failed) {
+      stop(impl, i);
+      free(impl->workers);
+      free(impl);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  scheduler->pimpl = impl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_fiber_scheduler_uninitialize
+  (
+    idlib_fiber_scheduler* scheduler
+  )
+{
+  if (!scheduler) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (idlib_fiber_impl_of_thread) {
+    return IDLIB_OPERATION_INVALID;
+  }
+  idlib_fiber_scheduler_impl* impl = (idlib_fiber_scheduler_impl*)scheduler->pimpl;
+  uint32_t number_of_fibers = idlib_atomic_load_acquire_u32(&impl->number_of_fibers);
+  while (number_of_fibers) {
+    idlib_futex_wait(&impl->number_of_fibers, number_of_fibers);
+    number_of_fibers = idlib_atomic_load_acquire_u32(&impl->number_of_fibers);
+  }
+  scheduler->pimpl = NULL;
+  stop(impl, impl->number_of_workers);
+  while (impl->unused) {
+    idlib_fiber_impl* fiber = impl->unused;
+    impl->unused = fiber->next;
+    destroy_fiber(fiber);
+  }
+  free(impl->workers);
+  free(impl);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_fiber_spawn
+  (
+    idlib_fiber_scheduler* scheduler,
+    idlib_fiber_procedure* procedure,
+    void* context
+  )
+{
+  if (!scheduler || !procedure) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_fiber_scheduler_impl* impl = (idlib_fiber_scheduler_impl*)scheduler->pimpl;
+  lock(&impl->lock);
+  idlib_fiber_impl* fiber = impl->unused;
+  if (fiber) {
+    impl->unused = fiber->next;
+  }
+  unlock(&impl->lock);
+  if (!fiber) {
+    idlib_status status = create_fiber(impl, &fiber);
+    if (status) {
+      return status;
+    }
+  }
+  fiber->procedure = procedure;
+  fiber->context_of_procedure = context;
+  idlib_atomic_fetch_add_u32(&impl->number_of_fibers, 1);
+  schedule(impl, fiber);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_fiber_yield
+  (
+  )
+{
+  return idlib_fiber_impl_yield() ? IDLIB_SUCCESS : IDLIB_OPERATION_INVALID;
+}
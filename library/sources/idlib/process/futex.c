@@ -0,0 +1,108 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/futex.h"
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+#include "idlib/process/atomic.h"
+
+#include <pthread.h>
+
+// clock_gettime
+#include <time.h>
+
+// The number of buckets. A power of two.
+#define BUCKETS (64)
+
+// A waiter waits on the condition variable of the bucket of its address.
+// As different addresses may share a bucket, a wake-up wakes all waiters of the bucket.
+typedef struct bucket {
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
+} bucket;
+
+static bucket g_buckets[BUCKETS] = {
+  [0 ... BUCKETS - 1] = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER },
+};
+
+static bucket*
+get_bucket
+  (
+    uint32_t volatile* address
+  )
+{
+  uint64_t hash = (uint64_t)(uintptr_t)address * UINT64_C(0x9e3779b97f4a7c15);
+  return &g_buckets[(hash >> 32) & (BUCKETS - 1)];
+}
+
+void
+idlib_futex_wait_emulated
+  (
+    uint32_t volatile* address,
+    uint32_t expected
+  )
+{
+  bucket* bucket = get_bucket(address);
+  pthread_mutex_lock(&bucket->mutex);
+  // A waker modifies the word before it acquires the mutex of the bucket, hence the wake-up can not be missed.
+  if (expected == idlib_atomic_load_acquire_u32(address)) {
+    pthread_cond_wait(&bucket->condition, &bucket->mutex);
+  }
+  pthread_mutex_unlock(&bucket->mutex);
+}
+
+void
+idlib_futex_wait_for_emulated
+  (
+    uint32_t volatile* address,
+    uint32_t expected,
+    uint64_t timeout
+  )
+{
+  // pthread_cond_timedwait expects an absolute time of the realtime clock.
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  uint64_t nanoseconds = (uint64_t)deadline.tv_nsec + timeout % UINT64_C(1000000000);
+  deadline.tv_sec += (time_t)(timeout / UINT64_C(1000000000) + nanoseconds / UINT64_C(1000000000));
+  deadline.tv_nsec = (long)(nanoseconds % UINT64_C(1000000000));
+  bucket* bucket = get_bucket(address);
+  pthread_mutex_lock(&bucket->mutex);
+  if (expected == idlib_atomic_load_acquire_u32(address)) {
+    pthread_cond_timedwait(&bucket->condition, &bucket->mutex, &deadline);
+  }
+  pthread_mutex_unlock(&bucket->mutex);
+}
+
+void
+idlib_futex_wake_emulated
+  (
+    uint32_t volatile* address
+  )
+{
+  bucket* bucket = get_bucket(address);
+  pthread_mutex_lock(&bucket->mutex);
+  pthread_cond_broadcast(&bucket->condition);
+  pthread_mutex_unlock(&bucket->mutex);
+}
+
+#endif
@@ -0,0 +1,516 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process/future.h"
+
+#include "idlib/process/future_impl.h"
+
+#include "idlib/process/allocator_impl.h"
+
+#include "idlib/process/clock.h"
+
+#include "idlib/process/futex.h"
+
+// A combinator of idlib_future_when_all or idlib_future_when_any.
+typedef struct combinator {
+  // The allocator the combinator was allocated from.
+  idlib_allocator* allocator;
+  // The number of futures which are not ready.
+  uint32_t volatile remaining;
+  // The first error of a future.
+  uint32_t volatile error;
+  // Non-zero for idlib_future_when_any.
+  int any;
+  idlib_future_state* result;
+} combinator;
+
+static idlib_future_state*
+create_state
+  (
+    uint32_t reference_count
+  )
+{
+  idlib_allocator* allocator = idlib_allocator_impl_get();
+  idlib_future_state* state = idlib_allocator_impl_allocate(allocator, sizeof(idlib_future_state));
+  if (!state) {
+    return NULL;
+  }
+  state->allocator = allocator;
+  state->reference_count = reference_count;
+  state->claimed = 0;
+  state->state = IDLIB_FUTURE_EMPTY;
+  state->status = IDLIB_SUCCESS;
+  state->value = NULL;
+  state->nodes = NULL;
+  return state;
+}
+
+static void
+release_state
+  (
+    idlib_future_state* state
+  )
+{
+  if (1 == idlib_atomic_fetch_sub_u32(&state->reference_count, 1)) {
+    idlib_allocator_impl_deallocate(state->allocator, state, sizeof(idlib_future_state));
+  }
+}
+
+static idlib_status
+complete
+  (
+    idlib_future_state* state,
+    idlib_status status,
+    void* value
+  );
+
+static void
+run_node
+  (
+    void* context
+  )
+{
+  idlib_future_node* node = (idlib_future_node*)context;
+  void* value = NULL;
+  idlib_status status = node->continuation(node->context, node->status, node->value, &value);
+  if (node->result) {
+    complete(node->result, status, status ? NULL : value);
+    release_state(node->result);
+  }
+  idlib_allocator_impl_deallocate(node->allocator, node, sizeof(idlib_future_node));
+}
+
+static void
+dispatch_node
+  (
+    idlib_future_node* node,
+    idlib_status status,
+    void* value
+  )
+{
+  node->status = status;
+  node->value = value;
+  if (node->executor) {
+    node->executor(node->executor_context, &run_node, node);
+  } else {
+    run_node(node);
+  }
+}
+
+// Set the status and the value of a shared state, wake up the waiting threads, and dispatch the continuations.
+// Returns IDLIB_OPERATION_INVALID and does nothing if the shared state was already set.
+static idlib_status
+complete
+  (
+    idlib_future_state* state,
+    idlib_status status,
+    void* value
+  )
+{
+  if (idlib_atomic_exchange_u32(&state->claimed, 1)) {
+    return IDLIB_OPERATION_INVALID;
+  }
+  state->status = status;
+  state->value = value;
+  if (IDLIB_FUTURE_WAITERS == idlib_atomic_exchange_u32(&state->state, IDLIB_FUTURE_READY)) {
+    idlib_futex_wake_all(&state->state);
+  }
+  // Seal the list of continuations and dispatch them in the order of their addition.
+  idlib_future_node* nodes = (idlib_future_node*)idlib_atomic_exchange_pointer(&state->nodes, IDLIB_FUTURE_SEALED);
+  idlib_future_node* reversed = NULL;
+  while (nodes) {
+    idlib_future_node* next = nodes->next;
+    nodes->next = reversed;
+    reversed = nodes;
+    nodes = next;
+  }
+  while (reversed) {
+    idlib_future_node* next = reversed->next;
+    dispatch_node(reversed, status, value);
+    reversed = next;
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Add a continuation to a shared state or dispatch it if the list of continuations is sealed.
+static void
+add_node
+  (
+    idlib_future_state* state,
+    idlib_future_node* node
+  )
+{
+  void* head = idlib_atomic_load_acquire_pointer(&state->nodes);
+  do {
+    if (IDLIB_FUTURE_SEALED == head) {
+      // The list is sealed after the state word became IDLIB_FUTURE_READY.
+      dispatch_node(node, state->status, state->value);
+      return;
+    }
+    node->next = (idlib_future_node*)head;
+  } while (!idlib_atomic_compare_exchange_pointer(&state->nodes, &head, node));
+}
+
+static idlib_future_node*
+create_node
+  (
+    idlib_future_executor* executor,
+    void* executor_context,
+    idlib_future_continuation* continuation,
+    void* context,
+    idlib_future_state* result
+  )
+{
+  idlib_allocator* allocator = idlib_allocator_impl_get();
+  idlib_future_node* node = idlib_allocator_impl_allocate(allocator, sizeof(idlib_future_node));
+  if (!node) {
+    return NULL;
+  }
+  node->allocator = allocator;
+  node->next = NULL;
+  node->executor = executor;
+  node->executor_context = executor_context;
+  node->continuation = continuation;
+  node->context = context;
+  node->result = result;
+  node->status = IDLIB_SUCCESS;
+  node->value = NULL;
+  return node;
+}
+
+idlib_status
+idlib_promise_initialize
+  (
+    idlib_promise* promise
+  )
+{
+  if (!promise) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = create_state(1);
+  if (!state) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  promise->pimpl = state;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_promise_uninitialize
+  (
+    idlib_promise* promise
+  )
+{
+  if (!promise || !promise->pimpl) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = (idlib_future_state*)promise->pimpl;
+  promise->pimpl = NULL;
+  // A promise which was not set is broken.
+  complete(state, IDLIB_ABORTED, NULL);
+  release_state(state);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_promise_get_future
+  (
+    idlib_promise* promise,
+    idlib_future* future
+  )
+{
+  if (!promise || !promise->pimpl || !future) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = (idlib_future_state*)promise->pimpl;
+  if (!idlib_atomic_try_add_u32(&state->reference_count, 1)) {
+    return IDLIB_OVERFLOW;
+  }
+  future->pimpl = state;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_promise_set_value
+  (
+    idlib_promise* promise,
+    void* value
+  )
+{
+  if (!promise || !promise->pimpl) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return complete((idlib_future_state*)promise->pimpl, IDLIB_SUCCESS, value);
+}
+
+idlib_status
+idlib_promise_set_error
+  (
+    idlib_promise* promise,
+    idlib_status error
+  )
+{
+  if (!promise || !promise->pimpl || IDLIB_SUCCESS == error) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return complete((idlib_future_state*)promise->pimpl, error, NULL);
+}
+
+idlib_status
+idlib_future_uninitialize
+  (
+    idlib_future* future
+  )
+{
+  if (!future || !future->pimpl) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = (idlib_future_state*)future->pimpl;
+  future->pimpl = NULL;
+  release_state(state);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_future_wait
+  (
+    idlib_future* future
+  )
+{
+  if (!future || !future->pimpl) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = (idlib_future_state*)future->pimpl;
+  uint32_t expected = idlib_atomic_load_acquire_u32(&state->state);
+  while (IDLIB_FUTURE_READY != expected) {
+    if (IDLIB_FUTURE_EMPTY == expected && !idlib_atomic_compare_exchange_u32(&state->state, &expected, IDLIB_FUTURE_WAITERS)) {
+      continue;
+    }
+    idlib_futex_wait(&state->state, IDLIB_FUTURE_WAITERS);
+    expected = idlib_atomic_load_acquire_u32(&state->state);
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_future_wait_until
+  (
+    idlib_future* future,
+    uint64_t deadline
+  )
+{
+  if (!future || !future->pimpl) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = (idlib_future_state*)future->pimpl;
+  uint32_t expected = idlib_atomic_load_acquire_u32(&state->state);
+  while (IDLIB_FUTURE_READY != expected) {
+    uint64_t now = idlib_clock_now();
+    if (now >= deadline) {
+      return IDLIB_TIMED_OUT;
+    }
+    if (IDLIB_FUTURE_EMPTY == expected && !idlib_atomic_compare_exchange_u32(&state->state, &expected, IDLIB_FUTURE_WAITERS)) {
+      continue;
+    }
+    idlib_futex_wait_for(&state->state, IDLIB_FUTURE_WAITERS, deadline - now);
+    expected = idlib_atomic_load_acquire_u32(&state->state);
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_future_get
+  (
+    idlib_future* future,
+    void** value
+  )
+{
+  if (!value) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_future_wait(future);
+  if (status) {
+    return status;
+  }
+  idlib_future_state* state = (idlib_future_state*)future->pimpl;
+  if (state->status) {
+    return state->status;
+  }
+  *value = state->value;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_future_then
+  (
+    idlib_future* future,
+    idlib_future_executor* executor,
+    void* executor_context,
+    idlib_future_continuation* continuation,
+    void* context,
+    idlib_future* result
+  )
+{
+  if (!future || !future->pimpl || !continuation) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_future_state* state = NULL;
+  if (result) {
+    // One reference for the continuation and one for the resulting future.
+    state = create_state(2);
+    if (!state) {
+      return IDLIB_ALLOCATION_FAILED;
+    }
+  }
+  idlib_future_node* node = create_node(executor, executor_context, continuation, context, state);
+  if (!node) {
+    if (state) {
+      idlib_allocator_impl_deallocate(state->allocator, state, sizeof(idlib_future_state));
+    }
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  if (result) {
+    result->pimpl = state;
+  }
+  add_node((idlib_future_state*)future->pimpl, node);
+  return IDLIB_SUCCESS;
+}
+
+static idlib_status
+combine
+  (
+    void* context,
+    idlib_status status,
+    void* value,
+    void** result
+  )
+{
+  (void)result;
+  combinator* self = (combinator*)context;
+  if (self->any) {
+    complete(self->result, status, value);
+  } else if (status) {
+    uint32_t expected = IDLIB_SUCCESS;
+    idlib_atomic_compare_exchange_u32(&self->error, &expected, status);
+  }
+  if (1 == idlib_atomic_fetch_sub_u32(&self->remaining, 1)) {
+    if (!self->any) {
+      complete(self->result, idlib_atomic_load_acquire_u32(&self->error), NULL);
+    }
+    release_state(self->result);
+    idlib_allocator_impl_deallocate(self->allocator, self, sizeof(combinator));
+  }
+  return IDLIB_SUCCESS;
+}
+
+static idlib_status
+when
+  (
+    idlib_future* futures,
+    size_t n,
+    idlib_future* result,
+    int any
+  )
+{
+  if (n > UINT32_MAX) {
+    return IDLIB_TOO_BIG;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (!futures[i].pimpl) {
+      return IDLIB_ARGUMENT_INVALID;
+    }
+  }
+  idlib_allocator* allocator = idlib_allocator_impl_get();
+  // One reference for the combinator and one for the resulting future.
+  idlib_future_state* state = create_state(2);
+  if (!state) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  if (!n) {
+    complete(state, IDLIB_SUCCESS, NULL);
+    release_state(state);
+    result->pimpl = state;
+    return IDLIB_SUCCESS;
+  }
+  combinator* self = idlib_allocator_impl_allocate(allocator, sizeof(combinator));
+  if (!self) {
+    idlib_allocator_impl_deallocate(allocator, state, sizeof(idlib_future_state));
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  self->allocator = allocator;
+  self->remaining = (uint32_t)n;
+  self->error = IDLIB_SUCCESS;
+  self->any = any;
+  self->result = state;
+  // Create all continuations before adding any such that a failure has no effect.
+  idlib_future_node* nodes = NULL;
+  for (size_t i = 0; i < n; ++i) {
+    idlib_future_node* node = create_node(NULL, NULL, &combine, self, NULL);
+    if (!node) {
+      while (nodes) {
+        node = nodes;
+        nodes = nodes->next;
+        idlib_allocator_impl_deallocate(allocator, node, sizeof(idlib_future_node));
+      }
+      idlib_allocator_impl_deallocate(allocator, self, sizeof(combinator));
+      idlib_allocator_impl_deallocate(allocator, state, sizeof(idlib_future_state));
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    node->next = nodes;
+    nodes = node;
+  }
+  result->pimpl = state;
+  for (size_t i = 0; i < n; ++i) {
+    idlib_future_node* node = nodes;
+    nodes = nodes->next;
+    add_node((idlib_future_state*)futures[i].pimpl, node);
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_future_when_all
+  (
+    idlib_future* futures,
+    size_t n,
+    idlib_future* result
+  )
+{
+  if ((!futures && n) || !result) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return when(futures, n, result, 0);
+}
+
+idlib_status
+idlib_future_when_any
+  (
+    idlib_future* futures,
+    size_t n,
+    idlib_future* result
+  )
+{
+  if (!futures || !n || !result) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return when(futures, n, result, 1);
+}
@@ -0,0 +1,329 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/intern.h"
+
+#include "idlib/process/intern_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/once.h"
+
+// malloc, free
+#include <malloc.h>
+
+// memcmp, memcpy
+#include <string.h>
+
+static idlib_status
+create_table
+  (
+    size_t capacity,
+    idlib_intern_table** table
+  )
+{
+  idlib_intern_table* t = malloc(sizeof(idlib_intern_table));
+  if (!t) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  t->slots = malloc(sizeof(idlib_intern_record*) * capacity);
+  if (!t->slots) {
+    free(t);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  for (size_t i = 0; i < capacity; ++i) {
+    t->slots[i] = NULL;
+  }
+  t->capacity = capacity;
+  t->previous = NULL;
+  *table = t;
+  return IDLIB_SUCCESS;
+}
+
+// Get the record of the specified bytes in the specified table.
+// Returns a null pointer if no such record exists and assigns the index of the empty slot which terminated the probe sequence.
+static idlib_intern_record*
+find
+  (
+    idlib_intern_table* table,
+    uint64_t hash,
+    void const* p,
+    size_t n,
+    size_t* index
+  )
+{
+  size_t mask = table->capacity - 1;
+  for (size_t i = (size_t)hash & mask; ; i = (i + 1) & mask) {
+    idlib_intern_record* record = (idlib_intern_record*)idlib_atomic_load_acquire_pointer((void* volatile*)&table->slots[i]);
+    if (!record) {
+      *index = i;
+      return NULL;
+    }
+    if (record->hash == hash && record->n == n && !memcmp(record->bytes, p, n)) {
+      return record;
+    }
+  }
+}
+
+// Allocate a record of the specified number of Bytes from the arena.
+static idlib_intern_record*
+allocate_record
+  (
+    idlib_intern_set* set,
+    size_t n
+  )
+{
+  if (n > SIZE_MAX - sizeof(idlib_intern_record) - sizeof(uint64_t)) {
+    return NULL;
+  }
+  // The record, the terminating zero Byte, and the padding to the alignment of the next record.
+  size_t size = (sizeof(idlib_intern_record) + n + 1 + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+  if (size > IDLIB_INTERN_CHUNK_SIZE / 4) {
+    idlib_intern_chunk* chunk = malloc(sizeof(idlib_intern_chunk) + size);
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->size = size;
+    chunk->used = size;
+    // Keep packing records into the first chunk.
+    if (set->chunks) {
+      chunk->next = set->chunks->next;
+      set->chunks->next = chunk;
+    } else {
+      chunk->next = NULL;
+      set->chunks = chunk;
+    }
+    return (idlib_intern_record*)chunk->bytes;
+  }
+  idlib_intern_chunk* chunk = set->chunks;
+  if (!chunk || chunk->size - chunk->used < size) {
+    chunk = malloc(sizeof(idlib_intern_chunk) + IDLIB_INTERN_CHUNK_SIZE);
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->size = IDLIB_INTERN_CHUNK_SIZE;
+    chunk->used = 0;
+    chunk->next = set->chunks;
+    set->chunks = chunk;
+  }
+  idlib_intern_record* record = (idlib_intern_record*)((char*)chunk->bytes + chunk->used);
+  chunk->used += size;
+  return record;
+}
+
+// Must be invoked under the lock.
+static idlib_status
+intern_locked
+  (
+    idlib_intern_set* set,
+    uint64_t hash,
+    void const* p,
+    size_t n,
+    void const** interned
+  )
+{
+  idlib_intern_table* table = set->table;
+  size_t index;
+  idlib_intern_record* record = find(table, hash, p, n, &index);
+  if (record) {
+    *interned = record->bytes;
+    return IDLIB_SUCCESS;
+  }
+  if ((set->size + 1) * 2 > table->capacity) {
+    if (table->capacity > SIZE_MAX / 2 / sizeof(idlib_intern_record*)) {
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    idlib_intern_table* new_table;
+    idlib_status status = create_table(table->capacity * 2, &new_table);
+    if (status) {
+      return status;
+    }
+    size_t mask = new_table->capacity - 1;
+    for (size_t i = 0; i < table->capacity; ++i) {
+      idlib_intern_record* r = table->slots[i];
+      if (r) {
+        size_t j = (size_t)r->hash & mask;
+        while (new_table->slots[j]) {
+          j = (j + 1) & mask;
+        }
+        new_table->slots[j] = r;
+      }
+    }
+    new_table->previous = table;
+    idlib_atomic_store_release_pointer((void* volatile*)&set->table, new_table);
+    table = new_table;
+    find(table, hash, p, n, &index);
+  }
+  record = allocate_record(set, n);
+  if (!record) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  record->hash = hash;
+  record->n = n;
+  memcpy(record->bytes, p, n);
+  record->bytes[n] = '\0';
+  idlib_atomic_store_release_pointer((void* volatile*)&table->slots[index], record);
+  set->size++;
+  *interned = record->bytes;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_intern_impl_create
+  (
+    idlib_intern_set** set
+  )
+{
+  idlib_intern_set* s = malloc(sizeof(idlib_intern_set));
+  if (!s) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  if (idlib_mutex_initialize(&s->lock)) {
+    free(s);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_intern_table* table;
+  if (create_table(IDLIB_INTERN_MINIMUM_CAPACITY, &table)) {
+    idlib_mutex_uninitialize(&s->lock);
+    free(s);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  s->table = table;
+  s->size = 0;
+  s->chunks = NULL;
+  *set = s;
+  return IDLIB_SUCCESS;
+}
+
+void
+idlib_intern_impl_destroy
+  (
+    idlib_intern_set* set
+  )
+{
+  idlib_intern_table* table = set->table;
+  while (table) {
+    idlib_intern_table* previous = table->previous;
+    free((void*)table->slots);
+    free(table);
+    table = previous;
+  }
+  while (set->chunks) {
+    idlib_intern_chunk* chunk = set->chunks;
+    set->chunks = chunk->next;
+    free(chunk);
+  }
+  idlib_mutex_uninitialize(&set->lock);
+  free(set);
+}
+
+static idlib_status
+create_set
+  (
+    void* context
+  )
+{
+  idlib_process* process = (idlib_process*)context;
+  return idlib_intern_impl_create(&process->intern);
+}
+
+idlib_status
+idlib_intern
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    void const** interned
+  )
+{
+  if (!process || !p || !interned) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->intern_once, &create_set, process);
+  if (status) {
+    return status;
+  }
+  idlib_intern_set* set = process->intern;
+  uint64_t hash = idlib_process_hash(p, n);
+  size_t index;
+  // Fast path: the byte sequence was interned before.
+  idlib_intern_table* table = (idlib_intern_table*)idlib_atomic_load_acquire_pointer((void* volatile*)&set->table);
+  idlib_intern_record* record = find(table, hash, p, n, &index);
+  if (record) {
+    *interned = record->bytes;
+    return IDLIB_SUCCESS;
+  }
+  if (idlib_mutex_lock(&set->lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  status = intern_locked(set, hash, p, n, interned);
+  idlib_mutex_unlock(&set->lock);
+  return status;
+}
+
+idlib_status
+idlib_intern_many
+  (
+    idlib_process* process,
+    void const* const* p,
+    size_t const* n,
+    size_t count,
+    void const** interned
+  )
+{
+  if (!process || !p || !n || !interned) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!p[i]) {
+      return IDLIB_ARGUMENT_INVALID;
+    }
+  }
+  idlib_status status = idlib_once_call(&process->intern_once, &create_set, process);
+  if (status) {
+    return status;
+  }
+  idlib_intern_set* set = process->intern;
+  if (idlib_mutex_lock(&set->lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  for (size_t i = 0; i < count && !status; ++i) {
+    status = intern_locked(set, idlib_process_hash(p[i], n[i]), p[i], n[i], &interned[i]);
+  }
+  idlib_mutex_unlock(&set->lock);
+  return status;
+}
+
+idlib_status
+idlib_intern_get_size
+  (
+    void const* interned,
+    size_t* n
+  )
+{
+  if (!interned || !n) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  *n = ((idlib_intern_record const*)((char const*)interned - offsetof(idlib_intern_record, bytes)))->n;
+  return IDLIB_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/latch.h"
+
+#include "idlib/process/latch_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+idlib_status
+idlib_latch_initialize
+  (
+    idlib_latch* latch,
+    uint32_t count
+  )
+{
+  if (!latch) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_latch_impl* pimpl = malloc(sizeof(idlib_latch_impl));
+  if (!pimpl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  pimpl->count = count;
+  pimpl->waiters = 0;
+  latch->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_latch_uninitialize
+  (
+    idlib_latch* latch
+  )
+{
+  if (!latch) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_latch_impl* pimpl = (idlib_latch_impl*)latch->pimpl;
+  latch->pimpl = NULL;
+  free(pimpl);
+  pimpl = NULL;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_latch_count_down
+  (
+    idlib_latch* latch,
+    uint32_t count
+  )
+{
+  if (!latch) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_latch_impl* pimpl = (idlib_latch_impl*)latch->pimpl;
+  uint32_t expected = idlib_atomic_load_relaxed_u32(&pimpl->count);
+  do {
+    if (expected < count) {
+      return IDLIB_UNDERFLOW;
+    }
+  } while (!idlib_atomic_compare_exchange_u32(&pimpl->count, &expected, expected - count));
+  // See idlib_semaphore_release for why the waiters can not be missed.
+  if (expected == count && idlib_atomic_load_u32(&pimpl->waiters)) {
+    idlib_futex_wake_all(&pimpl->count);
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_latch_wait
+  (
+    idlib_latch* latch
+  )
+{
+  if (!latch) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_latch_impl* pimpl = (idlib_latch_impl*)latch->pimpl;
+  uint32_t count = idlib_atomic_load_acquire_u32(&pimpl->count);
+  if (IDLIB_LIKELY(0 == count)) {
+    return IDLIB_SUCCESS;
+  }
+  idlib_atomic_fetch_add_u32(&pimpl->waiters, 1);
+  while (0 != (count = idlib_atomic_load_acquire_u32(&pimpl->count))) {
+    idlib_futex_wait(&pimpl->count, count);
+  }
+  idlib_atomic_fetch_sub_u32(&pimpl->waiters, 1);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_latch_try_wait
+  (
+    idlib_latch* latch
+  )
+{
+  if (!latch) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_latch_impl* pimpl = (idlib_latch_impl*)latch->pimpl;
+  return 0 == idlib_atomic_load_acquire_u32(&pimpl->count) ? IDLIB_SUCCESS : IDLIB_LOCKED;
+}
+
+idlib_status
+idlib_latch_arrive_and_wait
+  (
+    idlib_latch* latch,
+    uint32_t count
+  )
+{
+  idlib_status status = idlib_latch_count_down(latch, count);
+  if (status) {
+    return status;
+  }
+  return idlib_latch_wait(latch);
+}
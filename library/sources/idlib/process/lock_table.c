@@ -0,0 +1,294 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/lock_table.h"
+
+#include "idlib/process/lock_table_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/futex.h"
+
+#include "idlib/process/once.h"
+
+// malloc, free
+#include <malloc.h>
+
+// Map an address to the index of its lock (Fibonacci hashing).
+static inline uint32_t
+get_index
+  (
+    void const* address
+  )
+{
+  return (uint32_t)(((uint64_t)(uintptr_t)address * UINT64_C(0x9e3779b97f4a7c15)) >> (64 - IDLIB_LOCK_TABLE_SHIFT));
+}
+
+static inline int
+is_mode
+  (
+    idlib_lock_mode mode
+  )
+{
+  return IDLIB_LOCK_MODE_EXCLUSIVE == mode || IDLIB_LOCK_MODE_SHARED == mode;
+}
+
+// Get if a lock in the specified state can be acquired in the specified mode.
+static inline int
+is_free
+  (
+    uint32_t state,
+    idlib_lock_mode mode
+  )
+{
+  if (IDLIB_LOCK_MODE_EXCLUSIVE == mode) {
+    // An exclusive locker keeps the waiters bit such that the threads sleeping on the lock are woken by its unlock.
+    return 0 == (state & (IDLIB_LOCK_TABLE_WRITER | IDLIB_LOCK_TABLE_READERS));
+  } else {
+    return 0 == (state & (IDLIB_LOCK_TABLE_WRITER | IDLIB_LOCK_TABLE_WAITERS))
+        && IDLIB_LOCK_TABLE_READERS != (state & IDLIB_LOCK_TABLE_READERS);
+  }
+}
+
+// Try to acquire a lock given its state. Returns non-zero on success.
+// Otherwise *state was assigned the current state if the compare exchange failed.
+static inline int
+try_lock
+  (
+    idlib_lock_table_lock_impl* lock,
+    idlib_lock_mode mode,
+    uint32_t* state
+  )
+{
+  uint32_t desired = IDLIB_LOCK_MODE_EXCLUSIVE == mode ? *state | IDLIB_LOCK_TABLE_WRITER : *state + 1;
+  return is_free(*state, mode) && idlib_atomic_compare_exchange_u32(&lock->state, state, desired);
+}
+
+static void
+lock
+  (
+    idlib_lock_table_lock_impl* lock,
+    idlib_lock_mode mode
+  )
+{
+  uint32_t state = IDLIB_LOCK_MODE_EXCLUSIVE == mode ? 0 : idlib_atomic_load_relaxed_u32(&lock->state);
+  if (try_lock(lock, mode, &state)) {
+    return;
+  }
+  for (int i = 0; i < IDLIB_LOCK_TABLE_SPINS; ++i) {
+    idlib_cpu_relax();
+    state = idlib_atomic_load_relaxed_u32(&lock->state);
+    if (try_lock(lock, mode, &state)) {
+      return;
+    }
+  }
+  while (!try_lock(lock, mode, &state)) {
+    if (is_free(state, mode)) {
+      // The compare exchange failed, retry with the current state.
+      continue;
+    }
+    // Announce that threads sleep on the lock and sleep until its state changes.
+    if (!(state & IDLIB_LOCK_TABLE_WAITERS)) {
+      uint32_t expected = state;
+      if (!idlib_atomic_compare_exchange_u32(&lock->state, &expected, state | IDLIB_LOCK_TABLE_WAITERS)) {
+        state = expected;
+        continue;
+      }
+      state |= IDLIB_LOCK_TABLE_WAITERS;
+    }
+    idlib_futex_wait(&lock->state, state);
+    state = idlib_atomic_load_relaxed_u32(&lock->state);
+  }
+}
+
+static void
+unlock
+  (
+    idlib_lock_table_lock_impl* lock,
+    idlib_lock_mode mode
+  )
+{
+  if (IDLIB_LOCK_MODE_EXCLUSIVE == mode) {
+    if (IDLIB_LOCK_TABLE_WAITERS & idlib_atomic_exchange_u32(&lock->state, 0)) {
+      idlib_futex_wake_all(&lock->state);
+    }
+    return;
+  }
+  uint32_t state = idlib_atomic_fetch_sub_u32(&lock->state, 1) - 1;
+  // The last shared holder wakes the sleeping threads unless an exclusive locker acquired the lock in the meantime.
+  if (IDLIB_LOCK_TABLE_WAITERS == state && idlib_atomic_compare_exchange_u32(&lock->state, &state, 0)) {
+    idlib_futex_wake_all(&lock->state);
+  }
+}
+
+idlib_status
+idlib_lock_table_impl_create
+  (
+    idlib_lock_table** table
+  )
+{
+  void* allocation = malloc(sizeof(idlib_lock_table) + IDLIB_CACHE_LINE_SIZE);
+  if (!allocation) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  idlib_lock_table* t = (idlib_lock_table*)(((uintptr_t)allocation + IDLIB_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(IDLIB_CACHE_LINE_SIZE - 1));
+  t->allocation = allocation;
+  for (uint32_t i = 0; i < IDLIB_LOCK_TABLE_LOCKS; ++i) {
+    t->locks[i].state = 0;
+  }
+  *table = t;
+  return IDLIB_SUCCESS;
+}
+
+void
+idlib_lock_table_impl_destroy
+  (
+    idlib_lock_table* table
+  )
+{
+  free(table->allocation);
+}
+
+static idlib_status
+create_table
+  (
+    void* context
+  )
+{
+  idlib_process* process = (idlib_process*)context;
+  return idlib_lock_table_impl_create(&process->lock_table);
+}
+
+idlib_status
+idlib_process_get_lock_table
+  (
+    idlib_process* process,
+    idlib_lock_table** table
+  )
+{
+  if (!process || !table) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->lock_table_once, &create_table, process);
+  if (status) {
+    return status;
+  }
+  *table = process->lock_table;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_lock_table_lock
+  (
+    idlib_lock_table* table,
+    void const* address,
+    idlib_lock_mode mode
+  )
+{
+  if (!table || !address || !is_mode(mode)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  lock(&table->locks[get_index(address)], mode);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_lock_table_unlock
+  (
+    idlib_lock_table* table,
+    void const* address,
+    idlib_lock_mode mode
+  )
+{
+  if (!table || !address || !is_mode(mode)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  unlock(&table->locks[get_index(address)], mode);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_lock_table_lock_many
+  (
+    idlib_lock_table* table,
+    void const* const* addresses,
+    size_t count,
+    idlib_lock_mode mode
+  )
+{
+  if (!table || !addresses || !is_mode(mode)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!addresses[i]) {
+      return IDLIB_ARGUMENT_INVALID;
+    }
+  }
+  // Acquire the locks in ascending order of their indices, each lock once.
+  // Selecting the next index by a scan does not allocate.
+  uint32_t previous = 0;
+  for (int first = 1;; first = 0) {
+    uint32_t next = IDLIB_LOCK_TABLE_LOCKS;
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t index = get_index(addresses[i]);
+      if ((first || index > previous) && index < next) {
+        next = index;
+      }
+    }
+    if (IDLIB_LOCK_TABLE_LOCKS == next) {
+      break;
+    }
+    lock(&table->locks[next], mode);
+    previous = next;
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_lock_table_unlock_many
+  (
+    idlib_lock_table* table,
+    void const* const* addresses,
+    size_t count,
+    idlib_lock_mode mode
+  )
+{
+  if (!table || !addresses || !is_mode(mode)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!addresses[i]) {
+      return IDLIB_ARGUMENT_INVALID;
+    }
+  }
+  // Release each lock once. The order does not matter.
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t index = get_index(addresses[i]);
+    size_t j = 0;
+    while (j < i && get_index(addresses[j]) != index) {
+      ++j;
+    }
+    if (j == i) {
+      unlock(&table->locks[index], mode);
+    }
+  }
+  return IDLIB_SUCCESS;
+}
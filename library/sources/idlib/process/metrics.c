@@ -0,0 +1,286 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process/metrics.h"
+
+#include "idlib/process/metrics_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+// memcpy, strcmp, strlen
+#include <string.h>
+
+IDLIB_THREAD_LOCAL uint32_t idlib_metrics_shard_index_plus_one = 0;
+
+// The number of threads which were assigned a shard.
+static uint32_t volatile g_number_of_shard_assignments = 0;
+
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+
+  idlib_metric idlib_metric_process_acquire = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_process_relinquish = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_process_allocation = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_registry_add = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_registry_get = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_registry_remove = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_registry_probe = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_registry_filter_reject = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_mutex_lock = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_mutex_lock_contended = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_mutex_allocation = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_mutex_live = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_condition_wait = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_condition_signal = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_condition_allocation = IDLIB_METRIC_INITIALIZER;
+  idlib_metric idlib_metric_condition_live = IDLIB_METRIC_INITIALIZER;
+
+  static struct {
+    idlib_metric* metric;
+    char const* name;
+    idlib_metric_kind kind;
+  } const g_builtin_metrics[] = {
+    { &idlib_metric_process_acquire, "idlib.process.acquire", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_process_relinquish, "idlib.process.relinquish", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_process_allocation, "idlib.process.allocation", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_registry_add, "idlib.registry.add", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_registry_get, "idlib.registry.get", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_registry_remove, "idlib.registry.remove", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_registry_probe, "idlib.registry.probe", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_registry_filter_reject, "idlib.registry.filter.reject", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_mutex_lock, "idlib.mutex.lock", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_mutex_lock_contended, "idlib.mutex.lock.contended", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_mutex_allocation, "idlib.mutex.allocation", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_mutex_live, "idlib.mutex.live", IDLIB_METRIC_KIND_GAUGE },
+    { &idlib_metric_condition_wait, "idlib.condition.wait", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_condition_signal, "idlib.condition.signal", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_condition_allocation, "idlib.condition.allocation", IDLIB_METRIC_KIND_COUNTER },
+    { &idlib_metric_condition_live, "idlib.condition.live", IDLIB_METRIC_KIND_GAUGE },
+  };
+
+#endif
+
+uint32_t
+idlib_metrics_assign_shard
+  (
+  )
+{
+  // Threads are assigned shards in a round-robin fashion.
+  uint32_t index = idlib_atomic_fetch_add_u32(&g_number_of_shard_assignments, 1) % IDLIB_METRIC_SHARDS;
+  idlib_metrics_shard_index_plus_one = index + 1;
+  return index + 1;
+}
+
+int64_t
+idlib_metric_get
+  (
+    idlib_metric* metric
+  )
+{
+  uint64_t value = 0;
+  for (size_t i = 0; i < IDLIB_METRIC_SHARDS; ++i) {
+    value += idlib_atomic_load_relaxed_u64(&metric->shards[i].value);
+  }
+  return (int64_t)value;
+}
+
+// Precondition: the metrics lock is held.
+static idlib_metric*
+find
+  (
+    idlib_process* process,
+    char const* name
+  )
+{
+  for (idlib_metric* metric = process->metrics; NULL != metric; metric = metric->next) {
+    if (!strcmp(metric->name, name)) {
+      return metric;
+    }
+  }
+  return NULL;
+}
+
+idlib_status
+idlib_metric_register
+  (
+    idlib_process* process,
+    idlib_metric* metric,
+    char const* name,
+    idlib_metric_kind kind
+  )
+{
+  if (!process || !metric || !name || (IDLIB_METRIC_KIND_COUNTER != kind && IDLIB_METRIC_KIND_GAUGE != kind)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  size_t n = strlen(name);
+  char* name_copy = malloc(n + 1);
+  if (!name_copy) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  memcpy(name_copy, name, n + 1);
+  if (idlib_mutex_lock(&process->metrics_lock)) {
+    free(name_copy);
+    return IDLIB_LOCK_FAILED;
+  }
+  if (find(process, name)) {
+    idlib_mutex_unlock(&process->metrics_lock);
+    free(name_copy);
+    return IDLIB_EXISTS;
+  }
+  metric->name = name_copy;
+  metric->kind = kind;
+  metric->next = process->metrics;
+  process->metrics = metric;
+  idlib_mutex_unlock(&process->metrics_lock);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_metric_unregister
+  (
+    idlib_process* process,
+    idlib_metric* metric
+  )
+{
+  if (!process || !metric) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (idlib_mutex_lock(&process->metrics_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  idlib_metric** previous = &process->metrics;
+  idlib_metric* current = process->metrics;
+  while (current) {
+    if (current == metric) {
+      *previous = current->next;
+      idlib_mutex_unlock(&process->metrics_lock);
+      free(metric->name);
+      metric->name = NULL;
+      metric->next = NULL;
+      return IDLIB_SUCCESS;
+    }
+    previous = &current->next;
+    current = current->next;
+  }
+  idlib_mutex_unlock(&process->metrics_lock);
+  return IDLIB_NOT_EXISTS;
+}
+
+idlib_status
+idlib_metric_find
+  (
+    idlib_process* process,
+    char const* name,
+    idlib_metric** metric
+  )
+{
+  if (!process || !name || !metric) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (idlib_mutex_lock(&process->metrics_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  idlib_metric* found = find(process, name);
+  idlib_mutex_unlock(&process->metrics_lock);
+  if (!found) {
+    return IDLIB_NOT_EXISTS;
+  }
+  *metric = found;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_metrics_snapshot
+  (
+    idlib_process* process,
+    idlib_metric_value* values,
+    size_t capacity,
+    size_t* count
+  )
+{
+  if (!process || !count || (capacity && !values)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (idlib_mutex_lock(&process->metrics_lock)) {
+    return IDLIB_LOCK_FAILED;
+  }
+  size_t n = 0;
+  for (idlib_metric* metric = process->metrics; NULL != metric; metric = metric->next) {
+    n++;
+  }
+  if (n > capacity) {
+    idlib_mutex_unlock(&process->metrics_lock);
+    *count = n;
+    return IDLIB_TOO_SMALL;
+  }
+  n = 0;
+  for (idlib_metric* metric = process->metrics; NULL != metric; metric = metric->next) {
+    values[n].name = metric->name;
+    values[n].kind = metric->kind;
+    values[n].value = idlib_metric_get(metric);
+    n++;
+  }
+  idlib_mutex_unlock(&process->metrics_lock);
+  *count = n;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_metrics_startup
+  (
+    idlib_process* process
+  )
+{
+  process->metrics = NULL;
+  idlib_status status = idlib_mutex_initialize(&process->metrics_lock);
+  if (status) {
+    return status;
+  }
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+  for (size_t i = 0; i < sizeof(g_builtin_metrics) / sizeof(g_builtin_metrics[0]); ++i) {
+    status = idlib_metric_register(process, g_builtin_metrics[i].metric, g_builtin_metrics[i].name, g_builtin_metrics[i].kind);
+    if (status) {
+      idlib_metrics_shutdown(process);
+      return status;
+    }
+  }
+#endif
+  return IDLIB_SUCCESS;
+}
+
+void
+idlib_metrics_shutdown
+  (
+    idlib_process* process
+  )
+{
+  while (process->metrics) {
+    idlib_metric* metric = process->metrics;
+    process->metrics = metric->next;
+    free(metric->name);
+    metric->name = NULL;
+    metric->next = NULL;
+  }
+  idlib_mutex_uninitialize(&process->metrics_lock);
+}
@@ -23,17 +23,25 @@
 
 #include "idlib/process/mutex_impl.h"
 
-#include <malloc.h>
+#include "idlib/process/allocator_impl.h"
 
-#include <stdio.h>
+#include "idlib/process/fiber_impl.h"
 
-#define IDLIB_MUTEX_LOG (1)
+#include "idlib/process/metrics_impl.h"
+
+#include "idlib/process/trace_impl.h"
+
+#if 1 == IDLIB_PROCESS_WITH_LOGGING
+  #include <stdio.h>
+#endif
+
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
 
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
   #include <pthread.h>
-  #if defined(IDLIB_MUTEX_LOG)
+  #if 1 == IDLIB_PROCESS_WITH_LOGGING || 1 == IDLIB_PROCESS_WITH_METRICS
     #include <errno.h>
   #endif
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
@@ -43,7 +51,10 @@
   #error("operating system not (yet) supported")
 #endif
 
-#if defined(IDLIB_MUTEX_LOG)
+#if 1 == IDLIB_PROCESS_WITH_LOGGING && \
+    ((IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS))
 
 static char const*
 errno_value_to_string
@@ -81,6 +92,8 @@ errno_value_to_string
 
 #endif
 
+#endif
+
 idlib_status
 idlib_mutex_initialize
   (
@@ -90,10 +103,12 @@ idlib_mutex_initialize
   if (!mutex) {
     return IDLIB_ARGUMENT_INVALID;
   }
-  idlib_mutex_impl* pimpl = malloc(sizeof(idlib_mutex_impl));
+  idlib_mutex_impl* pimpl = idlib_allocator_impl_allocate(idlib_allocator_impl_get(), sizeof(idlib_mutex_impl));
   if (!pimpl) {
     return IDLIB_ALLOCATION_FAILED;
   }
+  IDLIB_METRIC_ADD(mutex_allocation, 1);
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
@@ -103,22 +118,25 @@ idlib_mutex_initialize
   int result = pthread_mutex_init(&pimpl->mtx, &attr);
   pthread_mutexattr_destroy(&attr);
   if (result) {
-    free(pimpl);
+  #if 1 == IDLIB_PROCESS_WITH_LOGGING
+    fprintf(stderr, "%s:%d: %s failed with %s\n", __FILE__, __LINE__, "pthread_mutex_init", errno_value_to_string(result));
+  #endif
+    idlib_allocator_impl_deallocate(idlib_allocator_impl_get(), pimpl, sizeof(idlib_mutex_impl));
     pimpl = NULL;
     return IDLIB_ENVIRONMENT_FAILED;
   }
-  mutex->pimpl = pimpl;
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
-  pimpl->mtx = CreateMutex(NULL, FALSE, NULL);
-  if (!pimpl->mtx) {
-    free(pimpl);
-    pimpl = NULL;
-    return IDLIB_ENVIRONMENT_FAILED;
-  }
-  mutex->pimpl = pimpl;
+  InitializeCriticalSection(&pimpl->mtx);
 #else
   #error("operating system not (yet) supported")
 #endif
+#else
+  pimpl->state = 0;
+  pimpl->count = 0;
+  pimpl->owner = NULL;
+#endif
+  mutex->pimpl = pimpl;
+  IDLIB_METRIC_ADD(mutex_live, 1);
   return IDLIB_SUCCESS;
 }
 
@@ -133,18 +151,20 @@ idlib_mutex_uninitialize
   }
   idlib_mutex_impl* pimpl = (idlib_mutex_impl*)mutex->pimpl;
   mutex->pimpl = NULL;
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
   pthread_mutex_destroy(&pimpl->mtx);
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
-  CloseHandle(pimpl->mtx);
-  pimpl->mtx = NULL;
+  DeleteCriticalSection(&pimpl->mtx);
 #else
   #error("operating system not (yet) supported")
 #endif
-  free(pimpl);
+#endif
+  idlib_allocator_impl_deallocate(idlib_allocator_impl_get(), pimpl, sizeof(idlib_mutex_impl));
   pimpl = NULL;
+  IDLIB_METRIC_ADD(mutex_live, -1);
   return IDLIB_SUCCESS;
 }
 
@@ -158,29 +178,62 @@ idlib_mutex_lock
     return IDLIB_ARGUMENT_INVALID;
   }
   idlib_mutex_impl* pimpl = (idlib_mutex_impl*)mutex->pimpl;
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+  // A pthread mutex is owned by a thread but a fiber may resume on another thread.
+  if (idlib_fiber_impl_of_thread) {
+    return IDLIB_OPERATION_INVALID;
+  }
+#endif
+  IDLIB_TRACE(LOCK_ACQUIRE_START, pimpl);
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+  int result = pthread_mutex_trylock(&pimpl->mtx);
+  if (EBUSY == result) {
+    IDLIB_METRIC_ADD(mutex_lock_contended, 1);
+    result = pthread_mutex_lock(&pimpl->mtx);
+  }
+#else
   int result = pthread_mutex_lock(&pimpl->mtx);
+#endif
   if (result) {
-  #if defined(IDLIB_MUTEX_LOG)
+  #if 1 == IDLIB_PROCESS_WITH_LOGGING
     fprintf(stderr, "%s:%d: %s failed with %s\n", __FILE__, __LINE__, "pthread_mutex_lock", errno_value_to_string(result));
   #endif
     return IDLIB_LOCK_FAILED;
   }
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
-  DWORD result = WaitForSingleObject(pimpl->mtx, INFINITE);
-  switch (result) {
-    case WAIT_OBJECT_0: {
-      return IDLIB_SUCCESS;
-    } break;
-    default: {
-      return IDLIB_LOCK_FAILED;
-    } break;
-  };
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+  if (!TryEnterCriticalSection(&pimpl->mtx)) {
+    IDLIB_METRIC_ADD(mutex_lock_contended, 1);
+    EnterCriticalSection(&pimpl->mtx);
+  }
+#else
+  EnterCriticalSection(&pimpl->mtx);
+#endif
 #else
   #error("operating system not (yet) supported")
 #endif
+#else
+  void* self = idlib_mutex_impl_self();
+  if (self == idlib_atomic_load_acquire_pointer(&pimpl->owner)) {
+    if (UINT32_MAX == pimpl->count) {
+      return IDLIB_OVERFLOW;
+    }
+    pimpl->count++;
+  } else {
+    if (IDLIB_UNLIKELY(!idlib_mutex_impl_try_acquire(pimpl))) {
+      IDLIB_METRIC_ADD(mutex_lock_contended, 1);
+      idlib_mutex_impl_acquire_slow(pimpl);
+    }
+    idlib_atomic_store_release_pointer(&pimpl->owner, self);
+    pimpl->count = 1;
+  }
+#endif
+  IDLIB_TRACE(LOCK_ACQUIRED, pimpl);
+  IDLIB_METRIC_ADD(mutex_lock, 1);
   return IDLIB_SUCCESS;
 }
 
@@ -194,14 +247,26 @@ idlib_mutex_unlock
     return IDLIB_ARGUMENT_INVALID;
   }
   idlib_mutex_impl* pimpl = (idlib_mutex_impl*)mutex->pimpl;
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+  IDLIB_TRACE(LOCK_RELEASED, pimpl);
 #if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
     (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
   pthread_mutex_unlock(&pimpl->mtx);
 #elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
-  ReleaseMutex(pimpl->mtx);
+  LeaveCriticalSection(&pimpl->mtx);
 #else
   #error("operating system not (yet) supported")
+#endif
+#else
+  if (idlib_mutex_impl_self() != idlib_atomic_load_acquire_pointer(&pimpl->owner)) {
+    return IDLIB_NOT_LOCKED;
+  }
+  IDLIB_TRACE(LOCK_RELEASED, pimpl);
+  if (0 == --pimpl->count) {
+    idlib_atomic_store_release_pointer(&pimpl->owner, NULL);
+    idlib_mutex_impl_release(pimpl);
+  }
 #endif
   return IDLIB_SUCCESS;
 }
@@ -20,3 +20,37 @@
 */
 
 #include "idlib/process/mutex_impl.h"
+
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_FUTEX) || \
+    (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_ADAPTIVE)
+
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_ADAPTIVE)
+// The number of times a contended mutex is polled before the thread waits.
+#define IDLIB_MUTEX_SPIN_COUNT (128)
+#endif
+
+IDLIB_THREAD_LOCAL char idlib_mutex_impl_thread = 0;
+
+void
+idlib_mutex_impl_acquire_slow
+  (
+    idlib_mutex_impl* pimpl
+  )
+{
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_ADAPTIVE)
+  for (int i = 0; i < IDLIB_MUTEX_SPIN_COUNT; ++i) {
+    if (0 == idlib_atomic_load_relaxed_u32(&pimpl->state) && idlib_mutex_impl_try_acquire(pimpl)) {
+      return;
+    }
+    idlib_cpu_relax();
+  }
+#endif
+  // Announce that threads wait (state 2) and wait until the mutex was unlocked (state 0).
+  uint32_t state = idlib_atomic_exchange_u32(&pimpl->state, 2);
+  while (0 != state) {
+    idlib_futex_wait(&pimpl->state, 2);
+    state = idlib_atomic_exchange_u32(&pimpl->state, 2);
+  }
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/once.h"
+
+#include "idlib/process/futex.h"
+
+idlib_status
+idlib_once_call_slow
+  (
+    idlib_once* once,
+    idlib_once_procedure* procedure,
+    void* context
+  )
+{
+  if (!once || !procedure) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  while (1) {
+    uint32_t state = idlib_atomic_load_acquire_u32(&once->state);
+    switch (state) {
+      case IDLIB_ONCE_DONE: {
+        return IDLIB_SUCCESS;
+      } break;
+      case IDLIB_ONCE_INITIAL: {
+        if (!idlib_atomic_compare_exchange_u32(&once->state, &state, IDLIB_ONCE_RUNNING)) {
+          continue;
+        }
+        idlib_status status = procedure(context);
+        // If the procedure failed, the state is reset such that the next call invokes the procedure again.
+        if (IDLIB_ONCE_RUNNING_WAITERS == idlib_atomic_exchange_u32(&once->state, status ? IDLIB_ONCE_INITIAL : IDLIB_ONCE_DONE)) {
+          idlib_futex_wake_all(&once->state);
+        }
+        return status;
+      } break;
+      case IDLIB_ONCE_RUNNING: {
+        if (!idlib_atomic_compare_exchange_u32(&once->state, &state, IDLIB_ONCE_RUNNING_WAITERS)) {
+          continue;
+        }
+        idlib_futex_wait(&once->state, IDLIB_ONCE_RUNNING_WAITERS);
+      } break;
+      case IDLIB_ONCE_RUNNING_WAITERS: {
+        idlib_futex_wait(&once->state, IDLIB_ONCE_RUNNING_WAITERS);
+      } break;
+      default: {
+        return IDLIB_OPERATION_INVALID;
+      } break;
+    };
+  }
+}
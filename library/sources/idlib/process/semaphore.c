@@ -0,0 +1,123 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/semaphore.h"
+
+#include "idlib/process/semaphore_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+idlib_status
+idlib_semaphore_initialize
+  (
+    idlib_semaphore* semaphore,
+    uint32_t count
+  )
+{
+  if (!semaphore) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_semaphore_impl* pimpl = malloc(sizeof(idlib_semaphore_impl));
+  if (!pimpl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  pimpl->count = count;
+  pimpl->waiters = 0;
+  semaphore->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_semaphore_uninitialize
+  (
+    idlib_semaphore* semaphore
+  )
+{
+  if (!semaphore) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_semaphore_impl* pimpl = (idlib_semaphore_impl*)semaphore->pimpl;
+  semaphore->pimpl = NULL;
+  free(pimpl);
+  pimpl = NULL;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_semaphore_acquire
+  (
+    idlib_semaphore* semaphore
+  )
+{
+  if (!semaphore) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_semaphore_impl* pimpl = (idlib_semaphore_impl*)semaphore->pimpl;
+  if (IDLIB_LIKELY(idlib_atomic_try_sub_u32(&pimpl->count, 1))) {
+    return IDLIB_SUCCESS;
+  }
+  idlib_atomic_fetch_add_u32(&pimpl->waiters, 1);
+  while (!idlib_atomic_try_sub_u32(&pimpl->count, 1)) {
+    idlib_futex_wait(&pimpl->count, 0);
+  }
+  idlib_atomic_fetch_sub_u32(&pimpl->waiters, 1);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_semaphore_try_acquire
+  (
+    idlib_semaphore* semaphore
+  )
+{
+  if (!semaphore) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_semaphore_impl* pimpl = (idlib_semaphore_impl*)semaphore->pimpl;
+  return idlib_atomic_try_sub_u32(&pimpl->count, 1) ? IDLIB_SUCCESS : IDLIB_LOCKED;
+}
+
+idlib_status
+idlib_semaphore_release
+  (
+    idlib_semaphore* semaphore,
+    uint32_t count
+  )
+{
+  if (!semaphore) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_semaphore_impl* pimpl = (idlib_semaphore_impl*)semaphore->pimpl;
+  if (!idlib_atomic_try_add_u32(&pimpl->count, count)) {
+    return IDLIB_OVERFLOW;
+  }
+  // The addition and this load are sequentially consistent:
+  // Either this thread observes a waiter or the waiter observes the permits before it blocks.
+  if (idlib_atomic_load_u32(&pimpl->waiters)) {
+    if (1 == count) {
+      idlib_futex_wake_one(&pimpl->count);
+    } else {
+      idlib_futex_wake_all(&pimpl->count);
+    }
+  }
+  return IDLIB_SUCCESS;
+}
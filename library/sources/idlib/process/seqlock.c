@@ -0,0 +1,198 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/seqlock.h"
+
+#include "idlib/process/seqlock_impl.h"
+
+// malloc, free
+#include <malloc.h>
+
+// memcpy
+#include <string.h>
+
+IDLIB_THREAD_LOCAL char idlib_seqlock_impl_thread = 0;
+
+idlib_status
+idlib_seqlock_initialize
+  (
+    idlib_seqlock* seqlock
+  )
+{
+  if (!seqlock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_seqlock_impl* pimpl = malloc(sizeof(idlib_seqlock_impl));
+  if (!pimpl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  idlib_status status = idlib_mutex_initialize(&pimpl->mutex);
+  if (status) {
+    free(pimpl);
+    pimpl = NULL;
+    return status;
+  }
+  pimpl->sequence = 0;
+  pimpl->owner = NULL;
+  seqlock->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_seqlock_uninitialize
+  (
+    idlib_seqlock* seqlock
+  )
+{
+  if (!seqlock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_seqlock_impl* pimpl = (idlib_seqlock_impl*)seqlock->pimpl;
+  seqlock->pimpl = NULL;
+  idlib_mutex_uninitialize(&pimpl->mutex);
+  free(pimpl);
+  pimpl = NULL;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_seqlock_read_begin
+  (
+    idlib_seqlock* seqlock,
+    uint32_t* sequence
+  )
+{
+  if (!seqlock || !sequence) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_seqlock_impl* pimpl = (idlib_seqlock_impl*)seqlock->pimpl;
+  uint32_t value = idlib_atomic_load_acquire_u32(&pimpl->sequence);
+  while (IDLIB_UNLIKELY(value & 1)) {
+    idlib_cpu_relax();
+    value = idlib_atomic_load_acquire_u32(&pimpl->sequence);
+  }
+  *sequence = value;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_seqlock_read_end
+  (
+    idlib_seqlock* seqlock,
+    uint32_t sequence
+  )
+{
+  if (!seqlock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_seqlock_impl* pimpl = (idlib_seqlock_impl*)seqlock->pimpl;
+  // Order the loads of the data before the load of the sequence counter.
+  idlib_atomic_fence_acquire();
+  if (sequence != idlib_atomic_load_relaxed_u32(&pimpl->sequence)) {
+    return IDLIB_ABORTED;
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_seqlock_read
+  (
+    idlib_seqlock* seqlock,
+    void* target,
+    void const* source,
+    size_t n
+  )
+{
+  if (!seqlock || !target || !source) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  uint32_t sequence;
+  do {
+    idlib_seqlock_read_begin(seqlock, &sequence);
+    memcpy(target, source, n);
+  } while (idlib_seqlock_read_end(seqlock, sequence));
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_seqlock_write_lock
+  (
+    idlib_seqlock* seqlock
+  )
+{
+  if (!seqlock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_seqlock_impl* pimpl = (idlib_seqlock_impl*)seqlock->pimpl;
+  void* self = idlib_seqlock_impl_self();
+  // Only the calling writer could have stored itself as the owner, hence the owner is examined without holding the mutex.
+  if (self == idlib_atomic_load_acquire_pointer(&pimpl->owner)) {
+    return IDLIB_OPERATION_INVALID;
+  }
+  idlib_status status = idlib_mutex_lock(&pimpl->mutex);
+  if (status) {
+    return status;
+  }
+  idlib_atomic_store_release_pointer(&pimpl->owner, self);
+  idlib_atomic_store_relaxed_u32(&pimpl->sequence, pimpl->sequence + 1);
+  // Order the store of the sequence counter before the stores of the data.
+  idlib_atomic_fence_release();
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_seqlock_write_unlock
+  (
+    idlib_seqlock* seqlock
+  )
+{
+  if (!seqlock) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_seqlock_impl* pimpl = (idlib_seqlock_impl*)seqlock->pimpl;
+  // The sequence counter must not be touched by a thread which does not hold the sequence lock.
+  if (idlib_seqlock_impl_self() != idlib_atomic_load_acquire_pointer(&pimpl->owner)) {
+    return IDLIB_NOT_LOCKED;
+  }
+  idlib_atomic_store_release_pointer(&pimpl->owner, NULL);
+  idlib_atomic_store_release_u32(&pimpl->sequence, pimpl->sequence + 1);
+  return idlib_mutex_unlock(&pimpl->mutex);
+}
+
+idlib_status
+idlib_seqlock_write
+  (
+    idlib_seqlock* seqlock,
+    void* target,
+    void const* source,
+    size_t n
+  )
+{
+  if (!seqlock || !target || !source) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_seqlock_write_lock(seqlock);
+  if (status) {
+    return status;
+  }
+  memcpy(target, source, n);
+  return idlib_seqlock_write_unlock(seqlock);
+}
@@ -0,0 +1,629 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#define IDLIB_PROCESS_PRIVATE (1)
+#include "idlib/process/shared_registry.h"
+
+#include "idlib/process/shared_registry_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/futex.h"
+
+#include "idlib/process/clock.h"
+
+// malloc, free
+#include <malloc.h>
+
+// memcmp, memcpy, strlen
+#include <string.h>
+
+// snprintf
+#include <stdio.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // errno, EEXIST, ENOENT
+  #include <errno.h>
+  // O_CREAT, O_EXCL, O_RDWR
+  #include <fcntl.h>
+  // sched_yield
+  #include <sched.h>
+  // kill
+  #include <signal.h>
+  // mmap, munmap, shm_open, shm_unlink
+  #include <sys/mman.h>
+  // fstat
+  #include <sys/stat.h>
+  // close, ftruncate, getpid
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  /* Intentionally empty. */
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// The maximum length of the name of a shared registry.
+#define NAME_MAXIMUM_LENGTH (200)
+
+static inline uint64_t
+align
+  (
+    uint64_t x
+  )
+{
+  return (x + IDLIB_SHARED_REGISTRY_ALIGNMENT - 1) & ~(uint64_t)(IDLIB_SHARED_REGISTRY_ALIGNMENT - 1);
+}
+
+// Translate the name of a shared registry into the name of its shared memory segment.
+static idlib_status
+get_segment_name
+  (
+    char* segment_name,
+    size_t segment_name_size,
+    char const* name
+  )
+{
+  if (!name) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  size_t length = strlen(name);
+  if (!length || length > NAME_MAXIMUM_LENGTH) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    char c = name[i];
+    if (!(('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || '-' == c || '_' == c || '.' == c)) {
+      return IDLIB_ARGUMENT_INVALID;
+    }
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  snprintf(segment_name, segment_name_size, "/%s", name);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  snprintf(segment_name, segment_name_size, "Local\\%s", name);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+static void
+yield
+  (
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  sched_yield();
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  SwitchToThread();
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+static uint32_t
+get_process_id
+  (
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  return (uint32_t)getpid() & ~IDLIB_SHARED_REGISTRY_LOCK_WAITERS;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  return (uint32_t)GetCurrentProcessId() & ~IDLIB_SHARED_REGISTRY_LOCK_WAITERS;
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+// Get if the process of the specified identifier exists.
+static int
+is_process_alive
+  (
+    uint32_t process_id
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // EPERM: the process exists but this process may not send signals to it.
+  return 0 == kill((pid_t)process_id, 0) || EPERM == errno;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)process_id);
+  if (!process) {
+    // ERROR_ACCESS_DENIED: the process exists but this process may not open it.
+    return ERROR_INVALID_PARAMETER != GetLastError();
+  }
+  int alive = WAIT_TIMEOUT == WaitForSingleObject(process, 0);
+  CloseHandle(process);
+  return alive;
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+// Acquire the lock of the segment.
+// Under Linux, a process waits on the lock using a process-shared futex, otherwise it yields.
+// If the holder of the lock has terminated, the lock is taken over:
+// an entry is published by a single store after it was written, hence a terminated holder leaves no partially visible entry.
+static void
+lock
+  (
+    idlib_shared_registry_header* header
+  )
+{
+  uint32_t self = get_process_id();
+  uint32_t expected = 0;
+  if (idlib_atomic_compare_exchange_u32(&header->lock, &expected, self)) {
+    return;
+  }
+  while (1) {
+    uint32_t value = idlib_atomic_load_acquire_u32(&header->lock);
+    if (0 == value || !is_process_alive(value & ~IDLIB_SHARED_REGISTRY_LOCK_WAITERS)) {
+      // Other processes might wait, hence the lock is acquired with the bit of waiters set.
+      expected = value;
+      if (idlib_atomic_compare_exchange_u32(&header->lock, &expected, self | IDLIB_SHARED_REGISTRY_LOCK_WAITERS)) {
+        return;
+      }
+      continue;
+    }
+    if (!(value & IDLIB_SHARED_REGISTRY_LOCK_WAITERS)) {
+      expected = value;
+      if (!idlib_atomic_compare_exchange_u32(&header->lock, &expected, value | IDLIB_SHARED_REGISTRY_LOCK_WAITERS)) {
+        continue;
+      }
+      value |= IDLIB_SHARED_REGISTRY_LOCK_WAITERS;
+    }
+    // The holder does not wake this process if it terminates, hence the wait is bounded.
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+    idlib_futex_wait_for_shared(&header->lock, value, IDLIB_SHARED_REGISTRY_LOCK_POLL_INTERVAL);
+#else
+    yield();
+#endif
+  }
+}
+
+static void
+unlock
+  (
+    idlib_shared_registry_header* header
+  )
+{
+  if (IDLIB_SHARED_REGISTRY_LOCK_WAITERS & idlib_atomic_exchange_u32(&header->lock, 0)) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+    idlib_futex_wake_one_shared(&header->lock);
+#endif
+  }
+}
+
+// Initialize the header and the buckets of a segment of the specified size.
+// The segment is filled with zeroes.
+static void
+initialize_segment
+  (
+    idlib_shared_registry_header* header,
+    size_t size
+  )
+{
+  // One bucket per 256 Bytes.
+  uint64_t number_of_buckets = 1;
+  while (number_of_buckets * 2 <= size / 256) {
+    number_of_buckets *= 2;
+  }
+  memcpy(header->magic, IDLIB_SHARED_REGISTRY_MAGIC, sizeof(header->magic));
+  header->version = IDLIB_SHARED_REGISTRY_VERSION;
+  header->lock = 0;
+  header->size = size;
+  header->number_of_buckets = number_of_buckets;
+  header->buckets = align(sizeof(idlib_shared_registry_header));
+  header->top = header->buckets + number_of_buckets * sizeof(uint64_t);
+  header->number_of_entries = 0;
+  idlib_atomic_store_release_u32(&header->state, IDLIB_SHARED_REGISTRY_STATE_READY);
+}
+
+// Wait until the creator of the segment has initialized it and validate it.
+// Returns IDLIB_TIMED_OUT if the segment was not initialized before the deadline passed (e.g., as its creator terminated).
+static idlib_status
+wait_segment
+  (
+    idlib_shared_registry_header* header,
+    size_t size,
+    uint64_t deadline
+  )
+{
+  while (IDLIB_SHARED_REGISTRY_STATE_READY != idlib_atomic_load_acquire_u32(&header->state)) {
+    if (idlib_clock_now() >= deadline) {
+      return IDLIB_TIMED_OUT;
+    }
+    yield();
+  }
+  if (memcmp(header->magic, IDLIB_SHARED_REGISTRY_MAGIC, sizeof(header->magic)) ||
+      IDLIB_SHARED_REGISTRY_VERSION != header->version || header->size > size) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  return IDLIB_SUCCESS;
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+static idlib_status
+open_segment
+  (
+    idlib_shared_registry_impl* pimpl,
+    char const* segment_name,
+    size_t size
+  )
+{
+  uint64_t deadline = idlib_clock_now() + IDLIB_SHARED_REGISTRY_INITIALIZATION_TIMEOUT;
+  int created = 1;
+  int fd = shm_open(segment_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (-1 == fd && EEXIST == errno) {
+    created = 0;
+    fd = shm_open(segment_name, O_RDWR, 0600);
+  }
+  if (-1 == fd) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  struct stat information;
+  if (created) {
+    if (ftruncate(fd, (off_t)size)) {
+      close(fd);
+      shm_unlink(segment_name);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  } else {
+    // Wait until the creator has set the size of the segment.
+    do {
+      if (fstat(fd, &information)) {
+        close(fd);
+        return IDLIB_ENVIRONMENT_FAILED;
+      }
+      if (!information.st_size) {
+        if (idlib_clock_now() >= deadline) {
+          close(fd);
+          return IDLIB_TIMED_OUT;
+        }
+        yield();
+      }
+    } while (!information.st_size);
+    size = (size_t)information.st_size;
+  }
+  void* address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping remains valid after the file descriptor was closed.
+  close(fd);
+  if (MAP_FAILED == address) {
+    if (created) {
+      shm_unlink(segment_name);
+    }
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  pimpl->header = (idlib_shared_registry_header*)address;
+  pimpl->size = size;
+  if (created) {
+    initialize_segment(pimpl->header, size);
+    return IDLIB_SUCCESS;
+  }
+  idlib_status status = wait_segment(pimpl->header, size, deadline);
+  if (status) {
+    munmap(address, size);
+    return status;
+  }
+  return IDLIB_SUCCESS;
+}
+
+static void
+close_segment
+  (
+    idlib_shared_registry_impl* pimpl
+  )
+{
+  munmap(pimpl->header, pimpl->size);
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+static idlib_status
+open_segment
+  (
+    idlib_shared_registry_impl* pimpl,
+    char const* segment_name,
+    size_t size
+  )
+{
+  uint64_t deadline = idlib_clock_now() + IDLIB_SHARED_REGISTRY_INITIALIZATION_TIMEOUT;
+  HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, segment_name);
+  if (!mapping) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  int created = ERROR_ALREADY_EXISTS != GetLastError();
+  void* address = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+  if (!address) {
+    CloseHandle(mapping);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  MEMORY_BASIC_INFORMATION information;
+  if (!VirtualQuery(address, &information, sizeof(information))) {
+    UnmapViewOfFile(address);
+    CloseHandle(mapping);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  pimpl->header = (idlib_shared_registry_header*)address;
+  pimpl->size = created ? size : information.RegionSize;
+  pimpl->mapping = mapping;
+  if (created) {
+    initialize_segment(pimpl->header, size);
+    return IDLIB_SUCCESS;
+  }
+  idlib_status status = wait_segment(pimpl->header, pimpl->size, deadline);
+  if (status) {
+    UnmapViewOfFile(address);
+    CloseHandle(mapping);
+    return status;
+  }
+  return IDLIB_SUCCESS;
+}
+
+static void
+close_segment
+  (
+    idlib_shared_registry_impl* pimpl
+  )
+{
+  UnmapViewOfFile(pimpl->header);
+  CloseHandle(pimpl->mapping);
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+idlib_status
+idlib_shared_registry_open
+  (
+    idlib_shared_registry* registry,
+    char const* name,
+    size_t size
+  )
+{
+  if (!registry) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  char segment_name[NAME_MAXIMUM_LENGTH + 16];
+  idlib_status status = get_segment_name(segment_name, sizeof(segment_name), name);
+  if (status) {
+    return status;
+  }
+  if (size < IDLIB_SHARED_REGISTRY_MINIMUM_SIZE) {
+    return IDLIB_TOO_SMALL;
+  }
+  idlib_shared_registry_impl* pimpl = malloc(sizeof(idlib_shared_registry_impl));
+  if (!pimpl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  status = open_segment(pimpl, segment_name, size);
+  if (status) {
+    free(pimpl);
+    return status;
+  }
+  registry->pimpl = pimpl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_shared_registry_close
+  (
+    idlib_shared_registry* registry
+  )
+{
+  if (!registry || !registry->pimpl) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_shared_registry_impl* pimpl = (idlib_shared_registry_impl*)registry->pimpl;
+  registry->pimpl = NULL;
+  close_segment(pimpl);
+  free(pimpl);
+  pimpl = NULL;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_shared_registry_unlink
+  (
+    char const* name
+  )
+{
+  char segment_name[NAME_MAXIMUM_LENGTH + 16];
+  idlib_status status = get_segment_name(segment_name, sizeof(segment_name), name);
+  if (status) {
+    return status;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (shm_unlink(segment_name)) {
+    return ENOENT == errno ? IDLIB_NOT_EXISTS : IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  // A named file mapping has no name to remove, it is destroyed when its last handle is closed.
+  return IDLIB_OPERATION_INVALID;
+#else
+  #error("operating system not (yet) supported")
+#endif
+  return IDLIB_SUCCESS;
+}
+
+// Get if the n Bytes at the specified offset lie within a segment of the specified size.
+static inline int
+is_within
+  (
+    uint64_t size,
+    uint64_t offset,
+    uint64_t n
+  )
+{
+  return offset <= size && n <= size - offset;
+}
+
+// Get the end of the buckets of a segment mapped with the specified size.
+// Returns 0 if the buckets do not lie within the segment.
+// The segment is not trusted: another process may have corrupted it or it might not have been created by this library.
+static uint64_t
+get_buckets_end
+  (
+    idlib_shared_registry_header* header,
+    size_t size
+  )
+{
+  uint64_t number_of_buckets = header->number_of_buckets, buckets = header->buckets;
+  if (!number_of_buckets || (number_of_buckets & (number_of_buckets - 1)) || number_of_buckets > size / sizeof(uint64_t) ||
+      buckets < sizeof(idlib_shared_registry_header) || (buckets % IDLIB_SHARED_REGISTRY_ALIGNMENT) ||
+      !is_within(size, buckets, number_of_buckets * sizeof(uint64_t))) {
+    return 0;
+  }
+  return buckets + number_of_buckets * sizeof(uint64_t);
+}
+
+// Get the entry of the specified key.
+// Every offset and size read from the segment is validated before it is followed.
+// Returns IDLIB_NOT_EXISTS if no entry of the key exists and IDLIB_ENVIRONMENT_FAILED if the segment is corrupted.
+static idlib_status
+find
+  (
+    idlib_shared_registry_impl* pimpl,
+    uint64_t hash,
+    void const* p,
+    size_t n,
+    idlib_shared_registry_entry** entry
+  )
+{
+  idlib_shared_registry_header* header = pimpl->header;
+  uint64_t end = get_buckets_end(header, pimpl->size);
+  if (!end) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  char* base = (char*)header;
+  uint64_t volatile* buckets = (uint64_t volatile*)(base + header->buckets);
+  uint64_t offset = idlib_atomic_load_acquire_u64(&buckets[hash & (header->number_of_buckets - 1)]);
+  while (offset) {
+    if (offset < end || (offset % IDLIB_SHARED_REGISTRY_ALIGNMENT) || !is_within(pimpl->size, offset, sizeof(idlib_shared_registry_entry))) {
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+    idlib_shared_registry_entry* current = (idlib_shared_registry_entry*)(base + offset);
+    // An entry only refers to an entry added before it, that is, at a lower offset. Hence the traversal terminates.
+    if (!is_within(pimpl->size, offset + sizeof(idlib_shared_registry_entry), current->n) ||
+        !is_within(pimpl->size, current->value, current->m) || current->next >= offset) {
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+    if (current->hash == hash && current->n == n && !memcmp(current + 1, p, n)) {
+      *entry = current;
+      return IDLIB_SUCCESS;
+    }
+    offset = current->next;
+  }
+  return IDLIB_NOT_EXISTS;
+}
+
+idlib_status
+idlib_shared_registry_add
+  (
+    idlib_shared_registry* registry,
+    void const* p,
+    size_t n,
+    void const* v,
+    size_t m
+  )
+{
+  if (!registry || !registry->pimpl || !p || (!v && m)) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_shared_registry_impl* pimpl = (idlib_shared_registry_impl*)registry->pimpl;
+  idlib_shared_registry_header* header = pimpl->header;
+  if (n > pimpl->size || m > pimpl->size) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  uint64_t hash = idlib_process_hash(p, n);
+  uint64_t entry_size = align(sizeof(idlib_shared_registry_entry) + n), value_size = align(m);
+  lock(header);
+  idlib_shared_registry_entry* entry = NULL;
+  idlib_status status = find(pimpl, hash, p, n, &entry);
+  if (IDLIB_NOT_EXISTS != status) {
+    unlock(header);
+    return status ? status : IDLIB_EXISTS;
+  }
+  uint64_t offset = header->top, size = header->size;
+  if (size > pimpl->size || offset < get_buckets_end(header, pimpl->size) || (offset % IDLIB_SHARED_REGISTRY_ALIGNMENT) || offset > size) {
+    unlock(header);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (entry_size + value_size > size - offset) {
+    unlock(header);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  char* base = (char*)header;
+  entry = (idlib_shared_registry_entry*)(base + offset);
+  uint64_t volatile* bucket = &((uint64_t volatile*)(base + header->buckets))[hash & (header->number_of_buckets - 1)];
+  entry->next = *bucket;
+  entry->hash = hash;
+  entry->n = n;
+  entry->m = m;
+  entry->value = offset + entry_size;
+  memcpy(entry + 1, p, n);
+  if (m) {
+    memcpy(base + entry->value, v, m);
+  }
+  header->top = offset + entry_size + value_size;
+  header->number_of_entries++;
+  idlib_atomic_store_release_u64(bucket, offset);
+  unlock(header);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_shared_registry_get
+  (
+    idlib_shared_registry* registry,
+    void const* p,
+    size_t n,
+    void const** v,
+    size_t* m
+  )
+{
+  if (!registry || !registry->pimpl || !p || !v || !m) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_shared_registry_impl* pimpl = (idlib_shared_registry_impl*)registry->pimpl;
+  idlib_shared_registry_entry* entry = NULL;
+  idlib_status status = find(pimpl, idlib_process_hash(p, n), p, n, &entry);
+  if (status) {
+    return status;
+  }
+  *v = (char const*)pimpl->header + entry->value;
+  *m = (size_t)entry->m;
+  return IDLIB_SUCCESS;
+}
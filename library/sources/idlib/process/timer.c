@@ -0,0 +1,537 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process/timer.h"
+
+#include "idlib/process/timer_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/clock.h"
+
+#include "idlib/process/futex.h"
+
+#include "idlib/process/once.h"
+
+// malloc, realloc, free
+#include <malloc.h>
+
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  // _BitScanForward64
+  #include <intrin.h>
+#endif
+
+// The number of callbacks dispatched per acquisition of the mutex.
+#define DISPATCH_BATCH_SIZE (64)
+
+// The initial capacity of the array of timers.
+#define MINIMUM_CAPACITY (64)
+
+// The index of the least significant set bit of a non-zero value.
+static inline uint32_t
+count_trailing_zeros
+  (
+    uint64_t x
+  )
+{
+#if (IDLIB_COMPILER_C == IDLIB_COMPILER_C_MSVC)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return (uint32_t)index;
+#else
+  return (uint32_t)__builtin_ctzll(x);
+#endif
+}
+
+static void
+link_node
+  (
+    idlib_timer_service_impl* impl,
+    uint32_t i,
+    uint32_t list
+  )
+{
+  idlib_timer_node* node = &impl->nodes[i];
+  node->list = list;
+  node->previous = IDLIB_TIMER_NULL;
+  node->next = impl->heads[list];
+  if (IDLIB_TIMER_NULL != node->next) {
+    impl->nodes[node->next].previous = i;
+  }
+  impl->heads[list] = i;
+  if (list < IDLIB_TIMER_SLOTS) {
+    impl->occupied[list / 64] |= UINT64_C(1) << (list % 64);
+  }
+}
+
+static void
+unlink_node
+  (
+    idlib_timer_service_impl* impl,
+    uint32_t i
+  )
+{
+  idlib_timer_node* node = &impl->nodes[i];
+  if (IDLIB_TIMER_NULL == node->previous) {
+    impl->heads[node->list] = node->next;
+  } else {
+    impl->nodes[node->previous].next = node->next;
+  }
+  if (IDLIB_TIMER_NULL != node->next) {
+    impl->nodes[node->next].previous = node->previous;
+  }
+  if (node->list < IDLIB_TIMER_SLOTS && IDLIB_TIMER_NULL == impl->heads[node->list]) {
+    impl->occupied[node->list / 64] &= ~(UINT64_C(1) << (node->list % 64));
+  }
+}
+
+// Invalidate the identifier of a timer and put it into the free list.
+static void
+free_node
+  (
+    idlib_timer_service_impl* impl,
+    uint32_t i
+  )
+{
+  idlib_timer_node* node = &impl->nodes[i];
+  node->generation++;
+  node->list = IDLIB_TIMER_NULL;
+  node->next = impl->free;
+  impl->free = i;
+}
+
+// Link a timer into the slot of its expiry.
+// A timer expiring before the current tick expires at the current tick.
+// A timer expiring more than 2^32 ticks after the current tick is put into the last slot of the last level,
+// it is put into a slot again whenever that slot is cascaded.
+static void
+place_node
+  (
+    idlib_timer_service_impl* impl,
+    uint32_t i
+  )
+{
+  uint64_t expiry = impl->nodes[i].expiry > impl->current ? impl->nodes[i].expiry : impl->current;
+  uint64_t delta = expiry - impl->current;
+  if (delta > UINT32_MAX) {
+    delta = UINT32_MAX;
+    expiry = impl->current + delta;
+  }
+  uint32_t level = 0;
+  while (level + 1 < IDLIB_TIMER_LEVELS && delta >= (UINT64_C(1) << ((level + 1) * IDLIB_TIMER_SLOT_BITS))) {
+    level++;
+  }
+  uint32_t slot = (uint32_t)(expiry >> (level * IDLIB_TIMER_SLOT_BITS)) & (IDLIB_TIMER_SLOTS - 1);
+  link_node(impl, i, level * IDLIB_TIMER_SLOTS + slot);
+}
+
+// Move the timers of the slots of the higher levels which expire in the next IDLIB_TIMER_SLOTS ticks to lower levels.
+// Invoked when the current tick is a multiple of IDLIB_TIMER_SLOTS.
+static void
+cascade
+  (
+    idlib_timer_service_impl* impl
+  )
+{
+  for (uint32_t level = 1; level < IDLIB_TIMER_LEVELS; ++level) {
+    uint32_t slot = (uint32_t)(impl->current >> (level * IDLIB_TIMER_SLOT_BITS)) & (IDLIB_TIMER_SLOTS - 1);
+    uint32_t i = impl->heads[level * IDLIB_TIMER_SLOTS + slot];
+    impl->heads[level * IDLIB_TIMER_SLOTS + slot] = IDLIB_TIMER_NULL;
+    while (IDLIB_TIMER_NULL != i) {
+      uint32_t next = impl->nodes[i].next;
+      place_node(impl, i);
+      i = next;
+    }
+    if (slot) {
+      break;
+    }
+  }
+}
+
+// The next tick which must be processed:
+// The current tick if it is a multiple of IDLIB_TIMER_SLOTS, the tick of the next non-empty slot of level zero,
+// or the next multiple of IDLIB_TIMER_SLOTS.
+static uint64_t
+get_next_tick
+  (
+    idlib_timer_service_impl* impl
+  )
+{
+  uint32_t slot = (uint32_t)impl->current & (IDLIB_TIMER_SLOTS - 1);
+  if (!slot) {
+    return impl->current;
+  }
+  for (uint32_t word = slot / 64; word < IDLIB_TIMER_SLOTS / 64; ++word) {
+    uint64_t bits = impl->occupied[word];
+    if (word == slot / 64) {
+      bits &= ~UINT64_C(0) << (slot % 64);
+    }
+    if (bits) {
+      return (impl->current & ~(uint64_t)(IDLIB_TIMER_SLOTS - 1)) + word * 64 + count_trailing_zeros(bits);
+    }
+  }
+  return (impl->current | (IDLIB_TIMER_SLOTS - 1)) + 1;
+}
+
+// Process the ticks up to and including the specified tick.
+// The timers of the processed ticks are moved to the list of expired timers.
+static void
+advance
+  (
+    idlib_timer_service_impl* impl,
+    uint64_t tick
+  )
+{
+  while (impl->current <= tick) {
+    if (!impl->number_of_timers) {
+      impl->current = tick + 1;
+      break;
+    }
+    uint32_t slot = (uint32_t)impl->current & (IDLIB_TIMER_SLOTS - 1);
+    if (!slot) {
+      cascade(impl);
+    }
+    while (IDLIB_TIMER_NULL != impl->heads[slot]) {
+      uint32_t i = impl->heads[slot];
+      unlink_node(impl, i);
+      link_node(impl, i, IDLIB_TIMER_EXPIRED);
+      impl->number_of_timers--;
+    }
+    impl->current++;
+    uint64_t next = get_next_tick(impl);
+    impl->current = next < tick + 1 ? next : tick + 1;
+  }
+}
+
+static void
+run
+  (
+    idlib_timer_service_impl* impl
+  )
+{
+  if (idlib_mutex_lock(&impl->mutex)) {
+    return;
+  }
+  while (!idlib_atomic_load_acquire_u32(&impl->stop)) {
+    advance(impl, (idlib_clock_now() - impl->base) / IDLIB_TIMER_RESOLUTION);
+    if (IDLIB_TIMER_NULL != impl->heads[IDLIB_TIMER_EXPIRED]) {
+      // Dispatch the callbacks without holding the mutex.
+      idlib_timer_callback* callbacks[DISPATCH_BATCH_SIZE];
+      void* contexts[DISPATCH_BATCH_SIZE];
+      size_t n = 0;
+      while (n < DISPATCH_BATCH_SIZE && IDLIB_TIMER_NULL != impl->heads[IDLIB_TIMER_EXPIRED]) {
+        uint32_t i = impl->heads[IDLIB_TIMER_EXPIRED];
+        unlink_node(impl, i);
+        callbacks[n] = impl->nodes[i].callback;
+        contexts[n] = impl->nodes[i].context;
+        free_node(impl, i);
+        n++;
+      }
+      idlib_mutex_unlock(&impl->mutex);
+      for (size_t i = 0; i < n; ++i) {
+        if (impl->executor) {
+          impl->executor(impl->executor_context, callbacks[i], contexts[i]);
+        } else {
+          callbacks[i](contexts[i]);
+        }
+      }
+      if (idlib_mutex_lock(&impl->mutex)) {
+        return;
+      }
+      continue;
+    }
+    impl->wakeup = impl->number_of_timers ? get_next_tick(impl) : UINT64_MAX;
+    uint64_t wakeup = impl->wakeup;
+    uint32_t sequence = idlib_atomic_load_acquire_u32(&impl->sequence);
+    idlib_mutex_unlock(&impl->mutex);
+    // The stop flag is set before the sequence is incremented, hence it is observed here or the wait returns.
+    if (idlib_atomic_load_acquire_u32(&impl->stop)) {
+      return;
+    }
+    if (UINT64_MAX == wakeup) {
+      idlib_futex_wait(&impl->sequence, sequence);
+    } else {
+      uint64_t deadline = impl->base + wakeup * IDLIB_TIMER_RESOLUTION;
+      uint64_t now = idlib_clock_now();
+      if (deadline > now) {
+        idlib_futex_wait_for(&impl->sequence, sequence, deadline - now);
+      }
+    }
+    if (idlib_mutex_lock(&impl->mutex)) {
+      return;
+    }
+  }
+  idlib_mutex_unlock(&impl->mutex);
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+static void*
+thread_procedure
+  (
+    void* argument
+  )
+{
+  run((idlib_timer_service_impl*)argument);
+  return NULL;
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+static DWORD WINAPI
+thread_procedure
+  (
+    LPVOID argument
+  )
+{
+  run((idlib_timer_service_impl*)argument);
+  return 0;
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// Wake up the thread of the timer service.
+// The mutex must be locked unless the thread is stopped.
+static void
+wake
+  (
+    idlib_timer_service_impl* impl
+  )
+{
+  idlib_atomic_fetch_add_u32(&impl->sequence, 1);
+  idlib_futex_wake_one(&impl->sequence);
+}
+
+idlib_status
+idlib_timer_service_initialize
+  (
+    idlib_timer_service* service,
+    idlib_timer_executor* executor,
+    void* executor_context
+  )
+{
+  if (!service) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_timer_service_impl* impl = malloc(sizeof(idlib_timer_service_impl));
+  if (!impl) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  idlib_status status = idlib_mutex_initialize(&impl->mutex);
+  if (status) {
+    free(impl);
+    return status;
+  }
+  impl->executor = executor;
+  impl->executor_context = executor_context;
+  impl->base = idlib_clock_now();
+  impl->current = 0;
+  impl->wakeup = UINT64_MAX;
+  for (size_t i = 0; i < IDLIB_TIMER_EXPIRED + 1; ++i) {
+    impl->heads[i] = IDLIB_TIMER_NULL;
+  }
+  for (size_t i = 0; i < IDLIB_TIMER_SLOTS / 64; ++i) {
+    impl->occupied[i] = 0;
+  }
+  impl->number_of_timers = 0;
+  impl->nodes = NULL;
+  impl->number_of_nodes = 0;
+  impl->capacity = 0;
+  impl->free = IDLIB_TIMER_NULL;
+  impl->stop = 0;
+  impl->sequence = 0;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pthread_create(&impl->thread, NULL, &thread_procedure, impl)) {
+    idlib_mutex_uninitialize(&impl->mutex);
+    free(impl);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  impl->thread = CreateThread(NULL, 0, &thread_procedure, impl, 0, NULL);
+  if (!impl->thread) {
+    idlib_mutex_uninitialize(&impl->mutex);
+    free(impl);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  service->pimpl = impl;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_timer_service_uninitialize
+  (
+    idlib_timer_service* service
+  )
+{
+  if (!service) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_timer_service_impl* impl = (idlib_timer_service_impl*)service->pimpl;
+  service->pimpl = NULL;
+  // The mutex is not locked such that the thread can be stopped by a fiber if the mutex does not support fibers.
+  idlib_atomic_store_release_u32(&impl->stop, 1);
+  wake(impl);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_join(impl->thread, NULL);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  WaitForSingleObject(impl->thread, INFINITE);
+  CloseHandle(impl->thread);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  idlib_mutex_uninitialize(&impl->mutex);
+  free(impl->nodes);
+  free(impl);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_timer_schedule
+  (
+    idlib_timer_service* service,
+    uint64_t delay,
+    idlib_timer_callback* callback,
+    void* context,
+    idlib_timer_id* id
+  )
+{
+  if (!service || !callback) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_timer_service_impl* impl = (idlib_timer_service_impl*)service->pimpl;
+  // The first tick at which the delay has elapsed.
+  uint64_t elapsed = idlib_clock_now() - impl->base;
+  uint64_t deadline = delay < UINT64_MAX - elapsed ? elapsed + delay : UINT64_MAX;
+  uint64_t expiry = deadline / IDLIB_TIMER_RESOLUTION + (deadline % IDLIB_TIMER_RESOLUTION ? 1 : 0);
+  idlib_status status = idlib_mutex_lock(&impl->mutex);
+  if (status) {
+    return status;
+  }
+  if (IDLIB_TIMER_NULL == impl->free) {
+    if (impl->number_of_nodes == impl->capacity) {
+      // IDLIB_TIMER_NULL is not a valid index.
+      if (impl->capacity == IDLIB_TIMER_NULL) {
+        idlib_mutex_unlock(&impl->mutex);
+        return IDLIB_TOO_BIG;
+      }
+      uint32_t capacity = impl->capacity < MINIMUM_CAPACITY ? MINIMUM_CAPACITY
+                        : impl->capacity <= IDLIB_TIMER_NULL / 2 ? impl->capacity * 2 : IDLIB_TIMER_NULL;
+      idlib_timer_node* nodes = realloc(impl->nodes, sizeof(idlib_timer_node) * (size_t)capacity);
+      if (!nodes) {
+        idlib_mutex_unlock(&impl->mutex);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      impl->nodes = nodes;
+      impl->capacity = capacity;
+    }
+    impl->nodes[impl->number_of_nodes].generation = 1;
+    impl->free = impl->number_of_nodes++;
+    impl->nodes[impl->free].next = IDLIB_TIMER_NULL;
+  }
+  uint32_t i = impl->free;
+  idlib_timer_node* node = &impl->nodes[i];
+  impl->free = node->next;
+  node->expiry = expiry;
+  node->callback = callback;
+  node->context = context;
+  place_node(impl, i);
+  impl->number_of_timers++;
+  if (expiry < impl->wakeup) {
+    // The timer expires before the thread wakes up.
+    impl->wakeup = expiry;
+    wake(impl);
+  }
+  if (id) {
+    *id = ((uint64_t)node->generation << 32) | i;
+  }
+  idlib_mutex_unlock(&impl->mutex);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_timer_cancel
+  (
+    idlib_timer_service* service,
+    idlib_timer_id id
+  )
+{
+  if (!service) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_timer_service_impl* impl = (idlib_timer_service_impl*)service->pimpl;
+  uint32_t i = (uint32_t)id;
+  uint32_t generation = (uint32_t)(id >> 32);
+  idlib_status status = idlib_mutex_lock(&impl->mutex);
+  if (status) {
+    return status;
+  }
+  if (i >= impl->number_of_nodes || impl->nodes[i].generation != generation || IDLIB_TIMER_NULL == impl->nodes[i].list) {
+    idlib_mutex_unlock(&impl->mutex);
+    return IDLIB_NOT_EXISTS;
+  }
+  if (IDLIB_TIMER_EXPIRED != impl->nodes[i].list) {
+    impl->number_of_timers--;
+  }
+  unlink_node(impl, i);
+  free_node(impl, i);
+  idlib_mutex_unlock(&impl->mutex);
+  return IDLIB_SUCCESS;
+}
+
+static idlib_status
+start_timer_service
+  (
+    void* context
+  )
+{
+  idlib_process* process = (idlib_process*)context;
+  return idlib_timer_service_initialize(&process->timer_service, NULL, NULL);
+}
+
+idlib_status
+idlib_process_get_timer_service
+  (
+    idlib_process* process,
+    idlib_timer_service** service
+  )
+{
+  if (!process || !service) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->timer_once, &start_timer_service, process);
+  if (status) {
+    return status;
+  }
+  *service = &process->timer_service;
+  return IDLIB_SUCCESS;
+}
@@ -0,0 +1,406 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/tls.h"
+
+#include "idlib/process/tls_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/once.h"
+
+// malloc, free
+#include <malloc.h>
+
+// memset
+#include <string.h>
+
+IDLIB_THREAD_LOCAL idlib_tls_block* idlib_tls_block_of_thread = NULL;
+
+static void
+lock
+  (
+    idlib_tls_registry* registry
+  )
+{
+  uint32_t expected = 0;
+  while (!idlib_atomic_compare_exchange_u32(&registry->lock, &expected, 1)) {
+    expected = 0;
+    idlib_cpu_relax();
+  }
+}
+
+static void
+unlock
+  (
+    idlib_tls_registry* registry
+  )
+{
+  idlib_atomic_store_release_u32(&registry->lock, 0);
+}
+
+static void
+release_registry
+  (
+    idlib_tls_registry* registry
+  )
+{
+  if (1 == idlib_atomic_fetch_sub_u32(&registry->reference_count, 1)) {
+    free(registry);
+  }
+}
+
+// Invoke the destructors of the values of the block and make the block available for reuse.
+// If the registry is destroyed meanwhile, the remaining values are not destroyed.
+static void
+retire_block
+  (
+    idlib_tls_block* block
+  )
+{
+  // The block is pinned such that idlib_tls_impl_destroy does not free the registry before a reference was acquired.
+  idlib_atomic_store_release_u32(&block->pinned, 1);
+  idlib_atomic_fence();
+  idlib_tls_registry* registry = (idlib_tls_registry*)idlib_atomic_load_acquire_pointer(&block->registry);
+  if (registry) {
+    idlib_atomic_fetch_add_u32(&registry->reference_count, 1);
+  }
+  idlib_atomic_store_release_u32(&block->pinned, 0);
+  if (!registry) {
+    // The block was detached from a destroyed registry.
+    idlib_tls_block_of_thread = NULL;
+    return;
+  }
+  for (int pass = 0; pass < IDLIB_TLS_DESTRUCTOR_PASSES; ++pass) {
+    int invoked = 0;
+    for (uint32_t i = 0; i < IDLIB_TLS_MAXIMUM_SLOTS; ++i) {
+      lock(registry);
+      if (registry->destroying || i >= registry->number_of_slots) {
+        unlock(registry);
+        break;
+      }
+      void* value = block->values[i];
+      block->values[i] = NULL;
+      idlib_tls_destructor* destructor = registry->destructors[i];
+      unlock(registry);
+      if (value && destructor) {
+        destructor(value);
+        invoked = 1;
+      }
+    }
+    if (!invoked) {
+      break;
+    }
+  }
+  lock(registry);
+  // Values assigned by destructors in the last pass are discarded.
+  // If the registry was destroyed, the block was detached and is not freed.
+  memset(block->values, 0, sizeof(block->values));
+  block->retired = 1;
+  unlock(registry);
+  release_registry(registry);
+  idlib_tls_block_of_thread = NULL;
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+static void
+retire
+  (
+    void* block
+  )
+{
+  retire_block((idlib_tls_block*)block);
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+static void WINAPI
+retire
+  (
+    void* block
+  )
+{
+  // FlsFree invokes this callback for the blocks of all threads.
+  // These blocks were detached from the registry before.
+  if (block) {
+    retire_block((idlib_tls_block*)block);
+  }
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+idlib_status
+idlib_tls_impl_create
+  (
+    idlib_tls_registry** registry
+  )
+{
+  idlib_tls_registry* r = malloc(sizeof(idlib_tls_registry));
+  if (!r) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pthread_key_create(&r->key, &retire)) {
+    free(r);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  r->key = FlsAlloc(&retire);
+  if (FLS_OUT_OF_INDEXES == r->key) {
+    free(r);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  r->lock = 0;
+  r->number_of_slots = 0;
+  memset(r->allocated, 0, sizeof(r->allocated));
+  for (uint32_t i = 0; i < IDLIB_TLS_MAXIMUM_SLOTS; ++i) {
+    r->destructors[i] = NULL;
+  }
+  r->blocks = NULL;
+  r->destroying = 0;
+  r->reference_count = 1;
+  *registry = r;
+  return IDLIB_SUCCESS;
+}
+
+void
+idlib_tls_impl_destroy
+  (
+    idlib_tls_registry* registry
+  )
+{
+  lock(registry);
+  idlib_atomic_store_release_u32(&registry->destroying, 1);
+  // The blocks of terminated threads are freed.
+  // The blocks of other threads are orphaned as the modules of these threads may still cache them.
+  while (registry->blocks) {
+    idlib_tls_block* block = registry->blocks;
+    registry->blocks = block->next;
+    if (block->retired) {
+      free(block);
+    } else {
+      block->next = NULL;
+      idlib_atomic_store_release_pointer(&block->registry, NULL);
+      idlib_atomic_fence();
+      // Wait until a terminating owning thread has acquired a reference or observed the null pointer.
+      while (idlib_atomic_load_acquire_u32(&block->pinned)) {
+        idlib_cpu_relax();
+      }
+    }
+  }
+  unlock(registry);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_key_delete(registry->key);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  FlsFree(registry->key);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  // Terminating threads which are invoking destructors hold references.
+  release_registry(registry);
+  idlib_tls_block_of_thread = NULL;
+}
+
+static idlib_status
+create_registry
+  (
+    void* context
+  )
+{
+  idlib_process* process = (idlib_process*)context;
+  return idlib_tls_impl_create(&process->tls);
+}
+
+idlib_status
+idlib_tls_impl_attach
+  (
+    idlib_process* process,
+    int create,
+    idlib_tls_block** block
+  )
+{
+  // The block of this thread of a destroyed registry or null.
+  idlib_tls_block* detached = idlib_tls_block_of_thread && !idlib_tls_block_of_thread->registry ? idlib_tls_block_of_thread : NULL;
+  if (!create && IDLIB_ONCE_DONE != idlib_atomic_load_acquire_u32(&process->tls_once.state)) {
+    // No slot was ever allocated.
+    *block = NULL;
+    return IDLIB_SUCCESS;
+  }
+  idlib_status status = idlib_once_call(&process->tls_once, &create_registry, process);
+  if (status) {
+    return status;
+  }
+  idlib_tls_registry* registry = process->tls;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  idlib_tls_block* b = (idlib_tls_block*)pthread_getspecific(registry->key);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  idlib_tls_block* b = (idlib_tls_block*)FlsGetValue(registry->key);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  if (!b) {
+    if (!create) {
+      *block = NULL;
+      return IDLIB_SUCCESS;
+    }
+    lock(registry);
+    // Reuse the detached block of this thread as other modules may still cache it.
+    // Otherwise reuse the block of a terminated thread if possible.
+    b = detached ? NULL : registry->blocks;
+    while (b && !b->retired) {
+      b = b->next;
+    }
+    if (b) {
+      b->retired = 0;
+    } else {
+      b = detached ? detached : malloc(sizeof(idlib_tls_block));
+      if (!b) {
+        unlock(registry);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      memset(b->values, 0, sizeof(b->values));
+      b->registry = registry;
+      b->retired = 0;
+      b->pinned = 0;
+      b->next = registry->blocks;
+      registry->blocks = b;
+    }
+    unlock(registry);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    int failed = 0 != pthread_setspecific(registry->key, b);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+    int failed = !FlsSetValue(registry->key, b);
+#else
+    #error("operating system not (yet) supported")
+#endif
+    if (failed) {
+      lock(registry);
+      b->retired = 1;
+      unlock(registry);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  idlib_tls_block_of_thread = b;
+  *block = b;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_tls_allocate
+  (
+    idlib_process* process,
+    idlib_tls_destructor* destructor,
+    idlib_tls_slot* slot
+  )
+{
+  if (!process || !slot) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->tls_once, &create_registry, process);
+  if (status) {
+    return status;
+  }
+  idlib_tls_registry* registry = process->tls;
+  lock(registry);
+  uint32_t i = 0;
+  while (i < IDLIB_TLS_MAXIMUM_SLOTS && registry->allocated[i]) {
+    i++;
+  }
+  if (IDLIB_TLS_MAXIMUM_SLOTS == i) {
+    unlock(registry);
+    return IDLIB_TOO_BIG;
+  }
+  registry->allocated[i] = 1;
+  registry->destructors[i] = destructor;
+  if (i >= registry->number_of_slots) {
+    registry->number_of_slots = i + 1;
+  }
+  unlock(registry);
+  *slot = i;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_tls_free
+  (
+    idlib_process* process,
+    idlib_tls_slot slot
+  )
+{
+  if (!process || slot >= IDLIB_TLS_MAXIMUM_SLOTS) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (IDLIB_ONCE_DONE != idlib_atomic_load_acquire_u32(&process->tls_once.state)) {
+    return IDLIB_NOT_EXISTS;
+  }
+  idlib_tls_registry* registry = process->tls;
+  lock(registry);
+  if (!registry->allocated[slot]) {
+    unlock(registry);
+    return IDLIB_NOT_EXISTS;
+  }
+  registry->allocated[slot] = 0;
+  registry->destructors[slot] = NULL;
+  // Reset the values such that the slot is null for all threads when it is allocated again.
+  for (idlib_tls_block* block = registry->blocks; NULL != block; block = block->next) {
+    block->values[slot] = NULL;
+  }
+  unlock(registry);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_tls_set
+  (
+    idlib_process* process,
+    idlib_tls_slot slot,
+    void* value
+  )
+{
+  if (!process || slot >= IDLIB_TLS_MAXIMUM_SLOTS) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_tls_block* block = idlib_tls_block_of_thread;
+  if (IDLIB_UNLIKELY(!block || !block->registry)) {
+    idlib_status status = idlib_tls_impl_attach(process, 1, &block);
+    if (status) {
+      return status;
+    }
+  }
+  block->values[slot] = value;
+  return IDLIB_SUCCESS;
+}
@@ -0,0 +1,662 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/configure.h"
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // sched_getcpu, CPU_ALLOC, pthread_setaffinity_np
+  #define _GNU_SOURCE
+#endif
+
+#include "idlib/process/topology.h"
+
+#include "idlib/process/topology_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/once.h"
+
+// malloc, free
+#include <malloc.h>
+
+// fopen, fread, fclose, snprintf
+#include <stdio.h>
+
+// strtoul, strtol
+#include <stdlib.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // pthread_self, pthread_setaffinity_np
+  #include <pthread.h>
+  // sched_getcpu, CPU_ALLOC
+  #include <sched.h>
+  // sysconf
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // sysconf
+  #include <unistd.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+// The CPUs found by the discovery with keys identifying their cores, last-level caches, and nodes.
+// The keys are replaced by dense indices when the topology is built.
+typedef struct discovery {
+  uint32_t number_of_cpus;
+  uint32_t* ids;
+  uint32_t* packages;
+  uint64_t* core_keys;
+  uint64_t* cache_keys;
+  uint64_t* node_keys;
+} discovery;
+
+static idlib_status
+discovery_initialize
+  (
+    discovery* discovery,
+    uint32_t number_of_cpus
+  )
+{
+  discovery->number_of_cpus = number_of_cpus;
+  discovery->ids = malloc(sizeof(uint32_t) * 2 * number_of_cpus);
+  discovery->core_keys = malloc(sizeof(uint64_t) * 3 * number_of_cpus);
+  if (!discovery->ids || !discovery->core_keys) {
+    free(discovery->core_keys);
+    free(discovery->ids);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  discovery->packages = discovery->ids + number_of_cpus;
+  discovery->cache_keys = discovery->core_keys + number_of_cpus;
+  discovery->node_keys = discovery->core_keys + 2 * number_of_cpus;
+  for (uint32_t i = 0; i < number_of_cpus; ++i) {
+    discovery->ids[i] = i;
+    discovery->packages[i] = 0;
+    discovery->core_keys[i] = i;
+    discovery->cache_keys[i] = 0;
+    discovery->node_keys[i] = 0;
+  }
+  return IDLIB_SUCCESS;
+}
+
+static void
+discovery_uninitialize
+  (
+    discovery* discovery
+  )
+{
+  free(discovery->core_keys);
+  free(discovery->ids);
+}
+
+// Map the keys to dense indices: equal keys are mapped to equal indices, numbered in the order of their first occurrence.
+// Return the number of distinct keys.
+static uint32_t
+densify
+  (
+    uint64_t const* keys,
+    uint32_t number_of_keys,
+    uint32_t* indices
+  )
+{
+  uint32_t number_of_distinct_keys = 0;
+  for (uint32_t i = 0; i < number_of_keys; ++i) {
+    uint32_t j = 0;
+    while (j < i && keys[j] != keys[i]) {
+      j++;
+    }
+    indices[i] = j < i ? indices[j] : number_of_distinct_keys++;
+  }
+  return number_of_distinct_keys;
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+
+// The maximal size of a file read from sysfs.
+#define TEXT_SIZE (4096)
+
+// Read a file into a zero-terminated buffer of TEXT_SIZE Bytes.
+static int
+read_text
+  (
+    char const* path,
+    char* buffer
+  )
+{
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return 1;
+  }
+  size_t size = fread(buffer, 1, TEXT_SIZE - 1, file);
+  fclose(file);
+  buffer[size] = '\0';
+  return 0;
+}
+
+// Parse a CPU or node list like "0-3,8,10-11".
+// Invoke the visitor for each element. Return 1 if the list is malformed, 0 otherwise.
+static int
+parse_list
+  (
+    char const* text,
+    void (*visitor)(void* context, uint32_t element),
+    void* context
+  )
+{
+  char const* p = text;
+  while (*p && '\n' != *p) {
+    char* end;
+    unsigned long first = strtoul(p, &end, 10);
+    if (end == p || first >= UINT32_MAX) {
+      return 1;
+    }
+    unsigned long last = first;
+    p = end;
+    if ('-' == *p) {
+      p++;
+      last = strtoul(p, &end, 10);
+      if (end == p || last >= UINT32_MAX || last < first) {
+        return 1;
+      }
+      p = end;
+    }
+    for (unsigned long element = first; element <= last; ++element) {
+      visitor(context, (uint32_t)element);
+    }
+    if (',' == *p) {
+      p++;
+    }
+  }
+  return 0;
+}
+
+static void
+count_visitor
+  (
+    void* context,
+    uint32_t element
+  )
+{
+  (void)element;
+  (*(uint32_t*)context)++;
+}
+
+static void
+store_visitor
+  (
+    void* context,
+    uint32_t element
+  )
+{
+  discovery* discovery = (struct discovery*)context;
+  discovery->ids[discovery->number_of_cpus++] = element;
+}
+
+typedef struct node_visitor_context {
+  discovery* discovery;
+  uint32_t node;
+} node_visitor_context;
+
+static void
+node_visitor
+  (
+    void* context,
+    uint32_t element
+  )
+{
+  node_visitor_context* node_context = (node_visitor_context*)context;
+  discovery* discovery = node_context->discovery;
+  for (uint32_t i = 0; i < discovery->number_of_cpus; ++i) {
+    if (element == discovery->ids[i]) {
+      discovery->node_keys[i] = node_context->node;
+      break;
+    }
+  }
+}
+
+static void
+first_visitor
+  (
+    void* context,
+    uint32_t element
+  )
+{
+  uint64_t* first = (uint64_t*)context;
+  if (UINT64_MAX == *first) {
+    *first = element;
+  }
+}
+
+static idlib_status
+discover
+  (
+    discovery* discovery
+  )
+{
+  char* text = malloc(TEXT_SIZE);
+  if (!text) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  char path[128];
+  uint32_t number_of_cpus = 0;
+  if (read_text("/sys/devices/system/cpu/online", text) || parse_list(text, &count_visitor, &number_of_cpus) || !number_of_cpus) {
+    // Without sysfs each online CPU is a core of its own.
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    free(text);
+    return discovery_initialize(discovery, n > 0 && n < UINT32_MAX ? (uint32_t)n : 1);
+  }
+  idlib_status status = discovery_initialize(discovery, number_of_cpus);
+  if (status) {
+    free(text);
+    return status;
+  }
+  discovery->number_of_cpus = 0;
+  parse_list(text, &store_visitor, discovery);
+  for (uint32_t i = 0; i < discovery->number_of_cpus; ++i) {
+    uint32_t id = discovery->ids[i];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", id);
+    // The package is -1 if it is unknown.
+    long package = read_text(path, text) ? 0 : strtol(text, NULL, 10);
+    discovery->packages[i] = package > 0 && package < UINT32_MAX ? (uint32_t)package : 0;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", id);
+    if (!read_text(path, text)) {
+      discovery->core_keys[i] = ((uint64_t)discovery->packages[i] << 32) | (uint32_t)strtoul(text, NULL, 10);
+    }
+    // The last-level cache is identified by its level and the first CPU sharing it.
+    unsigned long best = 0;
+    for (uint32_t j = 0; j < 16; ++j) {
+      snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", id, j);
+      if (read_text(path, text)) {
+        break;
+      }
+      unsigned long level = strtoul(text, NULL, 10);
+      if (level < best) {
+        continue;
+      }
+      snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", id, j);
+      uint64_t first = UINT64_MAX;
+      if (!read_text(path, text) && !parse_list(text, &first_visitor, &first) && UINT64_MAX != first) {
+        best = level;
+        discovery->cache_keys[i] = ((uint64_t)level << 32) | first;
+      }
+    }
+  }
+  // Without NUMA all CPUs belong to node 0.
+  if (!read_text("/sys/devices/system/node/online", text)) {
+    uint32_t number_of_nodes = 0;
+    if (!parse_list(text, &count_visitor, &number_of_nodes) && number_of_nodes) {
+      uint32_t* nodes = malloc(sizeof(uint32_t) * number_of_nodes);
+      if (!nodes) {
+        discovery_uninitialize(discovery);
+        free(text);
+        return IDLIB_ALLOCATION_FAILED;
+      }
+      struct discovery node_list = { .number_of_cpus = 0, .ids = nodes };
+      parse_list(text, &store_visitor, &node_list);
+      for (uint32_t i = 0; i < number_of_nodes; ++i) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", nodes[i]);
+        if (!read_text(path, text)) {
+          node_visitor_context context = { .discovery = discovery, .node = nodes[i] };
+          parse_list(text, &node_visitor, &context);
+        }
+      }
+      free(nodes);
+    }
+  }
+  free(text);
+  return IDLIB_SUCCESS;
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+// The CPUs of the processor group of the process.
+static idlib_status
+discover
+  (
+    discovery* discovery
+  )
+{
+  DWORD length = 0;
+  GetLogicalProcessorInformation(NULL, &length);
+  SYSTEM_LOGICAL_PROCESSOR_INFORMATION* entries = malloc(length);
+  if (!entries) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  if (!GetLogicalProcessorInformation(entries, &length)) {
+    free(entries);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  size_t number_of_entries = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+  ULONG_PTR online = 0;
+  for (size_t i = 0; i < number_of_entries; ++i) {
+    if (RelationProcessorCore == entries[i].Relationship) {
+      online |= entries[i].ProcessorMask;
+    }
+  }
+  uint32_t number_of_cpus = 0;
+  for (uint32_t id = 0; id < sizeof(ULONG_PTR) * 8; ++id) {
+    if (online & ((ULONG_PTR)1 << id)) {
+      number_of_cpus++;
+    }
+  }
+  idlib_status status = discovery_initialize(discovery, number_of_cpus ? number_of_cpus : 1);
+  if (status || !number_of_cpus) {
+    free(entries);
+    return status;
+  }
+  number_of_cpus = 0;
+  for (uint32_t id = 0; id < sizeof(ULONG_PTR) * 8; ++id) {
+    if (online & ((ULONG_PTR)1 << id)) {
+      discovery->ids[number_of_cpus++] = id;
+    }
+  }
+  BYTE* levels = calloc(number_of_cpus, 1);
+  if (!levels) {
+    discovery_uninitialize(discovery);
+    free(entries);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  uint32_t package = 0;
+  for (size_t i = 0; i < number_of_entries; ++i) {
+    for (uint32_t j = 0; j < number_of_cpus; ++j) {
+      if (!(entries[i].ProcessorMask & ((ULONG_PTR)1 << discovery->ids[j]))) {
+        continue;
+      }
+      switch (entries[i].Relationship) {
+        case RelationProcessorCore: {
+          discovery->core_keys[j] = i;
+        } break;
+        case RelationCache: {
+          if (entries[i].Cache.Level >= levels[j]) {
+            levels[j] = entries[i].Cache.Level;
+            discovery->cache_keys[j] = i;
+          }
+        } break;
+        case RelationNumaNode: {
+          discovery->node_keys[j] = entries[i].NumaNode.NodeNumber;
+        } break;
+        case RelationProcessorPackage: {
+          discovery->packages[j] = package;
+        } break;
+        default: {
+        } break;
+      }
+    }
+    if (RelationProcessorPackage == entries[i].Relationship) {
+      package++;
+    }
+  }
+  free(levels);
+  free(entries);
+  return IDLIB_SUCCESS;
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+// Each online CPU is a core of its own.
+static idlib_status
+discover
+  (
+    discovery* discovery
+  )
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return discovery_initialize(discovery, n > 0 && n < UINT32_MAX ? (uint32_t)n : 1);
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+idlib_status
+idlib_topology_impl_create
+  (
+    idlib_topology** topology
+  )
+{
+  discovery discovery;
+  idlib_status status = discover(&discovery);
+  if (status) {
+    return status;
+  }
+  uint32_t n = discovery.number_of_cpus;
+  idlib_topology* t = malloc(sizeof(idlib_topology));
+  if (!t) {
+    discovery_uninitialize(&discovery);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  t->number_of_cpus = n;
+  t->number_of_indices = discovery.ids[n - 1] + 1;
+  t->cpus = malloc(sizeof(idlib_topology_cpu) * n);
+  t->indices = malloc(sizeof(uint32_t) * t->number_of_indices);
+  if (!t->cpus || !t->indices) {
+    free(t->indices);
+    free(t->cpus);
+    free(t);
+    discovery_uninitialize(&discovery);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  // The indices of the cores, caches, and nodes are assigned in the array of indices of the CPUs which is large enough.
+  uint32_t* dense = t->indices;
+  densify(discovery.core_keys, n, dense);
+  for (uint32_t i = 0; i < n; ++i) {
+    t->cpus[i].core = dense[i];
+  }
+  densify(discovery.cache_keys, n, dense);
+  for (uint32_t i = 0; i < n; ++i) {
+    t->cpus[i].cache = dense[i];
+  }
+  t->number_of_nodes = densify(discovery.node_keys, n, dense);
+  for (uint32_t i = 0; i < n; ++i) {
+    t->cpus[i].node = dense[i];
+  }
+  for (uint32_t i = 0; i < t->number_of_indices; ++i) {
+    t->indices[i] = UINT32_MAX;
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    t->cpus[i].id = discovery.ids[i];
+    t->cpus[i].package = discovery.packages[i];
+    t->indices[discovery.ids[i]] = i;
+  }
+  discovery_uninitialize(&discovery);
+  *topology = t;
+  return IDLIB_SUCCESS;
+}
+
+void
+idlib_topology_impl_destroy
+  (
+    idlib_topology* topology
+  )
+{
+  free(topology->indices);
+  free(topology->cpus);
+  free(topology);
+}
+
+static idlib_status
+create_topology
+  (
+    void* context
+  )
+{
+  idlib_process* process = (idlib_process*)context;
+  return idlib_topology_impl_create(&process->topology);
+}
+
+idlib_status
+idlib_process_get_topology
+  (
+    idlib_process* process,
+    idlib_topology** topology
+  )
+{
+  if (!process || !topology) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->topology_once, &create_topology, process);
+  if (status) {
+    return status;
+  }
+  *topology = process->topology;
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_topology_get_counts
+  (
+    idlib_topology* topology,
+    uint32_t* number_of_cpus,
+    uint32_t* number_of_nodes
+  )
+{
+  if (!topology) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  if (number_of_cpus) {
+    *number_of_cpus = topology->number_of_cpus;
+  }
+  if (number_of_nodes) {
+    *number_of_nodes = topology->number_of_nodes;
+  }
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_topology_get_cpu
+  (
+    idlib_topology* topology,
+    uint32_t index,
+    idlib_topology_cpu* cpu
+  )
+{
+  if (!topology || !cpu || index >= topology->number_of_cpus) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  *cpu = topology->cpus[index];
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_topology_get_current
+  (
+    idlib_topology* topology,
+    uint32_t* index,
+    uint32_t* node
+  )
+{
+  if (!topology) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  int id = sched_getcpu();
+  uint32_t i = id >= 0 && (uint32_t)id < topology->number_of_indices ? topology->indices[id] : UINT32_MAX;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  DWORD id = GetCurrentProcessorNumber();
+  uint32_t i = id < topology->number_of_indices ? topology->indices[id] : UINT32_MAX;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  uint32_t i = 0;
+#else
+  #error("operating system not (yet) supported")
+#endif
+  // The CPU may have come online after the topology was discovered.
+  if (UINT32_MAX == i) {
+    i = 0;
+  }
+  if (index) {
+    *index = i;
+  }
+  if (node) {
+    *node = topology->cpus[i].node;
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Restrict the calling thread to the CPU of the index if node is UINT32_MAX or to the CPUs of the node otherwise.
+static idlib_status
+pin
+  (
+    idlib_topology* topology,
+    uint32_t index,
+    uint32_t node
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  cpu_set_t* set = CPU_ALLOC(topology->number_of_indices);
+  if (!set) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  size_t size = CPU_ALLOC_SIZE(topology->number_of_indices);
+  CPU_ZERO_S(size, set);
+  for (uint32_t i = 0; i < topology->number_of_cpus; ++i) {
+    if (UINT32_MAX == node ? i == index : node == topology->cpus[i].node) {
+      CPU_SET_S(topology->cpus[i].id, size, set);
+    }
+  }
+  int result = pthread_setaffinity_np(pthread_self(), size, set);
+  CPU_FREE(set);
+  return result ? IDLIB_ENVIRONMENT_FAILED : IDLIB_SUCCESS;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  DWORD_PTR mask = 0;
+  for (uint32_t i = 0; i < topology->number_of_cpus; ++i) {
+    if (UINT32_MAX == node ? i == index : node == topology->cpus[i].node) {
+      mask |= (DWORD_PTR)1 << topology->cpus[i].id;
+    }
+  }
+  return SetThreadAffinityMask(GetCurrentThread(), mask) ? IDLIB_SUCCESS : IDLIB_ENVIRONMENT_FAILED;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  return IDLIB_OPERATION_INVALID;
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+idlib_status
+idlib_topology_pin_thread_to_cpu
+  (
+    idlib_topology* topology,
+    uint32_t index
+  )
+{
+  if (!topology || index >= topology->number_of_cpus) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return pin(topology, index, UINT32_MAX);
+}
+
+idlib_status
+idlib_topology_pin_thread_to_node
+  (
+    idlib_topology* topology,
+    uint32_t node
+  )
+{
+  if (!topology || node >= topology->number_of_nodes) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return pin(topology, UINT32_MAX, node);
+}
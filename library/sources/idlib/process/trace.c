@@ -0,0 +1,330 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process/trace.h"
+
+#include "idlib/process/trace_impl.h"
+
+#include "idlib/process/once.h"
+
+// malloc, free
+#include <malloc.h>
+
+// fopen, fwrite, fclose
+#include <stdio.h>
+
+// memcpy
+#include <string.h>
+
+#if 1 == IDLIB_PROCESS_WITH_TRACING
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  #include <pthread.h>
+  #include <time.h>
+  #include <unistd.h>
+  #include <sys/syscall.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+IDLIB_THREAD_LOCAL idlib_trace_ring* idlib_trace_ring_of_thread = NULL;
+
+// Non-zero if the ring buffer of the calling thread was retired as the thread terminates.
+// Events recorded afterwards (e.g., by the destructors of other thread-specific data) are discarded.
+static IDLIB_THREAD_LOCAL int retired_of_thread = 0;
+
+// Guards g_rings.
+// A spin lock as it is only acquired when a thread records its first event and when the events are saved.
+static uint32_t volatile g_lock = 0;
+
+// The list of ring buffers.
+static idlib_trace_ring* g_rings = NULL;
+
+// Creates g_key and assigns g_base_timestamp and g_base_clock.
+static idlib_once g_once = IDLIB_ONCE_INITIALIZER;
+
+// The time stamp and the clock value when tracing started.
+static uint64_t g_base_timestamp = 0;
+static uint64_t g_base_clock = 0;
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  // Used to retire the ring buffer of a thread when the thread terminates.
+  static pthread_key_t g_key;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  static DWORD g_key = FLS_OUT_OF_INDEXES;
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+static void
+lock
+  (
+  )
+{
+  uint32_t expected = 0;
+  while (!idlib_atomic_compare_exchange_u32(&g_lock, &expected, 1)) {
+    expected = 0;
+    idlib_cpu_relax();
+  }
+}
+
+static void
+unlock
+  (
+  )
+{
+  idlib_atomic_store_release_u32(&g_lock, 0);
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+static void
+retire
+  (
+    void* ring
+  )
+{
+  // The ring buffer may be assigned to another thread once it is retired, hence the calling thread must not write it anymore.
+  idlib_trace_ring_of_thread = NULL;
+  retired_of_thread = 1;
+  idlib_atomic_store_release_u32(&((idlib_trace_ring*)ring)->retired, 1);
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+static void WINAPI
+retire
+  (
+    void* ring
+  )
+{
+  if (ring) {
+    // The ring buffer may be assigned to another thread once it is retired, hence the calling thread must not write it anymore.
+    idlib_trace_ring_of_thread = NULL;
+    retired_of_thread = 1;
+    idlib_atomic_store_release_u32(&((idlib_trace_ring*)ring)->retired, 1);
+  }
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+uint64_t
+idlib_trace_clock
+  (
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  LARGE_INTEGER frequency, now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  return (uint64_t)((double)now.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+static uint64_t
+get_thread_id
+  (
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  return (uint64_t)syscall(SYS_gettid);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+      (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  return (uint64_t)(uintptr_t)pthread_self();
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  return (uint64_t)GetCurrentThreadId();
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+static idlib_status
+initialize
+  (
+    void* context
+  )
+{
+  (void)context;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  if (pthread_key_create(&g_key, &retire)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  g_key = FlsAlloc(&retire);
+  if (FLS_OUT_OF_INDEXES == g_key) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  #error("operating system not (yet) supported")
+#endif
+  g_base_clock = idlib_trace_clock();
+  g_base_timestamp = idlib_trace_timestamp();
+  return IDLIB_SUCCESS;
+}
+
+idlib_trace_ring*
+idlib_trace_ring_acquire
+  (
+  )
+{
+  if (retired_of_thread || idlib_once_call(&g_once, &initialize, NULL)) {
+    return NULL;
+  }
+  lock();
+  // Reuse the ring buffer of a terminated thread if possible.
+  idlib_trace_ring* ring = g_rings;
+  while (ring && !idlib_atomic_load_acquire_u32(&ring->retired)) {
+    ring = ring->next;
+  }
+  if (ring) {
+    idlib_atomic_store_release_u64(&ring->head, 0);
+    ring->retired = 0;
+  } else {
+    ring = malloc(sizeof(idlib_trace_ring));
+    if (!ring) {
+      unlock();
+      return NULL;
+    }
+    ring->head = 0;
+    ring->retired = 0;
+    ring->next = g_rings;
+    g_rings = ring;
+  }
+  ring->thread_id = get_thread_id();
+  unlock();
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_setspecific(g_key, ring);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  FlsSetValue(g_key, ring);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  idlib_trace_ring_of_thread = ring;
+  return ring;
+}
+
+idlib_status
+idlib_trace_save
+  (
+    char const* path
+  )
+{
+  if (!path) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_trace_event* events = malloc(sizeof(idlib_trace_event) * IDLIB_TRACE_RING_CAPACITY);
+  if (!events) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    free(events);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_trace_file_header header;
+  memcpy(header.magic, IDLIB_TRACE_FILE_MAGIC, sizeof(header.magic));
+  header.version = IDLIB_TRACE_FILE_VERSION;
+  header.base_timestamp = g_base_timestamp;
+  header.ticks_per_nanosecond = 1.0;
+  if (IDLIB_ONCE_DONE == idlib_atomic_load_acquire_u32(&g_once.state)) {
+    // Calibrate the time stamp counter against the clock over at least 10 milliseconds.
+    // The lock is not held such that threads recording their first events are not delayed.
+    uint64_t clock = idlib_trace_clock();
+    while (clock - g_base_clock < UINT64_C(10000000)) {
+      idlib_cpu_relax();
+      clock = idlib_trace_clock();
+    }
+    uint64_t timestamp = idlib_trace_timestamp();
+    header.ticks_per_nanosecond = (double)(timestamp - g_base_timestamp) / (double)(clock - g_base_clock);
+  }
+  lock();
+  header.number_of_rings = 0;
+  for (idlib_trace_ring* ring = g_rings; NULL != ring; ring = ring->next) {
+    header.number_of_rings++;
+  }
+  int failed = 1 != fwrite(&header, sizeof(header), 1, file);
+  for (idlib_trace_ring* ring = g_rings; NULL != ring && !failed; ring = ring->next) {
+    // Copy the events and discard those which might have been overwritten while copying.
+    uint64_t end = idlib_atomic_load_acquire_u64(&ring->head);
+    uint64_t start = end > IDLIB_TRACE_RING_CAPACITY ? end - IDLIB_TRACE_RING_CAPACITY : 0;
+    for (uint64_t i = start; i < end; ++i) {
+      events[i - start] = ring->events[i & (IDLIB_TRACE_RING_CAPACITY - 1)];
+    }
+    uint64_t head = idlib_atomic_load_acquire_u64(&ring->head);
+    uint64_t valid = head + 1 > IDLIB_TRACE_RING_CAPACITY ? head + 1 - IDLIB_TRACE_RING_CAPACITY : 0;
+    if (valid > start) {
+      valid = valid < end ? valid : end;
+    } else {
+      valid = start;
+    }
+    idlib_trace_file_ring ring_header;
+    ring_header.thread_id = ring->thread_id;
+    ring_header.number_of_events = end - valid;
+    failed = 1 != fwrite(&ring_header, sizeof(ring_header), 1, file);
+    if (!failed && ring_header.number_of_events) {
+      failed = ring_header.number_of_events != fwrite(events + (valid - start), sizeof(idlib_trace_event), (size_t)ring_header.number_of_events, file);
+    }
+  }
+  unlock();
+  failed |= 0 != fclose(file);
+  free(events);
+  return failed ? IDLIB_ENVIRONMENT_FAILED : IDLIB_SUCCESS;
+}
+
+#else
+
+idlib_status
+idlib_trace_save
+  (
+    char const* path
+  )
+{
+  if (!path) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  return IDLIB_OPERATION_INVALID;
+}
+
+#endif
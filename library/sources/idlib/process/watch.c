@@ -0,0 +1,383 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process/watch.h"
+
+#include "idlib/process/watch_impl.h"
+
+#include "idlib/process/process_impl.h"
+
+#include "idlib/process/atomic.h"
+
+#include "idlib/process/clock.h"
+
+#include "idlib/process/futex.h"
+
+#include "idlib/process/once.h"
+
+#include "idlib/process.h"
+
+// malloc, free
+#include <malloc.h>
+
+// memcmp, memcpy
+#include <string.h>
+
+// Lock the watches.
+// The lock is a futex: it never fails and parks a fiber instead of blocking its worker thread.
+static void
+lock_set
+  (
+    idlib_watch_set* set
+  )
+{
+  uint32_t expected = 0;
+  if (idlib_atomic_compare_exchange_u32(&set->lock, &expected, 1)) {
+    return;
+  }
+  // Announce that threads wait (state 2) and wait until the watches were unlocked (state 0).
+  uint32_t state = idlib_atomic_exchange_u32(&set->lock, 2);
+  while (0 != state) {
+    idlib_futex_wait(&set->lock, 2);
+    state = idlib_atomic_exchange_u32(&set->lock, 2);
+  }
+}
+
+static void
+unlock_set
+  (
+    idlib_watch_set* set
+  )
+{
+  if (2 == idlib_atomic_exchange_u32(&set->lock, 0)) {
+    idlib_futex_wake_one(&set->lock);
+  }
+}
+
+static inline idlib_watch**
+get_bucket
+  (
+    idlib_watch_set* set,
+    uint64_t hash
+  )
+{
+  return &set->buckets[hash & (IDLIB_WATCH_BUCKETS - 1)];
+}
+
+static inline int
+is_key
+  (
+    idlib_watch const* watch,
+    uint64_t hash,
+    void const* p,
+    size_t n
+  )
+{
+  return watch->hash == hash && watch->n == n && !memcmp(watch->p, p, n);
+}
+
+// Insert a watch and increment the number of watches.
+// The lock must be held.
+static void
+insert_watch
+  (
+    idlib_process* process,
+    idlib_watch* watch
+  )
+{
+  idlib_watch** bucket = get_bucket(process->watches, watch->hash);
+  watch->next = *bucket;
+  *bucket = watch;
+  idlib_atomic_fetch_add_u32(&process->number_of_watches, 1);
+}
+
+// Unlink a watch.
+// The lock must be held.
+static void
+unlink_watch
+  (
+    idlib_watch_set* set,
+    idlib_watch* watch
+  )
+{
+  idlib_watch** link = get_bucket(set, watch->hash);
+  while (*link != watch) {
+    link = &(*link)->next;
+  }
+  *link = watch->next;
+}
+
+// Remove a watch and decrement the number of watches.
+// The lock must be held.
+static void
+remove_watch
+  (
+    idlib_process* process,
+    idlib_watch* watch
+  )
+{
+  unlink_watch(process->watches, watch);
+  idlib_atomic_fetch_sub_u32(&process->number_of_watches, 1);
+}
+
+static void
+free_watch
+  (
+    idlib_watch* watch
+  )
+{
+  free((void*)watch->p);
+  free(watch);
+}
+
+idlib_status
+idlib_watch_impl_create
+  (
+    idlib_watch_set** set
+  )
+{
+  idlib_watch_set* s = malloc(sizeof(idlib_watch_set));
+  if (!s) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  s->lock = 0;
+  for (size_t i = 0; i < IDLIB_WATCH_BUCKETS; ++i) {
+    s->buckets[i] = NULL;
+  }
+  *set = s;
+  return IDLIB_SUCCESS;
+}
+
+void
+idlib_watch_impl_destroy
+  (
+    idlib_watch_set* set
+  )
+{
+  // Blocked threads and notifying threads hold a reference to the singleton, hence only watchers remain.
+  for (size_t i = 0; i < IDLIB_WATCH_BUCKETS; ++i) {
+    while (set->buckets[i]) {
+      idlib_watch* watch = set->buckets[i];
+      set->buckets[i] = watch->next;
+      free_watch(watch);
+    }
+  }
+  free(set);
+}
+
+void
+idlib_watch_impl_notify
+  (
+    idlib_watch_set* set,
+    uint64_t hash,
+    idlib_global_event event,
+    void const* p,
+    size_t n,
+    void* v
+  )
+{
+  lock_set(set);
+  idlib_watch* watch = *get_bucket(set, hash);
+  while (watch) {
+    if (watch->removed || !is_key(watch, hash, p, n)) {
+      watch = watch->next;
+      continue;
+    }
+    if (watch->watcher) {
+      // The watcher is invoked without the lock such that it may watch and unwatch globals.
+      // The reference keeps the watch and hence its successor link valid while the lock is not held.
+      watch->references++;
+      unlock_set(set);
+      watch->watcher(watch->context, event, p, n, v);
+      lock_set(set);
+      idlib_watch* next = watch->next;
+      if (0 == --watch->references && watch->removed) {
+        // The watch was unwatched while it was invoked.
+        unlink_watch(set, watch);
+        free_watch(watch);
+      }
+      watch = next;
+    } else {
+      if (IDLIB_GLOBAL_ADDED == event && 0 == watch->state) {
+        // The blocked thread removes its watch under the lock, hence the watch is valid until the lock is released.
+        watch->v = v;
+        idlib_atomic_store_release_u32(&watch->state, 1);
+        idlib_futex_wake_one(&watch->state);
+      }
+      watch = watch->next;
+    }
+  }
+  unlock_set(set);
+}
+
+static idlib_status
+create_set
+  (
+    void* context
+  )
+{
+  idlib_process* process = (idlib_process*)context;
+  return idlib_watch_impl_create(&process->watches);
+}
+
+idlib_status
+idlib_watch_global
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_watcher* watcher,
+    void* context
+  )
+{
+  if (!process || !p || !watcher) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->watch_once, &create_set, process);
+  if (status) {
+    return status;
+  }
+  idlib_watch* watch = malloc(sizeof(idlib_watch));
+  void* q = malloc(n > 0 ? n : 1);
+  if (!watch || !q) {
+    free(q);
+    free(watch);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  memcpy(q, p, n);
+  watch->hash = idlib_process_hash(p, n);
+  watch->p = q;
+  watch->n = n;
+  watch->watcher = watcher;
+  watch->context = context;
+  watch->references = 0;
+  watch->removed = 0;
+  watch->state = 0;
+  watch->v = NULL;
+  lock_set(process->watches);
+  insert_watch(process, watch);
+  unlock_set(process->watches);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_unwatch_global
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    idlib_global_watcher* watcher,
+    void* context
+  )
+{
+  if (!process || !p || !watcher) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  idlib_status status = idlib_once_call(&process->watch_once, &create_set, process);
+  if (status) {
+    return status;
+  }
+  uint64_t hash = idlib_process_hash(p, n);
+  lock_set(process->watches);
+  idlib_watch* watch = *get_bucket(process->watches, hash);
+  while (watch && (watch->removed || watch->watcher != watcher || watch->context != context || !is_key(watch, hash, p, n))) {
+    watch = watch->next;
+  }
+  if (!watch) {
+    unlock_set(process->watches);
+    return IDLIB_NOT_EXISTS;
+  }
+  if (watch->references) {
+    // The watch is invoked by notifying threads, the last of them frees it.
+    watch->removed = 1;
+    idlib_atomic_fetch_sub_u32(&process->number_of_watches, 1);
+    unlock_set(process->watches);
+    return IDLIB_SUCCESS;
+  }
+  remove_watch(process, watch);
+  unlock_set(process->watches);
+  free_watch(watch);
+  return IDLIB_SUCCESS;
+}
+
+idlib_status
+idlib_wait_global
+  (
+    idlib_process* process,
+    void const* p,
+    size_t n,
+    uint64_t deadline,
+    void** v
+  )
+{
+  if (!process || !p || !v) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  // Fast path: the global exists.
+  idlib_status status = idlib_get_global(process, p, n, v);
+  if (IDLIB_NOT_EXISTS != status) {
+    return status;
+  }
+  status = idlib_once_call(&process->watch_once, &create_set, process);
+  if (status) {
+    return status;
+  }
+  idlib_watch watch;
+  watch.hash = idlib_process_hash(p, n);
+  watch.p = p;
+  watch.n = n;
+  watch.watcher = NULL;
+  watch.context = NULL;
+  watch.references = 0;
+  watch.removed = 0;
+  watch.state = 0;
+  watch.v = NULL;
+  lock_set(process->watches);
+  insert_watch(process, &watch);
+  unlock_set(process->watches);
+  // The number of watches was incremented before the entries are examined and the thread adding a global
+  // examines the number of watches after it inserted the global, both separated by a full fence.
+  // Hence either the global is found or the thread adding it observes the watch and notifies it.
+  idlib_atomic_fence();
+  status = idlib_get_global(process, p, n, v);
+  if (IDLIB_NOT_EXISTS == status) {
+    status = IDLIB_SUCCESS;
+    while (0 == idlib_atomic_load_acquire_u32(&watch.state)) {
+      uint64_t now = idlib_clock_now();
+      if (now >= deadline) {
+        status = IDLIB_TIMED_OUT;
+        break;
+      }
+      idlib_futex_wait_for(&watch.state, 0, deadline - now);
+    }
+  }
+  lock_set(process->watches);
+  remove_watch(process, &watch);
+  unlock_set(process->watches);
+  if (IDLIB_TIMED_OUT == status && 1 == watch.state) {
+    // A global of the key was added after the deadline passed but before the watch was removed.
+    status = IDLIB_SUCCESS;
+  }
+  if (!status && 1 == watch.state) {
+    *v = watch.v;
+  }
+  return status;
+}
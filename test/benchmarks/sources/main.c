@@ -0,0 +1,648 @@
+/*
+  IdLib Process
+  Copyright (C) 2023-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process.h"
+
+#include "harness.h"
+
+// EXIT_SUCCESS, EXIT_FAILURE
+#include <stdlib.h>
+
+// fprintf, snprintf, stderr, stdout, fopen, fclose
+#include <stdio.h>
+
+// malloc, free
+#include <malloc.h>
+
+// strcmp, strlen
+#include <string.h>
+
+// Benchmarks of the primitives of this library.
+// The results are written as JSON (default) or CSV such that they can be compared between releases.
+//
+// Command-line arguments:
+// --profile=quick|full  The "quick" profile performs few iterations and is used by CTest. Default is "full".
+// --format=json|csv     The output format. Default is "json".
+// --output=<path>       The output file. Default is the standard output.
+// --threads=<n>         The maximum number of threads. Default is the number of logical processors.
+// --iterations=<n>      The number of iterations per thread.
+// --max-entries=<n>     The maximum number of entries in the registry.
+
+typedef struct result {
+  char const* name;
+  size_t threads;
+  size_t entries;
+  uint64_t operations;
+  uint64_t elapsed;
+} result;
+
+typedef struct results {
+  result* elements;
+  size_t size;
+  size_t capacity;
+} results;
+
+typedef struct configuration {
+  size_t max_threads;
+  size_t iterations;
+  size_t max_entries;
+} configuration;
+
+static idlib_status
+results_append
+  (
+    results* results,
+    char const* name,
+    size_t threads,
+    size_t entries,
+    uint64_t operations,
+    uint64_t elapsed
+  )
+{
+  if (results->size == results->capacity) {
+    size_t new_capacity = results->capacity ? results->capacity * 2 : 32;
+    result* new_elements = realloc(results->elements, sizeof(result) * new_capacity);
+    if (!new_elements) {
+      return IDLIB_ALLOCATION_FAILED;
+    }
+    results->elements = new_elements;
+    results->capacity = new_capacity;
+  }
+  result* r = &results->elements[results->size++];
+  r->name = name;
+  r->threads = threads;
+  r->entries = entries;
+  r->operations = operations;
+  r->elapsed = elapsed;
+  fprintf(stderr, "%-40s threads = %4zu entries = %8zu ns/op = %10.2f\n", name, threads, entries,
+          operations ? (double)elapsed * (double)threads / (double)operations : 0.0);
+  return IDLIB_SUCCESS;
+}
+
+// The thread counts are 1, 2, 4, ... up to and including the maximum number of threads.
+static size_t
+next_number_of_threads
+  (
+    size_t current,
+    size_t maximum
+  )
+{
+  if (current == maximum) {
+    return 0;
+  }
+  return current * 2 < maximum ? current * 2 : maximum;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+typedef struct acquire_relinquish_context {
+  size_t iterations;
+  volatile int failed;
+} acquire_relinquish_context;
+
+static void
+acquire_relinquish_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  acquire_relinquish_context* context = (acquire_relinquish_context*)argument;
+  for (size_t i = 0; i < context->iterations; ++i) {
+    idlib_process* process = NULL;
+    if (idlib_process_acquire(&process)) {
+      context->failed = 1;
+      return;
+    }
+    idlib_process_relinquish(process);
+  }
+}
+
+static idlib_status
+benchmark_acquire_relinquish
+  (
+    configuration const* configuration,
+    results* results
+  )
+{
+  // Keep a reference such that the singleton is not created and destroyed in every iteration.
+  idlib_process* process = NULL;
+  idlib_status status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t n = 1; n; n = next_number_of_threads(n, configuration->max_threads)) {
+    acquire_relinquish_context context = { .iterations = configuration->iterations, .failed = 0 };
+    uint64_t elapsed;
+    status = harness_run(n, &acquire_relinquish_procedure, &context, &elapsed);
+    if (!status && context.failed) {
+      status = IDLIB_ENVIRONMENT_FAILED;
+    }
+    if (!status) {
+      status = results_append(results, "process.acquire_relinquish", n, 0, (uint64_t)n * context.iterations, elapsed);
+    }
+    if (status) {
+      break;
+    }
+  }
+  idlib_process_relinquish(process);
+  return status;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+typedef struct mutex_context {
+  size_t iterations;
+  // If shared is non-zero, all threads lock mutexes[0], otherwise thread i locks mutexes[i].
+  int shared;
+  idlib_mutex* mutexes;
+  volatile int failed;
+} mutex_context;
+
+static void
+mutex_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  mutex_context* context = (mutex_context*)argument;
+  idlib_mutex* mutex = context->shared ? &context->mutexes[0] : &context->mutexes[index];
+  for (size_t i = 0; i < context->iterations; ++i) {
+    if (idlib_mutex_lock(mutex)) {
+      context->failed = 1;
+      return;
+    }
+    idlib_mutex_unlock(mutex);
+  }
+}
+
+static idlib_status
+benchmark_mutex
+  (
+    configuration const* configuration,
+    results* results,
+    int shared
+  )
+{
+  idlib_status status = IDLIB_SUCCESS;
+  idlib_mutex* mutexes = malloc(sizeof(idlib_mutex) * configuration->max_threads);
+  if (!mutexes) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  size_t number_of_mutexes = 0;
+  for (; number_of_mutexes < configuration->max_threads; ++number_of_mutexes) {
+    status = idlib_mutex_initialize(&mutexes[number_of_mutexes]);
+    if (status) {
+      break;
+    }
+  }
+  for (size_t n = 1; n && !status; n = next_number_of_threads(n, configuration->max_threads)) {
+    mutex_context context = { .iterations = configuration->iterations, .shared = shared, .mutexes = mutexes, .failed = 0 };
+    uint64_t elapsed;
+    status = harness_run(n, &mutex_procedure, &context, &elapsed);
+    if (!status && context.failed) {
+      status = IDLIB_LOCK_FAILED;
+    }
+    if (!status) {
+      status = results_append(results, shared ? "mutex.lock_unlock.contended" : "mutex.lock_unlock.uncontended",
+                              n, 0, (uint64_t)n * context.iterations, elapsed);
+    }
+  }
+  while (number_of_mutexes > 0) {
+    idlib_mutex_uninitialize(&mutexes[--number_of_mutexes]);
+  }
+  free(mutexes);
+  mutexes = NULL;
+  return status;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+typedef struct ping_pong_context {
+  size_t round_trips;
+  idlib_mutex mutex;
+  idlib_condition condition;
+  // The index of the thread whose turn it is.
+  size_t turn;
+} ping_pong_context;
+
+static void
+ping_pong_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  ping_pong_context* context = (ping_pong_context*)argument;
+  idlib_mutex_lock(&context->mutex);
+  for (size_t i = 0; i < context->round_trips; ++i) {
+    while (context->turn != index) {
+      idlib_condition_wait(&context->condition, &context->mutex);
+    }
+    context->turn = 1 - index;
+    idlib_condition_signal_one(&context->condition);
+  }
+  idlib_mutex_unlock(&context->mutex);
+}
+
+static idlib_status
+benchmark_condition_ping_pong
+  (
+    configuration const* configuration,
+    results* results
+  )
+{
+  ping_pong_context context;
+  context.round_trips = configuration->iterations / 10 > 0 ? configuration->iterations / 10 : 1;
+  context.turn = 0;
+  idlib_status status = idlib_mutex_initialize(&context.mutex);
+  if (status) {
+    return status;
+  }
+  status = idlib_condition_initialize(&context.condition);
+  if (status) {
+    idlib_mutex_uninitialize(&context.mutex);
+    return status;
+  }
+  uint64_t elapsed;
+  status = harness_run(2, &ping_pong_procedure, &context, &elapsed);
+  if (!status) {
+    // Each round trip consists of two hand-offs. We report the latency of a single hand-off.
+    status = results_append(results, "condition.ping_pong", 1, 0, 2 * (uint64_t)context.round_trips, elapsed);
+  }
+  idlib_condition_uninitialize(&context.condition);
+  idlib_mutex_uninitialize(&context.mutex);
+  return status;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// The longest prefix "missing-", at most 20 digits of a size_t, and the zero terminator.
+#define KEY_CAPACITY (29)
+
+static void
+make_key
+  (
+    char* key,
+    char const* prefix,
+    size_t index
+  )
+{
+  snprintf(key, KEY_CAPACITY, "%s%zu", prefix, index);
+}
+
+// The operations of the registry benchmarks.
+#define REGISTRY_ADD (0)
+#define REGISTRY_GET_EXISTING (1)
+#define REGISTRY_GET_MISSING (2)
+#define REGISTRY_REMOVE (3)
+
+typedef struct registry_context {
+  idlib_process* process;
+  // The keys added, got, and removed, KEY_CAPACITY Bytes each.
+  char const* keys;
+  // The keys which are not added, KEY_CAPACITY Bytes each.
+  char const* missing_keys;
+  size_t number_of_keys;
+  size_t number_of_threads;
+  int operation;
+  volatile int failed;
+} registry_context;
+
+static void
+registry_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  registry_context* context = (registry_context*)argument;
+  void* v;
+  if (REGISTRY_ADD == context->operation || REGISTRY_REMOVE == context->operation) {
+    // Thread i adds or removes the keys i, i + n, i + 2n, ... where n is the number of threads.
+    for (size_t i = index; i < context->number_of_keys; i += context->number_of_threads) {
+      char const* key = context->keys + i * KEY_CAPACITY;
+      if (REGISTRY_ADD == context->operation ? idlib_add_global(context->process, key, strlen(key), (void*)key)
+                                             : idlib_remove_global(context->process, key, strlen(key))) {
+        context->failed = 1;
+        return;
+      }
+    }
+  } else {
+    // Each thread gets all keys, starting at a different key.
+    for (size_t i = 0; i < context->number_of_keys; ++i) {
+      size_t j = (i + index * context->number_of_keys / context->number_of_threads) % context->number_of_keys;
+      if (REGISTRY_GET_EXISTING == context->operation) {
+        char const* key = context->keys + j * KEY_CAPACITY;
+        if (idlib_get_global(context->process, key, strlen(key), &v)) {
+          context->failed = 1;
+          return;
+        }
+      } else {
+        char const* key = context->missing_keys + j * KEY_CAPACITY;
+        if (IDLIB_NOT_EXISTS != idlib_get_global(context->process, key, strlen(key), &v)) {
+          context->failed = 1;
+          return;
+        }
+      }
+    }
+  }
+}
+
+static idlib_status
+benchmark_registry
+  (
+    configuration const* configuration,
+    results* results
+  )
+{
+  static char const* names[] = { "registry.add", "registry.get.existing", "registry.get.missing", "registry.remove" };
+  idlib_process* process = NULL;
+  idlib_status status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  char* keys = malloc(KEY_CAPACITY * configuration->max_entries);
+  char* missing_keys = malloc(KEY_CAPACITY * configuration->max_entries);
+  if (!keys || !missing_keys) {
+    free(missing_keys);
+    free(keys);
+    idlib_process_relinquish(process);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  for (size_t i = 0; i < configuration->max_entries; ++i) {
+    make_key(keys + i * KEY_CAPACITY, "key-", i);
+    make_key(missing_keys + i * KEY_CAPACITY, "missing-", i);
+  }
+  for (size_t n = 10; n <= configuration->max_entries && !status; n *= 10) {
+    for (size_t t = 1; t && !status; t = next_number_of_threads(t, configuration->max_threads)) {
+      // The keys are added, got, and removed such that the registry is empty after each thread count.
+      for (int operation = REGISTRY_ADD; operation <= REGISTRY_REMOVE && !status; ++operation) {
+        registry_context context = { .process = process, .keys = keys, .missing_keys = missing_keys, .number_of_keys = n,
+                                     .number_of_threads = t, .operation = operation, .failed = 0 };
+        uint64_t elapsed;
+        status = harness_run(t, &registry_procedure, &context, &elapsed);
+        if (!status && context.failed) {
+          status = IDLIB_ENVIRONMENT_FAILED;
+        }
+        if (!status) {
+          uint64_t operations = REGISTRY_ADD == operation || REGISTRY_REMOVE == operation ? n : (uint64_t)n * t;
+          status = results_append(results, names[operation], t, n, operations, elapsed);
+        }
+      }
+    }
+  }
+  free(missing_keys);
+  missing_keys = NULL;
+  free(keys);
+  keys = NULL;
+  idlib_process_relinquish(process);
+  return status;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// The number of counters updated by an operation. They span several cache lines.
+#define NUMBER_OF_COUNTERS (32)
+
+typedef struct combining_context {
+  size_t iterations;
+  // If combining is non-zero, the operations are applied under the combining lock, otherwise under the mutex.
+  int combining;
+  idlib_combining_lock lock;
+  idlib_mutex mutex;
+  // Guarded by the lock or the mutex.
+  uint64_t counters[NUMBER_OF_COUNTERS];
+  volatile int failed;
+} combining_context;
+
+static void
+combining_operation
+  (
+    void* argument
+  )
+{
+  combining_context* context = (combining_context*)argument;
+  for (size_t i = 0; i < NUMBER_OF_COUNTERS; ++i) {
+    context->counters[i]++;
+  }
+}
+
+static void
+combining_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  combining_context* context = (combining_context*)argument;
+  for (size_t i = 0; i < context->iterations; ++i) {
+    if (context->combining) {
+      if (idlib_combining_lock_apply(&context->lock, &combining_operation, context)) {
+        context->failed = 1;
+        return;
+      }
+    } else {
+      if (idlib_mutex_lock(&context->mutex)) {
+        context->failed = 1;
+        return;
+      }
+      combining_operation(context);
+      idlib_mutex_unlock(&context->mutex);
+    }
+  }
+}
+
+// The same operation on shared data applied by all threads under a mutex and under a combining lock.
+static idlib_status
+benchmark_combining_lock
+  (
+    configuration const* configuration,
+    results* results
+  )
+{
+  static combining_context context;
+  idlib_status status = idlib_combining_lock_initialize(&context.lock);
+  if (status) {
+    return status;
+  }
+  status = idlib_mutex_initialize(&context.mutex);
+  if (status) {
+    idlib_combining_lock_uninitialize(&context.lock);
+    return status;
+  }
+  for (int combining = 0; combining < 2 && !status; ++combining) {
+    for (size_t n = 1; n && !status; n = next_number_of_threads(n, configuration->max_threads)) {
+      uint64_t elapsed;
+      context.iterations = configuration->iterations;
+      context.combining = combining;
+      context.failed = 0;
+      for (size_t i = 0; i < NUMBER_OF_COUNTERS; ++i) {
+        context.counters[i] = 0;
+      }
+      status = harness_run(n, &combining_procedure, &context, &elapsed);
+      if (!status && (context.failed || context.counters[NUMBER_OF_COUNTERS - 1] != (uint64_t)n * context.iterations)) {
+        status = IDLIB_LOCK_FAILED;
+      }
+      if (!status) {
+        status = results_append(results, combining ? "combining_lock.apply.contended" : "mutex.apply.contended",
+                                n, 0, (uint64_t)n * context.iterations, elapsed);
+      }
+    }
+  }
+  idlib_mutex_uninitialize(&context.mutex);
+  idlib_combining_lock_uninitialize(&context.lock);
+  return status;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+static void
+write_results
+  (
+    FILE* file,
+    results const* results,
+    int csv
+  )
+{
+  if (csv) {
+    fprintf(file, "name,threads,entries,operations,elapsed_ns,ns_per_op,ops_per_s\n");
+  } else {
+    fprintf(file, "{\n  \"benchmarks\": [\n");
+  }
+  for (size_t i = 0; i < results->size; ++i) {
+    result const* r = &results->elements[i];
+    double ns_per_op = r->operations ? (double)r->elapsed * (double)r->threads / (double)r->operations : 0.0;
+    double ops_per_s = r->elapsed ? (double)r->operations * 1e9 / (double)r->elapsed : 0.0;
+    if (csv) {
+      fprintf(file, "%s,%zu,%zu,%llu,%llu,%.3f,%.1f\n", r->name, r->threads, r->entries,
+              (unsigned long long)r->operations, (unsigned long long)r->elapsed, ns_per_op, ops_per_s);
+    } else {
+      fprintf(file, "    { \"name\": \"%s\", \"threads\": %zu, \"entries\": %zu, \"operations\": %llu, \"elapsed_ns\": %llu, \"ns_per_op\": %.3f, \"ops_per_s\": %.1f }%s\n",
+              r->name, r->threads, r->entries, (unsigned long long)r->operations, (unsigned long long)r->elapsed,
+              ns_per_op, ops_per_s, i + 1 < results->size ? "," : "");
+    }
+  }
+  if (!csv) {
+    fprintf(file, "  ]\n}\n");
+  }
+}
+
+int
+main
+  (
+    int argc,
+    char** argv
+  )
+{
+  configuration configuration = {
+    .max_threads = harness_processor_count(),
+    .iterations = 1000000,
+#if (IDLIB_PROCESS_REGISTRY == IDLIB_PROCESS_REGISTRY_HASH)
+    .max_entries = 1000000,
+#else
+    // The operations of the list registry take linear time.
+    .max_entries = 100000,
+#endif
+  };
+  char const* format = "json";
+  char const* output = NULL;
+  char const* profile = "full";
+  size_t max_threads = 0, iterations = 0, max_entries = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (harness_parse_string(argv[i], "--profile", &profile) ||
+        harness_parse_string(argv[i], "--format", &format) ||
+        harness_parse_string(argv[i], "--output", &output) ||
+        harness_parse_size(argv[i], "--threads", &max_threads) ||
+        harness_parse_size(argv[i], "--iterations", &iterations) ||
+        harness_parse_size(argv[i], "--max-entries", &max_entries)) {
+      continue;
+    }
+    fprintf(stderr, "%s:%d: unknown or invalid argument `%s`\n", __FILE__, __LINE__, argv[i]);
+    return EXIT_FAILURE;
+  }
+  if (!strcmp(profile, "quick")) {
+    configuration.max_threads = configuration.max_threads < 2 ? configuration.max_threads : 2;
+    configuration.iterations = 10000;
+    configuration.max_entries = 1000;
+  } else if (strcmp(profile, "full")) {
+    fprintf(stderr, "%s:%d: unknown profile `%s`\n", __FILE__, __LINE__, profile);
+    return EXIT_FAILURE;
+  }
+  if (max_threads) {
+    configuration.max_threads = max_threads;
+  }
+  if (iterations) {
+    configuration.iterations = iterations;
+  }
+  if (max_entries) {
+    configuration.max_entries = max_entries;
+  }
+  if (strcmp(format, "json") && strcmp(format, "csv")) {
+    fprintf(stderr, "%s:%d: unknown format `%s`\n", __FILE__, __LINE__, format);
+    return EXIT_FAILURE;
+  }
+
+  results results = { .elements = NULL, .size = 0, .capacity = 0 };
+  idlib_status status = IDLIB_SUCCESS;
+  if (!status) {
+    status = benchmark_acquire_relinquish(&configuration, &results);
+  }
+  if (!status) {
+    status = benchmark_registry(&configuration, &results);
+  }
+  if (!status) {
+    status = benchmark_mutex(&configuration, &results, 0);
+  }
+  if (!status) {
+    status = benchmark_mutex(&configuration, &results, 1);
+  }
+  if (!status) {
+    status = benchmark_condition_ping_pong(&configuration, &results);
+  }
+  if (!status) {
+    status = benchmark_combining_lock(&configuration, &results);
+  }
+  if (status) {
+    fprintf(stderr, "%s:%d: benchmark failed with status %u\n", __FILE__, __LINE__, (unsigned)status);
+    free(results.elements);
+    return EXIT_FAILURE;
+  }
+
+  FILE* file = stdout;
+  if (output) {
+    file = fopen(output, "w");
+    if (!file) {
+      fprintf(stderr, "%s:%d: unable to open `%s`\n", __FILE__, __LINE__, output);
+      free(results.elements);
+      return EXIT_FAILURE;
+    }
+  }
+  write_results(file, &results, !strcmp(format, "csv"));
+  if (file != stdout) {
+    fclose(file);
+  }
+  free(results.elements);
+  results.elements = NULL;
+  return EXIT_SUCCESS;
+}
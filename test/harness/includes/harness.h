@@ -0,0 +1,110 @@
+/*
+  IdLib Process
+  Copyright (C) 2023-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#if !defined(IDLIB_PROCESS_TEST_HARNESS_H_INCLUDED)
+#define IDLIB_PROCESS_TEST_HARNESS_H_INCLUDED
+
+#include "idlib/process.h"
+
+// size_t
+#include <stddef.h>
+
+// uint64_t
+#include <stdint.h>
+
+// Support code shared by the benchmark and the stress executables.
+
+/**
+ * @brief The type of a procedure executed by a harness thread.
+ * @param argument The argument passed to harness_run.
+ * @param index The zero-based index of the thread in [0, number_of_threads).
+ */
+typedef void (harness_procedure)(void* argument, size_t index);
+
+/**
+ * @brief Get the value of a monotonic clock.
+ * @return The value of the clock in nanoseconds.
+ */
+uint64_t
+harness_now_ns
+  (
+  );
+
+/**
+ * @brief Get the number of logical processors available to this process.
+ * @return The number of logical processors. At least 1.
+ */
+size_t
+harness_processor_count
+  (
+  );
+
+/**
+ * @brief Run a procedure concurrently on the specified number of threads.
+ * All threads are released at the same time.
+ * @param number_of_threads The number of threads. Must be positive.
+ * @param procedure The procedure.
+ * @param argument The argument to pass to the procedure.
+ * @param elapsed [out] A pointer to a <code>uint64_t</code> variable.
+ * @return #IDLIB_SUCCESS on success. A non-zero return value on failure.
+ * @success <code>*elapsed</code> was assigned the wall clock time in nanoseconds between the release of the threads and the termination of the last thread.
+ */
+idlib_status
+harness_run
+  (
+    size_t number_of_threads,
+    harness_procedure* procedure,
+    void* argument,
+    uint64_t* elapsed
+  );
+
+/**
+ * @brief Parse a command-line argument of the form <code>--name=value</code> where value is a non-negative integer.
+ * @param argument The command-line argument.
+ * @param name The name including the leading <code>--</code>.
+ * @param value [out] A pointer to a <code>size_t</code> variable.
+ * @return 1 if the argument matched, 0 otherwise.
+ */
+int
+harness_parse_size
+  (
+    char const* argument,
+    char const* name,
+    size_t* value
+  );
+
+/**
+ * @brief Parse a command-line argument of the form <code>--name=value</code>.
+ * @param argument The command-line argument.
+ * @param name The name including the leading <code>--</code>.
+ * @param value [out] A pointer to a <code>char const*</code> variable.
+ * @return 1 if the argument matched, 0 otherwise.
+ */
+int
+harness_parse_string
+  (
+    char const* argument,
+    char const* name,
+    char const** value
+  );
+
+#endif // IDLIB_PROCESS_TEST_HARNESS_H_INCLUDED
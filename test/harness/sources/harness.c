@@ -0,0 +1,277 @@
+/*
+  IdLib Process
+  Copyright (C) 2023-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "harness.h"
+
+// malloc, free
+#include <malloc.h>
+
+// strlen, strncmp
+#include <string.h>
+
+// strtoull
+#include <stdlib.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  #include <pthread.h>
+  #include <time.h>
+  #include <unistd.h>
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+typedef struct gate {
+  idlib_mutex mutex;
+  idlib_condition condition;
+  size_t ready;
+  int open;
+} gate;
+
+typedef struct thread_context {
+  gate* gate;
+  harness_procedure* procedure;
+  void* argument;
+  size_t index;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  pthread_t thread;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  HANDLE thread;
+#else
+  #error("operating system not (yet) supported")
+#endif
+} thread_context;
+
+static void
+thread_main
+  (
+    thread_context* context
+  )
+{
+  idlib_mutex_lock(&context->gate->mutex);
+  context->gate->ready++;
+  idlib_condition_signal_all(&context->gate->condition);
+  while (!context->gate->open) {
+    idlib_condition_wait(&context->gate->condition, &context->gate->mutex);
+  }
+  idlib_mutex_unlock(&context->gate->mutex);
+  context->procedure(context->argument, context->index);
+}
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+
+static void*
+thread_entry
+  (
+    void* argument
+  )
+{
+  thread_main((thread_context*)argument);
+  return NULL;
+}
+
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+
+static DWORD WINAPI
+thread_entry
+  (
+    LPVOID argument
+  )
+{
+  thread_main((thread_context*)argument);
+  return 0;
+}
+
+#else
+  #error("operating system not (yet) supported")
+#endif
+
+uint64_t
+harness_now_ns
+  (
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  static LARGE_INTEGER frequency = { 0 };
+  if (!frequency.QuadPart) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return (uint64_t)((double)now.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+size_t
+harness_processor_count
+  (
+  )
+{
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (size_t)count : 1;
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+  #error("operating system not (yet) supported")
+#endif
+}
+
+idlib_status
+harness_run
+  (
+    size_t number_of_threads,
+    harness_procedure* procedure,
+    void* argument,
+    uint64_t* elapsed
+  )
+{
+  if (!number_of_threads || !procedure || !elapsed) {
+    return IDLIB_ARGUMENT_INVALID;
+  }
+  gate gate;
+  gate.ready = 0;
+  gate.open = 0;
+  idlib_status status = idlib_mutex_initialize(&gate.mutex);
+  if (status) {
+    return status;
+  }
+  status = idlib_condition_initialize(&gate.condition);
+  if (status) {
+    idlib_mutex_uninitialize(&gate.mutex);
+    return status;
+  }
+  thread_context* contexts = malloc(sizeof(thread_context) * number_of_threads);
+  if (!contexts) {
+    idlib_condition_uninitialize(&gate.condition);
+    idlib_mutex_uninitialize(&gate.mutex);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  size_t number_of_started_threads = 0;
+  for (size_t i = 0; i < number_of_threads; ++i) {
+    contexts[i].gate = &gate;
+    contexts[i].procedure = procedure;
+    contexts[i].argument = argument;
+    contexts[i].index = i;
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    if (pthread_create(&contexts[i].thread, NULL, &thread_entry, &contexts[i])) {
+      status = IDLIB_ENVIRONMENT_FAILED;
+      break;
+    }
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+    contexts[i].thread = CreateThread(NULL, 0, &thread_entry, &contexts[i], 0, NULL);
+    if (!contexts[i].thread) {
+      status = IDLIB_ENVIRONMENT_FAILED;
+      break;
+    }
+#else
+  #error("operating system not (yet) supported")
+#endif
+    number_of_started_threads++;
+  }
+  // Wait until all started threads are waiting at the gate, then open the gate.
+  idlib_mutex_lock(&gate.mutex);
+  while (gate.ready < number_of_started_threads) {
+    idlib_condition_wait(&gate.condition, &gate.mutex);
+  }
+  uint64_t start = harness_now_ns();
+  gate.open = 1;
+  idlib_condition_signal_all(&gate.condition);
+  idlib_mutex_unlock(&gate.mutex);
+  for (size_t i = 0; i < number_of_started_threads; ++i) {
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)  || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_CYGWIN) || \
+    (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_MACOS)
+    pthread_join(contexts[i].thread, NULL);
+#elif (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+    WaitForSingleObject(contexts[i].thread, INFINITE);
+    CloseHandle(contexts[i].thread);
+#else
+  #error("operating system not (yet) supported")
+#endif
+  }
+  *elapsed = harness_now_ns() - start;
+  free(contexts);
+  contexts = NULL;
+  idlib_condition_uninitialize(&gate.condition);
+  idlib_mutex_uninitialize(&gate.mutex);
+  return status;
+}
+
+int
+harness_parse_size
+  (
+    char const* argument,
+    char const* name,
+    size_t* value
+  )
+{
+  char const* string;
+  if (!harness_parse_string(argument, name, &string)) {
+    return 0;
+  }
+  char* end;
+  unsigned long long temporary = strtoull(string, &end, 10);
+  if (end == string || *end != '\0') {
+    return 0;
+  }
+  *value = (size_t)temporary;
+  return 1;
+}
+
+int
+harness_parse_string
+  (
+    char const* argument,
+    char const* name,
+    char const** value
+  )
+{
+  size_t n = strlen(name);
+  if (strncmp(argument, name, n) || argument[n] != '=') {
+    return 0;
+  }
+  *value = argument + n + 1;
+  return 1;
+}
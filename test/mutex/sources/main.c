@@ -65,6 +65,45 @@ test1
   return IDLIB_SUCCESS;
 }
 
+// Lock a mutex recursively.
+static int
+test2
+  (
+  )
+{
+  idlib_status status;
+  idlib_mutex mutex;
+
+  status = idlib_mutex_initialize(&mutex);
+  if (status) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return status;
+  }
+  for (int i = 0; i < 3; ++i) {
+    status = idlib_mutex_lock(&mutex);
+    if (status) {
+      fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+      idlib_mutex_uninitialize(&mutex);
+      return status;
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    status = idlib_mutex_unlock(&mutex);
+    if (status) {
+      fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+      idlib_mutex_uninitialize(&mutex);
+      return status;
+    }
+  }
+  status = idlib_mutex_uninitialize(&mutex);
+  if (status) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return status;
+  }
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
 int
 main
   (
@@ -75,6 +114,9 @@ main
   if (test1()) {
     return EXIT_FAILURE;
   }
+  if (test2()) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
 
@@ -23,6 +23,21 @@
 
 #include <stdlib.h>
 
+// remove
+#include <stdio.h>
+
+// strcmp
+#include <string.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // O_CREAT, O_EXCL, O_RDWR
+  #include <fcntl.h>
+  // shm_open
+  #include <sys/mman.h>
+  // close, ftruncate
+  #include <unistd.h>
+#endif
+
 static int
 test1
   (
@@ -45,6 +60,725 @@ test1
   return IDLIB_SUCCESS;
 }
 
+// Register a metric, update it, and obtain a snapshot.
+static int
+test2
+  (
+  )
+{
+  static idlib_metric metric = IDLIB_METRIC_INITIALIZER;
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  status = idlib_metric_register(process, &metric, "test.metric", IDLIB_METRIC_KIND_COUNTER);
+  if (status) {
+    idlib_process_relinquish(process);
+    return status;
+  }
+  if (IDLIB_EXISTS != idlib_metric_register(process, &metric, "test.metric", IDLIB_METRIC_KIND_COUNTER)) {
+    idlib_metric_unregister(process, &metric);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_metric_add(&metric, 3);
+  idlib_metric_add(&metric, 4);
+  idlib_metric* found = NULL;
+  status = idlib_metric_find(process, "test.metric", &found);
+  if (status || found != &metric || 7 != idlib_metric_get(found)) {
+    idlib_metric_unregister(process, &metric);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  size_t count = 0;
+  if (IDLIB_TOO_SMALL != idlib_metrics_snapshot(process, NULL, 0, &count) || count < 1) {
+    idlib_metric_unregister(process, &metric);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_metric_value* values = malloc(sizeof(idlib_metric_value) * count);
+  if (!values) {
+    idlib_metric_unregister(process, &metric);
+    idlib_process_relinquish(process);
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  status = idlib_metrics_snapshot(process, values, count, &count);
+  int found_in_snapshot = 0;
+  for (size_t i = 0; !status && i < count; ++i) {
+    if (!strcmp(values[i].name, "test.metric") && 7 == values[i].value) {
+      found_in_snapshot = 1;
+    }
+  }
+  free(values);
+  values = NULL;
+  if (status || !found_in_snapshot) {
+    idlib_metric_unregister(process, &metric);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  status = idlib_metric_unregister(process, &metric);
+  if (status) {
+    idlib_process_relinquish(process);
+    return status;
+  }
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+  // The library registers its metrics with the singleton.
+  if (idlib_metric_find(process, "idlib.process.acquire", &found) || idlib_metric_get(found) < 1) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#endif
+  if (IDLIB_NOT_EXISTS != idlib_metric_find(process, "test.metric", &found)) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  status = idlib_process_relinquish(process);
+  if (status) {
+    return status;
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Add, get, and remove enough entries such that a hash registry must grow.
+static int
+test3
+  (
+  )
+{
+  static int values[1024];
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < 1024; ++i) {
+    status = idlib_add_global(process, &i, sizeof(size_t), &values[i]);
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  for (size_t i = 0; i < 1024; ++i) {
+    void* v = NULL;
+    status = idlib_get_global(process, &i, sizeof(size_t), &v);
+    if (status || v != &values[i]) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  size_t i = 0;
+  if (IDLIB_EXISTS != idlib_add_global(process, &i, sizeof(size_t), &values[0])) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < 1024; i += 2) {
+    status = idlib_remove_global(process, &i, sizeof(size_t));
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  for (size_t i = 0; i < 1024; ++i) {
+    void* v = NULL;
+    status = idlib_get_global(process, &i, sizeof(size_t), &v);
+    if ((i % 2 == 0 && IDLIB_NOT_EXISTS != status) || (i % 2 == 1 && IDLIB_SUCCESS != status)) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  // The remaining entries are removed when the singleton is destroyed.
+  status = idlib_process_relinquish(process);
+  if (status) {
+    return status;
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Freeze entries, add entries to the overlay, and freeze again.
+static int
+test4
+  (
+  )
+{
+  static int values[512];
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < 256; ++i) {
+    status = idlib_add_global(process, &i, sizeof(size_t), &values[i]);
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  status = idlib_process_freeze_globals(process);
+  if (status) {
+    idlib_process_relinquish(process);
+    return status;
+  }
+  for (size_t i = 256; i < 512; ++i) {
+    status = idlib_add_global(process, &i, sizeof(size_t), &values[i]);
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  size_t i = 0;
+  if (IDLIB_EXISTS != idlib_add_global(process, &i, sizeof(size_t), &values[0]) ||
+      IDLIB_OPERATION_INVALID != idlib_remove_global(process, &i, sizeof(size_t))) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // Remove an entry from the overlay and freeze the remaining overlay entries.
+  i = 511;
+  status = idlib_remove_global(process, &i, sizeof(size_t));
+  if (!status) {
+    status = idlib_process_freeze_globals(process);
+  }
+  if (status) {
+    idlib_process_relinquish(process);
+    return status;
+  }
+  for (size_t i = 0; i < 512; ++i) {
+    void* v = NULL;
+    status = idlib_get_global(process, &i, sizeof(size_t), &v);
+    if ((i < 511 && (status || v != &values[i])) || (i == 511 && IDLIB_NOT_EXISTS != status)) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  status = idlib_process_relinquish(process);
+  if (status) {
+    return status;
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Get missing keys before and after enough removes to rebuild the filter of the registry.
+static int
+test5
+  (
+  )
+{
+  static int values[256];
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < 256; ++i) {
+    status = idlib_add_global(process, &i, sizeof(size_t), &values[i]);
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  for (size_t i = 0; i < 200; ++i) {
+    status = idlib_remove_global(process, &i, sizeof(size_t));
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  for (size_t i = 0; i < 1024; ++i) {
+    void* v = NULL;
+    status = idlib_get_global(process, &i, sizeof(size_t), &v);
+    if ((200 <= i && i < 256 && (status || v != &values[i])) || ((i < 200 || 256 <= i) && IDLIB_NOT_EXISTS != status)) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+#if 1 == IDLIB_PROCESS_WITH_METRICS
+  // Most missing keys are rejected by the filter.
+  idlib_metric* found = NULL;
+  if (idlib_metric_find(process, "idlib.registry.filter.reject", &found) || idlib_metric_get(found) < 512) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#endif
+  status = idlib_process_relinquish(process);
+  if (status) {
+    return status;
+  }
+  return IDLIB_SUCCESS;
+}
+
+static void
+destroy_value
+  (
+    void* v
+  )
+{
+  (*(int*)v)++;
+}
+
+// Remove a global while a reference to it is held.
+static int
+test6
+  (
+  )
+{
+  static int destroyed[2] = { 0, 0 };
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < 2; ++i) {
+    status = idlib_add_global_with_destructor(process, &i, sizeof(size_t), &destroyed[i], &destroy_value);
+    if (status) {
+      idlib_process_relinquish(process);
+      return status;
+    }
+  }
+  size_t i = 0;
+  idlib_global_ref* ref = NULL;
+  void* v = NULL;
+  status = idlib_get_global_ref(process, &i, sizeof(size_t), &ref, &v);
+  if (status || v != &destroyed[0]) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  status = idlib_remove_global(process, &i, sizeof(size_t));
+  if (status || 0 != destroyed[0] || IDLIB_NOT_EXISTS != idlib_get_global(process, &i, sizeof(size_t), &v)) {
+    idlib_global_ref_release(ref);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // The value is destroyed when the last reference is released.
+  idlib_global_ref_release(ref);
+  if (1 != destroyed[0]) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // The remaining value is destroyed when the singleton is destroyed.
+  status = idlib_process_relinquish(process);
+  if (status) {
+    return status;
+  }
+  if (1 != destroyed[1]) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  return IDLIB_SUCCESS;
+}
+
+// Add entries to a shared registry through one mapping and get them through another mapping.
+// Opening a shared registry which is never initialized times out.
+static int
+test7
+  (
+  )
+{
+  static char const* name = "idlib-process.test.process.shared-registry";
+  idlib_shared_registry first, second;
+  idlib_status status;
+  idlib_shared_registry_unlink(name);
+  status = idlib_shared_registry_open(&first, name, 65536);
+  if (status) {
+    return status;
+  }
+  status = idlib_shared_registry_open(&second, name, 4096);
+  if (status) {
+    idlib_shared_registry_close(&first);
+    idlib_shared_registry_unlink(name);
+    return status;
+  }
+  for (size_t i = 0; i < 256 && !status; ++i) {
+    size_t value[2] = { i, i * i };
+    status = idlib_shared_registry_add(&first, &i, sizeof(size_t), value, sizeof(value));
+  }
+  size_t i = 0;
+  if (!status && IDLIB_EXISTS != idlib_shared_registry_add(&second, &i, sizeof(size_t), &i, sizeof(size_t))) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < 512 && !status; ++i) {
+    void const* v = NULL;
+    size_t m = 0;
+    idlib_status result = idlib_shared_registry_get(&second, &i, sizeof(size_t), &v, &m);
+    if (i < 256) {
+      if (result || m != 2 * sizeof(size_t) || ((size_t const*)v)[0] != i || ((size_t const*)v)[1] != i * i) {
+        status = IDLIB_ENVIRONMENT_FAILED;
+      }
+    } else if (IDLIB_NOT_EXISTS != result) {
+      status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  idlib_shared_registry_close(&second);
+  idlib_shared_registry_close(&first);
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  if (IDLIB_OPERATION_INVALID != idlib_shared_registry_unlink(name) && !status) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  if (idlib_shared_registry_unlink(name) && !status) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+#endif
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // A segment whose creator terminated before it initialized the segment is not waited for forever.
+  int fd = shm_open("/idlib-process.test.process.shared-registry", O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (-1 == fd) {
+    return status ? status : IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (ftruncate(fd, 4096) && !status) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  close(fd);
+  if (!status && IDLIB_TIMED_OUT != idlib_shared_registry_open(&first, name, 4096)) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_shared_registry_unlink(name);
+#endif
+  return status;
+}
+
+static idlib_status
+serialize_value
+  (
+    void* context,
+    void const* p,
+    size_t n,
+    void* v,
+    void const** blob,
+    size_t* m
+  )
+{
+  // The serializer is invoked without the registry being locked, hence it may remove the global it serializes.
+  if (context && *(size_t const*)p >= 128 && idlib_remove_global((idlib_process*)context, p, n)) {
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  *blob = v;
+  *m = sizeof(size_t);
+  return IDLIB_SUCCESS;
+}
+
+// Save the globals, destroy the singleton, and map the saved globals.
+// The globals removed by the serializer are saved as they existed when the globals were collected.
+// A file is not mapped if one of its keys is the key of an existing global.
+static int
+test8
+  (
+  )
+{
+  static char const* path = "idlib-process.test.process.globals";
+  static size_t values[256];
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < 256 && !status; ++i) {
+    values[i] = i * i;
+    status = idlib_add_global(process, &i, sizeof(size_t), &values[i]);
+  }
+  if (!status) {
+    status = idlib_globals_save(process, path, &serialize_value, process);
+  }
+  idlib_process_relinquish(process);
+  if (status) {
+    remove(path);
+    return status;
+  }
+  status = idlib_process_acquire(&process);
+  if (status) {
+    remove(path);
+    return status;
+  }
+  size_t i = 0;
+  if (idlib_add_global(process, &i, sizeof(size_t), &values[0]) ||
+      IDLIB_EXISTS != idlib_globals_load_mapped(process, path) ||
+      idlib_remove_global(process, &i, sizeof(size_t))) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (!status) {
+    status = idlib_globals_load_mapped(process, path);
+  }
+  if (!status && IDLIB_EXISTS != idlib_globals_load_mapped(process, path)) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < 512 && !status; ++i) {
+    void* v = NULL;
+    idlib_status result = idlib_get_global(process, &i, sizeof(size_t), &v);
+    if ((i < 256 && (result || *(size_t*)v != i * i)) || (i >= 256 && IDLIB_NOT_EXISTS != result)) {
+      status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  if (!status && (IDLIB_EXISTS != idlib_add_global(process, &i, sizeof(size_t), &values[0]) ||
+                  IDLIB_OPERATION_INVALID != idlib_remove_global(process, &i, sizeof(size_t)))) {
+    status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_process_relinquish(process);
+  remove(path);
+  return status;
+}
+
+static void
+count_down_latch
+  (
+    void* context
+  )
+{
+  idlib_latch_count_down((idlib_latch*)context, 1);
+}
+
+// Count down the latch, then acquire and relinquish the process singleton.
+static void
+acquire_and_relinquish_process
+  (
+    void* context
+  )
+{
+  idlib_process* process = NULL;
+  idlib_latch_count_down((idlib_latch*)context, 1);
+  if (!idlib_process_acquire(&process)) {
+    idlib_process_relinquish(process);
+  }
+}
+
+// The timer service of the process singleton is started once and stopped when the singleton is destroyed.
+// A callback may acquire and relinquish the singleton while the last reference to it is relinquished.
+static int
+test9
+  (
+  )
+{
+  idlib_status status;
+  idlib_process* process = NULL;
+  idlib_timer_service* first = NULL, * second = NULL;
+  idlib_latch latch;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  status = idlib_latch_initialize(&latch, 2);
+  if (status) {
+    idlib_process_relinquish(process);
+    return status;
+  }
+  if (idlib_process_get_timer_service(process, &first) || idlib_process_get_timer_service(process, &second) || first != second ||
+      idlib_timer_schedule(first, 2000000, &count_down_latch, &latch, NULL) ||
+      idlib_timer_schedule(second, 0, &count_down_latch, &latch, NULL)) {
+    idlib_latch_uninitialize(&latch);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_latch_wait(&latch);
+  idlib_latch_uninitialize(&latch);
+  status = idlib_latch_initialize(&latch, 1);
+  if (status) {
+    idlib_process_relinquish(process);
+    return status;
+  }
+  if (idlib_timer_schedule(first, 0, &acquire_and_relinquish_process, &latch, NULL)) {
+    idlib_latch_uninitialize(&latch);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_latch_wait(&latch);
+  status = idlib_process_relinquish(process);
+  idlib_latch_uninitialize(&latch);
+  return status;
+}
+
+// The topology is discovered once and the calling thread can be pinned to the CPU it runs on.
+static int
+test10
+  (
+  )
+{
+  idlib_status status;
+  idlib_process* process = NULL;
+  idlib_topology* first = NULL, * second = NULL;
+  uint32_t number_of_cpus = 0, number_of_nodes = 0, index = UINT32_MAX, node = UINT32_MAX;
+  idlib_topology_cpu cpu;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  if (idlib_process_get_topology(process, &first) || idlib_process_get_topology(process, &second) || first != second ||
+      idlib_topology_get_counts(first, &number_of_cpus, &number_of_nodes) || !number_of_cpus || !number_of_nodes ||
+      IDLIB_ARGUMENT_INVALID != idlib_topology_get_cpu(first, number_of_cpus, &cpu)) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (uint32_t i = 0; i < number_of_cpus; ++i) {
+    uint32_t previous = cpu.id;
+    if (idlib_topology_get_cpu(first, i, &cpu) || (i && cpu.id <= previous) || cpu.node >= number_of_nodes ||
+        cpu.core >= number_of_cpus || cpu.cache >= number_of_cpus) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  if (idlib_topology_get_current(first, &index, &node) || index >= number_of_cpus || node >= number_of_nodes) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX) || (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_WINDOWS)
+  // Once pinned, the thread runs on the CPU.
+  uint32_t pinned = index;
+  if (idlib_topology_pin_thread_to_cpu(first, pinned) || idlib_topology_get_current(first, &index, &node) || pinned != index ||
+      idlib_topology_pin_thread_to_node(first, node)) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#endif
+  return idlib_process_relinquish(process);
+}
+
+#define NUMBER_OF_NAMES (2000)
+
+// Equal byte sequences are interned to the same pointer, different byte sequences to different pointers.
+// The table grows and large byte sequences are interned.
+static int
+test11
+  (
+  )
+{
+  static char names[NUMBER_OF_NAMES][16];
+  static void const* p[NUMBER_OF_NAMES];
+  static size_t n[NUMBER_OF_NAMES];
+  static void const* first[NUMBER_OF_NAMES];
+  static void const* second[NUMBER_OF_NAMES];
+  static char large[32768];
+  void const* a = NULL, * b = NULL;
+  size_t size = 0;
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < NUMBER_OF_NAMES; ++i) {
+    n[i] = (size_t)snprintf(names[i], sizeof(names[i]), "name.%zu", i);
+    p[i] = names[i];
+    if (idlib_intern(process, names[i], n[i], &first[i])) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  if (idlib_intern_many(process, p, n, NUMBER_OF_NAMES, second)) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < NUMBER_OF_NAMES; ++i) {
+    if (first[i] != second[i] || first[i] == p[i] || strcmp(first[i], names[i]) ||
+        idlib_intern_get_size(first[i], &size) || size != n[i] || (i && first[i] == first[i - 1])) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  memset(large, 'x', sizeof(large));
+  if (idlib_intern(process, large, sizeof(large), &a) || idlib_intern(process, large, sizeof(large), &b) || a != b ||
+      idlib_intern_get_size(a, &size) || size != sizeof(large) ||
+      idlib_intern(process, large, sizeof(large) - 1, &b) || a == b ||
+      idlib_intern(process, "", 0, &a) || idlib_intern(process, names[0], 0, &b) || a != b || '\0' != *(char const*)a) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  return idlib_process_relinquish(process);
+}
+
+typedef struct prefix_context {
+  // The keys visited so far separated by spaces.
+  char keys[256];
+  size_t number_of_keys;
+} prefix_context;
+
+static idlib_status
+visit_prefix
+  (
+    void* context,
+    void const* p,
+    size_t n,
+    void* v
+  )
+{
+  prefix_context* c = (prefix_context*)context;
+  size_t m = strlen(c->keys);
+  if (m + n + 2 <= sizeof(c->keys)) {
+    memcpy(c->keys + m, p, n);
+    c->keys[m + n] = ' ';
+    c->keys[m + n + 1] = '\0';
+  }
+  c->number_of_keys++;
+  return IDLIB_SUCCESS;
+}
+
+// Globals with a common key prefix are visited in the order of their keys and removed together.
+// Frozen globals are visited but not removed, nor are the other globals with the same prefix.
+static int
+test12
+  (
+  )
+{
+  static char const* keys[] = { "plugin.b.z", "plugin.a.y", "plugin", "plugin.ab", "other", "plugin.a.x" };
+  static char name[16];
+  prefix_context context;
+  size_t number_of_removed = 0;
+  void* v;
+  idlib_status status;
+  idlib_process* process = NULL;
+  status = idlib_process_acquire(&process);
+  if (status) {
+    return status;
+  }
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+    if (idlib_add_global(process, keys[i], strlen(keys[i]), (void*)keys[i])) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  context.keys[0] = '\0';
+  context.number_of_keys = 0;
+  if (idlib_globals_foreach_prefix(process, "plugin.a", 8, &visit_prefix, &context) ||
+      strcmp(context.keys, "plugin.a.x plugin.a.y plugin.ab ") ||
+      idlib_remove_globals_with_prefix(process, "plugin.a.", 9, &number_of_removed) || 2 != number_of_removed ||
+      IDLIB_NOT_EXISTS != idlib_get_global(process, "plugin.a.x", 10, &v) ||
+      idlib_get_global(process, "plugin.ab", 9, &v) || idlib_get_global(process, "plugin", 6, &v)) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // Many keys sharing prefixes split and merge the nodes of the index.
+  for (size_t i = 0; i < 1000; ++i) {
+    snprintf(name, sizeof(name), "k.%zu", i);
+    if (idlib_add_global(process, name, strlen(name), (void*)keys[0])) {
+      idlib_process_relinquish(process);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  context.keys[0] = '\0';
+  context.number_of_keys = 0;
+  if (idlib_remove_globals_with_prefix(process, "k.1", 3, &number_of_removed) || 111 != number_of_removed ||
+      idlib_globals_foreach_prefix(process, "k.", 2, &visit_prefix, &context) || 889 != context.number_of_keys ||
+      idlib_get_global(process, "k.2", 3, &v) || IDLIB_NOT_EXISTS != idlib_get_global(process, "k.15", 4, &v) ||
+      idlib_remove_globals_with_prefix(process, "k.", 2, &number_of_removed) || 889 != number_of_removed) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  context.keys[0] = '\0';
+  context.number_of_keys = 0;
+  if (idlib_process_freeze_globals(process) || idlib_add_global(process, "plugin.c", 8, (void*)keys[0]) ||
+      idlib_globals_foreach_prefix(process, "plugin", 6, &visit_prefix, &context) ||
+      strcmp(context.keys, "plugin plugin.ab plugin.b.z plugin.c ") ||
+      IDLIB_OPERATION_INVALID != idlib_remove_globals_with_prefix(process, "plugin", 6, &number_of_removed) ||
+      idlib_get_global(process, "plugin.c", 8, &v) || idlib_get_global(process, "plugin.b.z", 10, &v) ||
+      idlib_remove_globals_with_prefix(process, "plugin.c", 8, &number_of_removed) || 1 != number_of_removed ||
+      IDLIB_NOT_EXISTS != idlib_get_global(process, "plugin.c", 8, &v)) {
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  return idlib_process_relinquish(process);
+}
+
 int
 main
   (
@@ -55,6 +789,39 @@ main
   if (test1()) {
     return EXIT_FAILURE;
   }
+  if (test2()) {
+    return EXIT_FAILURE;
+  }
+  if (test3()) {
+    return EXIT_FAILURE;
+  }
+  if (test4()) {
+    return EXIT_FAILURE;
+  }
+  if (test5()) {
+    return EXIT_FAILURE;
+  }
+  if (test6()) {
+    return EXIT_FAILURE;
+  }
+  if (test7()) {
+    return EXIT_FAILURE;
+  }
+  if (test8()) {
+    return EXIT_FAILURE;
+  }
+  if (test9()) {
+    return EXIT_FAILURE;
+  }
+  if (test10()) {
+    return EXIT_FAILURE;
+  }
+  if (test11()) {
+    return EXIT_FAILURE;
+  }
+  if (test12()) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
 
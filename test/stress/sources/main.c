@@ -0,0 +1,537 @@
+/*
+  IdLib Process
+  Copyright (C) 2023-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process.h"
+
+#include "harness.h"
+
+// EXIT_SUCCESS, EXIT_FAILURE
+#include <stdlib.h>
+
+// fprintf, snprintf, stderr, stdout
+#include <stdio.h>
+
+// malloc, free, calloc
+#include <malloc.h>
+
+// strcmp, strlen
+#include <string.h>
+
+// Stress test of the primitives of this library under contention and oversubscription.
+// For each scenario, the latencies of the individual operations are recorded in HDR-style histograms and
+// the percentiles p50, p99, p99.9, and the maximum are reported together with fairness metrics derived
+// from the number of operations performed by each thread.
+//
+// Command-line arguments:
+// --profile=quick|full      The "quick" profile runs each scenario briefly and is used by CTest. Default is "full".
+// --scenario=<name>         One of "all", "mutex", "registry", or "condition". Default is "all".
+// --threads=<n>             The number of threads. Default is twice the number of logical processors.
+// --duration-ms=<n>         The duration of each scenario in milliseconds.
+// --critical-section=<n>    The length of the critical section in iterations of a busy loop.
+// --read-ratio=<n>          The percentage of registry operations which are reads. Default is 90.
+// --keys=<n>                The number of keys in the registry. Default is 1000.
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// A log-linear histogram in the style of HdrHistogram.
+// Values below 2 * HISTOGRAM_SUB_BUCKETS are recorded exactly.
+// Larger values are recorded with a relative error of at most 1 / HISTOGRAM_SUB_BUCKETS.
+#define HISTOGRAM_SUB_BUCKET_BITS (5)
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct histogram {
+  uint64_t counts[HISTOGRAM_BUCKETS];
+  uint64_t total;
+  uint64_t maximum;
+} histogram;
+
+static size_t
+histogram_index
+  (
+    uint64_t value
+  )
+{
+  if (value < 2 * HISTOGRAM_SUB_BUCKETS) {
+    return (size_t)value;
+  }
+  size_t magnitude = 0;
+  while (value >> (magnitude + 1)) {
+    magnitude++;
+  }
+  size_t shift = magnitude - HISTOGRAM_SUB_BUCKET_BITS;
+  return shift * HISTOGRAM_SUB_BUCKETS + (size_t)(value >> shift);
+}
+
+// The highest value equivalent to the values recorded in the specified bucket.
+static uint64_t
+histogram_value
+  (
+    size_t index
+  )
+{
+  if (index < 2 * HISTOGRAM_SUB_BUCKETS) {
+    return (uint64_t)index;
+  }
+  size_t shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t sub_bucket = (uint64_t)(index % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS);
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+static void
+histogram_record
+  (
+    histogram* histogram,
+    uint64_t value
+  )
+{
+  histogram->counts[histogram_index(value)]++;
+  histogram->total++;
+  if (value > histogram->maximum) {
+    histogram->maximum = value;
+  }
+}
+
+static void
+histogram_merge
+  (
+    histogram* target,
+    histogram const* source
+  )
+{
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    target->counts[i] += source->counts[i];
+  }
+  target->total += source->total;
+  if (source->maximum > target->maximum) {
+    target->maximum = source->maximum;
+  }
+}
+
+static uint64_t
+histogram_percentile
+  (
+    histogram const* histogram,
+    double percentile
+  )
+{
+  if (!histogram->total) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->total + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t count = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    count += histogram->counts[i];
+    if (count >= rank) {
+      uint64_t value = histogram_value(i);
+      return value < histogram->maximum ? value : histogram->maximum;
+    }
+  }
+  return histogram->maximum;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+typedef struct configuration {
+  size_t threads;
+  uint64_t duration;
+  size_t critical_section;
+  size_t read_ratio;
+  size_t keys;
+} configuration;
+
+typedef struct thread_state {
+  histogram histogram;
+  uint64_t operations;
+  uint64_t random;
+  int failed;
+} thread_state;
+
+typedef struct scenario_context {
+  configuration const* configuration;
+  thread_state* states;
+  idlib_mutex mutex;
+  idlib_condition condition;
+  idlib_process* process;
+  // The keys of the registry scenario.
+  char* keys;
+  // The shared state modified in the critical sections.
+  volatile uint64_t shared;
+  // The number of items in the bounded queue of the condition scenario.
+  size_t items;
+  // Non-zero if a thread of the condition scenario has finished.
+  int stopped;
+} scenario_context;
+
+static uint64_t
+next_random
+  (
+    thread_state* state
+  )
+{
+  // xorshift64
+  uint64_t x = state->random;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  state->random = x;
+  return x;
+}
+
+static void
+critical_section
+  (
+    scenario_context* context
+  )
+{
+  for (size_t i = 0; i < context->configuration->critical_section; ++i) {
+    context->shared++;
+  }
+}
+
+// "stress-", at most 20 digits of a size_t, and the zero terminator.
+#define KEY_CAPACITY (28)
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Each operation locks the mutex, executes the critical section, and unlocks the mutex.
+// The latency is the time from the begin of the lock operation to the end of the unlock operation.
+static void
+mutex_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  scenario_context* context = (scenario_context*)argument;
+  thread_state* state = &context->states[index];
+  uint64_t deadline = harness_now_ns() + context->configuration->duration;
+  uint64_t now = harness_now_ns();
+  while (now < deadline) {
+    if (idlib_mutex_lock(&context->mutex)) {
+      state->failed = 1;
+      return;
+    }
+    critical_section(context);
+    idlib_mutex_unlock(&context->mutex);
+    uint64_t then = harness_now_ns();
+    histogram_record(&state->histogram, then - now);
+    state->operations++;
+    now = then;
+  }
+}
+
+// Each operation is either a read (idlib_get_global of a random key) or a write (idlib_remove_global and idlib_add_global of a random key owned by this thread).
+static void
+registry_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  scenario_context* context = (scenario_context*)argument;
+  thread_state* state = &context->states[index];
+  configuration const* configuration = context->configuration;
+  // The keys [begin, end) are owned by this thread. Only this thread removes and adds them.
+  size_t begin = configuration->keys * index / configuration->threads,
+         end = configuration->keys * (index + 1) / configuration->threads;
+  uint64_t deadline = harness_now_ns() + configuration->duration;
+  uint64_t now = harness_now_ns();
+  while (now < deadline) {
+    if (next_random(state) % 100 < configuration->read_ratio || begin == end) {
+      char const* key = context->keys + (next_random(state) % configuration->keys) * KEY_CAPACITY;
+      void* v;
+      idlib_status status = idlib_get_global(context->process, key, strlen(key), &v);
+      if (status && status != IDLIB_NOT_EXISTS) {
+        state->failed = 1;
+        return;
+      }
+    } else {
+      char* key = context->keys + (begin + next_random(state) % (end - begin)) * KEY_CAPACITY;
+      if (idlib_remove_global(context->process, key, strlen(key)) ||
+          idlib_add_global(context->process, key, strlen(key), key)) {
+        state->failed = 1;
+        return;
+      }
+    }
+    uint64_t then = harness_now_ns();
+    histogram_record(&state->histogram, then - now);
+    state->operations++;
+    now = then;
+  }
+}
+
+#define QUEUE_CAPACITY (8)
+
+// Even threads are producers, odd threads are consumers of a bounded queue.
+// The latency is the time from the begin of the lock operation to the end of the unlock operation including the time spent waiting.
+static void
+condition_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  scenario_context* context = (scenario_context*)argument;
+  thread_state* state = &context->states[index];
+  int producer = 0 == index % 2;
+  uint64_t deadline = harness_now_ns() + context->configuration->duration;
+  uint64_t now = harness_now_ns();
+  while (now < deadline) {
+    if (idlib_mutex_lock(&context->mutex)) {
+      state->failed = 1;
+      return;
+    }
+    if (producer) {
+      while (context->items == QUEUE_CAPACITY && !context->stopped) {
+        idlib_condition_wait(&context->condition, &context->mutex);
+      }
+      if (context->stopped) {
+        idlib_mutex_unlock(&context->mutex);
+        break;
+      }
+      context->items++;
+    } else {
+      while (context->items == 0 && !context->stopped) {
+        idlib_condition_wait(&context->condition, &context->mutex);
+      }
+      if (context->stopped) {
+        idlib_mutex_unlock(&context->mutex);
+        break;
+      }
+      context->items--;
+    }
+    critical_section(context);
+    idlib_condition_signal_all(&context->condition);
+    idlib_mutex_unlock(&context->mutex);
+    uint64_t then = harness_now_ns();
+    histogram_record(&state->histogram, then - now);
+    state->operations++;
+    now = then;
+  }
+  // Wake up the threads waiting for this thread.
+  idlib_mutex_lock(&context->mutex);
+  context->stopped = 1;
+  idlib_condition_signal_all(&context->condition);
+  idlib_mutex_unlock(&context->mutex);
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+static void
+report
+  (
+    char const* name,
+    configuration const* configuration,
+    thread_state const* states,
+    uint64_t elapsed
+  )
+{
+  histogram* merged = calloc(1, sizeof(histogram));
+  if (!merged) {
+    return;
+  }
+  // The share of a thread is the fraction of all operations performed by that thread.
+  // Jain's fairness index is 1 if all threads performed the same number of operations and 1/n if a single thread performed all operations.
+  double sum = 0.0, sum_of_squares = 0.0;
+  uint64_t minimum = UINT64_MAX, maximum = 0;
+  for (size_t i = 0; i < configuration->threads; ++i) {
+    histogram_merge(merged, &states[i].histogram);
+    double operations = (double)states[i].operations;
+    sum += operations;
+    sum_of_squares += operations * operations;
+    if (states[i].operations < minimum) {
+      minimum = states[i].operations;
+    }
+    if (states[i].operations > maximum) {
+      maximum = states[i].operations;
+    }
+  }
+  double fairness = sum_of_squares > 0.0 ? (sum * sum) / ((double)configuration->threads * sum_of_squares) : 0.0;
+  double minimum_share = sum > 0.0 ? (double)minimum / sum : 0.0;
+  double maximum_share = sum > 0.0 ? (double)maximum / sum : 0.0;
+  fprintf(stdout, "%-10s threads = %4zu operations = %10llu ops/s = %12.1f p50 = %8llu ns p99 = %8llu ns p99.9 = %8llu ns max = %10llu ns "
+                  "share min/max = %.4f/%.4f (ideal %.4f) jain = %.4f\n",
+          name, configuration->threads, (unsigned long long)merged->total,
+          elapsed ? (double)merged->total * 1e9 / (double)elapsed : 0.0,
+          (unsigned long long)histogram_percentile(merged, 50.0),
+          (unsigned long long)histogram_percentile(merged, 99.0),
+          (unsigned long long)histogram_percentile(merged, 99.9),
+          (unsigned long long)merged->maximum,
+          minimum_share, maximum_share, 1.0 / (double)configuration->threads, fairness);
+  free(merged);
+}
+
+static idlib_status
+run_scenario
+  (
+    char const* name,
+    harness_procedure* procedure,
+    configuration const* configuration
+  )
+{
+  scenario_context context;
+  memset(&context, 0, sizeof(scenario_context));
+  context.configuration = configuration;
+  context.states = calloc(configuration->threads, sizeof(thread_state));
+  if (!context.states) {
+    return IDLIB_ALLOCATION_FAILED;
+  }
+  for (size_t i = 0; i < configuration->threads; ++i) {
+    context.states[i].random = UINT64_C(0x9E3779B97F4A7C15) * (i + 1);
+  }
+  idlib_status status = idlib_mutex_initialize(&context.mutex);
+  if (status) {
+    free(context.states);
+    return status;
+  }
+  status = idlib_condition_initialize(&context.condition);
+  if (status) {
+    idlib_mutex_uninitialize(&context.mutex);
+    free(context.states);
+    return status;
+  }
+  status = idlib_process_acquire(&context.process);
+  if (status) {
+    idlib_condition_uninitialize(&context.condition);
+    idlib_mutex_uninitialize(&context.mutex);
+    free(context.states);
+    return status;
+  }
+  context.keys = malloc(KEY_CAPACITY * configuration->keys);
+  if (!context.keys) {
+    status = IDLIB_ALLOCATION_FAILED;
+  }
+  size_t number_of_keys = 0;
+  for (; !status && number_of_keys < configuration->keys; ++number_of_keys) {
+    char* key = context.keys + number_of_keys * KEY_CAPACITY;
+    snprintf(key, KEY_CAPACITY, "stress-%zu", number_of_keys);
+    status = idlib_add_global(context.process, key, strlen(key), key);
+    if (status) {
+      break;
+    }
+  }
+  if (!status) {
+    uint64_t elapsed;
+    status = harness_run(configuration->threads, procedure, &context, &elapsed);
+    for (size_t i = 0; !status && i < configuration->threads; ++i) {
+      if (context.states[i].failed) {
+        fprintf(stderr, "%s:%d: scenario %s failed on thread %zu\n", __FILE__, __LINE__, name, i);
+        status = IDLIB_ENVIRONMENT_FAILED;
+      }
+    }
+    if (!status) {
+      report(name, configuration, context.states, elapsed);
+    }
+  }
+  while (number_of_keys > 0) {
+    char* key = context.keys + --number_of_keys * KEY_CAPACITY;
+    idlib_remove_global(context.process, key, strlen(key));
+  }
+  free(context.keys);
+  idlib_process_relinquish(context.process);
+  idlib_condition_uninitialize(&context.condition);
+  idlib_mutex_uninitialize(&context.mutex);
+  free(context.states);
+  return status;
+}
+
+int
+main
+  (
+    int argc,
+    char** argv
+  )
+{
+  configuration configuration = {
+    .threads = 2 * harness_processor_count(),
+    .duration = UINT64_C(2000000000),
+    .critical_section = 100,
+    .read_ratio = 90,
+    .keys = 1000,
+  };
+  char const* profile = "full";
+  char const* scenario = "all";
+  size_t threads = 0, duration = 0, critical_section = SIZE_MAX, read_ratio = SIZE_MAX, keys = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (harness_parse_string(argv[i], "--profile", &profile) ||
+        harness_parse_string(argv[i], "--scenario", &scenario) ||
+        harness_parse_size(argv[i], "--threads", &threads) ||
+        harness_parse_size(argv[i], "--duration-ms", &duration) ||
+        harness_parse_size(argv[i], "--critical-section", &critical_section) ||
+        harness_parse_size(argv[i], "--read-ratio", &read_ratio) ||
+        harness_parse_size(argv[i], "--keys", &keys)) {
+      continue;
+    }
+    fprintf(stderr, "%s:%d: unknown or invalid argument `%s`\n", __FILE__, __LINE__, argv[i]);
+    return EXIT_FAILURE;
+  }
+  if (!strcmp(profile, "quick")) {
+    configuration.threads = configuration.threads < 8 ? configuration.threads : 8;
+    configuration.duration = UINT64_C(100000000);
+  } else if (strcmp(profile, "full")) {
+    fprintf(stderr, "%s:%d: unknown profile `%s`\n", __FILE__, __LINE__, profile);
+    return EXIT_FAILURE;
+  }
+  if (threads) {
+    configuration.threads = threads;
+  }
+  if (duration) {
+    configuration.duration = (uint64_t)duration * UINT64_C(1000000);
+  }
+  if (critical_section != SIZE_MAX) {
+    configuration.critical_section = critical_section;
+  }
+  if (read_ratio != SIZE_MAX) {
+    if (read_ratio > 100) {
+      fprintf(stderr, "%s:%d: read ratio must be within [0, 100]\n", __FILE__, __LINE__);
+      return EXIT_FAILURE;
+    }
+    configuration.read_ratio = read_ratio;
+  }
+  if (keys) {
+    configuration.keys = keys;
+  }
+  int all = !strcmp(scenario, "all");
+  if (!all && strcmp(scenario, "mutex") && strcmp(scenario, "registry") && strcmp(scenario, "condition")) {
+    fprintf(stderr, "%s:%d: unknown scenario `%s`\n", __FILE__, __LINE__, scenario);
+    return EXIT_FAILURE;
+  }
+  idlib_status status = IDLIB_SUCCESS;
+  if (!status && (all || !strcmp(scenario, "mutex"))) {
+    status = run_scenario("mutex", &mutex_procedure, &configuration);
+  }
+  if (!status && (all || !strcmp(scenario, "registry"))) {
+    status = run_scenario("registry", &registry_procedure, &configuration);
+  }
+  if (!status && (all || !strcmp(scenario, "condition"))) {
+    status = run_scenario("condition", &condition_procedure, &configuration);
+  }
+  if (status) {
+    fprintf(stderr, "%s:%d: stress test failed with status %u\n", __FILE__, __LINE__, (unsigned)status);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
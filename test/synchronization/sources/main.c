@@ -0,0 +1,1371 @@
+/*
+  IdLib Process
+  Copyright (C) 2023-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "idlib/process.h"
+
+#include "harness.h"
+
+#include <stdlib.h>
+
+#include <stdio.h>
+
+// memset
+#include <string.h>
+
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // poll
+  #include <poll.h>
+  // read
+  #include <unistd.h>
+#endif
+
+#define NUMBER_OF_THREADS (4)
+
+#define NUMBER_OF_ITERATIONS (1000)
+
+typedef struct semaphore_context {
+  idlib_semaphore semaphore;
+  // Guarded by the semaphore.
+  size_t counter;
+  idlib_status status;
+} semaphore_context;
+
+static void
+semaphore_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  semaphore_context* context = (semaphore_context*)argument;
+  for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+    if (idlib_semaphore_acquire(&context->semaphore)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+    context->counter++;
+    idlib_semaphore_release(&context->semaphore, 1);
+  }
+}
+
+// Use a semaphore with one permit as a lock.
+static int
+test1
+  (
+  )
+{
+  semaphore_context context = { .counter = 0, .status = IDLIB_SUCCESS };
+  uint64_t elapsed;
+  if (idlib_semaphore_initialize(&context.semaphore, 1)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_semaphore_try_acquire(&context.semaphore) ||
+      IDLIB_LOCKED != idlib_semaphore_try_acquire(&context.semaphore) ||
+      idlib_semaphore_release(&context.semaphore, 1)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_semaphore_uninitialize(&context.semaphore);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (harness_run(NUMBER_OF_THREADS, &semaphore_procedure, &context, &elapsed) || context.status ||
+      NUMBER_OF_THREADS * NUMBER_OF_ITERATIONS != context.counter) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_semaphore_uninitialize(&context.semaphore);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (IDLIB_OVERFLOW != idlib_semaphore_release(&context.semaphore, UINT32_MAX)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_semaphore_uninitialize(&context.semaphore);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_semaphore_uninitialize(&context.semaphore);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct latch_context {
+  idlib_latch latch;
+  idlib_status status;
+} latch_context;
+
+static void
+latch_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  latch_context* context = (latch_context*)argument;
+  if (idlib_latch_arrive_and_wait(&context->latch, 1)) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+}
+
+// All threads arrive at a latch and wait until the last thread has arrived.
+static int
+test2
+  (
+  )
+{
+  latch_context context = { .status = IDLIB_SUCCESS };
+  uint64_t elapsed;
+  if (idlib_latch_initialize(&context.latch, NUMBER_OF_THREADS)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (IDLIB_LOCKED != idlib_latch_try_wait(&context.latch) ||
+      IDLIB_UNDERFLOW != idlib_latch_count_down(&context.latch, NUMBER_OF_THREADS + 1)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_latch_uninitialize(&context.latch);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (harness_run(NUMBER_OF_THREADS, &latch_procedure, &context, &elapsed) || context.status ||
+      idlib_latch_try_wait(&context.latch)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_latch_uninitialize(&context.latch);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_latch_uninitialize(&context.latch);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct barrier_context {
+  idlib_barrier barrier;
+  // Incremented by the completion function.
+  size_t phases;
+  idlib_status status;
+} barrier_context;
+
+static void
+barrier_completion
+  (
+    void* argument
+  )
+{
+  barrier_context* context = (barrier_context*)argument;
+  context->phases++;
+}
+
+static void
+barrier_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  barrier_context* context = (barrier_context*)argument;
+  for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+    if (idlib_barrier_arrive_and_wait(&context->barrier)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+    // The completion function of this phase has been invoked and the completion function of the next phase can not be invoked before this thread arrives.
+    if (i + 1 != context->phases) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+  }
+}
+
+// All threads pass a barrier in lockstep.
+static int
+test3
+  (
+  )
+{
+  barrier_context context = { .phases = 0, .status = IDLIB_SUCCESS };
+  uint64_t elapsed;
+  if (IDLIB_ARGUMENT_INVALID != idlib_barrier_initialize(&context.barrier, 0, NULL, NULL)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_barrier_initialize(&context.barrier, NUMBER_OF_THREADS, &barrier_completion, &context)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (harness_run(NUMBER_OF_THREADS, &barrier_procedure, &context, &elapsed) || context.status ||
+      NUMBER_OF_ITERATIONS != context.phases) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_barrier_uninitialize(&context.barrier);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_barrier_uninitialize(&context.barrier);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct once_context {
+  idlib_once once;
+  // The number of times the procedure was invoked.
+  uint32_t volatile invocations;
+  idlib_status status;
+} once_context;
+
+static idlib_status
+once_procedure
+  (
+    void* argument
+  )
+{
+  once_context* context = (once_context*)argument;
+  // Fail the first invocation.
+  if (0 == idlib_atomic_fetch_add_u32(&context->invocations, 1)) {
+    return IDLIB_ABORTED;
+  }
+  return IDLIB_SUCCESS;
+}
+
+static void
+once_procedure_thread
+  (
+    void* argument,
+    size_t index
+  )
+{
+  once_context* context = (once_context*)argument;
+  if (idlib_once_call(&context->once, &once_procedure, context)) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+}
+
+// The procedure is invoked again after it failed and not invoked after it succeeded.
+static int
+test4
+  (
+  )
+{
+  once_context context = { .once = IDLIB_ONCE_INITIALIZER, .invocations = 0, .status = IDLIB_SUCCESS };
+  uint64_t elapsed;
+  if (IDLIB_ABORTED != idlib_once_call(&context.once, &once_procedure, &context) || 1 != context.invocations) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (harness_run(NUMBER_OF_THREADS, &once_procedure_thread, &context, &elapsed) || context.status ||
+      2 != context.invocations) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_once_call(&context.once, &once_procedure, &context) || 2 != context.invocations) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct seqlock_data {
+  uint64_t a;
+  // Always the complement of a.
+  uint64_t b;
+} seqlock_data;
+
+typedef struct seqlock_context {
+  idlib_seqlock seqlock;
+  seqlock_data data;
+  // Set by the writer when it is done.
+  uint32_t volatile done;
+  idlib_status status;
+} seqlock_context;
+
+static void
+seqlock_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  seqlock_context* context = (seqlock_context*)argument;
+  if (0 == index) {
+    for (uint64_t i = 1; i <= NUMBER_OF_ITERATIONS; ++i) {
+      seqlock_data data = { .a = i, .b = ~i };
+      if (idlib_seqlock_write(&context->seqlock, &context->data, &data, sizeof(seqlock_data))) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+        break;
+      }
+    }
+    idlib_atomic_store_release_u32(&context->done, 1);
+  } else {
+    uint64_t last = 0;
+    do {
+      seqlock_data data;
+      if (idlib_seqlock_read(&context->seqlock, &data, &context->data, sizeof(seqlock_data)) ||
+          data.b != ~data.a || data.a < last) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+        break;
+      }
+      last = data.a;
+    } while (!idlib_atomic_load_acquire_u32(&context->done));
+  }
+}
+
+// Readers never observe a torn or an older value.
+// A sequence lock is neither re-entered nor unlocked by a thread which does not hold it.
+static int
+test5
+  (
+  )
+{
+  seqlock_context context = { .data = { .a = 0, .b = ~UINT64_C(0) }, .done = 0, .status = IDLIB_SUCCESS };
+  uint64_t elapsed;
+  if (idlib_seqlock_initialize(&context.seqlock)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (IDLIB_NOT_LOCKED != idlib_seqlock_write_unlock(&context.seqlock) ||
+      idlib_seqlock_write_lock(&context.seqlock) ||
+      IDLIB_OPERATION_INVALID != idlib_seqlock_write_lock(&context.seqlock) ||
+      idlib_seqlock_write_unlock(&context.seqlock) ||
+      IDLIB_NOT_LOCKED != idlib_seqlock_write_unlock(&context.seqlock) ||
+      harness_run(NUMBER_OF_THREADS, &seqlock_procedure, &context, &elapsed) || context.status ||
+      NUMBER_OF_ITERATIONS != context.data.a) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_seqlock_uninitialize(&context.seqlock);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_seqlock_uninitialize(&context.seqlock);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct allocator_context {
+  idlib_process* process;
+  // The blocks allocated by each thread.
+  unsigned char* blocks[NUMBER_OF_THREADS][NUMBER_OF_ITERATIONS];
+  // Non-zero if the blocks are deallocated.
+  int deallocate;
+  idlib_status status;
+} allocator_context;
+
+static size_t
+allocator_size
+  (
+    size_t i
+  )
+{
+  // Cover all size classes and some large allocations.
+  return 1 + (i * 37) % 1100;
+}
+
+static void
+allocator_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  allocator_context* context = (allocator_context*)argument;
+  if (!context->deallocate) {
+    for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+      void* p = NULL;
+      if (idlib_allocator_allocate(context->process, allocator_size(i), &p)) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+        return;
+      }
+      memset(p, (int)index, allocator_size(i));
+      context->blocks[index][i] = p;
+    }
+  } else {
+    // Deallocate the blocks of another thread.
+    size_t other = (index + 1) % NUMBER_OF_THREADS;
+    for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+      unsigned char* p = context->blocks[other][i];
+      if (p[0] != other || p[allocator_size(i) - 1] != other) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+      }
+      idlib_allocator_deallocate(context->process, p, allocator_size(i));
+    }
+  }
+}
+
+// Blocks are deallocated by other threads and the caches of terminated threads are reused.
+static int
+test6
+  (
+  )
+{
+  static allocator_context context;
+  idlib_allocator_statistics before, between, after;
+  uint64_t elapsed;
+  context.deallocate = 0;
+  context.status = IDLIB_SUCCESS;
+  if (idlib_process_acquire(&context.process)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_allocator_get_statistics(context.process, &before) ||
+      harness_run(NUMBER_OF_THREADS, &allocator_procedure, &context, &elapsed) || context.status ||
+      idlib_allocator_get_statistics(context.process, &between)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(context.process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  context.deallocate = 1;
+  if (harness_run(NUMBER_OF_THREADS, &allocator_procedure, &context, &elapsed) || context.status ||
+      idlib_allocator_get_statistics(context.process, &after)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(context.process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_process_relinquish(context.process);
+  if (between.allocations - before.allocations < NUMBER_OF_THREADS * NUMBER_OF_ITERATIONS ||
+      after.deallocations - between.deallocations < NUMBER_OF_THREADS * NUMBER_OF_ITERATIONS ||
+      between.large_allocations == before.large_allocations ||
+      between.bytes_in_use <= before.bytes_in_use || after.bytes_in_use != before.bytes_in_use ||
+      0 == after.slabs || 0 == after.batch_transfers ||
+      after.caches > before.caches + NUMBER_OF_THREADS) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+#define NUMBER_OF_TIMERS (300)
+
+typedef struct timer_context timer_context;
+
+typedef struct timer_entry {
+  timer_context* context;
+  uint64_t delay;
+  uint64_t scheduled;
+  idlib_timer_id id;
+  // Incremented when the callback is invoked. UINT32_MAX if the timer was cancelled.
+  uint32_t volatile fired;
+} timer_entry;
+
+struct timer_context {
+  idlib_latch latch;
+  // Incremented by the executor.
+  uint32_t volatile executed;
+  idlib_status status;
+  timer_entry entries[NUMBER_OF_TIMERS];
+};
+
+static void
+timer_callback
+  (
+    void* argument
+  )
+{
+  timer_entry* entry = (timer_entry*)argument;
+  if (harness_now_ns() - entry->scheduled < entry->delay) {
+    entry->context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_atomic_fetch_add_u32(&entry->fired, 1);
+  idlib_latch_count_down(&entry->context->latch, 1);
+}
+
+static void
+timer_executor
+  (
+    void* executor_context,
+    idlib_timer_callback* callback,
+    void* context
+  )
+{
+  timer_context* owner = (timer_context*)executor_context;
+  idlib_atomic_fetch_add_u32(&owner->executed, 1);
+  callback(context);
+}
+
+// Timers expire after their delay, including timers cascaded from the second level, and cancelled timers do not expire.
+static int
+test7
+  (
+  )
+{
+  static timer_context context;
+  idlib_timer_service service;
+  context.executed = 0;
+  context.status = IDLIB_SUCCESS;
+  // Counted down when a timer expires or is cancelled.
+  if (idlib_latch_initialize(&context.latch, NUMBER_OF_TIMERS)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_timer_service_initialize(&service, &timer_executor, &context)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_latch_uninitialize(&context.latch);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < NUMBER_OF_TIMERS; ++i) {
+    timer_entry* entry = &context.entries[i];
+    entry->context = &context;
+    // Between 0 and 400 milliseconds in steps of 4/3 milliseconds, in reverse order for the even timers.
+    entry->delay = (i % 2 ? i : NUMBER_OF_TIMERS - 1 - i) * UINT64_C(4000000) / 3;
+    entry->fired = 0;
+    entry->scheduled = harness_now_ns();
+    if (idlib_timer_schedule(&service, entry->delay, &timer_callback, entry, &entry->id)) {
+      context.status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  // Cancel every third timer.
+  for (size_t i = 0; i < NUMBER_OF_TIMERS; i += 3) {
+    idlib_status status = idlib_timer_cancel(&service, context.entries[i].id);
+    if (!status) {
+      context.entries[i].fired = UINT32_MAX;
+      idlib_latch_count_down(&context.latch, 1);
+      if (IDLIB_NOT_EXISTS != idlib_timer_cancel(&service, context.entries[i].id)) {
+        context.status = IDLIB_ENVIRONMENT_FAILED;
+      }
+    } else if (IDLIB_NOT_EXISTS != status || context.entries[i].delay > UINT64_C(100000000)) {
+      // Only a timer with a short delay may have expired.
+      context.status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  idlib_latch_wait(&context.latch);
+  for (size_t i = 0; i < NUMBER_OF_TIMERS; ++i) {
+    uint32_t fired = context.entries[i].fired;
+    if ((1 != fired && UINT32_MAX != fired) || (1 == fired && IDLIB_NOT_EXISTS != idlib_timer_cancel(&service, context.entries[i].id))) {
+      context.status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  idlib_timer_service_uninitialize(&service);
+  idlib_latch_uninitialize(&context.latch);
+  if (context.status || context.executed < NUMBER_OF_TIMERS - (NUMBER_OF_TIMERS + 2) / 3) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct future_context {
+  idlib_promise promises[NUMBER_OF_THREADS];
+  idlib_future futures[NUMBER_OF_THREADS];
+  // The futures of the continuations of futures[1], ..., futures[NUMBER_OF_THREADS - 1].
+  idlib_future chained[NUMBER_OF_THREADS];
+  idlib_future all;
+  idlib_future any;
+  // Incremented by the executor.
+  uint32_t volatile executed;
+  idlib_status status;
+} future_context;
+
+static void
+future_executor
+  (
+    void* executor_context,
+    void (*task)(void* context),
+    void* context
+  )
+{
+  future_context* owner = (future_context*)executor_context;
+  idlib_atomic_fetch_add_u32(&owner->executed, 1);
+  task(context);
+}
+
+static idlib_status
+future_double
+  (
+    void* context,
+    idlib_status status,
+    void* value,
+    void** result
+  )
+{
+  if (status) {
+    return status;
+  }
+  *result = (void*)((uintptr_t)value * 2);
+  return IDLIB_SUCCESS;
+}
+
+static void
+future_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  future_context* context = (future_context*)argument;
+  if (0 == index) {
+    // Wait for the other threads.
+    void* value = NULL;
+    if (idlib_future_get(&context->all, &value) || idlib_future_get(&context->any, &value) ||
+        (uintptr_t)value < 2 || (uintptr_t)value > NUMBER_OF_THREADS) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+    }
+    for (size_t i = 1; i < NUMBER_OF_THREADS; ++i) {
+      if (idlib_future_get(&context->chained[i], &value) || (uintptr_t)value != 2 * (i + 1)) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+      }
+    }
+  } else {
+    if (idlib_promise_set_value(&context->promises[index], (void*)(uintptr_t)(index + 1))) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+}
+
+// A thread waits for futures set by other threads, continuations are chained, and futures are combined.
+static int
+test8
+  (
+  )
+{
+  static future_context context;
+  uint64_t elapsed;
+  void* value = NULL;
+  context.executed = 0;
+  context.status = IDLIB_SUCCESS;
+  for (size_t i = 0; i < NUMBER_OF_THREADS; ++i) {
+    if (idlib_promise_initialize(&context.promises[i]) || idlib_promise_get_future(&context.promises[i], &context.futures[i])) {
+      fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+      return IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  for (size_t i = 1; i < NUMBER_OF_THREADS; ++i) {
+    if (idlib_future_then(&context.futures[i], &future_executor, &context, &future_double, NULL, &context.chained[i])) {
+      context.status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  if (idlib_future_when_all(context.futures + 1, NUMBER_OF_THREADS - 1, &context.all) ||
+      idlib_future_when_any(context.futures + 1, NUMBER_OF_THREADS - 1, &context.any) ||
+      IDLIB_TIMED_OUT != idlib_future_wait_until(&context.all, idlib_clock_now() + 1000000)) {
+    context.status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (context.status || harness_run(NUMBER_OF_THREADS, &future_procedure, &context, &elapsed) || context.status ||
+      NUMBER_OF_THREADS - 1 != context.executed) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  // A promise is set once, a continuation added to a ready future is dispatched immediately,
+  // and a promise which is uninitialized before it was set is broken.
+  if (IDLIB_OPERATION_INVALID != idlib_promise_set_value(&context.promises[1], NULL) ||
+      idlib_future_then(&context.futures[1], &future_executor, &context, &future_double, NULL, NULL) ||
+      NUMBER_OF_THREADS != context.executed ||
+      idlib_promise_uninitialize(&context.promises[0]) ||
+      IDLIB_ABORTED != idlib_future_get(&context.futures[0], &value) ||
+      idlib_future_wait_until(&context.futures[0], 0)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < NUMBER_OF_THREADS; ++i) {
+    if (i) {
+      idlib_promise_uninitialize(&context.promises[i]);
+      idlib_future_uninitialize(&context.chained[i]);
+    }
+    idlib_future_uninitialize(&context.futures[i]);
+  }
+  idlib_future_uninitialize(&context.all);
+  idlib_future_uninitialize(&context.any);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+#define NUMBER_OF_FIBERS (64)
+
+#define NUMBER_OF_FIBER_ITERATIONS (100)
+
+typedef struct fiber_context {
+  idlib_latch start;
+  idlib_latch done;
+  idlib_semaphore semaphore;
+  idlib_mutex mutex;
+  idlib_condition condition;
+  // Guarded by the semaphore.
+  size_t counter;
+  // Guarded by the mutex.
+  size_t counter2;
+  // The index of the fiber whose turn it is. Guarded by the mutex.
+  size_t turn;
+  // A promise which is never set.
+  idlib_promise promise;
+  idlib_future future;
+  idlib_status status;
+} fiber_context;
+
+typedef struct fiber_argument {
+  fiber_context* context;
+  size_t index;
+} fiber_argument;
+
+static void
+fiber_procedure
+  (
+    void* argument
+  )
+{
+  fiber_context* context = ((fiber_argument*)argument)->context;
+  // Woken up by the main thread.
+  if (idlib_latch_wait(&context->start)) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  // Yield while holding the semaphore such that the other fibers wait.
+  for (size_t i = 0; i < NUMBER_OF_FIBER_ITERATIONS; ++i) {
+    if (idlib_semaphore_acquire(&context->semaphore)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      break;
+    }
+    size_t counter = context->counter;
+    idlib_fiber_yield();
+    context->counter = counter + 1;
+    idlib_semaphore_release(&context->semaphore, 1);
+  }
+#if (IDLIB_PROCESS_MUTEX_BACKEND == IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+  // A pthread mutex can not be locked by a fiber.
+  if (IDLIB_OPERATION_INVALID != idlib_mutex_lock(&context->mutex)) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  size_t index = ((fiber_argument*)argument)->index;
+  for (size_t i = 0; i < NUMBER_OF_FIBER_ITERATIONS; ++i) {
+    if (idlib_mutex_lock(&context->mutex)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      break;
+    }
+    size_t counter = context->counter2;
+    idlib_fiber_yield();
+    context->counter2 = counter + 1;
+    idlib_mutex_unlock(&context->mutex);
+  }
+  // The fibers take turns in the order of their indices.
+  idlib_mutex_lock(&context->mutex);
+  while (context->turn != index) {
+    if (idlib_condition_wait(&context->condition, &context->mutex)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      break;
+    }
+  }
+  context->turn++;
+  idlib_condition_signal_all(&context->condition);
+  idlib_mutex_unlock(&context->mutex);
+#endif
+  idlib_latch_count_down(&context->done, 1);
+}
+
+// The fiber is parked until the deadline passed.
+static void
+timed_fiber_procedure
+  (
+    void* argument
+  )
+{
+  fiber_context* context = (fiber_context*)argument;
+  uint64_t deadline = idlib_clock_now() + 10000000;
+  if (IDLIB_TIMED_OUT != idlib_future_wait_until(&context->future, deadline) || idlib_clock_now() < deadline) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_latch_count_down(&context->done, 1);
+}
+
+// Fibers contend on a semaphore, a mutex, and a condition on fewer worker threads.
+// A fiber waiting with a deadline is parked until the deadline passed.
+static int
+test9
+  (
+  )
+{
+  static fiber_context context;
+  static fiber_argument arguments[NUMBER_OF_FIBERS];
+  idlib_fiber_scheduler scheduler;
+  context.counter = 0;
+  context.counter2 = 0;
+  context.turn = 0;
+  context.status = IDLIB_SUCCESS;
+  if (IDLIB_OPERATION_INVALID != idlib_fiber_yield() ||
+      idlib_latch_initialize(&context.start, 1) || idlib_latch_initialize(&context.done, NUMBER_OF_FIBERS + 1) ||
+      idlib_semaphore_initialize(&context.semaphore, 1) || idlib_mutex_initialize(&context.mutex) ||
+      idlib_condition_initialize(&context.condition) ||
+      idlib_promise_initialize(&context.promise) || idlib_promise_get_future(&context.promise, &context.future) ||
+      idlib_fiber_scheduler_initialize(&scheduler, 2, 0)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < NUMBER_OF_FIBERS; ++i) {
+    arguments[i].context = &context;
+    arguments[i].index = i;
+    if (idlib_fiber_spawn(&scheduler, &fiber_procedure, &arguments[i])) {
+      context.status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+  if (idlib_fiber_spawn(&scheduler, &timed_fiber_procedure, &context)) {
+    context.status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_latch_count_down(&context.start, 1);
+  if (idlib_latch_wait(&context.done) || idlib_fiber_scheduler_uninitialize(&scheduler) || context.status ||
+      NUMBER_OF_FIBERS * NUMBER_OF_FIBER_ITERATIONS != context.counter) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#if (IDLIB_PROCESS_MUTEX_BACKEND != IDLIB_PROCESS_MUTEX_BACKEND_PTHREAD)
+  if (NUMBER_OF_FIBERS * NUMBER_OF_FIBER_ITERATIONS != context.counter2 || NUMBER_OF_FIBERS != context.turn) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+#endif
+  idlib_future_uninitialize(&context.future);
+  idlib_promise_uninitialize(&context.promise);
+  idlib_condition_uninitialize(&context.condition);
+  idlib_mutex_uninitialize(&context.mutex);
+  idlib_semaphore_uninitialize(&context.semaphore);
+  idlib_latch_uninitialize(&context.done);
+  idlib_latch_uninitialize(&context.start);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct event_context {
+  idlib_event event;
+  // Incremented by the producers before they signal the event.
+  uint32_t volatile produced;
+  idlib_status status;
+} event_context;
+
+static void
+event_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  event_context* context = (event_context*)argument;
+  uint32_t total = (NUMBER_OF_THREADS - 1) * NUMBER_OF_ITERATIONS;
+  if (0 == index) {
+    // The consumer examines the counter after the event was reset, hence it does not miss a signal.
+    while (idlib_atomic_load_acquire_u32(&context->produced) < total) {
+      if (idlib_event_wait(&context->event)) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+        return;
+      }
+    }
+  } else {
+    for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+      idlib_atomic_fetch_add_u32(&context->produced, 1);
+      if (idlib_event_signal(&context->event)) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+        return;
+      }
+    }
+  }
+}
+
+// Signals of an event are coalesced and a consumer does not miss signals of producers.
+static int
+test10
+  (
+  )
+{
+  static event_context context;
+  idlib_event_descriptor descriptor;
+  uint64_t elapsed;
+  context.produced = 0;
+  context.status = IDLIB_SUCCESS;
+  if (idlib_event_initialize(&context.event) || idlib_event_get_descriptor(&context.event, &descriptor)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+    if (idlib_event_signal(&context.event)) {
+      context.status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+#if (IDLIB_OPERATING_SYSTEM == IDLIB_OPERATING_SYSTEM_LINUX)
+  // The descriptor was written once and is not readable after the event was reset.
+  struct pollfd pollfd = { .fd = descriptor, .events = POLLIN, .revents = 0 };
+  uint64_t value = 0;
+  if (1 != poll(&pollfd, 1, 0) || sizeof(value) != read(descriptor, &value, sizeof(value)) || 1 != value ||
+      idlib_event_signal(&context.event) || 0 != poll(&pollfd, 1, 0) ||
+      idlib_event_reset(&context.event) || idlib_event_signal(&context.event) || 1 != poll(&pollfd, 1, 0) ||
+      idlib_event_reset(&context.event) || 0 != poll(&pollfd, 1, 0)) {
+    context.status = IDLIB_ENVIRONMENT_FAILED;
+  }
+#else
+  idlib_event_reset(&context.event);
+#endif
+  if (context.status || harness_run(NUMBER_OF_THREADS, &event_procedure, &context, &elapsed) || context.status) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_event_uninitialize(&context.event);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct tls_context {
+  idlib_process* process;
+  idlib_tls_slot slot;
+  // One value per thread.
+  size_t values[NUMBER_OF_THREADS];
+  // Incremented by the destructor.
+  uint32_t volatile destroyed;
+  // Counted down when thread 1 has set its value and when the singleton was created again.
+  idlib_latch set;
+  idlib_latch recreated;
+  idlib_status status;
+} tls_context;
+
+static tls_context* g_tls_context = NULL;
+
+static void
+tls_destructor
+  (
+    void* value
+  )
+{
+  size_t* p = (size_t*)value;
+  if (p < g_tls_context->values || p >= g_tls_context->values + NUMBER_OF_THREADS) {
+    g_tls_context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_atomic_fetch_add_u32(&g_tls_context->destroyed, 1);
+}
+
+static void
+tls_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  tls_context* context = (tls_context*)argument;
+  void* value;
+  if (idlib_tls_get(context->process, context->slot, &value) || NULL != value ||
+      idlib_tls_set(context->process, context->slot, &context->values[index])) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+    return;
+  }
+  for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+    if (idlib_tls_get(context->process, context->slot, &value) || &context->values[index] != value) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+  }
+}
+
+// Thread 0 destroys and creates the singleton while thread 1 caches its block of the destroyed singleton.
+static void
+tls_recreate_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  tls_context* context = (tls_context*)argument;
+  void* value;
+  if (0 == index) {
+    idlib_latch_wait(&context->set);
+    if (idlib_process_relinquish(context->process) || idlib_process_acquire(&context->process) ||
+        idlib_tls_allocate(context->process, NULL, &context->slot)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+    }
+    idlib_latch_count_down(&context->recreated, 1);
+  } else if (1 == index) {
+    if (idlib_tls_set(context->process, context->slot, &context->values[index])) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+    }
+    idlib_latch_count_down(&context->set, 1);
+    idlib_latch_wait(&context->recreated);
+    if (!context->status &&
+        (idlib_tls_get(context->process, context->slot, &value) || NULL != value ||
+         idlib_tls_set(context->process, context->slot, &context->values[index]) ||
+         idlib_tls_get(context->process, context->slot, &value) || &context->values[index] != value)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+}
+
+// The values of a slot are per thread and are destroyed when the threads terminate.
+// A slot which was freed and allocated again is null.
+// A thread which used the slots of a destroyed singleton uses the slots of the next singleton.
+static int
+test11
+  (
+  )
+{
+  static tls_context context;
+  uint64_t elapsed;
+  void* value;
+  context.destroyed = 0;
+  context.status = IDLIB_SUCCESS;
+  g_tls_context = &context;
+  if (idlib_process_acquire(&context.process)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_tls_allocate(context.process, &tls_destructor, &context.slot) ||
+      idlib_tls_set(context.process, context.slot, &context) ||
+      harness_run(NUMBER_OF_THREADS, &tls_procedure, &context, &elapsed) || context.status ||
+      NUMBER_OF_THREADS != context.destroyed ||
+      idlib_tls_get(context.process, context.slot, &value) || &context != value ||
+      idlib_tls_free(context.process, context.slot) ||
+      IDLIB_NOT_EXISTS != idlib_tls_free(context.process, context.slot) ||
+      idlib_tls_allocate(context.process, NULL, &context.slot) ||
+      idlib_tls_get(context.process, context.slot, &value) || NULL != value ||
+      idlib_tls_free(context.process, context.slot)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(context.process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_process_relinquish(context.process);
+  if (idlib_latch_initialize(&context.set, 1) || idlib_latch_initialize(&context.recreated, 1) ||
+      idlib_process_acquire(&context.process)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_tls_allocate(context.process, NULL, &context.slot) ||
+      harness_run(2, &tls_recreate_procedure, &context, &elapsed) || context.status ||
+      idlib_tls_free(context.process, context.slot)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(context.process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_process_relinquish(context.process);
+  idlib_latch_uninitialize(&context.recreated);
+  idlib_latch_uninitialize(&context.set);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct combining_context {
+  idlib_combining_lock lock;
+  // Guarded by the lock.
+  size_t counter;
+  idlib_status status;
+} combining_context;
+
+static void
+combining_increment
+  (
+    void* argument
+  )
+{
+  combining_context* context = (combining_context*)argument;
+  context->counter++;
+}
+
+static void
+combining_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  combining_context* context = (combining_context*)argument;
+  for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+    if (idlib_combining_lock_apply(&context->lock, &combining_increment, context)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+  }
+}
+
+// The operations applied under a combining lock are executed one at a time and none is lost.
+static int
+test12
+  (
+  )
+{
+  static combining_context context;
+  uint64_t elapsed;
+  context.counter = 0;
+  context.status = IDLIB_SUCCESS;
+  if (idlib_combining_lock_initialize(&context.lock)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (harness_run(NUMBER_OF_THREADS, &combining_procedure, &context, &elapsed) || context.status ||
+      NUMBER_OF_THREADS * NUMBER_OF_ITERATIONS != context.counter) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_combining_lock_uninitialize(&context.lock);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_combining_lock_uninitialize(&context.lock);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+typedef struct watch_context {
+  idlib_process* process;
+  // The value of the global "watch.<i>" is values + i.
+  size_t values[NUMBER_OF_THREADS];
+  // Incremented by the watcher.
+  uint32_t volatile added;
+  uint32_t volatile removed;
+  // Incremented by the watcher which unwatches itself.
+  uint32_t volatile once;
+  idlib_status status;
+} watch_context;
+
+static void
+watch_watcher
+  (
+    void* argument,
+    idlib_global_event event,
+    void const* p,
+    size_t n,
+    void* v
+  )
+{
+  watch_context* context = (watch_context*)argument;
+  if (7 != n || memcmp(p, "watch.1", 7) || &context->values[1] != v) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  } else if (IDLIB_GLOBAL_ADDED == event) {
+    idlib_atomic_fetch_add_u32(&context->added, 1);
+  } else {
+    idlib_atomic_fetch_add_u32(&context->removed, 1);
+  }
+}
+
+// A watcher which unwatches itself when it is notified.
+static void
+watch_once_watcher
+  (
+    void* argument,
+    idlib_global_event event,
+    void const* p,
+    size_t n,
+    void* v
+  )
+{
+  watch_context* context = (watch_context*)argument;
+  idlib_atomic_fetch_add_u32(&context->once, 1);
+  if (idlib_unwatch_global(context->process, p, n, &watch_once_watcher, context)) {
+    context->status = IDLIB_ENVIRONMENT_FAILED;
+  }
+}
+
+static void
+watch_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  watch_context* context = (watch_context*)argument;
+  // "watch.", at most 20 digits of a size_t, and the zero terminator.
+  char name[27];
+  void* v;
+  if (0 == index) {
+    // The publisher adds the globals the other threads wait for.
+    for (size_t i = 1; i < NUMBER_OF_THREADS; ++i) {
+      snprintf(name, sizeof(name), "watch.%zu", i);
+      if (idlib_add_global(context->process, name, strlen(name), &context->values[i])) {
+        context->status = IDLIB_ENVIRONMENT_FAILED;
+        return;
+      }
+    }
+  } else {
+    snprintf(name, sizeof(name), "watch.%zu", index);
+    if (idlib_wait_global(context->process, name, strlen(name), idlib_clock_now() + UINT64_C(10000000000), &v) ||
+        &context->values[index] != v) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+    }
+  }
+}
+
+// Threads waiting for globals are woken when the globals are added.
+// A watcher is notified of the additions and removals of the global of its key only.
+// A watcher may unwatch itself when it is notified.
+static int
+test13
+  (
+  )
+{
+  static watch_context context;
+  uint64_t elapsed;
+  size_t number_of_removed;
+  void* v;
+  context.added = 0;
+  context.removed = 0;
+  context.once = 0;
+  context.status = IDLIB_SUCCESS;
+  if (idlib_process_acquire(&context.process)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_watch_global(context.process, "watch.1", 7, &watch_watcher, &context) ||
+      IDLIB_TIMED_OUT != idlib_wait_global(context.process, "watch.0", 7, idlib_clock_now() + UINT64_C(1000000), &v) ||
+      harness_run(NUMBER_OF_THREADS, &watch_procedure, &context, &elapsed) || context.status ||
+      1 != context.added || 0 != context.removed ||
+      idlib_wait_global(context.process, "watch.2", 7, 0, &v) || &context.values[2] != v ||
+      idlib_remove_global(context.process, "watch.1", 7) || 1 != context.removed ||
+      idlib_unwatch_global(context.process, "watch.1", 7, &watch_watcher, &context) ||
+      IDLIB_NOT_EXISTS != idlib_unwatch_global(context.process, "watch.1", 7, &watch_watcher, &context) ||
+      idlib_add_global(context.process, "watch.1", 7, &context.values[1]) || 1 != context.added ||
+      idlib_remove_globals_with_prefix(context.process, "watch.", 6, &number_of_removed) ||
+      NUMBER_OF_THREADS - 1 != number_of_removed || 1 != context.removed || context.status ||
+      idlib_watch_global(context.process, "watch.3", 7, &watch_once_watcher, &context) ||
+      idlib_add_global(context.process, "watch.3", 7, &context.values[3]) || 1 != context.once ||
+      idlib_remove_global(context.process, "watch.3", 7) || 1 != context.once || context.status ||
+      IDLIB_NOT_EXISTS != idlib_unwatch_global(context.process, "watch.3", 7, &watch_once_watcher, &context)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(context.process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_process_relinquish(context.process);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+#define NUMBER_OF_ACCOUNTS (64)
+
+typedef struct lock_table_context {
+  idlib_lock_table* table;
+  // Each account is guarded by the lock of its address.
+  size_t accounts[NUMBER_OF_ACCOUNTS];
+  // Incremented together.
+  size_t pair[2];
+  // The number of times a reader observed different values of the pair.
+  uint32_t volatile inconsistencies;
+  idlib_status status;
+} lock_table_context;
+
+static void
+lock_table_procedure
+  (
+    void* argument,
+    size_t index
+  )
+{
+  lock_table_context* context = (lock_table_context*)argument;
+  for (size_t i = 0; i < NUMBER_OF_ITERATIONS; ++i) {
+    size_t* from = &context->accounts[(index + i) % NUMBER_OF_ACCOUNTS];
+    size_t* to = &context->accounts[(index * 7 + i * 3 + 1) % NUMBER_OF_ACCOUNTS];
+    // The threads lock the accounts in different orders.
+    void const* addresses[] = { index % 2 ? from : to, index % 2 ? to : from };
+    if (idlib_lock_table_lock_many(context->table, addresses, 2, IDLIB_LOCK_MODE_EXCLUSIVE)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+    if (*from > 0) {
+      (*from)--;
+      (*to)++;
+    }
+    idlib_lock_table_unlock_many(context->table, addresses, 2, IDLIB_LOCK_MODE_EXCLUSIVE);
+    // The pair is only modified under the exclusive locks of both, hence readers holding the shared locks observe equal values.
+    void const* pair[] = { &context->pair[0], &context->pair[1] };
+    idlib_lock_mode mode = i % 4 ? IDLIB_LOCK_MODE_SHARED : IDLIB_LOCK_MODE_EXCLUSIVE;
+    if (idlib_lock_table_lock_many(context->table, pair, 2, mode)) {
+      context->status = IDLIB_ENVIRONMENT_FAILED;
+      return;
+    }
+    if (IDLIB_LOCK_MODE_EXCLUSIVE == mode) {
+      context->pair[0]++;
+      context->pair[1]++;
+    } else if (context->pair[0] != context->pair[1]) {
+      idlib_atomic_fetch_add_u32(&context->inconsistencies, 1);
+    }
+    idlib_lock_table_unlock_many(context->table, pair, 2, mode);
+  }
+}
+
+// Transfers between accounts guarded by a lock table lose no units and do not deadlock.
+// Readers holding the shared locks of a pair observe the updates of writers holding the exclusive locks atomically.
+static int
+test14
+  (
+  )
+{
+  static lock_table_context context;
+  idlib_process* process = NULL;
+  idlib_lock_table* other = NULL;
+  uint64_t elapsed;
+  for (size_t i = 0; i < NUMBER_OF_ACCOUNTS; ++i) {
+    context.accounts[i] = NUMBER_OF_ITERATIONS * NUMBER_OF_THREADS;
+  }
+  context.pair[0] = 0;
+  context.pair[1] = 0;
+  context.inconsistencies = 0;
+  context.status = IDLIB_SUCCESS;
+  if (idlib_process_acquire(&process)) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  if (idlib_process_get_lock_table(process, &context.table) || idlib_process_get_lock_table(process, &other) ||
+      context.table != other ||
+      IDLIB_ARGUMENT_INVALID != idlib_lock_table_lock(context.table, &context, 0) ||
+      idlib_lock_table_lock(context.table, &context, IDLIB_LOCK_MODE_SHARED) ||
+      idlib_lock_table_lock(context.table, &context, IDLIB_LOCK_MODE_SHARED) ||
+      idlib_lock_table_unlock(context.table, &context, IDLIB_LOCK_MODE_SHARED) ||
+      idlib_lock_table_unlock(context.table, &context, IDLIB_LOCK_MODE_SHARED) ||
+      harness_run(NUMBER_OF_THREADS, &lock_table_procedure, &context, &elapsed) || context.status ||
+      0 != context.inconsistencies || NUMBER_OF_THREADS * NUMBER_OF_ITERATIONS / 4 != context.pair[0]) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  size_t sum = 0;
+  for (size_t i = 0; i < NUMBER_OF_ACCOUNTS; ++i) {
+    sum += context.accounts[i];
+  }
+  if (NUMBER_OF_ACCOUNTS * NUMBER_OF_ITERATIONS * NUMBER_OF_THREADS != sum) {
+    fprintf(stderr, "%s:%d: test failed\n", __FILE__, __LINE__);
+    idlib_process_relinquish(process);
+    return IDLIB_ENVIRONMENT_FAILED;
+  }
+  idlib_process_relinquish(process);
+  fprintf(stderr, "%s:%d: test success\n", __FILE__, __LINE__);
+  return IDLIB_SUCCESS;
+}
+
+int
+main
+  (
+    int argc,
+    char** argv
+  )
+{
+  if (test1()) {
+    return EXIT_FAILURE;
+  }
+  if (test2()) {
+    return EXIT_FAILURE;
+  }
+  if (test3()) {
+    return EXIT_FAILURE;
+  }
+  if (test4()) {
+    return EXIT_FAILURE;
+  }
+  if (test5()) {
+    return EXIT_FAILURE;
+  }
+  if (test6()) {
+    return EXIT_FAILURE;
+  }
+  if (test7()) {
+    return EXIT_FAILURE;
+  }
+  if (test8()) {
+    return EXIT_FAILURE;
+  }
+  if (test9()) {
+    return EXIT_FAILURE;
+  }
+  if (test10()) {
+    return EXIT_FAILURE;
+  }
+  if (test11()) {
+    return EXIT_FAILURE;
+  }
+  if (test12()) {
+    return EXIT_FAILURE;
+  }
+  if (test13()) {
+    return EXIT_FAILURE;
+  }
+  if (test14()) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+/*
+  IdLib Process
+  Copyright (C) 2018-2024 Michael Heilmann. All rights reserved.
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "idlib/process.h"
+
+// EXIT_SUCCESS, EXIT_FAILURE, malloc, realloc, free
+#include <stdlib.h>
+
+// fopen, fread, fprintf, fclose
+#include <stdio.h>
+
+// memcmp
+#include <string.h>
+
+// Convert a trace file written by idlib_trace_save into the Chrome trace event format (JSON).
+// The result can be viewed by Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+//
+// Usage: idlib-process.tools.trace-to-json <input file> <output file>
+//
+// Lock events are paired per thread and object:
+// LOCK_ACQUIRE_START/LOCK_ACQUIRED become a "wait" slice and LOCK_ACQUIRED/LOCK_RELEASED become a "hold" slice.
+// All other events become instant events.
+
+#define SPAN_WAIT (0)
+#define SPAN_HOLD (1)
+
+typedef struct span {
+  uint64_t object;
+  int kind;
+  uint64_t timestamp;
+} span;
+
+typedef struct spans {
+  span* elements;
+  size_t size;
+  size_t capacity;
+} spans;
+
+typedef struct converter {
+  FILE* output;
+  double ticks_per_microsecond;
+  uint64_t base_timestamp;
+  uint64_t thread_id;
+  // Non-zero if at least one event was written.
+  int written;
+} converter;
+
+static int
+spans_push
+  (
+    spans* spans,
+    uint64_t object,
+    int kind,
+    uint64_t timestamp
+  )
+{
+  if (spans->size == spans->capacity) {
+    size_t new_capacity = spans->capacity ? spans->capacity * 2 : 16;
+    span* new_elements = realloc(spans->elements, sizeof(span) * new_capacity);
+    if (!new_elements) {
+      return 0;
+    }
+    spans->elements = new_elements;
+    spans->capacity = new_capacity;
+  }
+  spans->elements[spans->size].object = object;
+  spans->elements[spans->size].kind = kind;
+  spans->elements[spans->size].timestamp = timestamp;
+  spans->size++;
+  return 1;
+}
+
+// Remove the most recently pushed span of the specified object and kind.
+// Return 1 and assign its time stamp to *timestamp if such a span exists, return 0 otherwise.
+static int
+spans_pop
+  (
+    spans* spans,
+    uint64_t object,
+    int kind,
+    uint64_t* timestamp
+  )
+{
+  for (size_t i = spans->size; i > 0; --i) {
+    span* s = &spans->elements[i - 1];
+    if (s->object == object && s->kind == kind) {
+      *timestamp = s->timestamp;
+      memmove(s, s + 1, sizeof(span) * (spans->size - i));
+      spans->size--;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static double
+to_microseconds
+  (
+    converter const* converter,
+    uint64_t timestamp
+  )
+{
+  return (double)(int64_t)(timestamp - converter->base_timestamp) / converter->ticks_per_microsecond;
+}
+
+static void
+write_slice
+  (
+    converter* converter,
+    char const* name,
+    uint64_t object,
+    uint64_t start,
+    uint64_t end
+  )
+{
+  double ts = to_microseconds(converter, start);
+  double dur = to_microseconds(converter, end) - ts;
+  fprintf(converter->output, "%s\n    { \"name\": \"%s 0x%llx\", \"cat\": \"lock\", \"ph\": \"X\", \"pid\": 1, \"tid\": %llu, \"ts\": %.3f, \"dur\": %.3f }",
+          converter->written ? "," : "", name, (unsigned long long)object, (unsigned long long)converter->thread_id, ts, dur);
+  converter->written = 1;
+}
+
+static void
+write_instant
+  (
+    converter* converter,
+    char const* name,
+    char const* category,
+    uint64_t object,
+    uint64_t timestamp
+  )
+{
+  fprintf(converter->output, "%s\n    { \"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %llu, \"ts\": %.3f, \"args\": { \"object\": \"0x%llx\" } }",
+          converter->written ? "," : "", name, category, (unsigned long long)converter->thread_id,
+          to_microseconds(converter, timestamp), (unsigned long long)object);
+  converter->written = 1;
+}
+
+static int
+convert_ring
+  (
+    converter* converter,
+    idlib_trace_event const* events,
+    size_t number_of_events
+  )
+{
+  spans spans = { .elements = NULL, .size = 0, .capacity = 0 };
+  int result = 1;
+  for (size_t i = 0; i < number_of_events && result; ++i) {
+    idlib_trace_event const* event = &events[i];
+    uint64_t object = IDLIB_TRACE_EVENT_OBJECT(event);
+    uint64_t start;
+    switch (IDLIB_TRACE_EVENT_TYPE(event)) {
+      case IDLIB_TRACE_EVENT_LOCK_ACQUIRE_START: {
+        result = spans_push(&spans, object, SPAN_WAIT, event->timestamp);
+      } break;
+      case IDLIB_TRACE_EVENT_LOCK_ACQUIRED: {
+        if (spans_pop(&spans, object, SPAN_WAIT, &start)) {
+          write_slice(converter, "wait", object, start, event->timestamp);
+        }
+        result = spans_push(&spans, object, SPAN_HOLD, event->timestamp);
+      } break;
+      case IDLIB_TRACE_EVENT_LOCK_RELEASED: {
+        if (spans_pop(&spans, object, SPAN_HOLD, &start)) {
+          write_slice(converter, "hold", object, start, event->timestamp);
+        } else {
+          // The acquisition was overwritten in the ring buffer.
+          write_instant(converter, "release", "lock", object, event->timestamp);
+        }
+      } break;
+      case IDLIB_TRACE_EVENT_REGISTRY_ADD: {
+        write_instant(converter, "registry add", "registry", object, event->timestamp);
+      } break;
+      case IDLIB_TRACE_EVENT_REGISTRY_REMOVE: {
+        write_instant(converter, "registry remove", "registry", object, event->timestamp);
+      } break;
+      case IDLIB_TRACE_EVENT_SINGLETON_CREATE: {
+        write_instant(converter, "singleton create", "singleton", object, event->timestamp);
+      } break;
+      case IDLIB_TRACE_EVENT_SINGLETON_DESTROY: {
+        write_instant(converter, "singleton destroy", "singleton", object, event->timestamp);
+      } break;
+      default: {
+        write_instant(converter, "unknown", "unknown", object, event->timestamp);
+      } break;
+    };
+  }
+  free(spans.elements);
+  return result;
+}
+
+int
+main
+  (
+    int argc,
+    char** argv
+  )
+{
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <input file> <output file>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  FILE* input = fopen(argv[1], "rb");
+  if (!input) {
+    fprintf(stderr, "%s:%d: unable to open `%s`\n", __FILE__, __LINE__, argv[1]);
+    return EXIT_FAILURE;
+  }
+  idlib_trace_file_header header;
+  if (1 != fread(&header, sizeof(header), 1, input) ||
+      memcmp(header.magic, IDLIB_TRACE_FILE_MAGIC, sizeof(header.magic)) ||
+      IDLIB_TRACE_FILE_VERSION != header.version ||
+      !(header.ticks_per_nanosecond > 0.0)) {
+    fprintf(stderr, "%s:%d: `%s` is not a trace file of version %d\n", __FILE__, __LINE__, argv[1], IDLIB_TRACE_FILE_VERSION);
+    fclose(input);
+    return EXIT_FAILURE;
+  }
+  FILE* output = fopen(argv[2], "w");
+  if (!output) {
+    fprintf(stderr, "%s:%d: unable to open `%s`\n", __FILE__, __LINE__, argv[2]);
+    fclose(input);
+    return EXIT_FAILURE;
+  }
+  idlib_trace_event* events = malloc(sizeof(idlib_trace_event) * IDLIB_TRACE_RING_CAPACITY);
+  if (!events) {
+    fclose(output);
+    fclose(input);
+    return EXIT_FAILURE;
+  }
+  converter converter = {
+    .output = output,
+    .ticks_per_microsecond = header.ticks_per_nanosecond * 1000.0,
+    .base_timestamp = header.base_timestamp,
+    .thread_id = 0,
+    .written = 0,
+  };
+  fprintf(output, "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [");
+  int result = 1;
+  for (uint32_t i = 0; i < header.number_of_rings && result; ++i) {
+    idlib_trace_file_ring ring;
+    if (1 != fread(&ring, sizeof(ring), 1, input) || ring.number_of_events > IDLIB_TRACE_RING_CAPACITY) {
+      result = 0;
+      break;
+    }
+    if (ring.number_of_events != fread(events, sizeof(idlib_trace_event), (size_t)ring.number_of_events, input)) {
+      result = 0;
+      break;
+    }
+    converter.thread_id = ring.thread_id;
+    result = convert_ring(&converter, events, (size_t)ring.number_of_events);
+  }
+  fprintf(output, "\n  ]\n}\n");
+  free(events);
+  fclose(output);
+  fclose(input);
+  if (!result) {
+    fprintf(stderr, "%s:%d: unable to convert `%s`\n", __FILE__, __LINE__, argv[1]);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}